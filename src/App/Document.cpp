@@ -68,9 +68,19 @@ recompute path. Also enables more complicated dependencies beyond trees.
 #include <boost/regex.hpp>
 #include <unordered_set>
 #include <unordered_map>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <set>
 
 #include <QCoreApplication>
 #include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "Document.h"
 #include "Application.h"
@@ -78,7 +88,7 @@ recompute path. Also enables more complicated dependencies beyond trees.
 #include "MergeDocuments.h"
 //#include <App/DocumentPy.h>
 
-//#include <Base/Console.h>
+#include <Base/Console.h>
 #include <Base/Exception.h>
 #include <Base/FileInfo.h>
 #include <Base/TimeInfo.h>
@@ -133,6 +143,252 @@ typedef Traits::edge_descriptor Edge;
 PROPERTY_SOURCE(App::Document, ::App::PropertyContainer)
 namespace App {
 
+/** Shared state of a parallel recompute
+ * The worker threads report finished objects and the property changes
+ * they have made. Both are handed over to the thread running the recompute
+ * which emits the signals and schedules the dependent objects.
+ */
+struct RecomputeScheduler
+{
+    QThread* mainThread;
+    QMutex mutex;
+    QWaitCondition finished;
+    std::vector<std::size_t> done;
+    std::vector<std::pair<const DocumentObject*, const Property*> > changes;
+
+    RecomputeScheduler() : mainThread(QThread::currentThread()) {}
+};
+
+/** Incrementally maintained adjacency of the document objects
+ * The OutList of every object and the resulting back links are cached. When a
+ * link property changes the object is only marked and its OutList is read again
+ * on the next access, so a link change costs O(degree) instead of a rebuild of
+ * the whole graph. Links to objects which are currently not part of the document
+ * (e.g. kept by the undo stack) are remembered to restore the back links once the
+ * object is added again.
+ */
+class DependencyCache
+{
+public:
+    struct Node
+    {
+        Node() : member(false), touched(false), order(0) {}
+        bool member;
+        bool touched;
+        /// position of the object in the order it was added to the document
+        std::size_t order;
+        std::vector<DocumentObject*> outList;
+        std::vector<DocumentObject*> inList;
+    };
+
+    DependencyCache() : nextOrder(0) {}
+
+    void addObject(DocumentObject* obj)
+    {
+        Node& node = nodes[obj];
+        node.member = true;
+        node.order = nextOrder++;
+        changedLinks.insert(obj);
+    }
+    void removeObject(DocumentObject* obj)
+    {
+        changedLinks.erase(obj);
+        auto it = nodes.find(obj);
+        if (it == nodes.end())
+            return;
+        if (it->second.touched) {
+            it->second.touched = false;
+            touched.erase(std::remove(touched.begin(), touched.end(), obj), touched.end());
+        }
+        clearOutList(obj, it->second);
+        it->second.member = false;
+        if (it->second.inList.empty())
+            nodes.erase(obj);
+    }
+    void touchLinks(const DocumentObject* obj)
+    {
+        auto it = nodes.find(obj);
+        if (it != nodes.end() && it->second.member)
+            changedLinks.insert(obj);
+    }
+    /// remember an object that may have to be recomputed
+    void touchObject(DocumentObject* obj)
+    {
+        auto it = nodes.find(obj);
+        if (it != nodes.end() && it->second.member && !it->second.touched) {
+            it->second.touched = true;
+            touched.push_back(obj);
+        }
+    }
+    void touchObjects(const std::vector<DocumentObject*>& objs)
+    {
+        for (auto obj : objs)
+            touchObject(obj);
+    }
+    /** Return the objects touched since the last call and forget them. They are
+     * sorted in the order of the document, so the recompute order doesn't depend
+     * on the addresses of the objects.
+     */
+    std::vector<DocumentObject*> takeTouched()
+    {
+        std::vector<DocumentObject*> objs;
+        objs.swap(touched);
+        for (auto obj : objs)
+            nodes[obj].touched = false;
+        std::sort(objs.begin(), objs.end(), [this](DocumentObject* a, DocumentObject* b) {
+            return nodes[a].order < nodes[b].order;
+        });
+        return objs;
+    }
+    /// forget all remembered objects which are not touched any more
+    void purgeTouched()
+    {
+        std::vector<DocumentObject*> objs;
+        for (auto obj : touched) {
+            if (obj->isTouched())
+                objs.push_back(obj);
+            else
+                nodes[obj].touched = false;
+        }
+        touched.swap(objs);
+    }
+    void clear()
+    {
+        nodes.clear();
+        changedLinks.clear();
+        touched.clear();
+        nextOrder = 0;
+    }
+    /// re-read the OutList of all objects whose links have changed
+    void update()
+    {
+        for (auto obj : changedLinks)
+            refresh(obj);
+        changedLinks.clear();
+    }
+    /** Get the given objects and all objects depending directly or indirectly on them
+     * in the order they must be recomputed, i.e. every object comes after the objects
+     * of its OutList. The cost is proportional to the number of returned objects.
+     * @return false if there is a cyclic dependency.
+     */
+    bool getDependentObjects(const std::vector<DocumentObject*>& objs, std::vector<DocumentObject*>& result) const
+    {
+        // collect the InList cone, the value counts the unprocessed dependencies inside the cone
+        std::unordered_map<const DocumentObject*, std::size_t> count;
+        std::vector<DocumentObject*> cone;
+        for (auto obj : objs) {
+            if (count.insert(std::make_pair(obj, 0)).second)
+                cone.push_back(obj);
+        }
+        for (std::size_t i = 0; i < cone.size(); ++i) {
+            const Node* node = getNode(cone[i]);
+            if (!node)
+                continue;
+            for (auto in : node->inList) {
+                if (count.insert(std::make_pair(in, 0)).second)
+                    cone.push_back(in);
+            }
+        }
+
+        std::deque<DocumentObject*> queue;
+        for (auto obj : cone) {
+            const Node* node = getNode(obj);
+            std::size_t& num = count[obj];
+            if (node) {
+                for (auto dep : node->outList) {
+                    if (count.find(dep) != count.end())
+                        num++;
+                }
+            }
+            if (num == 0)
+                queue.push_back(obj);
+        }
+
+        result.clear();
+        result.reserve(cone.size());
+        while (!queue.empty()) {
+            DocumentObject* obj = queue.front();
+            queue.pop_front();
+            result.push_back(obj);
+
+            const Node* node = getNode(obj);
+            if (!node)
+                continue;
+            for (auto in : node->inList) {
+                if (--count[in] == 0)
+                    queue.push_back(in);
+            }
+        }
+
+        return result.size() == cone.size();
+    }
+    const Node* getNode(const DocumentObject* obj) const
+    {
+        auto it = nodes.find(obj);
+        return it != nodes.end() ? &it->second : 0;
+    }
+
+private:
+    void refresh(const DocumentObject* obj)
+    {
+        auto it = nodes.find(obj);
+        if (it == nodes.end() || !it->second.member)
+            return;
+        Node& node = it->second;
+        DocumentObject* src = const_cast<DocumentObject*>(obj);
+        clearOutList(src, node);
+
+        // keep the order of getOutList() to get a reproducible sort
+        std::unordered_set<DocumentObject*> seen;
+        for (auto dep : obj->getOutList()) {
+            if (seen.insert(dep).second) {
+                node.outList.push_back(dep);
+                nodes[dep].inList.push_back(src);
+            }
+        }
+    }
+    void clearOutList(DocumentObject* obj, Node& node)
+    {
+        for (auto dep : node.outList) {
+            auto it = nodes.find(dep);
+            if (it == nodes.end())
+                continue;
+            std::vector<DocumentObject*>& in = it->second.inList;
+            in.erase(std::remove(in.begin(), in.end(), obj), in.end());
+            if (!it->second.member && in.empty() && dep != obj)
+                nodes.erase(it);
+        }
+        node.outList.clear();
+    }
+
+private:
+    std::unordered_map<const DocumentObject*, Node> nodes;
+    std::unordered_set<const DocumentObject*> changedLinks;
+    std::vector<DocumentObject*> touched;
+    std::size_t nextOrder;
+};
+
+class RecomputeTask : public QRunnable
+{
+public:
+    RecomputeTask(RecomputeScheduler& s, std::size_t i, std::function<void()> f)
+        : scheduler(s), index(i), func(f)
+    {
+    }
+    void run()
+    {
+        func();
+        QMutexLocker lock(&scheduler.mutex);
+        scheduler.done.push_back(index);
+        scheduler.finished.wakeAll();
+    }
+
+private:
+    RecomputeScheduler& scheduler;
+    std::size_t index;
+    std::function<void()> func;
+};
+
 bool Document::testStatus(Status pos) const
 {
     return d->StatusBits.test((size_t)pos);
@@ -901,6 +1157,18 @@ void Document::commitTransaction()
             delete mUndoTransactions.front();
             mUndoTransactions.pop_front();
         }
+        // drop the oldest steps while the undo stack exceeds the memory limit but always keep
+        // the last one, only the undo stack is trimmed so only its size is compared to the limit
+        if (d->UndoMemSize > 0) {
+            std::size_t size = 0;
+            for (std::list<Transaction*>::const_iterator it = mUndoTransactions.begin(); it != mUndoTransactions.end(); ++it)
+                size += (*it)->getMemSize();
+            while (size > d->UndoMemSize && mUndoTransactions.size() > 1) {
+                size -= mUndoTransactions.front()->getMemSize();
+                delete mUndoTransactions.front();
+                mUndoTransactions.pop_front();
+            }
+        }
     }
 }
 
@@ -975,16 +1243,29 @@ int Document::getUndoMode(void) const
     return d->iUndoMode;
 }
 
-unsigned int Document::getUndoMemSize (void) const
+std::size_t Document::getUndoMemSize (void) const
 {
-    return d->UndoMemSize;
+    std::size_t size = 0;
+    std::list<Transaction*>::const_iterator it;
+    for (it = mUndoTransactions.begin(); it != mUndoTransactions.end(); ++it)
+        size += (*it)->getMemSize();
+    for (it = mRedoTransactions.begin(); it != mRedoTransactions.end(); ++it)
+        size += (*it)->getMemSize();
+    if (d->activeUndoTransaction)
+        size += d->activeUndoTransaction->getMemSize();
+    return size;
 }
 
-void Document::setUndoLimit(unsigned int UndoMemSize)
+void Document::setUndoLimit(std::size_t UndoMemSize)
 {
     d->UndoMemSize = UndoMemSize;
 }
 
+std::size_t Document::getUndoLimit(void) const
+{
+    return d->UndoMemSize;
+}
+
 void Document::setMaxUndoStackSize(unsigned int UndoMaxStackSize)
 {
      d->UndoMaxStackSize = UndoMaxStackSize;
@@ -1037,12 +1318,50 @@ void Document::onChanged(const Property* prop)
 
 void Document::onBeforeChangeProperty(const TransactionalObject *Who, const Property *What)
 {
-    if (d->activeUndoTransaction && !d->rollback)
-        d->activeUndoTransaction->addObjectChange(Who,What);
+    if (d->activeUndoTransaction && !d->rollback) {
+        if (d->recomputeScheduler) {
+            QMutexLocker lock(&d->recomputeScheduler->mutex);
+            d->activeUndoTransaction->addObjectChange(Who,What);
+        }
+        else {
+            d->activeUndoTransaction->addObjectChange(Who,What);
+        }
+    }
+}
+
+void Document::onTouchedObject(DocumentObject *Who)
+{
+    std::unique_ptr<QMutexLocker> lock;
+    if (d->recomputeScheduler)
+        lock.reset(new QMutexLocker(&d->recomputeScheduler->mutex));
+    d->dependencyCache->touchObject(Who);
 }
 
 void Document::onChangedProperty(const DocumentObject *Who, const Property *What)
 {
+    // observers are not thread-safe, so changes made in a worker thread
+    // are delivered by the thread running the recompute
+    RecomputeScheduler* scheduler = d->recomputeScheduler;
+    if (scheduler && QThread::currentThread() != scheduler->mainThread) {
+        QMutexLocker lock(&scheduler->mutex);
+        scheduler->changes.push_back(std::make_pair(Who, What));
+        return;
+    }
+
+    bool linkChanged = (What == &Who->ExpressionEngine ||
+        What->isDerivedFrom(PropertyLink::getClassTypeId()) ||
+        What->isDerivedFrom(PropertyLinkSub::getClassTypeId()) ||
+        What->isDerivedFrom(PropertyLinkList::getClassTypeId()) ||
+        What->isDerivedFrom(PropertyLinkSubList::getClassTypeId()));
+    {
+        std::unique_ptr<QMutexLocker> lock;
+        if (scheduler)
+            lock.reset(new QMutexLocker(&scheduler->mutex));
+        if (linkChanged)
+            d->dependencyCache->touchLinks(Who);
+        d->dependencyCache->touchObject(const_cast<DocumentObject*>(Who));
+    }
+
     signalChangedObject(*Who, *What);
 }
 
@@ -1064,6 +1383,7 @@ Document::Document(void)
     // have to care about ref counting any more.
     //DocumentPythonObject = Py::Object(new DocumentPy(this), true);
     d = new DocumentP;
+    d->dependencyCache = new DependencyCache;
 
 #ifdef FC_LOGUPDATECHAIN
     Console().Log("+App::Document: %p\n",this);
@@ -1153,6 +1473,10 @@ Document::Document(void)
     ADD_PROPERTY_TYPE(TipName,(""),0,PropertyType(Prop_Hidden|Prop_ReadOnly),
         "Link of the tip object of the document");
     Uid.touch();
+
+    // schedule independent objects onto the thread pool when recomputing
+    setStatus(Status::ParallelRecompute, ::App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Document")->GetBool("ParallelRecompute",false));
 }
 
 Document::~Document()
@@ -1191,6 +1515,8 @@ Document::~Document()
     catch (const ::Base::Exception& e) {
         std::cerr << "Removing transient directory failed: " << e.what() << std::endl;
     }
+    delete d->dependencyCache;
+    delete d->deferredFiles;
     delete d;
 }
 
@@ -1316,6 +1642,7 @@ void Document::Restore(::Base::XMLReader &reader)
 void Document::exportObjects(const std::vector<::App::DocumentObject*>& obj,
                              std::ostream& out)
 {
+    _restoreDeferredFiles(obj);
     ::Base::ZipWriter writer(out);
     writer.putNextEntry("Document.xml");
     writer.Stream() << "<?xml version='1.0' encoding='utf-8'?>" << endl;
@@ -1491,7 +1818,7 @@ unsigned int Document::getMemSize (void) const
     size += PropertyContainer::getMemSize();
 
     // Undo Redo size
-    size += getUndoMemSize();
+    size += static_cast<unsigned int>(getUndoMemSize());
 
     return size;
 }
@@ -1532,8 +1859,17 @@ bool Document::save (void)
     int compression = ::App::GetApplication().GetParameterGroupByPath
         ("User parameter:BaseApp/Preferences/Document")->GetInt("CompressionLevel",3);
     compression = ::Base::clamp<int>(compression, Z_NO_COMPRESSION, Z_BEST_COMPRESSION);
+    // number of threads to write the data files, 0 means all cores
+    int saveThreads = ::App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Document")->GetInt("SaveThreadCount",1);
+    // write Document.xml in the compact binary encoding instead of XML text
+    bool binaryDocument = ::App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Document")->GetBool("SaveBinaryDocument",false);
 
     if (*(FileName.getValue()) != '\0') {
+        // the file will be replaced, so everything must be read from it first
+        restoreDeferredFiles();
+
         // Save the name of the tip object in order to handle in Restore()
         if(Tip.getValue()) {
             TipName.setValue(Tip.getValue()->getNameInDocument());
@@ -1564,6 +1900,9 @@ bool Document::save (void)
 
             writer.setComment("FreeCAD Document");
             writer.setLevel(compression);
+            writer.setThreadCount(saveThreads);
+            if (binaryDocument)
+                writer.setMode("BinaryDocument");
             writer.putNextEntry("Document.xml");
 
             Document::Save(writer);
@@ -1663,7 +2002,10 @@ void Document::restore (void)
     }
     d->objectArray.clear();
     d->objectMap.clear();
+    d->dependencyCache->clear();
     d->activeObject = 0;
+    delete d->deferredFiles;
+    d->deferredFiles = 0;
 
     ::Base::FileInfo fi(FileName.getValue());
     ::Base::ifstream file(fi, std::ios::in | std::ios::binary);
@@ -1694,6 +2036,31 @@ void Document::restore (void)
     // Note: This file doesn't need to be available if the document has been created
     // without GUI. But if available then follow after all data files of the App document.
     signalRestoreDocument(reader);
+
+    // with lazy loading the big data files are read when they are accessed first
+    bool lazy = ::App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Document")->GetBool("LazyLoading",false);
+    if (lazy) {
+        std::set<const ::Base::Persistence*> props;
+        for (std::vector<DocumentObject*>::iterator obj = d->objectArray.begin(); obj != d->objectArray.end(); ++obj) {
+            std::vector<Property*> list;
+            (*obj)->getPropertyList(list);
+            for (std::vector<Property*>::iterator it = list.begin(); it != list.end(); ++it) {
+                if ((*it)->canRestoreDeferred() && reader.isRegistered(*it))
+                    props.insert(*it);
+            }
+        }
+
+        d->deferredFiles = new ::Base::DeferredFileReader(FileName.getValue(), reader.FileVersion);
+        if (!props.empty() && d->deferredFiles->isValid()) {
+            reader.deferFiles(*d->deferredFiles, props);
+            for (std::set<const ::Base::Persistence*>::iterator it = props.begin(); it != props.end(); ++it) {
+                Property* prop = const_cast<Property*>(static_cast<const Property*>(*it));
+                prop->setStatus(Property::Deferred, d->deferredFiles->isPending(prop));
+            }
+        }
+    }
+
     reader.readFiles(zipstream);
 
     // reset all touched
@@ -1713,6 +2080,72 @@ void Document::restore (void)
     setStatus(Status::Restoring, false);
 }
 
+void Document::restoreDeferredFile(Property* prop)
+{
+    prop->setStatus(Property::Deferred, false);
+    if (!d->deferredFiles || !d->deferredFiles->isPending(prop))
+        return;
+
+    // reading the file is part of opening the document, so it must neither
+    // be recorded for undo nor mark the object as modified
+    DocumentObject* obj = dynamic_cast<DocumentObject*>(prop->getContainer());
+    if (!obj) {
+        d->deferredFiles->removeFile(prop);
+        return;
+    }
+
+    bool touched = obj->isTouched();
+    bool propTouched = prop->isTouched();
+    bool rollback = d->rollback;
+    d->rollback = true;
+    try {
+        ObjectStatusLocker restoring(ObjectStatus::Restore, obj);
+        d->deferredFiles->readFile(prop);
+    }
+    catch (const ::Base::Exception& e) {
+        Base::Console().Error("Failed to read data of %s: %s\n", obj->getNameInDocument(), e.what());
+    }
+    catch (const std::exception& e) {
+        Base::Console().Error("Failed to read data of %s: %s\n", obj->getNameInDocument(), e.what());
+    }
+    d->rollback = rollback;
+
+    if (!touched)
+        obj->StatusBits.reset(ObjectStatus::Touch);
+    if (!propTouched)
+        prop->purgeTouched();
+}
+
+void Document::discardDeferredFile(Property* prop)
+{
+    prop->setStatus(Property::Deferred, false);
+    if (d->deferredFiles)
+        d->deferredFiles->removeFile(prop);
+}
+
+void Document::restoreDeferredFiles(void)
+{
+    if (!d->deferredFiles)
+        return;
+    std::vector<Base::Persistence*> pending = d->deferredFiles->getPendingObjects();
+    for (std::vector<Base::Persistence*>::iterator it = pending.begin(); it != pending.end(); ++it)
+        restoreDeferredFile(static_cast<Property*>(*it));
+}
+
+void Document::_restoreDeferredFiles(const std::vector<DocumentObject*>& objs)
+{
+    if (!d->deferredFiles)
+        return;
+    for (std::vector<DocumentObject*>::const_iterator obj = objs.begin(); obj != objs.end(); ++obj) {
+        std::vector<Property*> list;
+        (*obj)->getPropertyList(list);
+        for (std::vector<Property*>::iterator it = list.begin(); it != list.end(); ++it) {
+            if ((*it)->testStatus(Property::Deferred))
+                restoreDeferredFile(*it);
+        }
+    }
+}
+
 bool Document::isSaved() const
 {
     std::string name = FileName.getValue();
@@ -1780,18 +2213,19 @@ int Document::countObjects(void) const
 
 std::vector<::App::DocumentObject*> Document::getInList(const DocumentObject* me) const
 {
-    // result list
-    std::vector<::App::DocumentObject*> result;
-    // go through all objects
-    for (std::map<std::string,DocumentObject*>::const_iterator It = d->objectMap.begin(); It != d->objectMap.end();++It) {
-        // get the outList and search if me is in that list
-        std::vector<DocumentObject*> OutList = It->second->getOutList();
-        for (std::vector<DocumentObject*>::const_iterator It2=OutList.begin();It2!=OutList.end();++It2)
-            if (*It2 && *It2 == me)
-                // add the parent object
-                result.push_back(It->second);
-    }
-    return result;
+    d->dependencyCache->update();
+    const DependencyCache::Node* node = d->dependencyCache->getNode(me);
+    if (!node)
+        return std::vector<::App::DocumentObject*>();
+    return node->inList;
+}
+
+void Document::_rebuildDependencyList(void)
+{
+    d->dependencyCache->clear();
+    for (auto obj : d->objectArray)
+        d->dependencyCache->addObject(obj);
+    d->dependencyCache->update();
 }
 
 
@@ -1846,36 +2280,69 @@ int Document::recompute()
     for (auto LogEntry: _RecomputeLog)
         delete LogEntry;
     _RecomputeLog.clear();
+    d->recomputeStats = RecomputeStatistics();
 
-    // get the sorted vector of all objects in the document and go though it from the end
-    vector<DocumentObject*> topoSortedObjects = topologicalSort();
+    // only the touched objects and the objects depending on them have to be checked,
+    // all other objects cannot have changed since the last recompute
+    d->dependencyCache->update();
+    std::vector<DocumentObject*> touched = d->dependencyCache->takeTouched();
+    std::vector<DocumentObject*> seeds;
+    for (auto obj : touched) {
+        if (obj->mustExecute() == 1)
+            seeds.push_back(obj);
+    }
 
-    if (topoSortedObjects.size() != d->objectArray.size()){
+    // get the objects in the order they must be recomputed
+    std::vector<DocumentObject*> objs;
+    if (!d->dependencyCache->getDependentObjects(seeds, objs)) {
         cerr << "App::Document::recompute(): topological sort fails, invalid DAG!" << endl;
+        d->dependencyCache->touchObjects(touched);
         return -1;
     }
+    d->recomputeStats.visited = objs.size();
 
-    for (auto objIt = topoSortedObjects.rbegin(); objIt != topoSortedObjects.rend(); ++objIt){
-        // ask the object if it should be recomputed
-        if ((*objIt)->mustExecute() == 1){
-            objectCount++;
-            if (_recomputeFeature(*objIt)) {
-                // if something happen break execution of recompute
-                return -1;
-            }
-            else{
-                (*objIt)->purgeTouched();
-                // set all dependent object touched to force recompute
-                for (auto inObjIt : (*objIt)->getInList())
-                    inObjIt->touch();
+    if (testStatus(Status::ParallelRecompute)) {
+        objectCount = _recomputeParallel(objs);
+    }
+    else {
+        Base::TimeInfo startTime;
+        for (auto objIt : objs) {
+            // ask the object if it should be recomputed
+            if (objIt->mustExecute() == 1){
+                objectCount++;
+                Base::TimeInfo execTime;
+                bool stop = _recomputeFeature(objIt);
+                d->recomputeStats.executed++;
+                d->recomputeStats.execTime += Base::TimeInfo::diffTimeF(execTime, Base::TimeInfo());
+                if (stop) {
+                    // if something happen break execution of recompute
+                    objectCount = -1;
+                    break;
+                }
+                else{
+                    objIt->purgeTouched();
+                    // set all dependent object touched to force recompute
+                    for (auto inObjIt : objIt->getInList())
+                        inObjIt->touch();
+                }
             }
         }
+        d->recomputeStats.elapsed = Base::TimeInfo::diffTimeF(startTime, Base::TimeInfo());
+    }
 
+    if (objectCount < 0) {
+        // the remaining objects must be checked again by the next recompute
+        d->dependencyCache->touchObjects(touched);
+        d->dependencyCache->touchObjects(objs);
+    }
+    else {
+        d->dependencyCache->purgeTouched();
     }
+
 #ifdef FC_DEBUG
     // check if all objects are recalculated which were thouched 
     for (auto objectIt : d->objectArray) {
-        if (objectIt->isTouched())
+        if (objectCount >= 0 && objectIt->isTouched())
             cerr << "Document::recompute(): " << objectIt->getNameInDocument() << " still touched after recompute" << endl;
     }
 #endif
@@ -1883,40 +2350,247 @@ int Document::recompute()
         return objectCount;
 }
 
+/**
+ * @brief Recompute the objects with the global thread pool.
+ *
+ * An object is scheduled as soon as all objects of its OutList are done. Objects
+ * which opt in via DocumentObject::canRecomputeConcurrently() are executed in a worker
+ * thread, all others in the calling thread. The bookkeeping (touching the InList,
+ * emitting the change signals and filling the recompute log) is always done in
+ * the calling thread and in the same order as a serial recompute would do it.
+ *
+ * @param objs All objects of the document in the order of a serial recompute.
+ * @return The number of executed objects or -1 if the recompute was aborted.
+ */
+int Document::_recomputeParallel(const std::vector<DocumentObject*>& objs)
+{
+    // deferred data files must be read before the worker threads access them
+    if (d->deferredFiles) {
+        std::vector<DocumentObject*> inputs(objs);
+        for (auto obj : objs) {
+            std::vector<DocumentObject*> outList = obj->getOutList();
+            inputs.insert(inputs.end(), outList.begin(), outList.end());
+        }
+        std::sort(inputs.begin(), inputs.end());
+        inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+        _restoreDeferredFiles(inputs);
+    }
+
+    const std::size_t numObjects = objs.size();
+    std::unordered_map<const DocumentObject*, std::size_t> index;
+    for (std::size_t i = 0; i < numObjects; ++i)
+        index[objs[i]] = i;
+
+    // number of not yet processed dependencies and the InList of each object
+    std::vector<std::size_t> pending(numObjects, 0);
+    std::vector<std::vector<std::size_t> > inList(numObjects);
+    for (std::size_t i = 0; i < numObjects; ++i) {
+        std::vector<DocumentObject*> outList = objs[i]->getOutList();
+        std::sort(outList.begin(), outList.end());
+        outList.erase(std::unique(outList.begin(), outList.end()), outList.end());
+        for (auto dep : outList) {
+            auto it = index.find(dep);
+            if (it != index.end()) {
+                pending[i]++;
+                inList[it->second].push_back(i);
+            }
+        }
+    }
+
+    // ordered by the serial recompute sequence to get a reproducible schedule
+    std::set<std::size_t> ready;
+    for (std::size_t i = 0; i < numObjects; ++i) {
+        if (pending[i] == 0)
+            ready.insert(i);
+    }
+
+    std::vector<std::vector<DocumentObjectExecReturn*> > logs(numObjects);
+    std::vector<char> executed(numObjects, 0);
+    std::vector<char> aborted(numObjects, 0);
+    std::vector<double> times(numObjects, 0.0);
+
+    RecomputeScheduler scheduler;
+    d->recomputeScheduler = &scheduler;
+    Base::TimeInfo startTime;
+
+    int objectCount = 0;
+    int running = 0;
+    bool stop = false;
+
+    // deliver the changes made by the given objects or all changes if no object is given
+    auto flushChanges = [&](const std::vector<std::size_t>* done) {
+        std::vector<std::pair<const DocumentObject*, const Property*> > changes;
+        {
+            QMutexLocker lock(&scheduler.mutex);
+            if (done) {
+                std::unordered_set<const DocumentObject*> finished;
+                for (auto i : *done)
+                    finished.insert(objs[i]);
+                auto it = std::stable_partition(scheduler.changes.begin(), scheduler.changes.end(),
+                    [&finished](const std::pair<const DocumentObject*, const Property*>& change) {
+                        return finished.count(change.first) > 0;
+                    });
+                changes.assign(scheduler.changes.begin(), it);
+                scheduler.changes.erase(scheduler.changes.begin(), it);
+            }
+            else {
+                changes.swap(scheduler.changes);
+            }
+        }
+        for (auto it : changes)
+            onChangedProperty(it.first, it.second);
+    };
+
+    auto finish = [&](std::size_t i) {
+        if (aborted[i]) {
+            stop = true;
+            return;
+        }
+        if (executed[i]) {
+            objs[i]->purgeTouched();
+            // set all dependent object touched to force recompute
+            for (auto in : inList[i])
+                objs[in]->touch();
+        }
+        for (auto in : inList[i]) {
+            if (--pending[in] == 0)
+                ready.insert(in);
+        }
+    };
+
+    auto waitForWorkers = [&]() {
+        std::vector<std::size_t> done;
+        {
+            QMutexLocker lock(&scheduler.mutex);
+            while (scheduler.done.empty())
+                scheduler.finished.wait(&scheduler.mutex);
+            done.swap(scheduler.done);
+        }
+        running -= static_cast<int>(done.size());
+        return done;
+    };
+
+    try {
+        for (;;) {
+            while (!stop && !ready.empty()) {
+                std::size_t i = *ready.begin();
+                ready.erase(ready.begin());
+
+                DocumentObject* obj = objs[i];
+                if (obj->mustExecute() != 1) {
+                    finish(i);
+                    continue;
+                }
+
+                objectCount++;
+                executed[i] = 1;
+                auto exec = [this, obj, i, &logs, &aborted, &times]() {
+                    Base::TimeInfo execTime;
+                    try {
+                        aborted[i] = _recomputeFeature(obj, logs[i]) ? 1 : 0;
+                    }
+                    catch (...) {
+                        // never let an exception escape from a worker thread
+                        logs[i].push_back(new DocumentObjectExecReturn("Unknown exception!", obj));
+                        obj->setError();
+                        aborted[i] = 1;
+                    }
+                    times[i] = Base::TimeInfo::diffTimeF(execTime, Base::TimeInfo());
+                };
+
+                if (obj->canRecomputeConcurrently()) {
+                    running++;
+                    d->recomputeStats.concurrent++;
+                    QThreadPool::globalInstance()->start(new RecomputeTask(scheduler, i, exec));
+                }
+                else {
+                    exec();
+                    finish(i);
+                }
+            }
+
+            if (running == 0)
+                break;
+
+            std::vector<std::size_t> done = waitForWorkers();
+            flushChanges(&done);
+            for (auto i : done)
+                finish(i);
+        }
+    }
+    catch (...) {
+        // the workers refer to the local data
+        while (running > 0)
+            waitForWorkers();
+        d->recomputeScheduler = 0;
+        throw;
+    }
+
+    d->recomputeScheduler = 0;
+    flushChanges(0);
+
+    // fill the log in the order of a serial recompute
+    for (std::size_t i = 0; i < numObjects; ++i) {
+        _RecomputeLog.insert(_RecomputeLog.end(), logs[i].begin(), logs[i].end());
+        if (executed[i]) {
+            d->recomputeStats.executed++;
+            d->recomputeStats.execTime += times[i];
+        }
+    }
+
+    RecomputeStatistics& stats = d->recomputeStats;
+    stats.elapsed = Base::TimeInfo::diffTimeF(startTime, Base::TimeInfo());
+    Base::Console().Log("Recompute of '%s': %lu objects executed (%lu in worker threads) in %.3f s, speedup %.2f\n",
+        getName(), stats.executed, stats.concurrent, stats.elapsed, stats.speedup());
+
+    if (stop)
+        return -1;
+    return objectCount;
+}
 
 std::vector<::App::DocumentObject*> Document::topologicalSort() const
 {
-    // topological sort algorithm described here:
-    // https://de.wikipedia.org/wiki/Topologische_Sortierung#Algorithmus_f.C3.BCr_das_Topologische_Sortieren
+    // Kahn's algorithm on the cached adjacency: start with the objects no other
+    // object links to and release the linked objects once all their parents are emitted
+    d->dependencyCache->update();
+
     vector <:: App::DocumentObject* > ret;
     ret.reserve(d->objectArray.size());
-    map <:: App::DocumentObject*,int > countMap;
-
-    for (auto objectIt : d->objectArray)
-        countMap[objectIt] = objectIt->getInList().size();
+    std::unordered_map<const DocumentObject*, std::size_t> countMap;
+    countMap.reserve(d->objectArray.size());
+    std::deque<DocumentObject*> queue;
 
-    auto rootObjeIt = find_if(countMap.begin(), countMap.end(), [](pair <:: App::DocumentObject*, int > count)->bool {
-        return count.second == 0;
-    });
+    for (auto objectIt : d->objectArray) {
+        const DependencyCache::Node* node = d->dependencyCache->getNode(objectIt);
+        std::size_t count = node ? node->inList.size() : 0;
+        countMap[objectIt] = count;
+        if (count == 0)
+            queue.push_back(objectIt);
+    }
 
-    if (rootObjeIt == countMap.end()){
+    if (queue.empty() && !d->objectArray.empty()){
         cerr << "Document::topologicalSort: cyclic dependency detected (no root object)" << endl;
         return ret;
     }
 
-    while (rootObjeIt != countMap.end()){
-        rootObjeIt->second = rootObjeIt->second - 1;
-        for (auto outListIt : rootObjeIt->first->getOutList()){
+    while (!queue.empty()) {
+        DocumentObject* obj = queue.front();
+        queue.pop_front();
+        ret.push_back(obj);
+
+        const DependencyCache::Node* node = d->dependencyCache->getNode(obj);
+        if (!node)
+            continue;
+        for (auto outListIt : node->outList) {
             auto outListMapIt = countMap.find(outListIt);
-            outListMapIt->second = outListMapIt->second - 1;
+            if (outListMapIt != countMap.end() && --outListMapIt->second == 0)
+                queue.push_back(outListIt);
         }
-        ret.push_back(rootObjeIt->first);
-
-        rootObjeIt = find_if(countMap.begin(), countMap.end(), [](pair <:: App::DocumentObject*, int > count)->bool {
-            return count.second == 0;
-        });
     }
 
+    if (ret.size() != d->objectArray.size())
+        cerr << "Document::topologicalSort: cyclic dependency detected" << endl;
+
     return ret;
 }
 
@@ -1928,8 +2602,18 @@ const char * Document::getErrorDescription(const ::App::DocumentObject*Obj) cons
     return 0;
 }
 
-// call the recompute of the Feature and handle the exceptions and errors.
+const RecomputeStatistics& Document::getRecomputeStatistics() const
+{
+    return d->recomputeStats;
+}
+
 bool Document::_recomputeFeature(DocumentObject* Feat)
+{
+    return _recomputeFeature(Feat, _RecomputeLog);
+}
+
+// call the recompute of the Feature and handle the exceptions and errors.
+bool Document::_recomputeFeature(DocumentObject* Feat, std::vector<DocumentObjectExecReturn*>& log)
 {
 #ifdef FC_LOGFEATUREUPDATE
     std::clog << "Solv: Executing Feature: " << Feat->getNameInDocument() << std::endl;;
@@ -1940,7 +2624,7 @@ bool Document::_recomputeFeature(DocumentObject* Feat)
         returnCode = Feat->ExpressionEngine.execute();
         if (returnCode != DocumentObject::StdReturn) {
             returnCode->Which = Feat;
-            _RecomputeLog.push_back(returnCode);
+            log.push_back(returnCode);
     #ifdef FC_DEBUG
             printf("%s\n",returnCode->Why.c_str());
     #endif
@@ -1952,32 +2636,32 @@ bool Document::_recomputeFeature(DocumentObject* Feat)
     }
     catch(::Base::AbortException &e){
         e.ReportException();
-        _RecomputeLog.push_back(new DocumentObjectExecReturn("User abort",Feat));
+        log.push_back(new DocumentObjectExecReturn("User abort",Feat));
         Feat->setError();
         return true;
     }
     catch (const ::Base::MemoryException& e) {
         std::cerr << ("Memory exception in feature '%s' thrown: %s\n",Feat->getNameInDocument(),e.what());
-        _RecomputeLog.push_back(new DocumentObjectExecReturn("Out of memory exception",Feat));
+        log.push_back(new DocumentObjectExecReturn("Out of memory exception",Feat));
         Feat->setError();
         return true;
     }
     catch (::Base::Exception &e) {
         e.ReportException();
-        _RecomputeLog.push_back(new DocumentObjectExecReturn(e.what(),Feat));
+        log.push_back(new DocumentObjectExecReturn(e.what(),Feat));
         Feat->setError();
         return false;
     }
     catch (std::exception &e) {
         std::cerr << ("exception in Feature \"%s\" thrown: %s\n",Feat->getNameInDocument(),e.what());
-        _RecomputeLog.push_back(new DocumentObjectExecReturn(e.what(),Feat));
+        log.push_back(new DocumentObjectExecReturn(e.what(),Feat));
         Feat->setError();
         return false;
     }
 #ifndef FC_DEBUG
     catch (...) {
         std::cerr << ("App::Document::_RecomputeFeature(): Unknown exception in Feature \"%s\" thrown\n",Feat->getNameInDocument());
-        _RecomputeLog.push_back(new DocumentObjectExecReturn("Unknown exeption!"));
+        log.push_back(new DocumentObjectExecReturn("Unknown exeption!"));
         Feat->setError();
         return true;
     }
@@ -1989,7 +2673,7 @@ bool Document::_recomputeFeature(DocumentObject* Feat)
     }
     else {
         returnCode->Which = Feat;
-        _RecomputeLog.push_back(returnCode);
+        log.push_back(returnCode);
 #ifdef FC_DEBUG
         printf("%s\n",returnCode->Why.c_str());
 #endif
@@ -2049,8 +2733,8 @@ DocumentObject * Document::addObject(const char* sType, const char* pObjectName,
     pcObject->pcNameInDocument = &(d->objectMap.find(ObjectName)->first);
     // insert in the vector
     d->objectArray.push_back(pcObject);
-    // insert in the adjacence list and referenc through the ConectionMap
-    //_DepConMap[pcObject] = add_vertex(_DepList);
+    // insert in the adjacence list
+    d->dependencyCache->addObject(pcObject);
 
     pcObject->Label.setValue( ObjectName );
 
@@ -2135,6 +2819,7 @@ std::vector<DocumentObject *> Document::addObjects(const char* sType, const std:
         pcObject->pcNameInDocument = &(d->objectMap.find(ObjectName)->first);
         // insert in the vector
         d->objectArray.push_back(pcObject);
+        d->dependencyCache->addObject(pcObject);
 
         pcObject->Label.setValue(ObjectName);
 
@@ -2191,6 +2876,7 @@ void Document::addObject(DocumentObject* pcObject, const char* pObjectName)
     pcObject->pcNameInDocument = &(d->objectMap.find(ObjectName)->first);
     // insert in the vector
     d->objectArray.push_back(pcObject);
+    d->dependencyCache->addObject(pcObject);
 
     pcObject->Label.setValue( ObjectName );
 
@@ -2211,6 +2897,7 @@ void Document::_addObject(DocumentObject* pcObject, const char* pObjectName)
     std::string ObjectName = getUniqueObjectName(pObjectName);
     d->objectMap[ObjectName] = pcObject;
     d->objectArray.push_back(pcObject);
+    d->dependencyCache->addObject(pcObject);
     // cache the pointer to the name string in the Object (for performance of DocumentObject::getNameInDocument())
     pcObject->pcNameInDocument = &(d->objectMap.find(ObjectName)->first);
 
@@ -2247,6 +2934,9 @@ void Document::remObject(const char* sName)
     if (d->activeObject == pos->second)
         d->activeObject = 0;
 
+    // the object may be kept by the undo stack, so read its data while it's still possible
+    _restoreDeferredFiles(std::vector<DocumentObject*>(1, pos->second));
+
     // Mark the object as about to be deleted
     pos->second->setStatus(ObjectStatus::Delete, true);
     if (!d->undoing && !d->rollback) {
@@ -2296,8 +2986,7 @@ void Document::remObject(const char* sName)
         }
     }
     // remove from adjancy list
-    //remove_vertex(_DepConMap[pos->second],_DepList);
-    //_DepConMap.erase(pos->second);
+    d->dependencyCache->removeObject(pos->second);
     d->objectMap.erase(pos);
 }
 
@@ -2313,6 +3002,9 @@ void Document::_remObject(DocumentObject* pcObject)
     if (d->activeObject == pcObject)
         d->activeObject = 0;
 
+    // the object may be kept by the undo stack, so read its data while it's still possible
+    _restoreDeferredFiles(std::vector<DocumentObject*>(1, pcObject));
+
     // Mark the object as about to be deleted
     pcObject->setStatus(ObjectStatus::Delete, true);
     if (!d->undoing && !d->rollback) {
@@ -2342,6 +3034,7 @@ void Document::_remObject(DocumentObject* pcObject)
 
     // remove from map
     d->objectMap.erase(pos);
+    d->dependencyCache->removeObject(pcObject);
 
     for (std::vector<DocumentObject*>::iterator it = d->objectArray.begin(); it != d->objectArray.end(); ++it) {
         if (*it == pcObject) {
@@ -42,6 +42,7 @@
 
 namespace Base {
     class Writer;
+    class DeferredFileReader;
 }
 
 namespace App
@@ -61,9 +62,35 @@ namespace App {
         SkipRecompute = 0,
         KeepTrailingDigits = 1,
         Closable = 2,
-        Restoring = 3
+        Restoring = 3,
+        ParallelRecompute = 4
     };
 
+    struct RecomputeScheduler;
+    class DependencyCache;
+
+/** Figures of the last recompute run of a document
+ */
+struct RecomputeStatistics
+{
+    /// number of objects which have been asked whether they must be executed
+    unsigned long visited;
+    /// number of objects whose execute() has been called
+    unsigned long executed;
+    /// number of objects that were executed in a worker thread
+    unsigned long concurrent;
+    /// wall clock time of the recompute in seconds
+    double elapsed;
+    /// accumulated execution time of all objects in seconds
+    double execTime;
+
+    RecomputeStatistics() : visited(0), executed(0), concurrent(0), elapsed(0.0), execTime(0.0) {}
+    /// the speedup compared to a serial recompute of the same objects
+    double speedup() const {
+        return elapsed > 0.0 ? execTime / elapsed : 1.0;
+    }
+};
+
 // Pimpl class
 struct DocumentP
 {
@@ -77,8 +104,15 @@ struct DocumentP
     bool undoing; ///< document in the middle of undo or redo
     std::bitset<32> StatusBits;
     int iUndoMode;
-    unsigned int UndoMemSize;
+    std::size_t UndoMemSize;
     unsigned int UndoMaxStackSize;
+    RecomputeStatistics recomputeStats;
+    /// set while a parallel recompute is running
+    RecomputeScheduler* recomputeScheduler;
+    /// adjacency of the objects, kept up to date with the link properties
+    DependencyCache* dependencyCache;
+    /// data files not yet read when the document was opened with lazy loading
+    Base::DeferredFileReader* deferredFiles;
 
     DocumentP() {
         activeObject = 0;
@@ -92,6 +126,9 @@ struct DocumentP
         iUndoMode = 0;
         UndoMemSize = 0;
         UndoMaxStackSize = 20;
+        recomputeScheduler = 0;
+        dependencyCache = 0;
+        deferredFiles = 0;
     }
 };
 
@@ -201,6 +238,12 @@ public:
     std::vector<App::DocumentObject*> importObjects(Base::XMLReader& reader);
     /// Opens the document from its file name
     //void open (void);
+    /// Read the data file of a property whose reading was deferred when opening the document
+    void restoreDeferredFile(Property* prop);
+    /// Forget the deferred data file of a property because its value has been replaced
+    void discardDeferredFile(Property* prop);
+    /// Read all data files whose reading was deferred when opening the document
+    void restoreDeferredFiles(void);
     /// Is the document already saved to a file
     bool isSaved() const;
     /// Get the document name
@@ -292,7 +335,7 @@ public:
     void setClosable(bool);
     /// check whether the document can be closed
     bool isClosable() const;
-    /// Recompute all touched features and return the amount of recalculated features
+    /// Recompute all touched features and the features depending on them and return the amount of recalculated features
     int recompute();
     /// Recompute only one feature
     void recomputeFeature(DocumentObject* Feat);
@@ -300,6 +343,8 @@ public:
     const std::vector<App::DocumentObjectExecReturn*> &getRecomputeLog(void)const{return _RecomputeLog;}
     /// get the text of the error of a spezified object
     const char* getErrorDescription(const App::DocumentObject*) const;
+    /// get the figures of the last recompute run
+    const RecomputeStatistics& getRecomputeStatistics() const;
     /// return the status bits
     bool testStatus(Status pos) const;
     /// set the status bits
@@ -323,10 +368,12 @@ public:
     void abortTransaction();
     /// Check if a transaction is open
     bool hasPendingTransaction() const;
-    /// Set the Undo limit in Byte!
-    void setUndoLimit(unsigned int UndoMemSize=0);
+    /// Set the Undo limit in Byte! 0 means no limit.
+    void setUndoLimit(std::size_t UndoMemSize=0);
+    /// Returns the Undo limit in Byte
+    std::size_t getUndoLimit(void) const;
     /// Returns the actual memory consumption of the Undo redo stuff.
-    unsigned int getUndoMemSize (void) const;
+    std::size_t getUndoMemSize (void) const;
     /// Set the Undo limit as stack size
     void setMaxUndoStackSize(unsigned int UndoMaxStackSize=20);
     /// Set the Undo limit as stack size
@@ -402,10 +449,17 @@ protected:
     void onBeforeChangeProperty(const TransactionalObject *Who, const Property *What);
     /// callback from the Document objects after property was changed
     void onChangedProperty(const DocumentObject *Who, const Property *What);
+    /// callback from the Document objects after they were touched
+    void onTouchedObject(DocumentObject *Who);
     /// helper which Recompute only this feature
     /// @return True if the recompute process of the Document shall be stopped, False if it shall be continued.
     bool _recomputeFeature(DocumentObject* Feat);
+    bool _recomputeFeature(DocumentObject* Feat, std::vector<App::DocumentObjectExecReturn*>& log);
+    /// helper which recomputes the given objects in dependency order with the global thread pool
+    int _recomputeParallel(const std::vector<App::DocumentObject*>& objs);
     void _clearRedos();
+    /// reads the deferred data files of the given objects
+    void _restoreDeferredFiles(const std::vector<App::DocumentObject*>& objs);
 
     /// refresh the internal dependency graph
     void _rebuildDependencyList(void);
@@ -434,6 +434,8 @@ void DocumentObject::onChanged(const Property* prop)
 void DocumentObject::touch(void)
 {
     StatusBits.set(ObjectStatus::Touch);
+    if (_pDoc)
+        _pDoc->onTouchedObject(this);
 }
 
 /**
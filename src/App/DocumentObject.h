@@ -186,6 +186,17 @@ public:
      */
     virtual short mustExecute(void) const;
 
+    /** canRecomputeConcurrently
+     *  Returns true if execute() of this type may run in a worker thread
+     *  when the document is recomputed in parallel mode. Only types whose
+     *  execute() solely reads their own properties and the (already computed)
+     *  objects of their OutList should opt in. All other objects are executed
+     *  by the thread that runs the recompute.
+     */
+    virtual bool canRecomputeConcurrently(void) const {
+        return false;
+    }
+
     /// Recompute only this feature
     bool recomputeFeature();
 
@@ -83,6 +83,10 @@ public:
             return 1;
         return FeatureT::mustExecute();
     }
+    /// the Python proxy needs the interpreter and thus must run in the main thread
+    virtual bool canRecomputeConcurrently(void) const {
+        return false;
+    }
     /// recalculate the Feature
     virtual DocumentObjectExecReturn *execute(void) {
         try {
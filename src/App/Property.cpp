@@ -33,6 +33,8 @@
 #include "PropertyContainer.h"
 #include <Base/Exception.h>
 #include "Application.h"
+#include "Document.h"
+#include "DocumentObject.h"
 
 using namespace App;
 
@@ -132,6 +134,18 @@ void Property::aboutToSetValue(void)
         father->onBeforeChange(this);
 }
 
+void Property::onRestoreDeferred(bool read)
+{
+    DocumentObject* obj = dynamic_cast<DocumentObject*>(father);
+    if (obj && obj->getDocument()) {
+        if (read)
+            obj->getDocument()->restoreDeferredFile(this);
+        else
+            obj->getDocument()->discardDeferredFile(this);
+    }
+    StatusBits.reset(Deferred);
+}
+
 void Property::verifyPath(const ObjectIdentifier &p) const
 {
     if (p.numSubComponents() != 1)
@@ -41,6 +41,7 @@ namespace App
 
 class PropertyContainer;
 class ObjectIdentifier;
+class PropertyDelta;
 
 /** Base class of all properties
  * This is the father of all properties. Properties are objects which are used
@@ -62,6 +63,7 @@ public:
         Immutable = 1, // can't modify property
         ReadOnly = 2, // for property editor
         Hidden = 3, // for property editor
+        Deferred = 4, // data file not yet restored
         User1 = 28, // user-defined status
         User2 = 29, // user-defined status
         User3 = 30, // user-defined status
@@ -149,9 +151,24 @@ public:
     virtual Property *Copy(void) const = 0;
     /// Paste the value from the property (mainly for Undo/Redo and transactions)
     virtual void Paste(const Property &from) = 0;
+    /** Returns a record of only the part of the value that is about to be changed
+     * The method is called by the transaction from within aboutToSetValue(). Properties
+     * with a large payload can implement it to avoid a full Copy() in the undo stack when
+     * only a small part of the data changes. The default returns 0 which means that
+     * a full copy is needed.
+     */
+    virtual PropertyDelta *CopyDelta(void) const { return 0; }
     /// Encodes an attribute upon saving.
     static std::string encodeAttribute(const std::string&);
 
+    /** Returns true if the property can read its data file on first access
+     * When a document is opened with lazy loading the data files of such
+     * properties are not read together with the document. Instead, the
+     * property must call restoreDeferred() before it accesses its value and
+     * discardDeferred() after it has replaced its value completely.
+     */
+    virtual bool canRestoreDeferred(void) const { return false; }
+
 
     friend class PropertyContainer;
 
@@ -164,6 +181,7 @@ protected:
      * 1 - object is marked as 'immutable'
      * 2 - object is marked as 'read-only' (for property editor)
      * 3 - object is marked as 'hidden' (for property editor)
+     * 4 - the data file of the object is not yet restored
      */
     std::bitset<32> StatusBits;
 
@@ -172,11 +190,23 @@ protected:
     void hasSetValue(void);
     /// Gets called by all setValue() methods before the value has changed
     void aboutToSetValue(void);
+    /// Reads the data file if the document has deferred it
+    inline void restoreDeferred(void) const {
+        if (StatusBits.test(Deferred))
+            const_cast<Property*>(this)->onRestoreDeferred(true);
+    }
+    /// Forgets the deferred data file because the value has been replaced
+    inline void discardDeferred(void) {
+        if (StatusBits.test(Deferred))
+            onRestoreDeferred(false);
+    }
 
     /// Verify a path for the current property
     virtual void verifyPath(const App::ObjectIdentifier & p) const;
 
 private:
+    void onRestoreDeferred(bool read);
+
     // forbidden
     Property(const Property&);
     Property& operator = (const Property&);
@@ -186,6 +216,23 @@ private:
 };
 
 
+/** Undo record of a partial change of a property
+ * A delta stores the old values of the changed part of a property only, e.g. a
+ * few points of a big mesh. Applying it goes through the normal modification
+ * interface of the property so that the inverse delta gets recorded for redo.
+ * @see Property::CopyDelta()
+ */
+class AppExport PropertyDelta
+{
+public:
+    virtual ~PropertyDelta() {}
+    /// restore the recorded values in the given property
+    virtual void apply(Property &prop) const = 0;
+    /// returns the memory needed by the record
+    virtual unsigned int getMemSize (void) const = 0;
+};
+
+
 /** Base class of all property lists.
  * The PropertyLists class is the base class for properties which can contain
  * multiple values, not only a single value. 
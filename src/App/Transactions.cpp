@@ -85,7 +85,11 @@ Transaction::~Transaction()
 
 unsigned int Transaction::getMemSize (void) const
 {
-    return 0;
+    unsigned int size = 0;
+    TransactionList::const_iterator It;
+    for (It = _Objects.begin(); It != _Objects.end(); ++It)
+        size += It->second->getMemSize();
+    return size;
 }
 
 void Transaction::Save (Base::Writer &/*writer*/) const
@@ -241,6 +245,11 @@ TransactionObject::~TransactionObject()
     std::map<const Property*,Property*>::const_iterator It;
     for (It=_PropChangeMap.begin();It!=_PropChangeMap.end();++It)
         delete It->second;
+    std::map<const Property*,std::vector<PropertyDelta*> >::const_iterator Jt;
+    for (Jt=_PropDeltaMap.begin();Jt!=_PropDeltaMap.end();++Jt) {
+        for (std::vector<PropertyDelta*>::const_iterator Kt = Jt->second.begin(); Kt != Jt->second.end(); ++Kt)
+            delete *Kt;
+    }
 }
 
 void TransactionObject::applyDel(Document & /*Doc*/, TransactionalObject * /*pcObj*/)
@@ -267,19 +276,45 @@ void TransactionObject::applyChn(Document & /*Doc*/, TransactionalObject * /*pcO
             for (It = _PropChangeMap.begin(); It != endIt; ++It)
                 const_cast<Property*>(It->first)->Paste(*(It->second));
         }
+
+        // the deltas were recorded before a full copy, so they must be reverted
+        // afterwards and in the opposite order of their recording
+        std::map<const Property*,std::vector<PropertyDelta*> >::const_iterator Jt;
+        for (Jt = _PropDeltaMap.begin(); Jt != _PropDeltaMap.end(); ++Jt) {
+            Property* prop = const_cast<Property*>(Jt->first);
+            std::vector<PropertyDelta*>::const_reverse_iterator Kt;
+            for (Kt = Jt->second.rbegin(); Kt != Jt->second.rend(); ++Kt)
+                (*Kt)->apply(*prop);
+        }
     }
 }
 
 void TransactionObject::setProperty(const Property* pcProp)
 {
+    // a full copy already holds the value at the start of the transaction
     std::map<const Property*, Property*>::iterator pos = _PropChangeMap.find(pcProp);
-    if (pos == _PropChangeMap.end())
+    if (pos != _PropChangeMap.end())
+        return;
+
+    PropertyDelta* delta = pcProp->CopyDelta();
+    if (delta)
+        _PropDeltaMap[pcProp].push_back(delta);
+    else
         _PropChangeMap[pcProp] = pcProp->Copy();
 }
 
 unsigned int TransactionObject::getMemSize (void) const
 {
-    return 0;
+    unsigned int size = 0;
+    std::map<const Property*,Property*>::const_iterator It;
+    for (It = _PropChangeMap.begin(); It != _PropChangeMap.end(); ++It)
+        size += It->second->getMemSize();
+    std::map<const Property*,std::vector<PropertyDelta*> >::const_iterator Jt;
+    for (Jt = _PropDeltaMap.begin(); Jt != _PropDeltaMap.end(); ++Jt) {
+        for (std::vector<PropertyDelta*>::const_iterator Kt = Jt->second.begin(); Kt != Jt->second.end(); ++Kt)
+            size += (*Kt)->getMemSize();
+    }
+    return size;
 }
 
 void TransactionObject::Save (Base::Writer &/*writer*/) const
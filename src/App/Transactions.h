@@ -28,12 +28,15 @@
 #include <Base/Persistence.h>
 
 #include <list>
+#include <map>
+#include <vector>
 
 namespace App
 {
 
 class Document;
 class Property;
+class PropertyDelta;
 class Transaction;
 class TransactionObject;
 class TransactionalObject;
@@ -107,6 +110,8 @@ public:
 protected:
     enum Status {New,Del,Chn} status;
     std::map<const Property*,Property*> _PropChangeMap;
+    /// partial changes recorded before a possible full copy, in chronological order
+    std::map<const Property*,std::vector<PropertyDelta*> > _PropDeltaMap;
     std::string _NameInDocument;
 };
 
@@ -30,7 +30,10 @@
 # include <xercesc/sax2/SAX2XMLReader.hpp>
 #endif
 
+#include <cstring>
 #include <locale>
+#include <memory>
+#include <sstream>
 
 /// Here the FreeCAD includes sorted by Base,App,Gui......
 #include "Reader.h"
@@ -62,8 +65,8 @@ using namespace std;
 
 Base::XMLReader::XMLReader(const char* FileName, std::istream& str) 
   : DocumentSchema(0), ProgramVersion(""), FileVersion(0), Level(0),
-    CharacterCount(0), ReadType(None), _File(FileName), _valid(false),
-    _verbose(true)
+    CharacterCount(0), ReadType(None), _File(FileName), parser(0), _valid(false),
+    _verbose(true), _binary(0), _binaryCDATAState(0)
 {
 #ifdef _MSC_VER
     str.imbue(std::locale::empty());
@@ -72,6 +75,24 @@ Base::XMLReader::XMLReader(const char* FileName, std::istream& str)
     str.imbue(std::locale::classic());
 #endif
 
+    // a binary document stream starts with a byte that cannot start an XML file
+    if (str.peek() == XMLBinaryStream::Magic[0]) {
+        char magic[sizeof(XMLBinaryStream::Magic)];
+        if (str.read(magic, sizeof(magic)) && memcmp(magic, XMLBinaryStream::Magic, sizeof(magic)) == 0) {
+            int version = str.get();
+            if (version != EOF && version <= XMLBinaryStream::Version) {
+                _binary = &str;
+                _valid = true;
+                return;
+            }
+            std::stringstream msg;
+            msg << "Unsupported version of binary document " << _File.fileName() << ": " << version;
+            throw Base::XMLBaseException(msg.str());
+        }
+        // the stream is neither a binary document nor an XML file
+        throw Base::XMLBaseException(std::string("Invalid binary document ") + _File.fileName());
+    }
+
     // create the parser
     parser = XMLReaderFactory::createXMLReader();
     //parser->setFeature(XMLUni::fgSAX2CoreNameSpaces, false);
@@ -186,6 +207,9 @@ bool Base::XMLReader::read(void)
 {
     ReadType = None;
 
+    if (_binary)
+        return readBinary();
+
     try {
         parser->parseNext(token);
     }
@@ -229,6 +253,89 @@ bool Base::XMLReader::read(void)
     return true;
 }
 
+bool Base::XMLReader::readBinary(void)
+{
+    // a CDATA section gives three events like with the XML parser
+    if (_binaryCDATAState == 1) {
+        Characters = _binaryCDATA;
+        CharacterCount += Characters.size();
+        ReadType = Chars;
+        _binaryCDATAState = 2;
+        return true;
+    }
+    else if (_binaryCDATAState == 2) {
+        _binaryCDATA.clear();
+        ReadType = EndCDATA;
+        _binaryCDATAState = 0;
+        return true;
+    }
+
+    for (;;) {
+        int token = _binary->get();
+        if (token == EOF)
+            throw Base::XMLBaseException("Unexpected end of binary document");
+
+        switch (token) {
+        case XMLBinaryStream::Name:
+            {
+                std::string name;
+                XMLBinaryStream::readString(*_binary, name);
+                _binaryNames.push_back(name);
+            }
+            break;
+        case XMLBinaryStream::StartElement:
+        case XMLBinaryStream::StartEndElement:
+            {
+                unsigned long id = XMLBinaryStream::readUInt(*_binary);
+                if (id >= _binaryNames.size())
+                    throw Base::XMLBaseException("Invalid name in binary document");
+                LocalName = _binaryNames[id];
+                AttrMap.clear();
+                unsigned long count = XMLBinaryStream::readUInt(*_binary);
+                for (unsigned long i = 0; i < count; i++) {
+                    unsigned long attr = XMLBinaryStream::readUInt(*_binary);
+                    if (attr >= _binaryNames.size())
+                        throw Base::XMLBaseException("Invalid name in binary document");
+                    XMLBinaryStream::readString(*_binary, AttrMap[_binaryNames[attr]]);
+                }
+                if (token == XMLBinaryStream::StartElement) {
+                    Level++;
+                    ReadType = StartElement;
+                }
+                else {
+                    ReadType = StartEndElement;
+                }
+            }
+            return true;
+        case XMLBinaryStream::EndElement:
+            {
+                unsigned long id = XMLBinaryStream::readUInt(*_binary);
+                if (id >= _binaryNames.size())
+                    throw Base::XMLBaseException("Invalid name in binary document");
+                Level--;
+                LocalName = _binaryNames[id];
+                ReadType = EndElement;
+            }
+            return true;
+        case XMLBinaryStream::Characters:
+            XMLBinaryStream::readString(*_binary, Characters);
+            CharacterCount += Characters.size();
+            ReadType = Chars;
+            return true;
+        case XMLBinaryStream::CDATA:
+            XMLBinaryStream::readString(*_binary, _binaryCDATA);
+            _binaryCDATAState = 1;
+            ReadType = StartCDATA;
+            return true;
+        case XMLBinaryStream::EndDocument:
+            ReadType = EndDocument;
+            return true;
+        default:
+            throw Base::XMLBaseException("Invalid token in binary document");
+        }
+    }
+}
+
 void Base::XMLReader::readElement(const char* ElementName)
 {
     bool ok;
@@ -345,6 +452,19 @@ void Base::XMLReader::readFiles(zipios::ZipInputStream &zipstream) const
     }
 }
 
+void Base::XMLReader::deferFiles(DeferredFileReader &deferred, const std::set<const Base::Persistence*>& objects)
+{
+    std::vector<FileEntry> files;
+    files.reserve(FileList.size());
+    for (std::vector<FileEntry>::const_iterator it = FileList.begin(); it != FileList.end(); ++it) {
+        if (objects.find(it->Object) != objects.end())
+            deferred.addFile(it->FileName, it->Object);
+        else
+            files.push_back(*it);
+    }
+    FileList.swap(files);
+}
+
 const char *Base::XMLReader::addFile(const char* Name, Base::Persistence *Object)
 {
     FileEntry temp;
@@ -504,6 +624,75 @@ void Base::XMLReader::resetErrors()
 
 // ----------------------------------------------------------
 
+// ----------------------------------------------------------------------------
+
+Base::DeferredFileReader::DeferredFileReader(const char* FileName, int version)
+  : zipFile(0), fileVersion(version)
+{
+    // reads the central directory only, the entries are located by their offsets
+    try {
+        zipFile = new zipios::ZipFile(FileName);
+    }
+    catch (const std::exception&) {
+    }
+}
+
+Base::DeferredFileReader::~DeferredFileReader()
+{
+    delete zipFile;
+}
+
+bool Base::DeferredFileReader::isValid() const
+{
+    return zipFile && zipFile->isValid();
+}
+
+void Base::DeferredFileReader::addFile(const std::string& FileName, Base::Persistence *Object)
+{
+    pending[Object] = FileName;
+}
+
+bool Base::DeferredFileReader::isPending(const Base::Persistence *Object) const
+{
+    return pending.find(Object) != pending.end();
+}
+
+bool Base::DeferredFileReader::readFile(Base::Persistence *Object)
+{
+    std::map<const Base::Persistence*, std::string>::iterator it = pending.find(Object);
+    if (it == pending.end())
+        return false;
+
+    // remove the request first so that a failure is not repeated on every access
+    std::string name = it->second;
+    pending.erase(it);
+
+    if (!isValid())
+        return false;
+    std::unique_ptr<std::istream> str(zipFile->getInputStream(name));
+    if (!str)
+        return false;
+    Base::Reader reader(*str, name, fileVersion);
+    //Object->RestoreDocFile(reader);
+    return true;
+}
+
+void Base::DeferredFileReader::removeFile(const Base::Persistence *Object)
+{
+    pending.erase(Object);
+}
+
+std::vector<Base::Persistence*> Base::DeferredFileReader::getPendingObjects() const
+{
+    std::vector<Base::Persistence*> objects;
+    objects.reserve(pending.size());
+    for (std::map<const Base::Persistence*, std::string>::const_iterator it = pending.begin(); it != pending.end(); ++it)
+        objects.push_back(const_cast<Base::Persistence*>(it->first));
+    return objects;
+}
+
+// ----------------------------------------------------------------------------
+
 Base::Reader::Reader(std::istream& str, const std::string& name, int version)
   : std::istream(str.rdbuf()), _str(str), _name(name), fileVersion(version)
 {
@@ -26,6 +26,7 @@
 
 #include <string>
 #include <map>
+#include <set>
 
 #include <xercesc/framework/XMLPScanToken.hpp>
 #include <xercesc/sax2/Attributes.hpp>
@@ -46,6 +47,7 @@ XERCES_CPP_NAMESPACE_END
 namespace Base
 {
 
+class DeferredFileReader;
 
 /** The XML reader class 
  * This is an important helper class for the store and retrieval system
@@ -158,6 +160,8 @@ public:
     const char *addFile(const char* Name, Base::Persistence *Object);
     /// process the requested file writes
     void readFiles(zipios::ZipInputStream &zipstream) const;
+    /// hand over the read requests of the given objects to be processed on demand
+    void deferFiles(DeferredFileReader &deferred, const std::set<const Base::Persistence*>& objects);
     /// get all registered file names
     const std::vector<std::string>& getFilenames() const;
     bool isRegistered(Base::Persistence *Object) const;
@@ -176,6 +180,8 @@ public:
 protected:
     /// read the next element
     bool read(void);
+    /// read the next element of a binary document stream
+    bool readBinary(void);
 
     // -----------------------------------------------------------------------
     //  Handlers for the SAX ContentHandler interface
@@ -246,6 +252,12 @@ protected:
     bool _valid;
     bool _verbose;
 
+    // set if the stream uses the encoding of XMLBinaryStream instead of XML
+    std::istream* _binary;
+    std::vector<std::string> _binaryNames;
+    std::string _binaryCDATA;
+    int _binaryCDATAState;
+
     struct FileEntry {
         std::string FileName;
         Base::Persistence *Object;
@@ -254,6 +266,37 @@ protected:
     std::vector<std::string> FileNames;
 };
 
+/** The DeferredFileReader class
+ * Keeps the directory of a project file open and reads the data files of the
+ * registered objects on demand instead of reading all of them in one go after
+ * the XML part has been restored.
+ * \see XMLReader::deferFiles()
+ */
+class BaseExport DeferredFileReader
+{
+public:
+    DeferredFileReader(const char* FileName, int version);
+    ~DeferredFileReader();
+
+    /// returns true if the directory of the project file could be read
+    bool isValid() const;
+    /// add a read request of a persistent object
+    void addFile(const std::string& FileName, Base::Persistence *Object);
+    /// check if the file of the object has not been read yet
+    bool isPending(const Base::Persistence *Object) const;
+    /// read the file of the object, returns false if there is nothing to read
+    bool readFile(Base::Persistence *Object);
+    /// remove the read request of the object without reading it
+    void removeFile(const Base::Persistence *Object);
+    /// get all objects whose files have not been read yet
+    std::vector<Base::Persistence*> getPendingObjects() const;
+
+private:
+    zipios::ZipFile* zipFile;
+    std::map<const Base::Persistence*, std::string> pending;
+    int fileVersion;
+};
+
 class BaseExport Reader : public std::istream
 {
 public:
@@ -34,9 +34,22 @@
 #include "FileInfo.h"
 #include "Stream.h"
 #include "Tools.h"
+#include "Console.h"
+#include "TimeInfo.h"
 
 #include <algorithm>
+#include <cstring>
+#include <deque>
 #include <locale>
+#include <map>
+#include <zlib.h>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 using namespace Base;
 using namespace std;
@@ -239,8 +252,146 @@ void Writer::decInd(void)
 
 // ----------------------------------------------------------------------------
 
+namespace Base {
+
+/* Writer for a single additional file of a ZipWriter
+ * It collects the data in memory so that several files can be serialized at the
+ * same time. Files that are added while saving are handed over to the ZipWriter.
+ */
+class ZipEntryWriter : public Writer
+{
+public:
+    ZipEntryWriter(const std::set<std::string>& modes,
+                   const std::vector<std::string>& names, int version)
+    {
+        Modes = modes;
+        FileNames = names;
+        fileVersion = version;
+        Buffer.imbue(std::locale::classic());
+        Buffer.precision(12);
+        Buffer.setf(ios::fixed,ios::floatfield);
+    }
+
+    virtual std::ostream &Stream(void){return Buffer;}
+    virtual void writeFiles(void){}
+
+    std::string getData(void) const {return Buffer.str();}
+    std::vector<std::pair<std::string, const Base::Persistence*> > getAddedFiles() const
+    {
+        std::vector<std::pair<std::string, const Base::Persistence*> > files;
+        for (std::vector<FileEntry>::const_iterator it = FileList.begin(); it != FileList.end(); ++it)
+            files.push_back(std::make_pair(it->FileName, it->Object));
+        return files;
+    }
+
+private:
+    std::ostringstream Buffer;
+};
+
+/* The result of serializing and compressing one additional file */
+struct ZipEntryJob
+{
+    std::string FileName;
+    const Base::Persistence* Object;
+    std::set<std::string> Modes;
+    std::vector<std::string> Names;
+    int FileVersion;
+    int Level;
+
+    std::string Data;
+    uLong Crc;
+    unsigned long Size;
+    zipios::StorageMethod Method;
+    double SerializeTime;
+    double CompressTime;
+    std::vector<std::pair<std::string, const Base::Persistence*> > AddedFiles;
+    std::string Error;
+    bool Done;
+
+    void run()
+    {
+        try {
+            Base::TimeInfo start;
+            ZipEntryWriter writer(Modes, Names, FileVersion);
+            //Object->SaveDocFile(writer);
+            std::string raw = writer.getData();
+            AddedFiles = writer.getAddedFiles();
+            SerializeTime = Base::TimeInfo::diffTimeF(start, Base::TimeInfo());
+
+            Base::TimeInfo compressStart;
+            Size = raw.size();
+            Crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(raw.data()), raw.size());
+            if (Level == Z_NO_COMPRESSION) {
+                // store-only: the data goes to the archive as is
+                Method = zipios::STORED;
+                Data.swap(raw);
+            }
+            else {
+                Method = zipios::DEFLATED;
+                deflateRaw(raw);
+            }
+            CompressTime = Base::TimeInfo::diffTimeF(compressStart, Base::TimeInfo());
+        }
+        catch (const Base::Exception& e) {
+            Error = e.what();
+        }
+        catch (const std::exception& e) {
+            Error = e.what();
+        }
+        catch (...) {
+            Error = "Unknown exception";
+        }
+    }
+
+private:
+    void deflateRaw(const std::string& raw)
+    {
+        z_stream zs;
+        zs.zalloc = Z_NULL;
+        zs.zfree = Z_NULL;
+        zs.opaque = Z_NULL;
+        // negative window bits write a raw deflate stream as required by zip
+        if (deflateInit2(&zs, Level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw Base::RuntimeError("Failed to initialize zlib");
+
+        Data.resize(deflateBound(&zs, raw.size()));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+        zs.avail_in = raw.size();
+        zs.next_out = reinterpret_cast<Bytef*>(&Data[0]);
+        zs.avail_out = Data.size();
+        int ret = deflate(&zs, Z_FINISH);
+        Data.resize(zs.total_out);
+        deflateEnd(&zs);
+        if (ret != Z_STREAM_END)
+            throw Base::RuntimeError("Failed to compress data");
+    }
+};
+
+class ZipEntryTask : public QRunnable
+{
+public:
+    ZipEntryTask(ZipEntryJob* job, QMutex* mutex, QWaitCondition* finished)
+        : job(job), mutex(mutex), finished(finished)
+    {
+    }
+    void run()
+    {
+        job->run();
+        QMutexLocker lock(mutex);
+        job->Done = true;
+        finished->wakeAll();
+    }
+
+private:
+    ZipEntryJob* job;
+    QMutex* mutex;
+    QWaitCondition* finished;
+};
+
+}
+
 ZipWriter::ZipWriter(const char* FileName) 
-  : ZipStream(FileName)
+  : ZipStream(FileName), binaryEntry(false), Level(6), ThreadCount(1)
 {
 #ifdef _MSC_VER
     ZipStream.imbue(std::locale::empty());
@@ -250,10 +401,13 @@ ZipWriter::ZipWriter(const char* FileName)
 #endif
     ZipStream.precision(12);
     ZipStream.setf(ios::fixed,ios::floatfield);
+    BinaryBuffer.imbue(std::locale::classic());
+    BinaryBuffer.precision(12);
+    BinaryBuffer.setf(ios::fixed,ios::floatfield);
 }
 
 ZipWriter::ZipWriter(std::ostream& os) 
-  : ZipStream(os)
+  : ZipStream(os), binaryEntry(false), Level(6), ThreadCount(1)
 {
 #ifdef _MSC_VER
     ZipStream.imbue(std::locale::empty());
@@ -263,28 +417,516 @@ ZipWriter::ZipWriter(std::ostream& os)
 #endif
     ZipStream.precision(12);
     ZipStream.setf(ios::fixed,ios::floatfield);
+    BinaryBuffer.imbue(std::locale::classic());
+    BinaryBuffer.precision(12);
+    BinaryBuffer.setf(ios::fixed,ios::floatfield);
+}
+
+void ZipWriter::putNextEntry(const char* str)
+{
+    finishBinaryEntry();
+    ZipStream.putNextEntry(str);
+    // the text is collected and converted when the entry is complete
+    if (getMode("BinaryDocument") && strcmp(str, "Document.xml") == 0)
+        binaryEntry = true;
+}
+
+void ZipWriter::finishBinaryEntry(void)
+{
+    if (!binaryEntry)
+        return;
+    binaryEntry = false;
+
+    Base::TimeInfo start;
+    std::string xml = BinaryBuffer.str();
+    BinaryBuffer.str(std::string());
+    if (!XMLBinaryStream::encode(xml, ZipStream)) {
+        // the reader detects the encoding, so the text is fine as well
+        ZipStream << xml;
+    }
+    Base::Console().Log("ZipWriter: Document.xml encoded in %.3f s\n",
+        Base::TimeInfo::diffTimeF(start, Base::TimeInfo()));
 }
 
 void ZipWriter::writeFiles(void)
+{
+    finishBinaryEntry();
+
+    Base::TimeInfo start;
+    Timings.clear();
+
+    // level 0 takes the buffered path too because it avoids zlib completely
+    if (ThreadCount == 1 && Level != Z_NO_COMPRESSION)
+        writeFilesSequential();
+    else
+        writeFilesConcurrent();
+
+    if (!Timings.empty()) {
+        unsigned long size = 0, compressedSize = 0;
+        for (std::vector<EntryTiming>::const_iterator it = Timings.begin(); it != Timings.end(); ++it) {
+            Base::Console().Log("ZipWriter: %s: %.3f s serialize, %.3f s compress, %lu -> %lu bytes\n",
+                it->FileName.c_str(), it->serializeTime, it->compressTime, it->size, it->compressedSize);
+            size += it->size;
+            compressedSize += it->compressedSize;
+        }
+        Base::Console().Log("ZipWriter: %lu files (%lu -> %lu bytes) written in %.3f s\n",
+            (unsigned long)Timings.size(), size, compressedSize,
+            Base::TimeInfo::diffTimeF(start, Base::TimeInfo()));
+    }
+}
+
+void ZipWriter::writeFilesSequential(void)
 {
     // use a while loop because it is possible that while
     // processing the files new ones can be added
     size_t index = 0;
     while (index < FileList.size()) {
         FileEntry entry = FileList.begin()[index];
+        Base::TimeInfo start;
         ZipStream.putNextEntry(entry.FileName);
         //entry.Object->SaveDocFile(*this);
+
+        // the stream compresses while writing, so the time cannot be split up
+        EntryTiming timing;
+        timing.FileName = entry.FileName;
+        timing.serializeTime = Base::TimeInfo::diffTimeF(start, Base::TimeInfo());
+        timing.compressTime = 0.0;
+        timing.size = 0;
+        timing.compressedSize = 0;
+        Timings.push_back(timing);
         index++;
     }
 }
 
+void ZipWriter::writeFilesConcurrent(void)
+{
+    int threads = ThreadCount > 0 ? ThreadCount : QThread::idealThreadCount();
+    if (threads < 1)
+        threads = 1;
+    // limit the number of buffered entries to keep the memory usage bounded
+    size_t window = 2 * threads;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    QMutex mutex;
+    QWaitCondition finished;
+    std::deque<ZipEntryJob*> jobs;
+    size_t submitted = 0;
+
+    try {
+        // use a while loop because it is possible that while
+        // processing the files new ones can be added
+        size_t index = 0;
+        while (index < FileList.size()) {
+            while (submitted < FileList.size() && submitted - index < window) {
+                ZipEntryJob* job = new ZipEntryJob();
+                job->FileName = FileList[submitted].FileName;
+                job->Object = FileList[submitted].Object;
+                job->Modes = Modes;
+                job->Names = FileNames;
+                job->FileVersion = fileVersion;
+                job->Level = Level;
+                job->Crc = 0;
+                job->Size = 0;
+                job->Method = zipios::STORED;
+                job->SerializeTime = 0.0;
+                job->CompressTime = 0.0;
+                job->Done = false;
+                jobs.push_back(job);
+                if (threads == 1) {
+                    job->run();
+                    job->Done = true;
+                }
+                else {
+                    pool.start(new ZipEntryTask(job, &mutex, &finished));
+                }
+                submitted++;
+            }
+
+            // the archive keeps the order of registration
+            ZipEntryJob* job = jobs.front();
+            {
+                QMutexLocker lock(&mutex);
+                while (!job->Done)
+                    finished.wait(&mutex);
+            }
+            jobs.pop_front();
+
+            if (!job->Error.empty()) {
+                addError(job->FileName + ": " + job->Error);
+            }
+            else {
+                ZipStream.putRawEntry(zipios::ZipCDirEntry(job->FileName), job->Data.data(),
+                    job->Data.size(), job->Crc, job->Size, job->Method);
+            }
+
+            EntryTiming timing;
+            timing.FileName = job->FileName;
+            timing.serializeTime = job->SerializeTime;
+            timing.compressTime = job->CompressTime;
+            timing.size = job->Size;
+            timing.compressedSize = job->Data.size();
+            Timings.push_back(timing);
+
+            // files registered while saving this one go to the end of the list
+            for (std::vector<std::pair<std::string, const Base::Persistence*> >::const_iterator
+                it = job->AddedFiles.begin(); it != job->AddedFiles.end(); ++it) {
+                FileEntry temp;
+                temp.FileName = it->first;
+                temp.Object = it->second;
+                FileList.push_back(temp);
+                FileNames.push_back(temp.FileName);
+            }
+
+            delete job;
+            index++;
+        }
+    }
+    catch (...) {
+        pool.waitForDone();
+        for (std::deque<ZipEntryJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+            delete *it;
+        throw;
+    }
+}
+
 ZipWriter::~ZipWriter()
 {
+    try {
+        finishBinaryEntry();
+    }
+    catch (...) {
+    }
     ZipStream.close();
 }
 
 // ----------------------------------------------------------------------------
 
+const char XMLBinaryStream::Magic[4] = {'\0', 'F', 'C', 'B'};
+const unsigned char XMLBinaryStream::Version = 1;
+
+void XMLBinaryStream::writeUInt(std::ostream& out, unsigned long value)
+{
+    // 7 bits per byte, the high bit marks that more bytes follow
+    while (value >= 0x80) {
+        out.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+unsigned long XMLBinaryStream::readUInt(std::istream& in)
+{
+    unsigned long value = 0;
+    int shift = 0;
+    int c;
+    do {
+        c = in.get();
+        if (c == EOF || shift > 63)
+            throw Base::XMLBaseException("Unexpected end of binary document");
+        value |= static_cast<unsigned long>(c & 0x7f) << shift;
+        shift += 7;
+    }
+    while (c & 0x80);
+    return value;
+}
+
+void XMLBinaryStream::writeString(std::ostream& out, const std::string& value)
+{
+    writeUInt(out, value.size());
+    out.write(value.c_str(), value.size());
+}
+
+void XMLBinaryStream::readString(std::istream& in, std::string& value)
+{
+    unsigned long size = readUInt(in);
+    value.resize(size);
+    if (size > 0 && !in.read(&value[0], size))
+        throw Base::XMLBaseException("Unexpected end of binary document");
+}
+
+namespace {
+
+struct XMLBinaryEncoder
+{
+    const std::string& xml;
+    std::size_t pos;
+    std::ostringstream out;
+    std::map<std::string, unsigned long> names;
+    bool emptyElement;
+
+    XMLBinaryEncoder(const std::string& str) : xml(str), pos(0), emptyElement(false)
+    {
+    }
+
+    bool startsWith(const char* str) const
+    {
+        return xml.compare(pos, strlen(str), str) == 0;
+    }
+    // adds the name to the string table of the stream if it's not yet part of it
+    void defineName(const std::string& name)
+    {
+        if (names.find(name) == names.end()) {
+            unsigned long id = names.size();
+            names[name] = id;
+            out.put(XMLBinaryStream::Name);
+            XMLBinaryStream::writeString(out, name);
+        }
+    }
+    void writeName(const std::string& name)
+    {
+        XMLBinaryStream::writeUInt(out, names[name]);
+    }
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    static void appendUtf8(std::string& str, unsigned long code)
+    {
+        if (code < 0x80) {
+            str += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            str += static_cast<char>(0xc0 | (code >> 6));
+            str += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000) {
+            str += static_cast<char>(0xe0 | (code >> 12));
+            str += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else {
+            str += static_cast<char>(0xf0 | (code >> 18));
+            str += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            str += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+    // resolves the entities like the XML parser does
+    static bool unescape(const std::string& text, std::string& result, bool attribute)
+    {
+        result.clear();
+        result.reserve(text.size());
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '&') {
+                std::size_t end = text.find(';', i);
+                if (end == std::string::npos)
+                    return false;
+                std::string entity = text.substr(i + 1, end - i - 1);
+                if (entity == "lt")
+                    result += '<';
+                else if (entity == "gt")
+                    result += '>';
+                else if (entity == "amp")
+                    result += '&';
+                else if (entity == "quot")
+                    result += '"';
+                else if (entity == "apos")
+                    result += '\'';
+                else if (entity.size() > 2 && entity[0] == '#' && entity[1] == 'x')
+                    appendUtf8(result, strtoul(entity.c_str() + 2, 0, 16));
+                else if (entity.size() > 1 && entity[0] == '#')
+                    appendUtf8(result, strtoul(entity.c_str() + 1, 0, 10));
+                else
+                    return false;
+                i = end;
+            }
+            else if (c == '\r') {
+                // line breaks are normalized, in attributes all white space becomes a blank
+                if (i + 1 < text.size() && text[i + 1] == '\n')
+                    ++i;
+                result += attribute ? ' ' : '\n';
+            }
+            else if (attribute && (c == '\n' || c == '\t')) {
+                result += ' ';
+            }
+            else {
+                result += c;
+            }
+        }
+        return true;
+    }
+    bool skipTo(const char* str)
+    {
+        std::size_t end = xml.find(str, pos);
+        if (end == std::string::npos)
+            return false;
+        pos = end + strlen(str);
+        return true;
+    }
+    bool readName(std::string& name)
+    {
+        std::size_t start = pos;
+        while (pos < xml.size() && !isSpace(xml[pos]) && xml[pos] != '>' &&
+               xml[pos] != '/' && xml[pos] != '=')
+            ++pos;
+        name = xml.substr(start, pos - start);
+        return !name.empty();
+    }
+    void skipSpace()
+    {
+        while (pos < xml.size() && isSpace(xml[pos]))
+            ++pos;
+    }
+    bool element()
+    {
+        ++pos; // '<'
+        std::string name;
+        if (!readName(name))
+            return false;
+
+        std::vector<std::pair<std::string, std::string> > attrs;
+        for (;;) {
+            skipSpace();
+            if (pos >= xml.size())
+                return false;
+            if (xml[pos] == '>' || xml[pos] == '/')
+                break;
+            std::string attr, value;
+            if (!readName(attr))
+                return false;
+            skipSpace();
+            if (pos >= xml.size() || xml[pos] != '=')
+                return false;
+            ++pos;
+            skipSpace();
+            if (pos >= xml.size() || (xml[pos] != '"' && xml[pos] != '\''))
+                return false;
+            char quote = xml[pos++];
+            std::size_t end = xml.find(quote, pos);
+            if (end == std::string::npos)
+                return false;
+            if (!unescape(xml.substr(pos, end - pos), value, true))
+                return false;
+            pos = end + 1;
+            attrs.push_back(std::make_pair(attr, value));
+        }
+
+        bool empty = (xml[pos] == '/');
+        if (empty) {
+            ++pos;
+            if (pos >= xml.size() || xml[pos] != '>')
+                return false;
+        }
+        ++pos; // '>'
+
+        // the names must be known before the element refers to them
+        defineName(name);
+        for (std::vector<std::pair<std::string, std::string> >::iterator it = attrs.begin(); it != attrs.end(); ++it)
+            defineName(it->first);
+        emptyElement = empty;
+        out.put(empty ? XMLBinaryStream::StartEndElement : XMLBinaryStream::StartElement);
+        writeName(name);
+        XMLBinaryStream::writeUInt(out, attrs.size());
+        for (std::vector<std::pair<std::string, std::string> >::iterator it = attrs.begin(); it != attrs.end(); ++it) {
+            writeName(it->first);
+            XMLBinaryStream::writeString(out, it->second);
+        }
+        return true;
+    }
+    bool endElement()
+    {
+        pos += 2; // '</'
+        std::string name;
+        if (!readName(name))
+            return false;
+        skipSpace();
+        if (pos >= xml.size() || xml[pos] != '>')
+            return false;
+        ++pos;
+        defineName(name);
+        out.put(XMLBinaryStream::EndElement);
+        writeName(name);
+        return true;
+    }
+    bool characters()
+    {
+        std::size_t end = xml.find('<', pos);
+        if (end == std::string::npos)
+            end = xml.size();
+        std::string text = xml.substr(pos, end - pos);
+        pos = end;
+
+        // skip the indentation between the elements
+        bool blank = true;
+        for (std::string::iterator it = text.begin(); it != text.end() && blank; ++it)
+            blank = isSpace(*it);
+        if (blank && text.find('\n') != std::string::npos)
+            return true;
+
+        std::string value;
+        if (!unescape(text, value, false))
+            return false;
+        out.put(XMLBinaryStream::Characters);
+        XMLBinaryStream::writeString(out, value);
+        return true;
+    }
+    bool cdata()
+    {
+        pos += 9; // '<![CDATA['
+        std::size_t end = xml.find("]]>", pos);
+        if (end == std::string::npos)
+            return false;
+        out.put(XMLBinaryStream::CDATA);
+        XMLBinaryStream::writeString(out, xml.substr(pos, end - pos));
+        pos = end + 3;
+        return true;
+    }
+    bool run()
+    {
+        int level = 0;
+        while (pos < xml.size()) {
+            bool ok;
+            if (xml[pos] != '<') {
+                ok = characters();
+            }
+            else if (startsWith("<?")) {
+                ok = skipTo("?>");
+            }
+            else if (startsWith("<!--")) {
+                ok = skipTo("-->");
+            }
+            else if (startsWith("<![CDATA[")) {
+                ok = cdata();
+            }
+            else if (startsWith("<!")) {
+                // DTDs are not supported
+                ok = false;
+            }
+            else if (startsWith("</")) {
+                ok = endElement();
+                level--;
+            }
+            else {
+                ok = element();
+                if (ok && !emptyElement)
+                    level++;
+            }
+            if (!ok || level < 0)
+                return false;
+        }
+        out.put(XMLBinaryStream::EndDocument);
+        return level == 0;
+    }
+};
+
+}
+
+bool XMLBinaryStream::encode(const std::string& xml, std::ostream& out)
+{
+    XMLBinaryEncoder encoder(xml);
+    if (!encoder.run())
+        return false;
+    out.write(Magic, sizeof(Magic));
+    out.put(static_cast<char>(Version));
+    std::string data = encoder.out.str();
+    out.write(data.c_str(), data.size());
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
 FileWriter::FileWriter(const char* DirName) : DirName(DirName)
 {
 }
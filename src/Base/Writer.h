@@ -26,8 +26,8 @@
 
 #include <set>
 #include <string>
-#include <sstream>
-#include <vector>
+#include <sstream>
+#include <vector>
 #include <cassert>
 
 #ifdef _MSC_VER
@@ -140,6 +140,12 @@ protected:
 /** The ZipWriter class 
  * This is an important helper class implementation for the store and retrieval system
  * of persistent objects in FreeCAD. 
+ *
+ * With a thread count other than 1 the additional files are serialized and compressed
+ * concurrently, each into its own memory buffer, and are appended to the archive in
+ * the order they were registered. Only a limited number of entries is kept in memory
+ * at the same time. With compression level 0 the entries are stored without running
+ * them through zlib at all.
  * \see Base::Persistence
  * \author Juergen Riegel
  */
@@ -152,14 +158,84 @@ public:
 
     virtual void writeFiles(void);
 
-    virtual std::ostream &Stream(void){return ZipStream;}
+    virtual std::ostream &Stream(void){
+        if (binaryEntry)
+            return BinaryBuffer;
+        return ZipStream;
+    }
 
     void setComment(const char* str){ZipStream.setComment(str);}
-    void setLevel(int level){ZipStream.setLevel( level );}
-    void putNextEntry(const char* str){ZipStream.putNextEntry(str);}
+    void setLevel(int level){ZipStream.setLevel( level ); Level = level;}
+    /** Start a new entry in the archive
+     * If the mode "BinaryDocument" is set the Document.xml entry is written
+     * in the compact binary encoding of XMLBinaryStream.
+     */
+    void putNextEntry(const char* str);
+
+    /// Set the number of threads used by writeFiles(), 0 uses all cores and 1 writes sequentially
+    void setThreadCount(int count){ThreadCount = count;}
+    int getThreadCount(void) const {return ThreadCount;}
+
+    /// Time spent on one additional file by writeFiles()
+    struct EntryTiming {
+        std::string FileName;
+        double serializeTime;
+        double compressTime;
+        unsigned long size;
+        unsigned long compressedSize;
+    };
+    /// get the timings of the files written by the last call of writeFiles()
+    const std::vector<EntryTiming>& getEntryTimings() const {return Timings;}
 
 private:
+    void writeFilesSequential(void);
+    void writeFilesConcurrent(void);
+    void finishBinaryEntry(void);
+
     zipios::ZipOutputStream ZipStream;
+    std::ostringstream BinaryBuffer;
+    bool binaryEntry;
+    int Level;
+    int ThreadCount;
+    std::vector<EntryTiming> Timings;
+};
+
+/** The XMLBinaryStream class
+ * Compact binary encoding of the XML document stream. The element and
+ * attribute names are stored once in a string table, the values are kept
+ * as text. Reading it skips the XML parser completely while the readers of
+ * the properties get exactly the same elements and attributes as from the
+ * XML text. A stream starts with Magic followed by the Version byte.
+ * \see XMLReader
+ */
+class BaseExport XMLBinaryStream
+{
+public:
+    enum Token {
+        EndDocument = 0,
+        StartElement,    ///< name, attribute count, attributes (name, value)
+        StartEndElement, ///< same as StartElement for an element without content
+        EndElement,      ///< name
+        Characters,      ///< text
+        CDATA,           ///< text
+        Name             ///< adds the text to the string table
+    };
+
+    /// the first bytes of a binary document stream, never the start of an XML file
+    static const char Magic[4];
+    /// the current version of the encoding
+    static const unsigned char Version;
+
+    /** Converts the XML text into the binary encoding
+     * Returns false if the text uses XML features that the encoding
+     * doesn't support. Nothing is written to the stream in this case.
+     */
+    static bool encode(const std::string& xml, std::ostream& out);
+
+    static void writeUInt(std::ostream& out, unsigned long value);
+    static unsigned long readUInt(std::istream& in);
+    static void writeString(std::ostream& out, const std::string& value);
+    static void readString(std::istream& in, std::string& value);
 };
 
 /** The StringWriter class 
@@ -172,6 +172,9 @@ Document::Document(App::Document* pcDocument,Application * app)
         d->_pcDocument->setUndoMode(1);
         // set the maximum stack size
         d->_pcDocument->setMaxUndoStackSize(App::GetApplication().GetParameterGroupByPath("User parameter:BaseApp/Preferences/Document")->GetInt("MaxUndoSize",20));
+        // memory limit of the undo stack in MB, 0 means no limit
+        unsigned long undoMemory = App::GetApplication().GetParameterGroupByPath("User parameter:BaseApp/Preferences/Document")->GetUnsigned("MaxUndoMemory",0);
+        d->_pcDocument->setUndoLimit(undoMemory * 1024 * 1024);
     }
 }
 
@@ -73,6 +73,8 @@
 # include <TopoDS_Iterator.hxx>
 # include <APIHeaderSection_MakeHeader.hxx>
 # include <OSD_Exception.hxx>
+# include <BRepMesh_IncrementalMesh.hxx>
+# include <ShapeFix_Shape.hxx>
 #if OCC_VERSION_HEX >= 0x060500
 # include <TDataXtd_Shape.hxx>
 # else
@@ -80,7 +82,12 @@
 # endif
 #endif
 
+#include <QFuture>
+#include <QtConcurrentRun>
+
 #include <Base/Console.h>
+#include <Base/TimeInfo.h>
+#include <Base/Tools.h>
 #include <App/Application.h>
 #include <App/Document.h>
 #include <App/DocumentObjectPy.h>
@@ -108,8 +115,30 @@ using namespace Import;
 
 #define OCAF_KEEP_PLACEMENT
 
+/// A shape that is healed and triangulated in a worker thread
+struct ImportOCAF::ShapeJob
+{
+    TopoDS_Shape input;
+    TopoDS_Shape shape;
+    bool heal;
+    bool mesh;
+    double deviation;
+    double angularDeflection;
+    // the location of the shape whose bounding box gives the deflection
+    TopLoc_Location loc;
+    // a job that shares sub-shapes with another job must not run concurrently to it
+    bool serial;
+    int faces;
+    double healTime;
+    double meshTime;
+    std::string error;
+    QFuture<void> future;
+};
+
 ImportOCAF::ImportOCAF(Handle(TDocStd_Document) h, App::Document* d, const std::string& name)
     : pDoc(h), doc(d), default_name(name)
+    , pipeline(false), healShapes(false), meshShapes(false), instancedRendering(false)
+    , meshDeviation(0.2), meshAngularDeflection(28.65)
 {
     aShapeTool = XCAFDoc_DocumentTool::ShapeTool (pDoc->Main());
     aColorTool = XCAFDoc_DocumentTool::ColorTool(pDoc->Main());
@@ -117,14 +146,206 @@ ImportOCAF::ImportOCAF(Handle(TDocStd_Document) h, App::Document* d, const std::
 
 ImportOCAF::~ImportOCAF()
 {
+    for (std::vector<ShapeJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        (*it)->future.waitForFinished();
+        delete *it;
+    }
 }
 
 void ImportOCAF::loadShapes()
 {
+    Base::Reference<ParameterGrp> hGrp = App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Mod/Import");
+    pipeline = hGrp->GetBool("ParallelImport", false);
+    healShapes = hGrp->GetBool("HealShapes", false);
+    meshShapes = tessellateShapes();
+    if (meshShapes) {
+        // the view providers then find a triangulation with their own parameters
+        Base::Reference<ParameterGrp> hPart = App::GetApplication().GetParameterGroupByPath
+            ("User parameter:BaseApp/Preferences/Mod/Part");
+        // ViewProviderPartExt keeps them as float, they must compare equal
+        meshDeviation = static_cast<float>(hPart->GetFloat("MeshDeviation", 0.2));
+        meshAngularDeflection = static_cast<float>(hPart->GetFloat("MeshAngularDeflection", 28.65));
+        instancedRendering = hPart->GetBool("InstancedRendering", false);
+    }
+
+    Base::TimeInfo start;
     std::vector<App::DocumentObject*> lValue;
     myRefShapes.clear();
     loadShapes(pDoc->Main(), TopLoc_Location(), default_name, "", false, lValue);
     lValue.clear();
+
+    if (pipeline)
+        finishShapes(Base::TimeInfo::diffTimeF(start, Base::TimeInfo()));
+}
+
+void ImportOCAF::setShape(Part::Feature* part, const TopoDS_Shape& key, const TopoDS_Shape& shape,
+                          const TopLoc_Location& loc, const std::vector<App::Color>& colors)
+{
+    if (!pipeline) {
+        if (!loc.IsIdentity())
+            part->Shape.setValue(shape.Moved(loc));
+        else
+            part->Shape.setValue(shape);
+        if (!colors.empty())
+            applyColors(part, colors);
+        return;
+    }
+
+    PendingShape item;
+    item.part = part;
+    item.job = 0;
+    item.loc = loc;
+    item.colors = colors;
+
+    // another instance of the same shape uses the same job
+    if (jobIndex.IsBound(key)) {
+        ShapeJob* job = jobs[jobIndex.Find(key)];
+        if (job->input.Orientation() == shape.Orientation())
+            item.job = job;
+    }
+
+    if (!item.job) {
+        ShapeJob* job = new ShapeJob();
+        job->input = shape;
+        job->shape = shape;
+        // healing may change the faces so that the face colors don't fit any more
+        job->heal = healShapes && colors.size() <= 1;
+        job->mesh = meshShapes;
+        job->deviation = meshDeviation;
+        job->angularDeflection = Base::toRadians<double>(meshAngularDeflection);
+        // without instanced rendering the view provider takes the bounding box
+        // of the placed shape, the one of the first instance is used
+        if (!instancedRendering)
+            job->loc = loc;
+        job->serial = false;
+        job->faces = 0;
+        job->healTime = 0.0;
+        job->meshTime = 0.0;
+
+        static const TopAbs_ShapeEnum types[] = {TopAbs_FACE, TopAbs_EDGE, TopAbs_VERTEX};
+        for (int i = 0; i < 3; i++) {
+            for (TopExp_Explorer xp(shape, types[i]); xp.More(); xp.Next()) {
+                if (types[i] == TopAbs_FACE)
+                    job->faces++;
+                if (!jobSubShapes.Add(xp.Current().Located(TopLoc_Location())))
+                    job->serial = true;
+            }
+        }
+
+        if (!jobIndex.IsBound(key))
+            jobIndex.Bind(key, static_cast<int>(jobs.size()));
+        jobs.push_back(job);
+        if (!job->serial && (job->heal || job->mesh))
+            job->future = QtConcurrent::run(&ImportOCAF::processShape, job);
+        item.job = job;
+    }
+
+    pending.push_back(item);
+}
+
+void ImportOCAF::processShape(ShapeJob* job)
+{
+    try {
+        Base::TimeInfo start;
+        if (job->heal) {
+            Handle(ShapeFix_Shape) fix = new ShapeFix_Shape(job->shape);
+            fix->Perform();
+            job->shape = fix->Shape();
+        }
+        Base::TimeInfo healed;
+        job->healTime = Base::TimeInfo::diffTimeF(start, healed);
+
+        if (job->mesh) {
+            // the same deflection as ViewProviderPartExt computes for the shape
+            Bnd_Box bounds;
+            BRepBndLib::Add(job->loc.IsIdentity() ? job->shape : job->shape.Moved(job->loc), bounds);
+            bounds.SetGap(0.0);
+            Standard_Real xMin, yMin, zMin, xMax, yMax, zMax;
+            bounds.Get(xMin, yMin, zMin, xMax, yMax, zMax);
+            Standard_Real deflection = ((xMax-xMin)+(yMax-yMin)+(zMax-zMin))/300.0 *
+                job->deviation;
+            // the jobs run concurrently already
+#if OCC_VERSION_HEX >= 0x060600
+            BRepMesh_IncrementalMesh(job->shape, deflection, Standard_False,
+                job->angularDeflection, Standard_False);
+#else
+            BRepMesh_IncrementalMesh(job->shape, deflection);
+#endif
+        }
+        job->meshTime = Base::TimeInfo::diffTimeF(healed, Base::TimeInfo());
+    }
+    catch (Standard_Failure& e) {
+        // Standard_Failure::Caught() is not reliable in a worker thread
+        const char* msg = e.GetMessageString();
+        job->error = (msg && msg[0] != '\0') ? msg : "Unknown OCC exception";
+    }
+    catch (...) {
+        job->error = "Unknown exception";
+    }
+}
+
+void ImportOCAF::finishShapes(double traversalTime)
+{
+    Base::TimeInfo start;
+
+    // the jobs that share sub-shapes with others run when all others are done
+    for (std::vector<ShapeJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+        (*it)->future.waitForFinished();
+    for (std::vector<ShapeJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        if ((*it)->serial && ((*it)->heal || (*it)->mesh))
+            processShape(*it);
+    }
+    double waitTime = Base::TimeInfo::diffTimeF(start, Base::TimeInfo());
+
+    for (std::vector<PendingShape>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        ShapeJob* job = it->job;
+        if (!job->error.empty()) {
+            Base::Console().Warning("Cannot heal or triangulate the shape of '%s': %s\n",
+                it->part->Label.getValue(), job->error.c_str());
+            job->shape = job->input;
+            job->error.clear();
+            job->mesh = false;
+        }
+
+        if (!it->loc.IsIdentity())
+            it->part->Shape.setValue(job->shape.Moved(it->loc));
+        else
+            it->part->Shape.setValue(job->shape);
+        if (job->mesh)
+            it->part->Shape.setTriangulationParameters(meshDeviation, meshAngularDeflection);
+        if (!it->colors.empty())
+            applyColors(it->part, it->colors);
+    }
+
+    int faces = 0;
+    double healTime = 0.0, meshTime = 0.0;
+    for (std::vector<ShapeJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        faces += (*it)->faces;
+        healTime += (*it)->healTime;
+        meshTime += (*it)->meshTime;
+    }
+    double totalTime = traversalTime + Base::TimeInfo::diffTimeF(start, Base::TimeInfo());
+
+    Base::Console().Log("Import: traversal of %d shapes in %.3f s (%.1f shapes/s)\n",
+        (int)pending.size(), traversalTime, traversalTime > 0.0 ? pending.size() / traversalTime : 0.0);
+    Base::Console().Log("Import: %d instances use %d distinct shapes with %d faces\n",
+        (int)pending.size(), (int)jobs.size(), faces);
+    if (healShapes)
+        Base::Console().Log("Import: healing busy %.3f s (%.1f faces/s)\n",
+            healTime, healTime > 0.0 ? faces / healTime : 0.0);
+    if (meshShapes)
+        Base::Console().Log("Import: triangulation busy %.3f s (%.1f faces/s)\n",
+            meshTime, meshTime > 0.0 ? faces / meshTime : 0.0);
+    Base::Console().Log("Import: waited %.3f s for the workers, total %.3f s\n",
+        waitTime, totalTime);
+
+    for (std::vector<ShapeJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it)
+        delete *it;
+    jobs.clear();
+    pending.clear();
+    jobIndex.Clear();
+    jobSubShapes.Clear();
 }
 
 void ImportOCAF::loadShapes(const TDF_Label& label, const TopLoc_Location& loc,
@@ -363,11 +584,8 @@ void ImportOCAF::createShape(const TDF_Label& label, const TopLoc_Location& loc,
                 Base::Placement pl;
                 pl.fromMatrix(mtrx);
                 part->Placement.setValue(pl);
-                if (!loc.IsIdentity())
-                    part->Shape.setValue(comp.Moved(loc));
-                else
-                    part->Shape.setValue(comp);
                 part->Label.setValue(name);
+                setShape(part, aShape, comp, loc, std::vector<App::Color>());
                 lValue.push_back(part);
             }
         }
@@ -415,16 +633,11 @@ void ImportOCAF::createShape(const TopoDS_Shape& aShape, const TopLoc_Location&
                              std::vector<App::DocumentObject*>& lvalue)
 {
     Part::Feature* part = static_cast<Part::Feature*>(doc->addObject("Part::Feature"));
-
-    if (!loc.IsIdentity())
-        // part->Shape.setValue(aShape.Moved(TopLoc_Location(loc.FirstDatum())));
-        part->Shape.setValue(aShape.Moved(loc));
-    else
-        part->Shape.setValue(aShape);
-
     part->Label.setValue(name);
     lvalue.push_back(part);
 
+    // the colors are applied together with the shape, see setShape()
+    std::vector<App::Color> colors;
     Quantity_Color aColor;
     App::Color color(0.8f,0.8f,0.8f);
     if (aColorTool->GetColor(aShape, XCAFDoc_ColorGen, aColor) ||
@@ -433,9 +646,7 @@ void ImportOCAF::createShape(const TopoDS_Shape& aShape, const TopLoc_Location&
         color.r = (float)aColor.Red();
         color.g = (float)aColor.Green();
         color.b = (float)aColor.Blue();
-        std::vector<App::Color> colors;
         colors.push_back(color);
-        applyColors(part, colors);
     }
 
     TopTools_IndexedMapOfShape faces;
@@ -463,9 +674,9 @@ void ImportOCAF::createShape(const TopoDS_Shape& aShape, const TopLoc_Location&
         xp.Next();
     }
 
-    if (found_face_color) {
-        applyColors(part, faceColors);
-    }
+    if (found_face_color)
+        colors.swap(faceColors);
+    setShape(part, aShape, aShape, loc, colors);
 }
 
 // ----------------------------------------------------------------------------
@@ -29,6 +29,9 @@
 #include <XCAFDoc_ShapeTool.hxx>
 #include <Quantity_Color.hxx>
 #include <TopoDS_Shape.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopTools_DataMapOfShapeInteger.hxx>
+#include <TopTools_MapOfShape.hxx>
 #include <climits>
 #include <string>
 #include <set>
@@ -59,12 +62,35 @@ public:
     virtual ~ImportOCAF();
     void loadShapes();
 
+protected:
+    /// Return true to triangulate the shapes for the 3d view while they are imported
+    virtual bool tessellateShapes() const { return false; }
+
 private:
     void loadShapes(const TDF_Label& label, const TopLoc_Location&, const std::string& partname, const std::string& assembly, bool isRef, std::vector<App::DocumentObject*> &);
     void createShape(const TDF_Label& label, const TopLoc_Location&, const std::string&, std::vector<App::DocumentObject*> &, bool);
     void createShape(const TopoDS_Shape& label, const TopLoc_Location&, const std::string&, std::vector<App::DocumentObject*> &);
     virtual void applyColors(Part::Feature*, const std::vector<App::Color>&){}
 
+    /** @name Import pipeline
+     * With the ParallelImport preference of Mod/Import the shapes are healed and
+     * triangulated in worker threads while the label tree is still traversed.
+     * The instances of a shape share the result.
+     */
+    //@{
+    struct ShapeJob;
+    struct PendingShape {
+        Part::Feature* part;
+        ShapeJob* job;
+        TopLoc_Location loc;
+        std::vector<App::Color> colors;
+    };
+    void setShape(Part::Feature*, const TopoDS_Shape& key, const TopoDS_Shape& shape,
+                  const TopLoc_Location&, const std::vector<App::Color>& colors);
+    void finishShapes(double traversalTime);
+    static void processShape(ShapeJob*);
+    //@}
+
 private:
     Handle(TDocStd_Document) pDoc;
     App::Document* doc;
@@ -73,6 +99,18 @@ private:
     std::string default_name;
     std::set<int> myRefShapes;
     static const int HashUpper = INT_MAX;
+
+    bool pipeline;
+    bool healShapes;
+    bool meshShapes;
+    bool instancedRendering;
+    double meshDeviation;
+    double meshAngularDeflection;
+    std::vector<ShapeJob*> jobs;
+    std::vector<PendingShape> pending;
+    // the job of every imported shape and the sub-shapes used by the jobs
+    TopTools_DataMapOfShapeInteger jobIndex;
+    TopTools_MapOfShape jobSubShapes;
 };
 
 class ImportExport ExportOCAF
@@ -279,6 +279,10 @@ public:
     }
 
 private:
+    bool tessellateShapes() const
+    {
+        return true;
+    }
     void applyColors(Part::Feature* part, const std::vector<App::Color>& colors)
     {
         Gui::ViewProvider* vp = Gui::Application::Instance->getViewProvider(part);
@@ -48,6 +48,7 @@
 #include <Mod/Mesh/App/Mesh.h>
 #include <Mod/Mesh/App/MeshFeature.h>
 #include <Mod/Mesh/App/Core/Algorithm.h>
+#include <Mod/Mesh/App/Core/BVH.h>
 #include <Mod/Mesh/App/Core/Grid.h>
 #include <Mod/Mesh/App/Core/Iterator.h>
 #include <Mod/Mesh/App/Core/MeshKernel.h>
@@ -253,34 +254,18 @@ namespace Inspection {
     };
 }
 
-InspectNominalMesh::InspectNominalMesh(const Mesh::MeshObject& rMesh, float offset) : _iter(rMesh.getKernel())
+InspectNominalMesh::InspectNominalMesh(const Mesh::MeshObject& rMesh, float offset)
+  : _rKernel(rMesh.getKernel()), _clMat(rMesh.getTransform())
 {
-    const MeshCore::MeshKernel& kernel = rMesh.getKernel();
-    _iter.Transform(rMesh.getTransform());
-
-    // Max. limit of grid elements
-    float fMaxGridElements=8000000.0f;
-    Base::BoundBox3f box = kernel.GetBoundBox().Transformed(rMesh.getTransform());
-
-    // estimate the minimum allowed grid length
-    float fMinGridLen = (float)pow((box.LengthX()*box.LengthY()*box.LengthZ()/fMaxGridElements), 0.3333f);
-    float fGridLen = 5.0f * MeshCore::MeshAlgorithm(kernel).GetAverageEdgeLength();
-
-    // We want to avoid to get too small grid elements otherwise building up the grid structure would take
-    // too much time and memory. 
-    // Having quite a dense grid speeds up more the following algorithms extremely. Due to the issue above it's
-    // always a compromise between speed and memory usage.
-    fGridLen = std::max<float>(fMinGridLen, fGridLen);
-
-    // build up grid structure to speed up algorithms
-    _pGrid = new MeshInspectGrid(kernel, fGridLen, rMesh.getTransform());
-    _box = box;
+    // the queries don't modify the hierarchy, so the points can be checked in several threads
+    _pBVH = new MeshCore::MeshFacetBVH(_rKernel, _clMat);
+    _box = _pBVH->GetBoundBox();
     _box.Enlarge(offset);
 }
 
 InspectNominalMesh::~InspectNominalMesh()
 {
-    delete this->_pGrid;
+    delete this->_pBVH;
 }
 
 float InspectNominalMesh::getDistance(const Base::Vector3f& point)
@@ -288,26 +273,17 @@ float InspectNominalMesh::getDistance(const Base::Vector3f& point)
     if (!_box.IsInBox(point))
         return FLT_MAX; // must be inside bbox
 
-    std::vector<unsigned long> indices;
-    //_pGrid->GetElements(point, indices);
-    if (indices.empty()) {
-        std::set<unsigned long> inds;
-        _pGrid->MeshGrid::SearchNearestFromPoint(point, inds);
-        indices.insert(indices.begin(), inds.begin(), inds.end());
-    }
-
-    float fMinDist=FLT_MAX;
-    bool positive = true;
-    for (std::vector<unsigned long>::iterator it = indices.begin(); it != indices.end(); ++it) {
-        _iter.Set(*it);
-        float fDist = _iter->DistanceToPoint(point);
-        if (fabs(fDist) < fabs(fMinDist)) {
-            fMinDist = fDist;
-            positive = point.DistanceToPlane(_iter->_aclPoints[0], _iter->GetNormal()) > 0;
-        }
-    }
-
-    if (!positive)
+    Base::Vector3f res;
+    unsigned long index;
+    if (!_pBVH->NearestPointFromPoint(point, res, index))
+        return FLT_MAX;
+
+    MeshCore::MeshGeomFacet face = _rKernel.GetFacet(index);
+    MeshCore::MeshGeomFacet trf(_clMat * face._aclPoints[0],
+                                _clMat * face._aclPoints[1],
+                                _clMat * face._aclPoints[2]);
+    float fMinDist = Base::Distance(point, res);
+    if (point.DistanceToPlane(trf._aclPoints[0], trf.GetNormal()) <= 0)
         fMinDist = -fMinDist;
     return fMinDist;
 }
@@ -37,6 +37,7 @@ class BRepExtrema_DistShapeShape;
 namespace MeshCore {
 class MeshKernel;
 class MeshGrid;
+class MeshFacetBVH;
 }
 
 namespace Mesh   { class MeshObject; }
@@ -110,8 +111,9 @@ public:
     virtual float getDistance(const Base::Vector3f&);
 
 private:
-    MeshCore::MeshFacetIterator _iter;
-    MeshCore::MeshGrid* _pGrid;
+    const MeshCore::MeshKernel& _rKernel;
+    Base::Matrix4D _clMat;
+    MeshCore::MeshFacetBVH* _pBVH;
     Base::BoundBox3f _box;
 };
 
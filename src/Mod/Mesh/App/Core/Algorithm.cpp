@@ -27,7 +27,11 @@
 # include <algorithm>
 #endif
 
+#include <QAtomicInt>
+
 #include "Algorithm.h"
+#include "Blocks.h"
+#include "BVH.h"
 #include "Approximation.h"
 #include "Elements.h"
 #include "Iterator.h"
@@ -140,6 +144,12 @@ bool MeshAlgorithm::NearestFacetOnRay (const Base::Vector3f &rclPt, const Base::
     return false;
 }
 
+bool MeshAlgorithm::NearestFacetOnRay (const Base::Vector3f &rclPt, const Base::Vector3f &rclDir, const MeshFacetBVH &rclBVH,
+                                       Base::Vector3f &rclRes, unsigned long &rulFacet) const
+{
+    return rclBVH.NearestFacetOnRay(rclPt, rclDir, rclRes, rulFacet);
+}
+
 bool MeshAlgorithm::NearestFacetOnRay (const Base::Vector3f &rclPt, const Base::Vector3f &rclDir, const std::vector<unsigned long> &raulFacets,
                                        Base::Vector3f &rclRes, unsigned long &rulFacet) const
 {
@@ -619,7 +629,7 @@ void MeshAlgorithm::SplitBoundaryLoops(const std::vector<unsigned long>& rBound,
 bool MeshAlgorithm::FillupHole(const std::vector<unsigned long>& boundary, 
                                AbstractPolygonTriangulator& cTria, 
                                MeshFacetArray& rFaces, MeshPointArray& rPoints,
-                               int level, const MeshRefPointToFacets* pP2FStructure) const
+                               int level, const MeshFlatPointToFacets* pP2FStructure) const
 {
     if (boundary.front() == boundary.back()) {
         // first and last vertex are identical
@@ -636,8 +646,8 @@ bool MeshAlgorithm::FillupHole(const std::vector<unsigned long>& boundary,
     unsigned long refPoint0 = *(boundary.begin());
     unsigned long refPoint1 = *(boundary.begin()+1);
     if (pP2FStructure) {
-        const std::set<unsigned long>& ring1 = (*pP2FStructure)[refPoint0];
-        const std::set<unsigned long>& ring2 = (*pP2FStructure)[refPoint1];
+        MeshIndexRange ring1 = (*pP2FStructure)[refPoint0];
+        MeshIndexRange ring2 = (*pP2FStructure)[refPoint1];
         std::vector<unsigned long> f_int;
         std::set_intersection(ring1.begin(), ring1.end(), ring2.begin(), ring2.end(),
             std::back_insert_iterator<std::vector<unsigned long> >(f_int));
@@ -1400,6 +1410,17 @@ bool MeshAlgorithm::NearestPointFromPoint (const Base::Vector3f &rclPt, const Me
   return true;
 }
 
+bool MeshAlgorithm::NearestPointFromPoint (const Base::Vector3f &rclPt, const MeshFacetBVH& rclBVH, unsigned long &rclResFacetIndex, Base::Vector3f &rclResPoint) const
+{
+  return rclBVH.NearestPointFromPoint(rclPt, rclResPoint, rclResFacetIndex);
+}
+
+bool MeshAlgorithm::NearestPointFromPoint (const Base::Vector3f &rclPt, const MeshFacetBVH& rclBVH, float fMaxSearchArea,
+                                           unsigned long &rclResFacetIndex, Base::Vector3f &rclResPoint) const
+{
+  return rclBVH.NearestPointFromPoint(rclPt, rclResPoint, rclResFacetIndex, fMaxSearchArea);
+}
+
 bool MeshAlgorithm::CutWithPlane (const Base::Vector3f &clBase, const Base::Vector3f &clNormal, const MeshFacetGrid &rclGrid,
                                   std::list<std::vector<Base::Vector3f> > &rclResult, float fMinEps, bool bConnectPolygons) const
 {
@@ -1657,7 +1678,7 @@ bool MeshAlgorithm::Distance (const Base::Vector3f &rclPt, unsigned long ulFacet
 {
   const MeshFacetArray &rclFAry = _rclMesh._aclFacetArray;
   const MeshPointArray &rclPAry = _rclMesh._aclPointArray;
-  const unsigned long *pulIdx = rclFAry[ulFacetIdx]._aulPoints;
+  const ElementIndex *pulIdx = rclFAry[ulFacetIdx]._aulPoints;
 
   BoundBox3f clBB;
   clBB.Add(rclPAry[*(pulIdx++)]);
@@ -1956,3 +1977,365 @@ MeshRefNormalToPoints::operator[] (unsigned long pos) const
 {
     return _norm[pos];
 }
+
+//----------------------------------------------------------------------------
+
+namespace MeshCore {
+namespace FlatAdjacency {
+
+/// A range of elements whose neighbours are collected by one thread
+struct Block
+{
+    unsigned long first, last;
+    std::vector<unsigned long> indices;
+};
+
+// A degenerated facet references a point only once
+static inline bool isFirstCorner(const MeshFacet& face, int corner)
+{
+    for (int i = 0; i < corner; i++) {
+        if (face._aulPoints[i] == face._aulPoints[corner])
+            return false;
+    }
+    return true;
+}
+
+// Counts the facets of every point within a block of facets. All blocks share
+// one counter per point.
+struct CountPointFacets
+{
+    typedef void result_type;
+    CountPointFacets(const MeshFacetArray& facets, std::vector<QAtomicInt>& counts)
+      : facets(facets), counts(counts)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        unsigned long ctPoints = counts.size();
+        for (unsigned long f = b.first; f < b.last; f++) {
+            for (int i = 0; i < 3; i++) {
+                unsigned long p = facets[f]._aulPoints[i];
+                if (p < ctPoints && isFirstCorner(facets[f], i))
+                    counts[p].fetchAndAddRelaxed(1);
+            }
+        }
+    }
+
+    const MeshFacetArray& facets;
+    std::vector<QAtomicInt>& counts;
+};
+
+// Writes the facets of a block to the ranges of their points. The counters were
+// reset to zero and give the next free position within a range.
+struct FillPointFacets
+{
+    typedef void result_type;
+    FillPointFacets(const MeshFacetArray& facets, const std::vector<unsigned long>& offsets,
+                    std::vector<QAtomicInt>& counts, std::vector<unsigned long>& indices)
+      : facets(facets), offsets(offsets), counts(counts), indices(indices)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        unsigned long ctPoints = counts.size();
+        for (unsigned long f = b.first; f < b.last; f++) {
+            for (int i = 0; i < 3; i++) {
+                unsigned long p = facets[f]._aulPoints[i];
+                if (p < ctPoints && isFirstCorner(facets[f], i))
+                    indices[offsets[p] + counts[p].fetchAndAddRelaxed(1)] = f;
+            }
+        }
+    }
+
+    const MeshFacetArray& facets;
+    const std::vector<unsigned long>& offsets;
+    std::vector<QAtomicInt>& counts;
+    std::vector<unsigned long>& indices;
+};
+
+// The threads fill the ranges in any order, so the facets of every point of a
+// block are sorted afterwards
+struct SortPointFacets
+{
+    typedef void result_type;
+    SortPointFacets(const std::vector<unsigned long>& offsets, std::vector<unsigned long>& indices)
+      : offsets(offsets), indices(indices)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        for (unsigned long p = b.first; p < b.last; p++)
+            std::sort(indices.begin() + offsets[p], indices.begin() + offsets[p+1]);
+    }
+
+    const std::vector<unsigned long>& offsets;
+    std::vector<unsigned long>& indices;
+};
+
+struct CollectPointPoints
+{
+    typedef void result_type;
+    CollectPointPoints(const MeshFacetArray& facets, const MeshFlatPointToFacets& pt2fa,
+                       std::vector<unsigned long>& offsets)
+      : facets(facets), pt2fa(pt2fa), offsets(offsets)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        std::vector<unsigned long> nb;
+        for (unsigned long p = b.first; p < b.last; p++) {
+            nb.clear();
+            MeshIndexRange faces = pt2fa[p];
+            for (MeshIndexRange::const_iterator it = faces.begin(); it != faces.end(); ++it) {
+                for (int i = 0; i < 3; i++) {
+                    // like MeshRefPointToPoints a point is its own neighbour if a
+                    // degenerated facet references it twice
+                    unsigned long q = facets[*it]._aulPoints[i];
+                    if (q != p || !isFirstCorner(facets[*it], i))
+                        nb.push_back(q);
+                }
+            }
+            std::sort(nb.begin(), nb.end());
+            nb.erase(std::unique(nb.begin(), nb.end()), nb.end());
+            b.indices.insert(b.indices.end(), nb.begin(), nb.end());
+            offsets[p+1] = nb.size();
+        }
+    }
+
+    const MeshFacetArray& facets;
+    const MeshFlatPointToFacets& pt2fa;
+    std::vector<unsigned long>& offsets;
+};
+
+struct CollectFacetFacets
+{
+    typedef void result_type;
+    CollectFacetFacets(const MeshFacetArray& facets, const MeshFlatPointToFacets& pt2fa,
+                       std::vector<unsigned long>& offsets)
+      : facets(facets), pt2fa(pt2fa), offsets(offsets)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        std::vector<unsigned long> nb;
+        unsigned long ctPoints = pt2fa.Size();
+        for (unsigned long f = b.first; f < b.last; f++) {
+            nb.clear();
+            for (int i = 0; i < 3; i++) {
+                unsigned long p = facets[f]._aulPoints[i];
+                if (p < ctPoints) {
+                    MeshIndexRange faces = pt2fa[p];
+                    nb.insert(nb.end(), faces.begin(), faces.end());
+                }
+            }
+            std::sort(nb.begin(), nb.end());
+            nb.erase(std::unique(nb.begin(), nb.end()), nb.end());
+            b.indices.insert(b.indices.end(), nb.begin(), nb.end());
+            offsets[f+1] = nb.size();
+        }
+    }
+
+    const MeshFacetArray& facets;
+    const MeshFlatPointToFacets& pt2fa;
+    std::vector<unsigned long>& offsets;
+};
+
+struct CopyBlock
+{
+    typedef void result_type;
+    CopyBlock(const std::vector<unsigned long>& offsets, std::vector<unsigned long>& indices)
+      : offsets(offsets), indices(indices)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        std::copy(b.indices.begin(), b.indices.end(), indices.begin() + offsets[b.first]);
+        std::vector<unsigned long>().swap(b.indices);
+    }
+
+    const std::vector<unsigned long>& offsets;
+    std::vector<unsigned long>& indices;
+};
+
+// Turns the numbers of neighbours into offsets
+static void accumulate(std::vector<unsigned long>& offsets)
+{
+    for (std::size_t i = 1; i < offsets.size(); i++)
+        offsets[i] += offsets[i-1];
+}
+
+}
+}
+
+void MeshFlatPointToFacets::Rebuild (void)
+{
+    using namespace FlatAdjacency;
+
+    const MeshFacetArray& rFacets = _rclMesh.GetFacets();
+    unsigned long ctPoints = _rclMesh.CountPoints();
+    _offsets.assign(ctPoints + 1, 0);
+
+    // a counting sort with one shared counter per point, the blocks of facets count
+    // and then write their facets in parallel
+    std::vector<QAtomicInt> counts(ctPoints);
+    std::vector<Block> facetBlocks = Blocks::makeThreadBlocks<Block>(rFacets.size());
+    Blocks::runBlocks(facetBlocks, CountPointFacets(rFacets, counts));
+    for (unsigned long p = 0; p < ctPoints; p++)
+        _offsets[p+1] = counts[p].fetchAndStoreRelaxed(0);
+    accumulate(_offsets);
+    _indices.clear();
+    _indices.resize(_offsets.back());
+    Blocks::runBlocks(facetBlocks, FillPointFacets(rFacets, _offsets, counts, _indices));
+    std::vector<QAtomicInt>().swap(counts);
+    std::vector<Block> pointBlocks = Blocks::makeThreadBlocks<Block>(ctPoints);
+    Blocks::runBlocks(pointBlocks, SortPointFacets(_offsets, _indices));
+}
+
+Base::Vector3f MeshFlatPointToFacets::GetNormal(unsigned long pos) const
+{
+    MeshIndexRange n = (*this)[pos];
+    Base::Vector3f normal;
+    MeshGeomFacet f;
+    for (MeshIndexRange::const_iterator it = n.begin(); it != n.end(); ++it) {
+        f = _rclMesh.GetFacet(*it);
+        normal += f.Area() * f.GetNormal();
+    }
+
+    normal.Normalize();
+    return normal;
+}
+
+std::set<unsigned long> MeshFlatPointToFacets::NeighbourPoints(const std::vector<unsigned long>& pt, int level) const
+{
+    std::set<unsigned long> cp,nb,lp;
+    cp.insert(pt.begin(), pt.end());
+    lp.insert(pt.begin(), pt.end());
+    MeshFacetArray::_TConstIterator f_it = _rclMesh.GetFacets().begin();
+    for (int i=0; i < level; i++) {
+        std::set<unsigned long> cur;
+        for (std::set<unsigned long>::iterator it = lp.begin(); it != lp.end(); ++it) {
+            MeshIndexRange ft = (*this)[*it];
+            for (MeshIndexRange::const_iterator jt = ft.begin(); jt != ft.end(); ++jt) {
+                for (int j = 0; j < 3; j++) {
+                    unsigned long index = f_it[*jt]._aulPoints[j];
+                    if (cp.find(index) == cp.end() && nb.find(index) == nb.end()) {
+                        nb.insert(index);
+                        cur.insert(index);
+                    }
+                }
+            }
+        }
+
+        lp = cur;
+        if (lp.empty())
+            break;
+    }
+    return nb;
+}
+
+void MeshFlatPointToFacets::Neighbours (unsigned long ulFacetInd, float fMaxDist, MeshCollector& collect) const
+{
+    std::set<unsigned long> visited;
+    Base::Vector3f  clCenter = _rclMesh.GetFacet(ulFacetInd).GetGravityPoint();
+
+    const MeshFacetArray& rFacets = _rclMesh.GetFacets();
+    SearchNeighbours(rFacets, ulFacetInd, clCenter, fMaxDist * fMaxDist, visited, collect);
+}
+
+void MeshFlatPointToFacets::SearchNeighbours(const MeshFacetArray& rFacets, unsigned long index, const Base::Vector3f &rclCenter,
+                                             float fMaxDist2, std::set<unsigned long>& visited, MeshCollector& collect) const
+{
+    if (visited.find(index) != visited.end())
+        return;
+
+    const MeshFacet& face = rFacets[index];
+    if (Base::DistanceP2(rclCenter, _rclMesh.GetFacet(face).GetGravityPoint()) > fMaxDist2)
+        return;
+
+    visited.insert(index);
+    collect.Append(_rclMesh, index);
+    for (int i = 0; i < 3; i++) {
+        MeshIndexRange f = (*this)[face._aulPoints[i]];
+
+        for (MeshIndexRange::const_iterator j = f.begin(); j != f.end(); ++j) {
+            SearchNeighbours(rFacets, *j, rclCenter, fMaxDist2, visited, collect);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+
+void MeshFlatFacetToFacets::Rebuild (void)
+{
+    MeshFlatPointToFacets vertexFace(_rclMesh);
+    Rebuild(vertexFace);
+}
+
+void MeshFlatFacetToFacets::Rebuild (const MeshFlatPointToFacets& vertexFace)
+{
+    using namespace FlatAdjacency;
+
+    const MeshFacetArray& rFacets = _rclMesh.GetFacets();
+    unsigned long ctFacets = rFacets.size();
+    _offsets.assign(ctFacets + 1, 0);
+
+    std::vector<Block> blocks = Blocks::makeThreadBlocks<Block>(ctFacets);
+    Blocks::runBlocks(blocks, CollectFacetFacets(rFacets, vertexFace, _offsets));
+    accumulate(_offsets);
+    _indices.clear();
+    _indices.resize(_offsets.back());
+    Blocks::runBlocks(blocks, CopyBlock(_offsets, _indices));
+}
+
+//----------------------------------------------------------------------------
+
+void MeshFlatPointToPoints::Rebuild (void)
+{
+    MeshFlatPointToFacets vertexFace(_rclMesh);
+    Rebuild(vertexFace);
+}
+
+void MeshFlatPointToPoints::Rebuild (const MeshFlatPointToFacets& vertexFace)
+{
+    using namespace FlatAdjacency;
+
+    const MeshFacetArray& rFacets = _rclMesh.GetFacets();
+    unsigned long ctPoints = _rclMesh.CountPoints();
+    _offsets.assign(ctPoints + 1, 0);
+
+    std::vector<Block> blocks = Blocks::makeThreadBlocks<Block>(ctPoints);
+    Blocks::runBlocks(blocks, CollectPointPoints(rFacets, vertexFace, _offsets));
+    accumulate(_offsets);
+    _indices.clear();
+    _indices.resize(_offsets.back());
+    Blocks::runBlocks(blocks, CopyBlock(_offsets, _indices));
+}
+
+Base::Vector3f MeshFlatPointToPoints::GetNormal(unsigned long pos) const
+{
+    const MeshPointArray& rPoints = _rclMesh.GetPoints();
+    MeshCore::PlaneFit pf;
+    pf.AddPoint(rPoints[pos]);
+    MeshIndexRange cv = (*this)[pos];
+    for (MeshIndexRange::const_iterator cv_it = cv.begin(); cv_it !=cv.end(); ++cv_it) {
+        pf.AddPoint(rPoints[*cv_it]);
+    }
+
+    pf.Fit();
+
+    Base::Vector3f normal = pf.GetNormal();
+    normal.Normalize();
+    return normal;
+}
+
+float MeshFlatPointToPoints::GetAverageEdgeLength(unsigned long index) const
+{
+    const MeshPointArray& rPoints = _rclMesh.GetPoints();
+    float len=0.0f;
+    MeshIndexRange n = (*this)[index];
+    const Base::Vector3f& p = rPoints[index];
+    for (MeshIndexRange::const_iterator it = n.begin(); it != n.end(); ++it) {
+        len += Base::Distance(p, rPoints[*it]);
+    }
+    return (len/n.size());
+}
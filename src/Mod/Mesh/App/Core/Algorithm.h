@@ -24,6 +24,7 @@
 #ifndef MESHALGORITHM_H
 #define MESHALGORITHM_H
 
+#include <algorithm>
 #include <set>
 #include <vector>
 #include <map>
@@ -45,8 +46,9 @@ class MeshGeomFacet;
 class MeshGeomEdge;
 class MeshKernel;
 class MeshFacetGrid;
+class MeshFacetBVH;
 class MeshFacetArray;
-class MeshRefPointToFacets;
+class MeshFlatPointToFacets;
 class AbstractPolygonTriangulator;
 
 /**
@@ -100,6 +102,13 @@ public:
    */
   bool NearestFacetOnRay (const Base::Vector3f &rclPt, const Base::Vector3f &rclDir, float fMaxSearchArea,
                           const MeshFacetGrid &rclGrid, Base::Vector3f &rclRes, unsigned long &rulFacet) const;
+  /**
+   * Searches for the nearest facet to the ray defined by (\a rclPt, \a rclDir) in direction of \a rclDir.
+   * The point \a rclRes holds the intersection point with the ray and the nearest facet with index \a rulFacet.
+   * \note This method is optimized by using a bounding volume hierarchy of the attached mesh.
+   */
+  bool NearestFacetOnRay (const Base::Vector3f &rclPt, const Base::Vector3f &rclDir, const MeshFacetBVH &rclBVH,
+                          Base::Vector3f &rclRes, unsigned long &rulFacet) const;
   /**
    * Searches for the first facet of the grid element (\a rclGrid) in that the point \a rclPt lies into which is a distance not
    * higher than \a fMaxDistance. Of no such facet is found \a rulFacet is undefined and false is returned, otherwise true.
@@ -167,7 +176,7 @@ public:
   bool FillupHole(const std::vector<unsigned long>& boundary,
                   AbstractPolygonTriangulator& cTria,
                   MeshFacetArray& rFaces, MeshPointArray& rPoints,
-                  int level, const MeshRefPointToFacets* pP2FStructure=0) const;
+                  int level, const MeshFlatPointToFacets* pP2FStructure=0) const;
   /** Sets to all facets in \a raulInds the properties in raulProps. 
    * \note Both arrays must have the same size.
    */
@@ -276,6 +285,10 @@ public:
                               unsigned long &rclResFacetIndex, Base::Vector3f &rclResPoint) const;
   bool NearestPointFromPoint (const Base::Vector3f &rclPt, const MeshFacetGrid& rclGrid, float fMaxSearchArea,
                               unsigned long &rclResFacetIndex, Base::Vector3f &rclResPoint) const;
+  bool NearestPointFromPoint (const Base::Vector3f &rclPt, const MeshFacetBVH& rclBVH,
+                              unsigned long &rclResFacetIndex, Base::Vector3f &rclResPoint) const;
+  bool NearestPointFromPoint (const Base::Vector3f &rclPt, const MeshFacetBVH& rclBVH, float fMaxSearchArea,
+                              unsigned long &rclResFacetIndex, Base::Vector3f &rclResPoint) const;
   /** Cuts the mesh with a plane. The result is a list of polylines. */
   bool CutWithPlane (const Base::Vector3f &clBase, const Base::Vector3f &clNormal, const MeshFacetGrid &rclGrid,
                      std::list<std::vector<Base::Vector3f> > &rclResult, float fMinEps = 1.0e-2f, bool bConnectPolygons = false) const;
@@ -509,6 +522,135 @@ protected:
     std::vector<Base::Vector3f> _norm;
 };
 
+/**
+ * The MeshIndexRange gives access to the neighbours of one element of a flat
+ * adjacency structure. The indices are sorted in ascending order.
+ */
+class MeshExport MeshIndexRange
+{
+public:
+    typedef const unsigned long* const_iterator;
+
+    MeshIndexRange (const_iterator first, const_iterator last)
+      : _first(first), _last(last)
+    { }
+
+    const_iterator begin() const
+    { return _first; }
+    const_iterator end() const
+    { return _last; }
+    std::size_t size() const
+    { return _last - _first; }
+    bool empty() const
+    { return _first == _last; }
+    /// Checks if \a index is a neighbour
+    bool contains(unsigned long index) const
+    { return std::binary_search(_first, _last, index); }
+
+private:
+    const_iterator _first, _last;
+};
+
+/**
+ * The MeshFlatAdjacency is the base class of the flat counterparts of MeshRefPointToFacets,
+ * MeshRefFacetToFacets and MeshRefPointToPoints. Instead of a std::set per element the
+ * neighbours of all elements are stored in one array and a second array holds the offset
+ * where the neighbours of an element start (compressed sparse row format). So building
+ * the structure needs two allocations instead of one per neighbour, it is done with a
+ * counting sort that runs in parallel on large meshes.
+ * The structure cannot be modified, it must be rebuilt if the underlying mesh kernel gets
+ * changed.
+ */
+class MeshExport MeshFlatAdjacency
+{
+public:
+    /// Returns the neighbours of the element with index \a pos
+    MeshIndexRange operator[] (unsigned long pos) const
+    {
+        const unsigned long* data = _indices.empty() ? 0 : &_indices[0];
+        return MeshIndexRange(data + _offsets[pos], data + _offsets[pos+1]);
+    }
+    /// Returns the number of elements
+    unsigned long Size() const
+    { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+    /// Returns the allocated memory in bytes
+    std::size_t MemSize() const
+    { return (_offsets.capacity() + _indices.capacity()) * sizeof(unsigned long); }
+
+protected:
+    MeshFlatAdjacency (const MeshKernel &rclM) : _rclMesh(rclM)
+    { }
+
+protected:
+    const MeshKernel  &_rclMesh; /**< The mesh kernel. */
+    std::vector<unsigned long> _offsets;
+    std::vector<unsigned long> _indices;
+};
+
+/**
+ * The MeshFlatPointToFacets gives access to all facets sharing the same point, like
+ * MeshRefPointToFacets.
+ */
+class MeshExport MeshFlatPointToFacets : public MeshFlatAdjacency
+{
+public:
+    /// Construction
+    MeshFlatPointToFacets (const MeshKernel &rclM) : MeshFlatAdjacency(rclM)
+    { Rebuild(); }
+
+    /// Rebuilds up data structure
+    void Rebuild (void);
+    std::set<unsigned long> NeighbourPoints(const std::vector<unsigned long>& , int level) const;
+    void Neighbours (unsigned long ulFacetInd, float fMaxDist, MeshCollector& collect) const;
+    Base::Vector3f GetNormal(unsigned long) const;
+
+protected:
+    void SearchNeighbours(const MeshFacetArray& rFacets, unsigned long index, const Base::Vector3f &rclCenter, 
+        float fMaxDist, std::set<unsigned long> &visit, MeshCollector& collect) const;
+};
+
+/**
+ * The MeshFlatFacetToFacets gives access to all facets sharing at least one point with
+ * a facet, like MeshRefFacetToFacets.
+ */
+class MeshExport MeshFlatFacetToFacets : public MeshFlatAdjacency
+{
+public:
+    /// Construction
+    MeshFlatFacetToFacets (const MeshKernel &rclM) : MeshFlatAdjacency(rclM)
+    { Rebuild(); }
+    /// Construction from an existing point to facets structure of the same kernel
+    MeshFlatFacetToFacets (const MeshFlatPointToFacets &rclPt2Fa, const MeshKernel &rclM)
+      : MeshFlatAdjacency(rclM)
+    { Rebuild(rclPt2Fa); }
+
+    /// Rebuilds up data structure
+    void Rebuild (void);
+    void Rebuild (const MeshFlatPointToFacets&);
+};
+
+/**
+ * The MeshFlatPointToPoints gives access to all neighbour points of a point, like
+ * MeshRefPointToPoints.
+ */
+class MeshExport MeshFlatPointToPoints : public MeshFlatAdjacency
+{
+public:
+    /// Construction
+    MeshFlatPointToPoints (const MeshKernel &rclM) : MeshFlatAdjacency(rclM)
+    { Rebuild(); }
+    /// Construction from an existing point to facets structure of the same kernel
+    MeshFlatPointToPoints (const MeshFlatPointToFacets &rclPt2Fa, const MeshKernel &rclM)
+      : MeshFlatAdjacency(rclM)
+    { Rebuild(rclPt2Fa); }
+
+    /// Rebuilds up data structure
+    void Rebuild (void);
+    void Rebuild (const MeshFlatPointToFacets&);
+    Base::Vector3f GetNormal(unsigned long) const;
+    float GetAverageEdgeLength(unsigned long) const;
+};
+
 }; // namespace MeshCore 
 
 #endif  // MESH_ALGORITHM_H 
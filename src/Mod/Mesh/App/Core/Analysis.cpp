@@ -0,0 +1,378 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+
+#include "PreCompiled.h"
+#ifndef _PreComp_
+# include <algorithm>
+#endif
+
+#include <QElapsedTimer>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include "Analysis.h"
+#include "Blocks.h"
+#include "Degeneration.h"
+#include "Evaluation.h"
+#include "MeshKernel.h"
+
+#include <Base/Exception.h>
+
+using namespace MeshCore;
+
+namespace MeshCore {
+namespace Analysis {
+
+// number of facets or points of a block, small enough to keep a block in the cache
+const unsigned long BlockSize = 4096;
+
+/// A range of points or facets checked by one thread
+struct Block
+{
+    Block() : first(0), last(0), flipped(false)
+    {
+        std::fill(nsecs, nsecs + MeshAnalysis::NumChecks, 0);
+    }
+
+    unsigned long first, last;
+    std::vector<unsigned long> indices[MeshAnalysis::NumChecks];
+    qint64 nsecs[MeshAnalysis::NumChecks];
+    bool flipped;
+};
+
+// Does the same as MeshEvalNaNPoints::GetIndices() for a block of points
+struct CheckPoints
+{
+    typedef void result_type;
+    CheckPoints(const MeshKernel& mesh, int checks)
+      : mesh(mesh), checks(checks)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        const MeshPointArray& rPoints = mesh.GetPoints();
+        QElapsedTimer timer;
+
+        if (checks & MeshAnalysis::NaNPoints) {
+            int index = MeshAnalysis::CheckIndex(MeshAnalysis::NaNPoints);
+            timer.start();
+            for (unsigned long i = b.first; i < b.last; i++) {
+                const MeshPoint& p = rPoints[i];
+                if (boost::math::isnan(p.x) || boost::math::isnan(p.y) || boost::math::isnan(p.z))
+                    b.indices[index].push_back(i);
+            }
+            b.nsecs[index] += timer.nsecsElapsed();
+        }
+    }
+
+    const MeshKernel& mesh;
+    int checks;
+};
+
+// Runs the checks of a facet and its neighbours for a block of facets. Each check
+// collects the same indices as its MeshEval class does for these facets.
+struct CheckFacets
+{
+    typedef void result_type;
+    CheckFacets(const MeshKernel& mesh, int checks, float epsilon)
+      : mesh(mesh), checks(checks), epsilon(epsilon)
+    {
+    }
+    void operator()(Block& b) const
+    {
+        const MeshFacetArray& rFaces = mesh.GetFacets();
+        MeshFacetArray::_TConstIterator iBeg = rFaces.begin();
+        QElapsedTimer timer;
+
+        // MeshEvalCorruptedFacets
+        if (checks & MeshAnalysis::CorruptedFacets) {
+            int index = MeshAnalysis::CheckIndex(MeshAnalysis::CorruptedFacets);
+            timer.start();
+            for (unsigned long i = b.first; i < b.last; i++) {
+                const MeshFacet& f = iBeg[i];
+                if ((f._aulPoints[0] == f._aulPoints[1]) ||
+                    (f._aulPoints[1] == f._aulPoints[2]) ||
+                    (f._aulPoints[2] == f._aulPoints[0]))
+                    b.indices[index].push_back(i);
+            }
+            b.nsecs[index] += timer.nsecsElapsed();
+        }
+
+        // MeshEvalDegeneratedFacets
+        if (checks & MeshAnalysis::DegeneratedFacets) {
+            int index = MeshAnalysis::CheckIndex(MeshAnalysis::DegeneratedFacets);
+            timer.start();
+            for (unsigned long i = b.first; i < b.last; i++) {
+                if (mesh.GetFacet(i).IsDegenerated(epsilon))
+                    b.indices[index].push_back(i);
+            }
+            b.nsecs[index] += timer.nsecsElapsed();
+        }
+
+        // MeshEvalFoldsOnSurface, the duplicates are removed after merging the blocks
+        if (checks & MeshAnalysis::Folds) {
+            int index = MeshAnalysis::CheckIndex(MeshAnalysis::Folds);
+            timer.start();
+            for (unsigned long i = b.first; i < b.last; i++) {
+                const MeshFacet& f = iBeg[i];
+                Base::Vector3f v1 = mesh.GetFacet(f).GetNormal();
+                for (int j = 0; j < 3; j++) {
+                    unsigned long n1 = f._aulNeighbours[j];
+                    unsigned long n2 = f._aulNeighbours[(j+1)%3];
+                    if (n1 != ULONG_MAX && n2 != ULONG_MAX) {
+                        Base::Vector3f v2 = mesh.GetFacet(n1).GetNormal();
+                        Base::Vector3f v3 = mesh.GetFacet(n2).GetNormal();
+                        if (v2 * v3 > 0.0f) {
+                            if (v1 * v2 < -0.1f && v1 * v3 < -0.1f) {
+                                b.indices[index].push_back(n1);
+                                b.indices[index].push_back(n2);
+                                b.indices[index].push_back(i);
+                            }
+                        }
+                    }
+                }
+            }
+            b.nsecs[index] += timer.nsecsElapsed();
+        }
+
+        // MeshEvalOrientation::Evaluate(), only the faulty facets are searched
+        // for with MeshEvalOrientation::GetIndices() afterwards
+        if (checks & MeshAnalysis::Orientation) {
+            int index = MeshAnalysis::CheckIndex(MeshAnalysis::Orientation);
+            timer.start();
+            for (unsigned long i = b.first; i < b.last && !b.flipped; i++) {
+                const MeshFacet& f = iBeg[i];
+                for (int j = 0; j < 3; j++) {
+                    if (f._aulNeighbours[j] != ULONG_MAX) {
+                        const MeshFacet& n = iBeg[f._aulNeighbours[j]];
+                        for (int k = 0; k < 3; k++) {
+                            if (f._aulPoints[j] == n._aulPoints[k]) {
+                                if ((f._aulPoints[(j+1)%3] == n._aulPoints[(k+1)%3]) ||
+                                    (f._aulPoints[(j+2)%3] == n._aulPoints[(k+2)%3])) {
+                                    b.flipped = true; // adjacent face with wrong orientation
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            b.nsecs[index] += timer.nsecsElapsed();
+        }
+    }
+
+    const MeshKernel& mesh;
+    int checks;
+    float epsilon;
+};
+
+} // namespace Analysis
+} // namespace MeshCore
+
+MeshAnalysis::MeshAnalysis(const MeshKernel& rclM)
+  : _rclMesh(rclM)
+  , _fEpsilon(MeshDefinitions::_fMinPointDistanceP2)
+  , _bParallel(true)
+  , _iChecks(0)
+  , _fTotalTime(0.0f)
+{
+    std::fill(_abDefects, _abDefects + NumChecks, false);
+    std::fill(_afTimes, _afTimes + NumChecks, 0.0f);
+}
+
+MeshAnalysis::~MeshAnalysis()
+{
+}
+
+int MeshAnalysis::CheckIndex(Check check)
+{
+    for (int i = 0; i < NumChecks; i++) {
+        if (check == (1 << i))
+            return i;
+    }
+
+    throw Base::ValueError("Not a single check");
+}
+
+const char* MeshAnalysis::CheckName(Check check)
+{
+    static const char* names[NumChecks] = {
+        "NaNPoints",
+        "DuplicatedPoints",
+        "DuplicatedFacets",
+        "CorruptedFacets",
+        "DegeneratedFacets",
+        "Folds",
+        "Orientation",
+        "NonManifoldEdges",
+        "NonManifoldPoints",
+        "SelfIntersections"
+    };
+
+    return names[CheckIndex(check)];
+}
+
+void MeshAnalysis::Analyze(int checks)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    _iChecks = checks & AllChecks;
+    for (int i = 0; i < NumChecks; i++) {
+        _abDefects[i] = false;
+        _aulIndices[i].clear();
+        _afTimes[i] = 0.0f;
+    }
+    _aclEdges.clear();
+    _aclIntersections.clear();
+
+    LocalChecks(_iChecks);
+    GlobalChecks(_iChecks);
+
+    _fTotalTime = timer.nsecsElapsed() * 1.0e-9f;
+}
+
+void MeshAnalysis::LocalChecks(int checks)
+{
+    using namespace Analysis;
+
+    if (checks & NaNPoints) {
+        std::vector<Block> blocks = Blocks::makeBlocks<Block>(_rclMesh.CountPoints(), BlockSize);
+        Blocks::runBlocks(blocks, CheckPoints(_rclMesh, checks), _bParallel);
+
+        int index = CheckIndex(NaNPoints);
+        for (std::vector<Block>::iterator it = blocks.begin(); it != blocks.end(); ++it) {
+            _aulIndices[index].insert(_aulIndices[index].end(), it->indices[index].begin(), it->indices[index].end());
+            _afTimes[index] += it->nsecs[index] * 1.0e-9f;
+        }
+    }
+
+    int facetChecks = checks & (CorruptedFacets | DegeneratedFacets | Folds | Orientation);
+    if (facetChecks == 0)
+        return;
+
+    std::vector<Block> blocks = Blocks::makeBlocks<Block>(_rclMesh.CountFacets(), BlockSize);
+    Blocks::runBlocks(blocks, CheckFacets(_rclMesh, facetChecks, _fEpsilon), _bParallel);
+
+    // merge in the order of the blocks, so the result doesn't depend on the threads
+    bool flipped = false;
+    for (std::vector<Block>::iterator it = blocks.begin(); it != blocks.end(); ++it) {
+        for (int i = 0; i < NumChecks; i++) {
+            _aulIndices[i].insert(_aulIndices[i].end(), it->indices[i].begin(), it->indices[i].end());
+            _afTimes[i] += it->nsecs[i] * 1.0e-9f;
+        }
+        if (it->flipped)
+            flipped = true;
+    }
+
+    std::vector<unsigned long>& folds = _aulIndices[CheckIndex(Folds)];
+    std::sort(folds.begin(), folds.end());
+    folds.erase(std::unique(folds.begin(), folds.end()), folds.end());
+
+    if (flipped) {
+        QElapsedTimer timer;
+        timer.start();
+        MeshEvalOrientation eval(_rclMesh);
+        _aulIndices[CheckIndex(Orientation)] = eval.GetIndices();
+        _afTimes[CheckIndex(Orientation)] += timer.nsecsElapsed() * 1.0e-9f;
+        _abDefects[CheckIndex(Orientation)] = true;
+    }
+
+    _abDefects[CheckIndex(NaNPoints)] = !_aulIndices[CheckIndex(NaNPoints)].empty();
+    _abDefects[CheckIndex(CorruptedFacets)] = !_aulIndices[CheckIndex(CorruptedFacets)].empty();
+    _abDefects[CheckIndex(DegeneratedFacets)] = !_aulIndices[CheckIndex(DegeneratedFacets)].empty();
+    _abDefects[CheckIndex(Folds)] = !folds.empty();
+}
+
+void MeshAnalysis::GlobalChecks(int checks)
+{
+    QElapsedTimer timer;
+
+    if (checks & DuplicatedPoints) {
+        timer.start();
+        MeshEvalDuplicatePoints eval(_rclMesh);
+        std::vector<unsigned long>& indices = _aulIndices[CheckIndex(DuplicatedPoints)];
+        indices = eval.GetIndices();
+        _abDefects[CheckIndex(DuplicatedPoints)] = !indices.empty();
+        _afTimes[CheckIndex(DuplicatedPoints)] = timer.nsecsElapsed() * 1.0e-9f;
+    }
+
+    if (checks & DuplicatedFacets) {
+        timer.start();
+        MeshEvalDuplicateFacets eval(_rclMesh);
+        std::vector<unsigned long>& indices = _aulIndices[CheckIndex(DuplicatedFacets)];
+        indices = eval.GetIndices();
+        _abDefects[CheckIndex(DuplicatedFacets)] = !indices.empty();
+        _afTimes[CheckIndex(DuplicatedFacets)] = timer.nsecsElapsed() * 1.0e-9f;
+    }
+
+    if (checks & NonManifoldEdges) {
+        timer.start();
+        MeshEvalTopology eval(_rclMesh);
+        _abDefects[CheckIndex(NonManifoldEdges)] = !eval.Evaluate();
+        _aclEdges = eval.GetIndices();
+        std::vector<unsigned long>& indices = _aulIndices[CheckIndex(NonManifoldEdges)];
+        const std::list<std::vector<unsigned long> >& facets = eval.GetFacets();
+        for (std::list<std::vector<unsigned long> >::const_iterator it = facets.begin(); it != facets.end(); ++it)
+            indices.insert(indices.end(), it->begin(), it->end());
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        _afTimes[CheckIndex(NonManifoldEdges)] = timer.nsecsElapsed() * 1.0e-9f;
+    }
+
+    if (checks & NonManifoldPoints) {
+        timer.start();
+        MeshEvalPointManifolds eval(_rclMesh);
+        _abDefects[CheckIndex(NonManifoldPoints)] = !eval.Evaluate();
+        _aulIndices[CheckIndex(NonManifoldPoints)] = eval.GetIndices();
+        _afTimes[CheckIndex(NonManifoldPoints)] = timer.nsecsElapsed() * 1.0e-9f;
+    }
+
+    if (checks & SelfIntersections) {
+        timer.start();
+        MeshEvalSelfIntersection eval(_rclMesh);
+        eval.GetIntersections(_aclIntersections);
+        std::vector<unsigned long>& indices = _aulIndices[CheckIndex(SelfIntersections)];
+        for (std::vector<std::pair<unsigned long, unsigned long> >::iterator it = _aclIntersections.begin(); it != _aclIntersections.end(); ++it) {
+            indices.push_back(it->first);
+            indices.push_back(it->second);
+        }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        _abDefects[CheckIndex(SelfIntersections)] = !_aclIntersections.empty();
+        _afTimes[CheckIndex(SelfIntersections)] = timer.nsecsElapsed() * 1.0e-9f;
+    }
+}
+
+bool MeshAnalysis::HasDefects(Check check) const
+{
+    return _abDefects[CheckIndex(check)];
+}
+
+const std::vector<unsigned long>& MeshAnalysis::GetIndices(Check check) const
+{
+    return _aulIndices[CheckIndex(check)];
+}
+
+float MeshAnalysis::GetTime(Check check) const
+{
+    return _afTimes[CheckIndex(check)];
+}
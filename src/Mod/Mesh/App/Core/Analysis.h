@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef MESHCORE_ANALYSIS_H
+#define MESHCORE_ANALYSIS_H
+
+#include <utility>
+#include <vector>
+#include "Definitions.h"
+
+namespace MeshCore {
+
+class MeshKernel;
+
+/**
+ * The MeshAnalysis class runs several of the MeshEval checks at once.
+ * The checks that only look at a single point or facet and its neighbours
+ * are done together in one parallel pass over the mesh, the facets are
+ * processed in blocks and every check runs on a block while it is still
+ * in the cache. The results are merged in the order of the blocks, so they
+ * are the same as the ones of the single MeshEval classes.
+ * The checks that need the whole mesh, e.g. the duplicated points, run one
+ * after another.
+ */
+class MeshExport MeshAnalysis
+{
+public:
+    enum Check {
+        NaNPoints         = 0x0001, /**< MeshEvalNaNPoints */
+        DuplicatedPoints  = 0x0002, /**< MeshEvalDuplicatePoints */
+        DuplicatedFacets  = 0x0004, /**< MeshEvalDuplicateFacets */
+        CorruptedFacets   = 0x0008, /**< MeshEvalCorruptedFacets */
+        DegeneratedFacets = 0x0010, /**< MeshEvalDegeneratedFacets */
+        Folds             = 0x0020, /**< MeshEvalFoldsOnSurface */
+        Orientation       = 0x0040, /**< MeshEvalOrientation */
+        NonManifoldEdges  = 0x0080, /**< MeshEvalTopology */
+        NonManifoldPoints = 0x0100, /**< MeshEvalPointManifolds */
+        SelfIntersections = 0x0200, /**< MeshEvalSelfIntersection */
+        AllChecks         = 0x03ff
+    };
+    /// Number of the single checks
+    enum { NumChecks = 10 };
+
+    /// Construction
+    MeshAnalysis(const MeshKernel& rclM);
+    /// Destruction
+    ~MeshAnalysis();
+
+    /** Sets the epsilon for the degenerated facets, the default is
+     * MeshDefinitions::_fMinPointDistanceP2. */
+    void SetEpsilon(float fEps)
+    { _fEpsilon = fEps; }
+    /** Enables or disables the use of several threads for the checks of the
+     * combined pass, it's enabled by default. */
+    void SetParallel(bool on)
+    { _bParallel = on; }
+
+    /**
+     * Runs the checks given as combination of Check flags. The results of
+     * a previous run are cleared.
+     */
+    void Analyze(int checks = AllChecks);
+
+    /** @name Results */
+    //@{
+    /// Returns true if the last run has found any defects of the given check
+    bool HasDefects(Check check) const;
+    /**
+     * Returns the point indices for NaNPoints, DuplicatedPoints and
+     * NonManifoldPoints and the facet indices for all other checks.
+     */
+    const std::vector<unsigned long>& GetIndices(Check check) const;
+    /// Returns the point indices of the edges shared by more than two facets
+    const std::vector<std::pair<unsigned long, unsigned long> >& GetNonManifoldEdges() const
+    { return _aclEdges; }
+    /// Returns the pairs of intersecting facets
+    const std::vector<std::pair<unsigned long, unsigned long> >& GetSelfIntersections() const
+    { return _aclIntersections; }
+    /**
+     * Returns the time in seconds spent for the given check. For the checks
+     * of the combined pass this is the sum over all threads.
+     */
+    float GetTime(Check check) const;
+    /// Returns the time in seconds of the whole last run
+    float GetTotalTime() const
+    { return _fTotalTime; }
+    //@}
+
+    /// Returns the index of the given check in the result arrays
+    static int CheckIndex(Check check);
+    /// Returns the name of the check
+    static const char* CheckName(Check check);
+
+private:
+    void LocalChecks(int checks);
+    void GlobalChecks(int checks);
+
+private:
+    const MeshKernel& _rclMesh;
+    float _fEpsilon;
+    bool _bParallel;
+    int _iChecks;
+    bool _abDefects[NumChecks];
+    std::vector<unsigned long> _aulIndices[NumChecks];
+    std::vector<std::pair<unsigned long, unsigned long> > _aclEdges;
+    std::vector<std::pair<unsigned long, unsigned long> > _aclIntersections;
+    float _afTimes[NumChecks];
+    float _fTotalTime;
+
+    MeshAnalysis(const MeshAnalysis&);
+    void operator = (const MeshAnalysis&);
+};
+
+} // namespace MeshCore
+
+#endif // MESHCORE_ANALYSIS_H
@@ -0,0 +1,619 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "PreCompiled.h"
+#ifndef _PreComp_
+# include <algorithm>
+# include <cmath>
+#endif
+
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include "BVH.h"
+#include "MeshKernel.h"
+
+using namespace MeshCore;
+
+namespace MeshCore {
+namespace BVH {
+
+// facets per leaf up to which the surface area heuristic decides about a split
+const unsigned long MaxLeafSize = 8;
+// number of bins to evaluate the surface area heuristic
+const int NumBins = 16;
+// below this depth the nodes are split in the middle, so the depth is bounded
+const unsigned long MaxSAHDepth = 64;
+// size of the traversal stacks, more than the maximum depth
+const int StackSize = 128;
+
+struct Box
+{
+    Base::Vector3f min, max;
+
+    Box() : min(FLOAT_MAX, FLOAT_MAX, FLOAT_MAX), max(-FLOAT_MAX, -FLOAT_MAX, -FLOAT_MAX)
+    {
+    }
+    void Add(const Base::Vector3f& p)
+    {
+        min.x = std::min<float>(min.x, p.x); max.x = std::max<float>(max.x, p.x);
+        min.y = std::min<float>(min.y, p.y); max.y = std::max<float>(max.y, p.y);
+        min.z = std::min<float>(min.z, p.z); max.z = std::max<float>(max.z, p.z);
+    }
+    void Add(const Box& b)
+    {
+        if (b.min.x > b.max.x)
+            return;
+        Add(b.min);
+        Add(b.max);
+    }
+    // half of the surface area, the factor doesn't matter for the heuristic
+    float HalfArea() const
+    {
+        if (min.x > max.x)
+            return 0.0f;
+        Base::Vector3f d = max - min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+struct Bin
+{
+    Box box;
+    unsigned long count;
+    Bin() : count(0) {}
+};
+
+/// A node to be split and the range of the facets it contains
+struct Range
+{
+    unsigned long node, first, last, depth;
+};
+
+/// Orders facets by one coordinate of their centers
+struct CenterLess
+{
+    CenterLess(const std::vector<Base::Vector3f>& centers, unsigned short axis)
+      : centers(centers), axis(axis)
+    {
+    }
+    bool operator()(unsigned long a, unsigned long b) const
+    {
+        return centers[a][axis] < centers[b][axis];
+    }
+
+    const std::vector<Base::Vector3f>& centers;
+    unsigned short axis;
+};
+
+struct StackItem
+{
+    unsigned long node;
+    float dist;
+};
+
+static inline int binIndex(float c, float cmin, float scale)
+{
+    int i = static_cast<int>((c - cmin) * scale);
+    return std::min<int>(std::max<int>(i, 0), NumBins - 1);
+}
+
+// The entry distance of the ray into the box, false if it misses the box or
+// enters it farther away than fMaxDist.
+static inline bool hitBox(const float* bmin, const float* bmax, const Base::Vector3f& p,
+                          const float* inv, float fMaxDist, float& fNear)
+{
+    float t0 = (bmin[0] - p.x) * inv[0];
+    float t1 = (bmax[0] - p.x) * inv[0];
+    float tmin = std::min<float>(t0, t1);
+    float tmax = std::max<float>(t0, t1);
+    t0 = (bmin[1] - p.y) * inv[1];
+    t1 = (bmax[1] - p.y) * inv[1];
+    tmin = std::max<float>(tmin, std::min<float>(t0, t1));
+    tmax = std::min<float>(tmax, std::max<float>(t0, t1));
+    t0 = (bmin[2] - p.z) * inv[2];
+    t1 = (bmax[2] - p.z) * inv[2];
+    tmin = std::max<float>(tmin, std::min<float>(t0, t1));
+    tmax = std::min<float>(tmax, std::max<float>(t0, t1));
+    tmin = std::max<float>(tmin, 0.0f);
+    fNear = tmin;
+    return tmin <= tmax && tmin <= fMaxDist;
+}
+
+static inline float boxDistance2(const float* bmin, const float* bmax, const Base::Vector3f& p)
+{
+    float dx = std::max<float>(std::max<float>(bmin[0] - p.x, p.x - bmax[0]), 0.0f);
+    float dy = std::max<float>(std::max<float>(bmin[1] - p.y, p.y - bmax[1]), 0.0f);
+    float dz = std::max<float>(std::max<float>(bmin[2] - p.z, p.z - bmax[2]), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Intersection of a ray with a triangle after Moeller and Trumbore. Both sides
+// of the triangle are hit, rays parallel to it are rejected like in
+// MeshGeomFacet::Foraminate().
+static inline bool hitTriangle(const Base::Vector3f& p, const Base::Vector3f& d, const Base::Vector3f* v, float& t)
+{
+    Base::Vector3f e1 = v[1] - v[0];
+    Base::Vector3f e2 = v[2] - v[0];
+    Base::Vector3f pv = d % e2;
+    float det = e1 * pv;
+    Base::Vector3f n = e1 % e2;
+    if (det * det <= 1.0e-6f * (n * n))
+        return false;
+
+    float inv = 1.0f / det;
+    Base::Vector3f tv = p - v[0];
+    float u = (tv * pv) * inv;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+    Base::Vector3f qv = tv % e1;
+    float w = (d * qv) * inv;
+    if (w < 0.0f || u + w > 1.0f)
+        return false;
+    t = (e2 * qv) * inv;
+    return t >= 0.0f;
+}
+
+// The nearest point of a triangle after Ericson, Real-Time Collision Detection
+static inline Base::Vector3f nearestOnTriangle(const Base::Vector3f& p, const Base::Vector3f* v)
+{
+    Base::Vector3f ab = v[1] - v[0];
+    Base::Vector3f ac = v[2] - v[0];
+    Base::Vector3f ap = p - v[0];
+    float d1 = ab * ap;
+    float d2 = ac * ap;
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return v[0];
+
+    Base::Vector3f bp = p - v[1];
+    float d3 = ab * bp;
+    float d4 = ac * bp;
+    if (d3 >= 0.0f && d4 <= d3)
+        return v[1];
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return v[0] + ab * (d1 / (d1 - d3));
+
+    Base::Vector3f cp = p - v[2];
+    float d5 = ab * cp;
+    float d6 = ac * cp;
+    if (d6 >= 0.0f && d5 <= d6)
+        return v[2];
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return v[0] + ac * (d2 / (d2 - d6));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return v[1] + (v[2] - v[1]) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    float denom = va + vb + vc;
+    if (denom == 0.0f) // degenerated facet
+        return v[0];
+    denom = 1.0f / denom;
+    return v[0] + ab * (vb * denom) + ac * (vc * denom);
+}
+
+/// Runs the ray queries of a range of rays
+struct RayQuery
+{
+    typedef void result_type;
+    RayQuery(const MeshFacetBVH& bvh, const std::vector<Base::Vector3f>& pts, const std::vector<Base::Vector3f>& dirs,
+             std::vector<Base::Vector3f>& res, std::vector<unsigned long>& facets, float maxDist)
+      : bvh(bvh), pts(pts), dirs(dirs), res(res), facets(facets), maxDist(maxDist)
+    {
+    }
+    void operator()(const std::pair<unsigned long, unsigned long>& range) const
+    {
+        for (unsigned long i = range.first; i < range.second; i++) {
+            if (!bvh.NearestFacetOnRay(pts[i], dirs[i], res[i], facets[i], maxDist))
+                facets[i] = ULONG_MAX;
+        }
+    }
+
+    const MeshFacetBVH& bvh;
+    const std::vector<Base::Vector3f>& pts;
+    const std::vector<Base::Vector3f>& dirs;
+    std::vector<Base::Vector3f>& res;
+    std::vector<unsigned long>& facets;
+    float maxDist;
+};
+
+} // namespace BVH
+} // namespace MeshCore
+
+MeshFacetBVH::MeshFacetBVH(const MeshKernel& rclM)
+  : _rclMesh(rclM), _bTransform(false)
+{
+    Rebuild();
+}
+
+MeshFacetBVH::MeshFacetBVH(const MeshKernel& rclM, const Base::Matrix4D& rclTrf)
+  : _rclMesh(rclM), _clTrf(rclTrf), _bTransform(true)
+{
+    Rebuild();
+}
+
+MeshFacetBVH::~MeshFacetBVH()
+{
+}
+
+void MeshFacetBVH::Rebuild()
+{
+    using namespace BVH;
+
+    _aclNodes.clear();
+    _aclPoints.clear();
+    _aulFacets.clear();
+
+    const MeshPointArray& rPoints = _rclMesh.GetPoints();
+    const MeshFacetArray& rFacets = _rclMesh.GetFacets();
+    unsigned long ctFacets = rFacets.size();
+    if (ctFacets == 0)
+        return;
+
+    std::vector<Base::Vector3f> points;
+    points.reserve(rPoints.size());
+    for (MeshPointArray::_TConstIterator it = rPoints.begin(); it != rPoints.end(); ++it) {
+        if (_bTransform)
+            points.push_back(_clTrf * (*it));
+        else
+            points.push_back(*it);
+    }
+
+    std::vector<Box> boxes(ctFacets);
+    std::vector<Base::Vector3f> centers(ctFacets);
+    std::vector<unsigned long> order(ctFacets);
+    for (unsigned long i = 0; i < ctFacets; i++) {
+        const MeshFacet& face = rFacets[i];
+        for (int j = 0; j < 3; j++)
+            boxes[i].Add(points[face._aulPoints[j]]);
+        centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+        order[i] = i;
+    }
+
+    _aclNodes.reserve(2 * ctFacets - 1);
+    _aclNodes.push_back(Node());
+
+    std::vector<Range> stack;
+    Range root = {0, 0, ctFacets, 0};
+    stack.push_back(root);
+    while (!stack.empty()) {
+        Range r = stack.back();
+        stack.pop_back();
+
+        Box bounds, centerBounds;
+        for (unsigned long i = r.first; i < r.last; i++) {
+            bounds.Add(boxes[order[i]]);
+            centerBounds.Add(centers[order[i]]);
+        }
+
+        Node& node = _aclNodes[r.node];
+        node._afMin[0] = bounds.min.x; node._afMin[1] = bounds.min.y; node._afMin[2] = bounds.min.z;
+        node._afMax[0] = bounds.max.x; node._afMax[1] = bounds.max.y; node._afMax[2] = bounds.max.z;
+
+        unsigned long count = r.last - r.first;
+        int bestAxis = -1;
+        int bestBin = 0;
+        if (count > 2) {
+            // the cost of a traversal step is about the cost of a facet test
+            float bestCost = count > MaxLeafSize ? FLOAT_MAX : float(count) * bounds.HalfArea();
+            float leafArea = bounds.HalfArea();
+            for (unsigned short axis = 0; axis < 3 && r.depth < MaxSAHDepth; axis++) {
+                float cmin = centerBounds.min[axis];
+                float extent = centerBounds.max[axis] - cmin;
+                if (extent <= 0.0f)
+                    continue;
+                float scale = NumBins / extent;
+
+                Bin bins[NumBins];
+                for (unsigned long i = r.first; i < r.last; i++) {
+                    Bin& bin = bins[binIndex(centers[order[i]][axis], cmin, scale)];
+                    bin.box.Add(boxes[order[i]]);
+                    bin.count++;
+                }
+
+                // sweep from the right to get the areas of the right sides
+                float rightArea[NumBins];
+                unsigned long rightCount[NumBins];
+                Box rightBox;
+                unsigned long ctRight = 0;
+                for (int i = NumBins - 1; i > 0; i--) {
+                    rightBox.Add(bins[i].box);
+                    ctRight += bins[i].count;
+                    rightArea[i] = rightBox.HalfArea();
+                    rightCount[i] = ctRight;
+                }
+
+                Box leftBox;
+                unsigned long ctLeft = 0;
+                for (int i = 0; i < NumBins - 1; i++) {
+                    leftBox.Add(bins[i].box);
+                    ctLeft += bins[i].count;
+                    if (ctLeft == 0 || rightCount[i+1] == 0)
+                        continue;
+                    float cost = leafArea + float(ctLeft) * leftBox.HalfArea()
+                                          + float(rightCount[i+1]) * rightArea[i+1];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = i;
+                    }
+                }
+            }
+        }
+
+        std::vector<unsigned long>::iterator first = order.begin() + r.first;
+        std::vector<unsigned long>::iterator last = order.begin() + r.last;
+        std::vector<unsigned long>::iterator mid = first;
+        if (bestAxis >= 0) {
+            float cmin = centerBounds.min[static_cast<unsigned short>(bestAxis)];
+            float scale = NumBins / (centerBounds.max[static_cast<unsigned short>(bestAxis)] - cmin);
+            for (std::vector<unsigned long>::iterator it = first; it != last; ++it) {
+                if (binIndex(centers[*it][static_cast<unsigned short>(bestAxis)], cmin, scale) <= bestBin)
+                    std::iter_swap(it, mid++);
+            }
+        }
+        else if (count > MaxLeafSize) {
+            // the heuristic found no split or the tree gets too deep, so
+            // split in the middle of the longest axis of the centers
+            Base::Vector3f extent = centerBounds.max - centerBounds.min;
+            unsigned short axis = 0;
+            if (extent.y > extent.x)
+                axis = 1;
+            if (extent.z > std::max<float>(extent.x, extent.y))
+                axis = 2;
+            mid = first + count / 2;
+            std::nth_element(first, mid, last, CenterLess(centers, axis));
+        }
+
+        if (mid == first || mid == last) {
+            node._ulFirst = r.first;
+            node._ulCount = count;
+            continue;
+        }
+
+        unsigned long left = _aclNodes.size();
+        node._ulFirst = left;
+        node._ulCount = 0;
+        _aclNodes.push_back(Node());
+        _aclNodes.push_back(Node());
+
+        unsigned long split = r.first + static_cast<unsigned long>(mid - first);
+        Range right = {left + 1, split, r.last, r.depth + 1};
+        stack.push_back(right);
+        Range lower = {left, r.first, split, r.depth + 1};
+        stack.push_back(lower);
+    }
+
+    _aclPoints.reserve(3 * ctFacets);
+    _aulFacets.reserve(ctFacets);
+    for (std::vector<unsigned long>::iterator it = order.begin(); it != order.end(); ++it) {
+        const MeshFacet& face = rFacets[*it];
+        for (int j = 0; j < 3; j++)
+            _aclPoints.push_back(points[face._aulPoints[j]]);
+        _aulFacets.push_back(*it);
+    }
+}
+
+bool MeshFacetBVH::NearestFacetOnRay(const Base::Vector3f& rclPt, const Base::Vector3f& rclDir,
+                                     Base::Vector3f& rclRes, unsigned long& rulFacet, float fMaxDist) const
+{
+    using namespace BVH;
+
+    float len = rclDir.Length();
+    if (_aclNodes.empty() || len == 0.0f)
+        return false;
+
+    // with a normalized direction the ray parameter is the distance
+    Base::Vector3f dir = rclDir / len;
+    float inv[3];
+    for (int i = 0; i < 3; i++)
+        inv[i] = std::fabs(dir[i]) > 1.0e-20f ? 1.0f / dir[i] : (dir[i] < 0.0f ? -FLOAT_MAX : FLOAT_MAX);
+
+    float best = fMaxDist;
+    unsigned long hit = ULONG_MAX;
+
+    StackItem stack[StackSize];
+    int top = 0;
+    float dist;
+    const Node& root = _aclNodes.front();
+    if (!hitBox(root._afMin, root._afMax, rclPt, inv, best, dist))
+        return false;
+    stack[top].node = 0;
+    stack[top].dist = dist;
+    top++;
+
+    while (top > 0) {
+        StackItem item = stack[--top];
+        if (item.dist > best)
+            continue;
+        const Node& node = _aclNodes[item.node];
+        if (node._ulCount > 0) {
+            unsigned long last = node._ulFirst + node._ulCount;
+            for (unsigned long i = node._ulFirst; i < last; i++) {
+                float t;
+                if (hitTriangle(rclPt, dir, &_aclPoints[3 * i], t) && t <= best) {
+                    best = t;
+                    hit = i;
+                }
+            }
+            continue;
+        }
+
+        // push the farther child first, so the nearer one gets visited first
+        unsigned long left = node._ulFirst;
+        float distLeft, distRight;
+        const Node& l = _aclNodes[left];
+        const Node& r = _aclNodes[left + 1];
+        bool hitLeft = hitBox(l._afMin, l._afMax, rclPt, inv, best, distLeft);
+        bool hitRight = hitBox(r._afMin, r._afMax, rclPt, inv, best, distRight);
+        if (hitLeft && hitRight) {
+            bool leftFirst = distLeft <= distRight;
+            stack[top].node = leftFirst ? left + 1 : left;
+            stack[top].dist = leftFirst ? distRight : distLeft;
+            top++;
+            stack[top].node = leftFirst ? left : left + 1;
+            stack[top].dist = leftFirst ? distLeft : distRight;
+            top++;
+        }
+        else if (hitLeft) {
+            stack[top].node = left;
+            stack[top].dist = distLeft;
+            top++;
+        }
+        else if (hitRight) {
+            stack[top].node = left + 1;
+            stack[top].dist = distRight;
+            top++;
+        }
+    }
+
+    if (hit == ULONG_MAX)
+        return false;
+
+    rclRes = rclPt + dir * best;
+    rulFacet = _aulFacets[hit];
+    return true;
+}
+
+void MeshFacetBVH::NearestFacetsOnRays(const std::vector<Base::Vector3f>& rclPts, const std::vector<Base::Vector3f>& rclDirs,
+                                       std::vector<Base::Vector3f>& rclRes, std::vector<unsigned long>& raulFacets,
+                                       float fMaxDist) const
+{
+    unsigned long count = std::min<unsigned long>(rclPts.size(), rclDirs.size());
+    rclRes.resize(count);
+    raulFacets.resize(count);
+
+    // several blocks per thread as the rays may take very different times
+    unsigned long ctThreads = std::max<int>(QThread::idealThreadCount(), 1);
+    unsigned long blockSize = std::max<unsigned long>(count / (4 * ctThreads), 256);
+    std::vector<std::pair<unsigned long, unsigned long> > blocks;
+    for (unsigned long i = 0; i < count; i += blockSize)
+        blocks.push_back(std::make_pair(i, std::min<unsigned long>(i + blockSize, count)));
+
+    BVH::RayQuery query(*this, rclPts, rclDirs, rclRes, raulFacets, fMaxDist);
+    if (blocks.size() > 1)
+        QtConcurrent::blockingMap(blocks, query);
+    else if (blocks.size() == 1)
+        query(blocks.front());
+}
+
+bool MeshFacetBVH::NearestPointFromPoint(const Base::Vector3f& rclPt, Base::Vector3f& rclRes,
+                                         unsigned long& rulFacet, float fMaxDist) const
+{
+    using namespace BVH;
+
+    if (_aclNodes.empty())
+        return false;
+
+    float best = fMaxDist < FLOAT_MAX ? fMaxDist * fMaxDist : FLOAT_MAX;
+    unsigned long hit = ULONG_MAX;
+    Base::Vector3f nearest;
+
+    StackItem stack[StackSize];
+    int top = 0;
+    const Node& root = _aclNodes.front();
+    stack[top].node = 0;
+    stack[top].dist = boxDistance2(root._afMin, root._afMax, rclPt);
+    top++;
+
+    while (top > 0) {
+        StackItem item = stack[--top];
+        if (item.dist > best)
+            continue;
+        const Node& node = _aclNodes[item.node];
+        if (node._ulCount > 0) {
+            unsigned long last = node._ulFirst + node._ulCount;
+            for (unsigned long i = node._ulFirst; i < last; i++) {
+                Base::Vector3f pnt = nearestOnTriangle(rclPt, &_aclPoints[3 * i]);
+                float dist = Base::DistanceP2(rclPt, pnt);
+                if (dist <= best) {
+                    best = dist;
+                    hit = i;
+                    nearest = pnt;
+                }
+            }
+            continue;
+        }
+
+        unsigned long left = node._ulFirst;
+        const Node& l = _aclNodes[left];
+        const Node& r = _aclNodes[left + 1];
+        float distLeft = boxDistance2(l._afMin, l._afMax, rclPt);
+        float distRight = boxDistance2(r._afMin, r._afMax, rclPt);
+        bool leftFirst = distLeft <= distRight;
+        stack[top].node = leftFirst ? left + 1 : left;
+        stack[top].dist = leftFirst ? distRight : distLeft;
+        top++;
+        stack[top].node = leftFirst ? left : left + 1;
+        stack[top].dist = leftFirst ? distLeft : distRight;
+        top++;
+    }
+
+    if (hit == ULONG_MAX)
+        return false;
+
+    rclRes = nearest;
+    rulFacet = _aulFacets[hit];
+    return true;
+}
+
+Base::BoundBox3f MeshFacetBVH::GetBoundBox() const
+{
+    if (_aclNodes.empty())
+        return Base::BoundBox3f();
+    const Node& root = _aclNodes.front();
+    return Base::BoundBox3f(root._afMin[0], root._afMin[1], root._afMin[2],
+                            root._afMax[0], root._afMax[1], root._afMax[2]);
+}
+
+unsigned long MeshFacetBVH::GetDepth() const
+{
+    if (_aclNodes.empty())
+        return 0;
+
+    unsigned long depth = 0;
+    std::vector<std::pair<unsigned long, unsigned long> > stack;
+    stack.push_back(std::make_pair(0, 1));
+    while (!stack.empty()) {
+        std::pair<unsigned long, unsigned long> item = stack.back();
+        stack.pop_back();
+        depth = std::max<unsigned long>(depth, item.second);
+        const Node& node = _aclNodes[item.first];
+        if (node._ulCount == 0) {
+            stack.push_back(std::make_pair(node._ulFirst, item.second + 1));
+            stack.push_back(std::make_pair(node._ulFirst + 1, item.second + 1));
+        }
+    }
+    return depth;
+}
+
+unsigned long MeshFacetBVH::MemSize() const
+{
+    return sizeof(MeshFacetBVH)
+         + _aclNodes.capacity() * sizeof(Node)
+         + _aclPoints.capacity() * sizeof(Base::Vector3f)
+         + _aulFacets.capacity() * sizeof(unsigned long);
+}
@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef MESHCORE_BVH_H
+#define MESHCORE_BVH_H
+
+#include <vector>
+#include "Definitions.h"
+#include "Elements.h"
+#include <Base/BoundBox.h>
+#include <Base/Matrix.h>
+#include <Base/Vector3D.h>
+
+namespace MeshCore {
+
+class MeshKernel;
+
+/**
+ * The MeshFacetBVH is a bounding volume hierarchy of the facets of a mesh.
+ * Unlike the MeshFacetGrid whose cells all have the same size it adapts to
+ * the density of the mesh, so it keeps fast for meshes with a few very
+ * detailed areas, e.g. scans.
+ *
+ * The tree is built with the surface area heuristic. The nodes are stored
+ * in one array and the points of the facets are copied in the order of the
+ * leaves, so the queries don't need to access the kernel.
+ * The hierarchy must be rebuilt after the mesh has been modified.
+ */
+class MeshExport MeshFacetBVH
+{
+public:
+    /// Construction
+    MeshFacetBVH(const MeshKernel& rclM);
+    /// Construction, the facets are transformed with \a rclTrf
+    MeshFacetBVH(const MeshKernel& rclM, const Base::Matrix4D& rclTrf);
+    /// Destruction
+    ~MeshFacetBVH();
+
+    /** Rebuilds the hierarchy from the current state of the mesh. */
+    void Rebuild();
+
+    /** @name Queries */
+    //@{
+    /**
+     * Searches for the nearest facet hit by the ray (\a rclPt, \a rclDir) in
+     * direction of \a rclDir and not farther away than \a fMaxDist.
+     * The point \a rclRes holds the intersection point and \a rulFacet the
+     * index of the facet. If there is no intersection false is returned.
+     */
+    bool NearestFacetOnRay(const Base::Vector3f& rclPt, const Base::Vector3f& rclDir,
+                           Base::Vector3f& rclRes, unsigned long& rulFacet,
+                           float fMaxDist = FLOAT_MAX) const;
+    /**
+     * Does the same as NearestFacetOnRay() for several rays at once. The work
+     * is distributed over several threads. For a ray without intersection the
+     * facet index is ULONG_MAX.
+     */
+    void NearestFacetsOnRays(const std::vector<Base::Vector3f>& rclPts, const std::vector<Base::Vector3f>& rclDirs,
+                             std::vector<Base::Vector3f>& rclRes, std::vector<unsigned long>& raulFacets,
+                             float fMaxDist = FLOAT_MAX) const;
+    /**
+     * Searches for the nearest point on the mesh to \a rclPt which is not
+     * farther away than \a fMaxDist.
+     * The point \a rclRes holds the nearest point and \a rulFacet the index
+     * of its facet. If there is no facet within the distance false is returned.
+     */
+    bool NearestPointFromPoint(const Base::Vector3f& rclPt, Base::Vector3f& rclRes,
+                               unsigned long& rulFacet, float fMaxDist = FLOAT_MAX) const;
+    //@}
+
+    /** @name Information */
+    //@{
+    /// Returns the bounding box of all facets
+    Base::BoundBox3f GetBoundBox() const;
+    /// Returns the number of nodes
+    unsigned long CountNodes() const
+    { return static_cast<unsigned long>(_aclNodes.size()); }
+    /// Returns the number of levels
+    unsigned long GetDepth() const;
+    /// Returns the used memory in bytes
+    unsigned long MemSize() const;
+    //@}
+
+protected:
+    struct Node {
+        float _afMin[3];
+        float _afMax[3];
+        /// index of the left child, the right child follows, or of the first facet of a leaf
+        ElementIndex _ulFirst;
+        /// number of facets of a leaf, 0 for an inner node
+        ElementIndex _ulCount;
+    };
+
+    const MeshKernel& _rclMesh;
+    Base::Matrix4D _clTrf;
+    bool _bTransform;
+    std::vector<Node> _aclNodes;
+    /// the three corners of each facet in the order of the leaves
+    std::vector<Base::Vector3f> _aclPoints;
+    /// the facet index of each facet in the order of the leaves
+    std::vector<unsigned long> _aulFacets;
+
+private:
+    MeshFacetBVH(const MeshFacetBVH&);
+    void operator = (const MeshFacetBVH&);
+};
+
+} // namespace MeshCore
+
+#endif // MESHCORE_BVH_H
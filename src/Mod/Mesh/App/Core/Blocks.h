@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef MESHCORE_BLOCKS_H
+#define MESHCORE_BLOCKS_H
+
+#include <algorithm>
+#include <vector>
+#include <QThread>
+#include <QtConcurrentMap>
+
+namespace MeshCore {
+
+/**
+ * Helpers to process the points or facets of a mesh in several threads. The
+ * elements are split into ranges, called blocks, and every block is done by one
+ * thread. A block type needs the members 'first' and 'last' that hold the
+ * half-open range of its elements, it may carry the results of its range.
+ */
+namespace Blocks {
+
+/// Returns the block size that gives one block per thread, meshes with less
+/// than 10000 elements get a single block
+inline unsigned long threadBlockSize(unsigned long count)
+{
+    unsigned long ctBlocks = 1;
+    if (count >= 10000)
+        ctBlocks = std::max<int>(QThread::idealThreadCount(), 1);
+    return std::max<unsigned long>((count + ctBlocks - 1) / ctBlocks, 1);
+}
+
+/// Splits \a count elements into blocks of \a blockSize elements
+template <class Block>
+std::vector<Block> makeBlocks(unsigned long count, unsigned long blockSize)
+{
+    std::vector<Block> blocks;
+    for (unsigned long i = 0; i < count; i += blockSize) {
+        Block b;
+        b.first = i;
+        b.last = std::min<unsigned long>(i + blockSize, count);
+        blocks.push_back(b);
+    }
+    return blocks;
+}
+
+/// Splits \a count elements into one block per thread
+template <class Block>
+std::vector<Block> makeThreadBlocks(unsigned long count)
+{
+    return makeBlocks<Block>(count, threadBlockSize(count));
+}
+
+/// Runs \a func on every block, concurrently if \a parallel is true and there is
+/// more than one block
+template <class Block, class Functor>
+void runBlocks(std::vector<Block>& blocks, const Functor& func, bool parallel = true)
+{
+    if (parallel && blocks.size() > 1) {
+        QtConcurrent::blockingMap(blocks, func);
+    }
+    else {
+        for (typename std::vector<Block>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+            func(*it);
+    }
+}
+
+} // namespace Blocks
+
+} // namespace MeshCore
+
+#endif // MESHCORE_BLOCKS_H
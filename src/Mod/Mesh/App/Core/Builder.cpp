@@ -27,6 +27,9 @@
 # include <algorithm>
 #endif
 
+#include <QThread>
+#include <QtConcurrentMap>
+
 #include <Base/Sequencer.h>
 #include <Base/Exception.h>
 
@@ -253,3 +256,151 @@ void MeshBuilder::Finish (bool freeMemory)
 
     _meshKernel.RecalcBoundBox();
 }
+
+// ----------------------------------------------------------------------------
+
+namespace MeshCore {
+namespace FastBuilder {
+
+struct Vertex
+{
+    float x, y, z;
+    unsigned long i;
+
+    bool operator < (const Vertex& v) const
+    {
+        if (x != v.x)
+            return x < v.x;
+        if (y != v.y)
+            return y < v.y;
+        return z < v.z;
+    }
+    bool operator != (const Vertex& v) const
+    {
+        return x != v.x || y != v.y || z != v.z;
+    }
+};
+
+struct Range
+{
+    std::vector<Vertex>::iterator first, middle, last;
+};
+
+struct SortRange
+{
+    typedef void result_type;
+    void operator()(Range& r) const
+    { std::sort(r.first, r.last); }
+};
+
+struct MergeRange
+{
+    typedef void result_type;
+    void operator()(Range& r) const
+    { std::inplace_merge(r.first, r.middle, r.last); }
+};
+
+}
+}
+
+MeshFastBuilder::MeshFastBuilder (MeshKernel& kernel) : _meshKernel(kernel)
+{
+}
+
+MeshFastBuilder::~MeshFastBuilder (void)
+{
+}
+
+void MeshFastBuilder::Initialize (unsigned long ctFacets)
+{
+    _meshKernel.Clear();
+    _corners.resize(3 * ctFacets);
+}
+
+void MeshFastBuilder::SetFacet (unsigned long index, const Base::Vector3f* facetPoints)
+{
+    Base::Vector3f* corners = &_corners[3 * index];
+    corners[0] = facetPoints[0];
+    corners[1] = facetPoints[1];
+    corners[2] = facetPoints[2];
+
+    // adjust circulation direction
+    if ((((facetPoints[1] - facetPoints[0]) % (facetPoints[2] - facetPoints[0])) * facetPoints[3]) < 0.0f)
+        std::swap(corners[1], corners[2]);
+}
+
+void MeshFastBuilder::Finish (void)
+{
+    using namespace FastBuilder;
+
+    std::size_t ctCorners = _corners.size();
+    std::vector<Vertex> verts(ctCorners);
+    for (std::size_t i = 0; i < ctCorners; i++) {
+        const Base::Vector3f& p = _corners[i];
+        Vertex& v = verts[i];
+        v.x = p.x; v.y = p.y; v.z = p.z;
+        v.i = i;
+    }
+    std::vector<Base::Vector3f>().swap(_corners);
+
+    // sort the blocks in parallel and merge them pairwise
+    std::size_t ctBlocks = std::max<int>(QThread::idealThreadCount(), 1);
+    std::size_t blockSize = std::max<std::size_t>((ctCorners + ctBlocks - 1) / ctBlocks, 1);
+    std::vector<Range> ranges;
+    for (std::size_t i = 0; i < ctCorners; i += blockSize) {
+        Range r;
+        r.first = verts.begin() + i;
+        r.last = verts.begin() + std::min(i + blockSize, ctCorners);
+        r.middle = r.last;
+        ranges.push_back(r);
+    }
+    QtConcurrent::blockingMap(ranges, SortRange());
+
+    while (ranges.size() > 1) {
+        std::vector<Range> merged;
+        for (std::size_t i = 0; i + 1 < ranges.size(); i += 2) {
+            Range r;
+            r.first = ranges[i].first;
+            r.middle = ranges[i].last;
+            r.last = ranges[i+1].last;
+            merged.push_back(r);
+        }
+        QtConcurrent::blockingMap(merged, MergeRange());
+        if (ranges.size() % 2 != 0)
+            merged.push_back(ranges.back());
+        ranges.swap(merged);
+    }
+
+    // assign a point index to each corner
+    MeshPointArray points;
+    std::vector<unsigned long> indices(ctCorners);
+    for (std::vector<Vertex>::iterator it = verts.begin(); it != verts.end(); ++it) {
+        if (it == verts.begin() || *(it-1) != *it)
+            points.push_back(MeshPoint(Base::Vector3f(it->x, it->y, it->z)));
+        indices[it->i] = points.size() - 1;
+    }
+    std::vector<Vertex>().swap(verts);
+
+    // skip degenerated facets (one edge has length 0)
+    MeshFacetArray facets;
+    facets.reserve(ctCorners / 3);
+    for (std::size_t i = 0; i < ctCorners; i += 3) {
+        unsigned long p0 = indices[i], p1 = indices[i+1], p2 = indices[i+2];
+        if (p0 == p1 || p0 == p2 || p1 == p2)
+            continue;
+        facets.push_back(MeshFacet(p0, p1, p2));
+    }
+    bool degenerated = facets.size() * 3 < ctCorners;
+
+    _meshKernel.Adopt(points, facets, true);
+
+    // the points of degenerated facets may be unreferenced
+    if (degenerated) {
+        _meshKernel._aclPointArray.SetFlag(MeshPoint::INVALID);
+        for (MeshFacetArray::_TConstIterator it = _meshKernel._aclFacetArray.begin(); it != _meshKernel._aclFacetArray.end(); ++it) {
+            for (int i=0; i<3; i++)
+                _meshKernel._aclPointArray[it->_aulPoints[i]].ResetInvalid();
+        }
+        _meshKernel.RemoveInvalids();
+    }
+}
@@ -164,6 +164,42 @@ private:
     float _fSaveTolerance;
 };
 
+/**
+ * Class for creating the mesh structure from a large number of facets, e.g. read in from an
+ * STL file. Unlike MeshBuilder the points are not merged while adding the facets but all corners
+ * are collected and finally merged with a parallel sort. Only points with identical coordinates
+ * are merged.
+ * \code
+ * MeshFastBuilder builder(someMeshReference);
+ * builder.Initialize(numberOfFacets);
+ * ...
+ * // may be called from several threads for different indices
+ * builder.SetFacet(index, facetPoints);
+ * ...
+ * builder.Finish();
+ * \endcode
+ */
+class MeshExport MeshFastBuilder
+{
+public:
+    MeshFastBuilder(MeshKernel &rclM);
+    ~MeshFastBuilder(void);
+
+    /** Clears the mesh kernel and reserves the space for \a ctFacets facets. */
+    void Initialize (unsigned long ctFacets);
+    /** Sets the facet with index \a index that must be lower than the number passed to Initialize().
+     * @param facetPoints Array of vectors (size 4) in order of vec1, vec2, vec3, normal. If the
+     * normal is not null it is used to adjust the orientation of the facet.
+     */
+    void SetFacet (unsigned long index, const Base::Vector3f* facetPoints);
+    /** Merges the points, removes degenerated facets and assigns the result to the mesh kernel. */
+    void Finish (void);
+
+private:
+    MeshKernel& _meshKernel;
+    std::vector<Base::Vector3f> _corners;
+};
+
 } // namespace MeshCore
 
 #endif 
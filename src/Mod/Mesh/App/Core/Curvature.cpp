@@ -66,7 +66,7 @@ void MeshCurvature::ComputePerFace(bool parallel)
     Base::Vector3f rkDir0, rkDir1, rkPnt;
     Base::Vector3f rkNormal;
     myCurvature.clear();
-    MeshRefPointToFacets search(myKernel);
+    MeshFlatPointToFacets search(myKernel);
     FacetCurvature face(myKernel, search, myRadius, myMinPoints);
 
     if (!parallel) {
@@ -126,8 +126,8 @@ void MeshCurvature::ComputePerVertex()
     // get all points
     const MeshPointArray& pts = myKernel.GetPoints();
 
-    MeshCore::MeshRefPointToFacets pt2f(myKernel);
-    MeshCore::MeshRefPointToPoints pt2p(myKernel);
+    MeshCore::MeshFlatPointToFacets pt2f(myKernel);
+    MeshCore::MeshFlatPointToPoints pt2p(pt2f, myKernel);
     unsigned long numPoints = myKernel.CountPoints();
 
     myCurvature.clear();
@@ -161,8 +161,8 @@ void MeshCurvature::ComputePerVertex()
 
         int iV0 = i;
         int iV1;
-        const std::set<unsigned long>& nb = pt2p[i];
-        for (std::set<unsigned long>::const_iterator it = nb.begin(); it != nb.end(); ++it) {
+        MeshIndexRange nb = pt2p[i];
+        for (MeshIndexRange::const_iterator it = nb.begin(); it != nb.end(); ++it) {
             iV1 = *it;
 
             // Compute edge from V0 to V1, project to tangent plane of vertex,
@@ -359,7 +359,7 @@ private:
 
 // --------------------------------------------------------
 
-FacetCurvature::FacetCurvature(const MeshKernel& kernel, const MeshRefPointToFacets& search, float r, unsigned long pt)
+FacetCurvature::FacetCurvature(const MeshKernel& kernel, const MeshFlatPointToFacets& search, float r, unsigned long pt)
   : myKernel(kernel), mySearch(search), myMinPoints(pt), myRadius(r)
 {
 }
@@ -29,7 +29,7 @@
 namespace MeshCore {
 
 class MeshKernel;
-class MeshRefPointToFacets;
+class MeshFlatPointToFacets;
 
 /** Curvature information. */
 struct MeshExport CurvatureInfo
@@ -41,12 +41,12 @@ struct MeshExport CurvatureInfo
 class MeshExport FacetCurvature
 {
 public:
-    FacetCurvature(const MeshKernel& kernel, const MeshRefPointToFacets& search, float, unsigned long);
+    FacetCurvature(const MeshKernel& kernel, const MeshFlatPointToFacets& search, float, unsigned long);
     CurvatureInfo Compute(unsigned long index) const;
 
 private:
     const MeshKernel& myKernel;
-    const MeshRefPointToFacets& mySearch;
+    const MeshFlatPointToFacets& mySearch;
     unsigned long myMinPoints;
     float myRadius;
 };
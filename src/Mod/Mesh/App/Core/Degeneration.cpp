@@ -515,7 +515,7 @@ unsigned long MeshFixDegeneratedFacets::RemoveEdgeTooSmall (float fMinEdgeLength
 
     // repeat until no facet van be removed
     do {
-        MeshRefPointToFacets  clPt2Facets(_rclMesh);
+        MeshFlatPointToFacets clPt2Facets(_rclMesh);
 
         rclFAry.ResetInvalid();
         rclPAry.ResetInvalid();
@@ -571,8 +571,8 @@ unsigned long MeshFixDegeneratedFacets::RemoveEdgeTooSmall (float fMinEdgeLength
 
             // Redirect all point-indices to the new neighbour point of all facets referencing the
             // deleted point
-            const std::set<unsigned long>& faces = clPt2Facets[pI->second];
-            for (std::set<unsigned long>::const_iterator pF = faces.begin(); pF != faces.end(); ++pF) {
+            MeshIndexRange faces = clPt2Facets[pI->second];
+            for (MeshIndexRange::const_iterator pF = faces.begin(); pF != faces.end(); ++pF) {
                 const MeshFacet &rclF = f_beg[*pF];
 
                 for (int i = 0; i < 3; i++) {
@@ -704,7 +704,7 @@ bool MeshFixDeformedFacets::Fixup()
 bool MeshEvalDentsOnSurface::Evaluate()
 {
     this->indices.clear();
-    MeshRefPointToFacets  clPt2Facets(_rclMesh);
+    MeshFlatPointToFacets clPt2Facets(_rclMesh);
     const MeshPointArray& rPntAry = _rclMesh.GetPoints();
     MeshFacetArray::_TConstIterator f_beg = _rclMesh.GetFacets().begin();
 
@@ -717,11 +717,11 @@ bool MeshEvalDentsOnSurface::Evaluate()
 
         // get the local neighbourhood of the point
         std::set<unsigned long> nb = clPt2Facets.NeighbourPoints(point,1);
-        const std::set<unsigned long>& faces = clPt2Facets[index];
+        MeshIndexRange faces = clPt2Facets[index];
 
         for (std::set<unsigned long>::iterator pt = nb.begin(); pt != nb.end(); ++pt) {
             const MeshPoint& mp = rPntAry[*pt];
-            for (std::set<unsigned long>::const_iterator
+            for (MeshIndexRange::const_iterator
                 ft = faces.begin(); ft != faces.end(); ++ft) {
                     // the point must not be part of the facet we test
                     if (f_beg[*ft]._aulPoints[0] == *pt)
@@ -733,7 +733,7 @@ bool MeshEvalDentsOnSurface::Evaluate()
                     // is the point projectable onto the facet?
                     rTriangle = _rclMesh.GetFacet(f_beg[*ft]);
                     if (rTriangle.IntersectWithLine(mp,rTriangle.GetNormal(),tmp)) {
-                        const std::set<unsigned long>& f = clPt2Facets[*pt];
+                        MeshIndexRange f = clPt2Facets[*pt];
                         this->indices.insert(this->indices.end(), f.begin(), f.end());
                         break;
                     }
@@ -895,8 +895,8 @@ bool MeshEvalBorderFacet::Evaluate()
     const MeshCore::MeshFacetArray& facets = _rclMesh.GetFacets();
     MeshCore::MeshFacetArray::_TConstIterator f_it,
         f_beg = facets.begin(), f_end = facets.end();
-    MeshCore::MeshRefPointToPoints vv_it(_rclMesh);
-    MeshCore::MeshRefPointToFacets vf_it(_rclMesh);
+    MeshCore::MeshFlatPointToFacets vf_it(_rclMesh);
+    MeshCore::MeshFlatPointToPoints vv_it(vf_it, _rclMesh);
 
     for (f_it = facets.begin(); f_it != f_end; ++f_it) {
         bool ok = true;
@@ -28,6 +28,7 @@
 #include <vector>
 #include <climits>
 #include <cstring>
+#include <stdint.h>
 
 #include "Definitions.h"
 
@@ -44,6 +45,43 @@ namespace MeshCore {
 class MeshHelpEdge;
 class MeshPoint;
 
+#if defined(MESH_COMPACT_INDEX)
+/**
+ * Storage type of the indices and properties kept in the points and facets of the
+ * mesh kernel if it is built with FREECAD_MESH_COMPACT_INDEX.
+ * The value is stored with 32 bits but behaves like an unsigned long, i.e. ULONG_MAX
+ * still marks an invalid index. This shrinks a facet from 64 to 32 and a point from
+ * 24 to 20 bytes on 64 bit platforms and so limits the kernel to 2^32-1 elements.
+ */
+class MeshExport ElementIndex
+{
+public:
+  ElementIndex() { }
+  ElementIndex(unsigned long ulIndex)
+    : _value(ulIndex == ULONG_MAX ? UINT32_MAX : static_cast<uint32_t>(ulIndex)) { }
+  operator unsigned long() const
+  { return _value == UINT32_MAX ? ULONG_MAX : static_cast<unsigned long>(_value); }
+
+  ElementIndex& operator ++ ()
+  { *this = static_cast<unsigned long>(*this) + 1; return *this; }
+  ElementIndex& operator -- ()
+  { *this = static_cast<unsigned long>(*this) - 1; return *this; }
+  ElementIndex operator ++ (int)
+  { ElementIndex tmp(*this); ++(*this); return tmp; }
+  ElementIndex operator -- (int)
+  { ElementIndex tmp(*this); --(*this); return tmp; }
+  ElementIndex& operator += (unsigned long ulVal)
+  { *this = static_cast<unsigned long>(*this) + ulVal; return *this; }
+  ElementIndex& operator -= (unsigned long ulVal)
+  { *this = static_cast<unsigned long>(*this) - ulVal; return *this; }
+
+private:
+  uint32_t _value;
+};
+#else
+typedef unsigned long ElementIndex;
+#endif
+
 /**
  * Helper class providing an operator for comparison 
  * of two edges. The class holds the point indices of the
@@ -135,7 +173,7 @@ public:
 
 public:
   unsigned char _ucFlag; /**< Flag member */
-  unsigned long _ulProp; /**< Free usable property */
+  ElementIndex  _ulProp; /**< Free usable property */
 };
 
 /**
@@ -292,9 +330,9 @@ public:
 
 public:
   unsigned char _ucFlag; /**< Flag member. */
-  unsigned long _ulProp; /**< Free usable property. */
-  unsigned long _aulPoints[3];     /**< Indices of corner points. */
-  unsigned long _aulNeighbours[3]; /**< Indices of neighbour facets. */
+  ElementIndex  _ulProp; /**< Free usable property. */
+  ElementIndex  _aulPoints[3];     /**< Indices of corner points. */
+  ElementIndex  _aulNeighbours[3]; /**< Indices of neighbour facets. */
 };
 
 /**
@@ -800,8 +838,10 @@ inline MeshFacet::MeshFacet (void)
 : _ucFlag(0),
   _ulProp(0)
 {
-    memset(_aulNeighbours, 0xff, sizeof(ULONG_MAX) * 3);
-    memset(_aulPoints, 0xff, sizeof(ULONG_MAX) * 3);
+    for (int i=0; i<3; i++) {
+        _aulPoints[i] = ULONG_MAX;
+        _aulNeighbours[i] = ULONG_MAX;
+    }
 }
 
 inline MeshFacet::MeshFacet(const MeshFacet &rclF)
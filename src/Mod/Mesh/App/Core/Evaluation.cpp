@@ -28,6 +28,10 @@
 # include <vector>
 #endif
 
+#include <QAtomicInt>
+#include <QThread>
+#include <QtConcurrentMap>
+
 #include <Mod/Mesh/App/WildMagic4/Wm4Matrix3.h>
 #include <Mod/Mesh/App/WildMagic4/Wm4Vector3.h>
 
@@ -467,16 +471,16 @@ bool MeshEvalPointManifolds::Evaluate ()
     this->nonManifoldPoints.clear();
     this->facetsOfNonManifoldPoints.clear();
 
-    MeshCore::MeshRefPointToPoints vv_it(_rclMesh);
-    MeshCore::MeshRefPointToFacets vf_it(_rclMesh);
+    MeshCore::MeshFlatPointToFacets vf_it(_rclMesh);
+    MeshCore::MeshFlatPointToPoints vv_it(vf_it, _rclMesh);
 
     unsigned long ctPoints = _rclMesh.CountPoints();
     for (unsigned long index=0; index < ctPoints; index++) {
         // get the local neighbourhood of the point
-        const std::set<unsigned long>& nf = vf_it[index];
-        const std::set<unsigned long>& np = vv_it[index];
+        MeshIndexRange nf = vf_it[index];
+        MeshIndexRange np = vv_it[index];
 
-        std::set<unsigned long>::size_type sp, sf;
+        std::size_t sp, sf;
         sp = np.size();
         sf = nf.size();
         // for an inner point the number of adjacent points is equal to the number of shared faces
@@ -590,76 +594,172 @@ bool MeshFixSingleFacet::Fixup ()
 
 // ----------------------------------------------------------------
 
-bool MeshEvalSelfIntersection::Evaluate ()
+namespace MeshCore {
+namespace SelfIntersection {
+
+typedef std::vector<std::pair<unsigned long, unsigned long> > FacetPairs;
+
+/// A range of grid cells whose facets are checked by one thread
+struct CellBlock
 {
-    // Contains bounding boxes for every facet 
-    std::vector<Base::BoundBox3f> boxes;
+    unsigned long first, last;
+    FacetPairs pairs;
+};
+
+// Checks all pairs of facets inside the cells of a block. The blocks only
+// write their own pairs, so the result doesn't depend on the number of threads.
+class CheckCells
+{
+public:
+    typedef void result_type;
+    CheckCells(const MeshKernel& mesh, const MeshFacetGrid& grid,
+               const std::vector<Base::BoundBox3f>& boxes,
+               bool stopAtFirst, QAtomicInt& found)
+      : mesh(mesh), grid(grid), boxes(boxes), stopAtFirst(stopAtFirst), found(found)
+    {
+    }
+    void operator()(CellBlock& block) const
+    {
+        unsigned long ulGridX, ulGridY, ulGridZ;
+        grid.GetCtGrids(ulGridX, ulGridY, ulGridZ);
+        const MeshFacetArray& rFaces = mesh.GetFacets();
+        MeshGridIterator clGridIter(grid);
+        std::vector<unsigned long> aulGridElements;
+        MeshGeomFacet facet1, facet2;
+        Base::Vector3f pt1, pt2;
 
+        for (unsigned long cell = block.first; cell < block.last; cell++) {
+            // another block has already found an intersection
+            if (stopAtFirst && found.fetchAndAddOrdered(0) != 0)
+                return;
+
+            // same order as MeshGridIterator::Next()
+            unsigned long x = cell % ulGridX;
+            unsigned long y = (cell / ulGridX) % ulGridY;
+            unsigned long z = cell / (ulGridX * ulGridY);
+            clGridIter.Set(x, y, z);
+            aulGridElements.clear();
+            clGridIter.GetElements(aulGridElements);
+
+            for (std::vector<unsigned long>::iterator it = aulGridElements.begin(); it != aulGridElements.end(); ++it) {
+                const Base::BoundBox3f& box1 = boxes[*it];
+                facet1 = mesh.GetFacet(*it);
+                const MeshFacet& rface1 = rFaces[*it];
+                for (std::vector<unsigned long>::iterator jt = it + 1; jt != aulGridElements.end(); ++jt) {
+                    // If the facets share a common vertex we do not check for self-intersections because they 
+                    // could but usually do not intersect each other and the algorithm below would detect false-positives,
+                    // otherwise
+                    const MeshFacet& rface2 = rFaces[*jt];
+                    if (rface1._aulPoints[0] == rface2._aulPoints[0] || 
+                        rface1._aulPoints[0] == rface2._aulPoints[1] ||
+                        rface1._aulPoints[0] == rface2._aulPoints[2])
+                        continue; // ignore facets sharing a common vertex
+                    if (rface1._aulPoints[1] == rface2._aulPoints[0] || 
+                        rface1._aulPoints[1] == rface2._aulPoints[1] ||
+                        rface1._aulPoints[1] == rface2._aulPoints[2])
+                        continue; // ignore facets sharing a common vertex
+                    if (rface1._aulPoints[2] == rface2._aulPoints[0] || 
+                        rface1._aulPoints[2] == rface2._aulPoints[1] ||
+                        rface1._aulPoints[2] == rface2._aulPoints[2])
+                        continue; // ignore facets sharing a common vertex
+
+                    const Base::BoundBox3f& box2 = boxes[*jt];
+                    if (box1 && box2) {
+                        facet2 = mesh.GetFacet(*jt);
+                        int ret = facet1.IntersectWithFacet(facet2, pt1, pt2);
+                        if (ret == 2) {
+                            block.pairs.push_back(std::make_pair(*it, *jt));
+                            if (stopAtFirst) {
+                                found.fetchAndStoreOrdered(1);
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    const MeshKernel& mesh;
+    const MeshFacetGrid& grid;
+    const std::vector<Base::BoundBox3f>& boxes;
+    bool stopAtFirst;
+    QAtomicInt& found;
+};
+
+// Checks the cells in waves of a few blocks per thread. The progress is only
+// reported between the waves from the calling thread and a cancelled
+// sequencer aborts the check there.
+static void checkGrid(const MeshKernel& mesh, bool stopAtFirst, FacetPairs& pairs)
+{
     // Splits the mesh using grid for speeding up the calculation
-    MeshFacetGrid cMeshFacetGrid(_rclMesh);
-    const MeshFacetArray& rFaces = _rclMesh.GetFacets();
-    MeshGridIterator clGridIter(cMeshFacetGrid);
+    MeshFacetGrid cMeshFacetGrid(mesh);
     unsigned long ulGridX, ulGridY, ulGridZ;
     cMeshFacetGrid.GetCtGrids(ulGridX, ulGridY, ulGridZ);
+    unsigned long ctCells = ulGridX * ulGridY * ulGridZ;
 
-    MeshFacetIterator cMFI(_rclMesh);
+    // Contains bounding boxes for every facet 
+    std::vector<Base::BoundBox3f> boxes;
+    boxes.reserve(mesh.CountFacets());
+    MeshFacetIterator cMFI(mesh);
     for (cMFI.Begin(); cMFI.More(); cMFI.Next()) {
         boxes.push_back((*cMFI).GetBoundBox());
     }
 
-    // Calculates the intersections
-    Base::SequencerLauncher seq("Checking for self-intersections...", ulGridX*ulGridY*ulGridZ);
-    for (clGridIter.Init(); clGridIter.More(); clGridIter.Next()) {
-        //Get the facet indices, belonging to the current grid unit
-        std::vector<unsigned long> aulGridElements;
-        clGridIter.GetElements(aulGridElements);
+    unsigned long ctThreads = 1;
+    if (mesh.CountFacets() >= 10000)
+        ctThreads = std::max<int>(QThread::idealThreadCount(), 1);
+    unsigned long blocksPerWave = 4 * ctThreads;
+    unsigned long ctBlocks = std::min<unsigned long>(64 * ctThreads, ctCells);
+    unsigned long blockSize = std::max<unsigned long>((ctCells + ctBlocks - 1) / std::max<unsigned long>(ctBlocks, 1), 1);
+
+    std::vector<CellBlock> blocks;
+    for (unsigned long i = 0; i < ctCells; i += blockSize) {
+        CellBlock b;
+        b.first = i;
+        b.last = std::min<unsigned long>(i + blockSize, ctCells);
+        blocks.push_back(b);
+    }
 
-        seq.next();
-        if (aulGridElements.size()==0)
-            continue;
+    QAtomicInt found(0);
+    CheckCells check(mesh, cMeshFacetGrid, boxes, stopAtFirst, found);
+    unsigned long ctWaves = (blocks.size() + blocksPerWave - 1) / blocksPerWave;
 
-        MeshGeomFacet facet1, facet2;
-        Base::Vector3f pt1, pt2;
-        for (std::vector<unsigned long>::iterator it = aulGridElements.begin(); it != aulGridElements.end(); ++it) {
-            const Base::BoundBox3f& box1 = boxes[*it];
-            cMFI.Set(*it);
-            facet1 = *cMFI;
-            const MeshFacet& rface1 = rFaces[*it];
-            for (std::vector<unsigned long>::iterator jt = it; jt != aulGridElements.end(); ++jt) {
-                if (jt == it) // the identical facet
-                    continue;
-                // If the facets share a common vertex we do not check for self-intersections because they 
-                // could but usually do not intersect each other and the algorithm below would detect false-positives,
-                // otherwise
-                const MeshFacet& rface2 = rFaces[*jt];
-                if (rface1._aulPoints[0] == rface2._aulPoints[0] || 
-                    rface1._aulPoints[0] == rface2._aulPoints[1] ||
-                    rface1._aulPoints[0] == rface2._aulPoints[2])
-                    continue; // ignore facets sharing a common vertex
-                if (rface1._aulPoints[1] == rface2._aulPoints[0] || 
-                    rface1._aulPoints[1] == rface2._aulPoints[1] ||
-                    rface1._aulPoints[1] == rface2._aulPoints[2])
-                    continue; // ignore facets sharing a common vertex
-                if (rface1._aulPoints[2] == rface2._aulPoints[0] || 
-                    rface1._aulPoints[2] == rface2._aulPoints[1] ||
-                    rface1._aulPoints[2] == rface2._aulPoints[2])
-                    continue; // ignore facets sharing a common vertex
-
-                const Base::BoundBox3f& box2 = boxes[*jt];
-                if (box1 && box2) {
-                    cMFI.Set(*jt);
-                    facet2 = *cMFI;
-                    int ret = facet1.IntersectWithFacet(facet2, pt1, pt2);
-                    if (ret == 2) {
-                        // abort after the first detected self-intersection
-                        return false;
-                    }
-                }
-            }
+    // Calculates the intersections
+    Base::SequencerLauncher seq("Checking for self-intersections...", ctWaves);
+    for (unsigned long wave = 0; wave < ctWaves; wave++) {
+        std::vector<CellBlock>::iterator first = blocks.begin() + wave * blocksPerWave;
+        std::vector<CellBlock>::iterator last = blocks.begin() + std::min<unsigned long>
+            ((wave + 1) * blocksPerWave, blocks.size());
+        if (ctThreads > 1) {
+            QtConcurrent::blockingMap(first, last, check);
         }
+        else {
+            for (std::vector<CellBlock>::iterator it = first; it != last; ++it)
+                check(*it);
+        }
+
+        // a quick check for an intersection can't be cancelled
+        seq.next(!stopAtFirst);
+        if (stopAtFirst && found.fetchAndAddOrdered(0) != 0)
+            break;
     }
 
-    return true;
+    // merge in the order of the cells, this gives the same result as a serial run
+    for (std::vector<CellBlock>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        pairs.insert(pairs.end(), it->pairs.begin(), it->pairs.end());
+}
+
+} // namespace SelfIntersection
+} // namespace MeshCore
+
+bool MeshEvalSelfIntersection::Evaluate ()
+{
+    // abort after the first detected self-intersection
+    SelfIntersection::FacetPairs pairs;
+    SelfIntersection::checkGrid(_rclMesh, true, pairs);
+    return pairs.empty();
 }
 
 void MeshEvalSelfIntersection::GetIntersections(const std::vector<std::pair<unsigned long, unsigned long> >& indices,
@@ -688,72 +788,7 @@ void MeshEvalSelfIntersection::GetIntersections(const std::vector<std::pair<unsi
 
 void MeshEvalSelfIntersection::GetIntersections(std::vector<std::pair<unsigned long, unsigned long> >& intersection) const
 {
-    // Contains bounding boxes for every facet 
-    std::vector<Base::BoundBox3f> boxes;
-    //intersection.clear();
-
-    // Splits the mesh using grid for speeding up the calculation
-    MeshFacetGrid cMeshFacetGrid(_rclMesh);
-    const MeshFacetArray& rFaces = _rclMesh.GetFacets();
-    MeshGridIterator clGridIter(cMeshFacetGrid);
-    unsigned long ulGridX, ulGridY, ulGridZ;
-    cMeshFacetGrid.GetCtGrids(ulGridX, ulGridY, ulGridZ);
-
-    MeshFacetIterator cMFI(_rclMesh);
-    for(cMFI.Begin(); cMFI.More(); cMFI.Next()) {
-        boxes.push_back((*cMFI).GetBoundBox());
-    }
-
-    // Calculates the intersections
-    Base::SequencerLauncher seq("Checking for self-intersections...", ulGridX*ulGridY*ulGridZ);
-    for (clGridIter.Init(); clGridIter.More(); clGridIter.Next()) {
-        //Get the facet indices, belonging to the current grid unit
-        std::vector<unsigned long> aulGridElements;
-        clGridIter.GetElements(aulGridElements);
-
-        seq.next(true);
-        if (aulGridElements.size()==0)
-            continue;
-
-        MeshGeomFacet facet1, facet2;
-        Base::Vector3f pt1, pt2;
-        for (std::vector<unsigned long>::iterator it = aulGridElements.begin(); it != aulGridElements.end(); ++it) {
-            const Base::BoundBox3f& box1 = boxes[*it];
-            cMFI.Set(*it);
-            facet1 = *cMFI;
-            const MeshFacet& rface1 = rFaces[*it];
-            for (std::vector<unsigned long>::iterator jt = it; jt != aulGridElements.end(); ++jt) {
-                if (jt == it) // the identical facet
-                    continue;
-                // If the facets share a common vertex we do not check for self-intersections because they 
-                // could but usually do not intersect each other and the algorithm below would detect false-positives,
-                // otherwise
-                const MeshFacet& rface2 = rFaces[*jt];
-                if (rface1._aulPoints[0] == rface2._aulPoints[0] || 
-                    rface1._aulPoints[0] == rface2._aulPoints[1] ||
-                    rface1._aulPoints[0] == rface2._aulPoints[2])
-                    continue; // ignore facets sharing a common vertex
-                if (rface1._aulPoints[1] == rface2._aulPoints[0] || 
-                    rface1._aulPoints[1] == rface2._aulPoints[1] ||
-                    rface1._aulPoints[1] == rface2._aulPoints[2])
-                    continue; // ignore facets sharing a common vertex
-                if (rface1._aulPoints[2] == rface2._aulPoints[0] || 
-                    rface1._aulPoints[2] == rface2._aulPoints[1] ||
-                    rface1._aulPoints[2] == rface2._aulPoints[2])
-                    continue; // ignore facets sharing a common vertex
-
-                const Base::BoundBox3f& box2 = boxes[*jt];
-                if (box1 && box2) {
-                    cMFI.Set(*jt);
-                    facet2 = *cMFI;
-                    int ret = facet1.IntersectWithFacet(facet2, pt1, pt2);
-                    if (ret == 2) {
-                        intersection.push_back(std::make_pair (*it,*jt));
-                    }
-                }
-            }
-        }
-    }
+    SelfIntersection::checkGrid(_rclMesh, false, intersection);
 }
 
 std::vector<unsigned long> MeshFixSelfIntersection::GetFacets() const
@@ -36,12 +36,15 @@
 
 using namespace MeshCore;
 
+bool MeshGrid::_bCompactLayout = true;
+
 MeshGrid::MeshGrid (const MeshKernel &rclM)
 : _pclMesh(&rclM),
   _ulCtElements(0),
   _ulCtGridsX(0), _ulCtGridsY(0), _ulCtGridsZ(0),
   _fGridLenX(0.0f), _fGridLenY(0.0f), _fGridLenZ(0.0f),
-  _fMinX(0.0f), _fMinY(0.0f), _fMinZ(0.0f)
+  _fMinX(0.0f), _fMinY(0.0f), _fMinZ(0.0f),
+  _bCompact(false)
 {
 }
 
@@ -50,8 +53,19 @@ MeshGrid::MeshGrid (void)
   _ulCtElements(0),
   _ulCtGridsX(MESH_CT_GRID), _ulCtGridsY(MESH_CT_GRID), _ulCtGridsZ(MESH_CT_GRID),
   _fGridLenX(0.0f), _fGridLenY(0.0f), _fGridLenZ(0.0f),
-  _fMinX(0.0f), _fMinY(0.0f), _fMinZ(0.0f)
+  _fMinX(0.0f), _fMinY(0.0f), _fMinZ(0.0f),
+  _bCompact(false)
+{
+}
+
+void MeshGrid::SetCompactLayout (bool on)
+{
+  _bCompactLayout = on;
+}
+
+bool MeshGrid::IsCompactLayout (void)
 {
+  return _bCompactLayout;
 }
 
 void MeshGrid::Attach (const MeshKernel &rclM)
@@ -63,6 +77,11 @@ void MeshGrid::Attach (const MeshKernel &rclM)
 void MeshGrid::Clear (void)
 {
   _aulGrid.clear();
+  _aulCellOffsets.clear();
+  _aulCellElements.clear();
+  _aulBuildCells.clear();
+  _aulBuildElements.clear();
+  _bCompact = false;
   _pclMesh = NULL;  
 }
 
@@ -129,6 +148,20 @@ void MeshGrid::InitGrid (void)
 
   // Daten-Struktur anlegen
   _aulGrid.clear();
+  _aulCellOffsets.clear();
+  _aulCellElements.clear();
+  _aulBuildCells.clear();
+  _aulBuildElements.clear();
+  _bCompact = _bCompactLayout;
+  if (_bCompact)
+  {
+    // the cells are filled by AddToCell() and compressed by FinishGrid()
+    _aulCellOffsets.resize(_ulCtGridsX * _ulCtGridsY * _ulCtGridsZ + 1, 0);
+    _aulBuildCells.reserve(_ulCtElements);
+    _aulBuildElements.reserve(_ulCtElements);
+    return;
+  }
+
   _aulGrid.resize(_ulCtGridsX);
   for (i = 0; i < _ulCtGridsX; i++)
   {
@@ -138,6 +171,64 @@ void MeshGrid::InitGrid (void)
   }
 }
 
+void MeshGrid::FinishGrid (void)
+{
+  if (!_bCompact)
+    return;
+
+  // counting sort of the (cell, element) pairs: count the elements per cell,
+  // turn the counts into offsets and scatter the elements. As the pairs were
+  // added with ascending element index each cell ends up sorted.
+  unsigned long ulCtCells = _aulCellOffsets.size() - 1;
+  std::fill(_aulCellOffsets.begin(), _aulCellOffsets.end(), 0);
+  std::vector<unsigned long>::const_iterator it;
+  for (it = _aulBuildCells.begin(); it != _aulBuildCells.end(); ++it)
+    _aulCellOffsets[*it + 1]++;
+  for (unsigned long i = 0; i < ulCtCells; i++)
+    _aulCellOffsets[i + 1] += _aulCellOffsets[i];
+
+  std::vector<unsigned long> aulFill(_aulCellOffsets.begin(), _aulCellOffsets.end() - 1);
+  _aulCellElements.resize(_aulBuildElements.size());
+  for (std::size_t i = 0; i < _aulBuildCells.size(); i++)
+    _aulCellElements[aulFill[_aulBuildCells[i]]++] = _aulBuildElements[i];
+
+  // release the memory of the temporary arrays
+  std::vector<unsigned long>().swap(_aulBuildCells);
+  std::vector<unsigned long>().swap(_aulBuildElements);
+}
+
+void MeshGrid::CopyElements (unsigned long ulX, unsigned long ulY, unsigned long ulZ,
+                             std::vector<unsigned long> &raulElements) const
+{
+  if (_bCompact)
+  {
+    unsigned long ulCell = CellIndex(ulX, ulY, ulZ);
+    raulElements.insert(raulElements.end(), _aulCellElements.begin() + _aulCellOffsets[ulCell],
+                                            _aulCellElements.begin() + _aulCellOffsets[ulCell + 1]);
+  }
+  else
+  {
+    const std::set<unsigned long> &rclSet = _aulGrid[ulX][ulY][ulZ];
+    raulElements.insert(raulElements.end(), rclSet.begin(), rclSet.end());
+  }
+}
+
+void MeshGrid::CopyElements (unsigned long ulX, unsigned long ulY, unsigned long ulZ,
+                             std::set<unsigned long> &raulElements) const
+{
+  if (_bCompact)
+  {
+    unsigned long ulCell = CellIndex(ulX, ulY, ulZ);
+    raulElements.insert(_aulCellElements.begin() + _aulCellOffsets[ulCell],
+                        _aulCellElements.begin() + _aulCellOffsets[ulCell + 1]);
+  }
+  else
+  {
+    const std::set<unsigned long> &rclSet = _aulGrid[ulX][ulY][ulZ];
+    raulElements.insert(rclSet.begin(), rclSet.end());
+  }
+}
+
 unsigned long MeshGrid::Inside (const Base::BoundBox3f &rclBB, std::vector<unsigned long> &raulElements,
                                 bool bDelDoubles) const
 {
@@ -155,7 +246,7 @@ unsigned long MeshGrid::Inside (const Base::BoundBox3f &rclBB, std::vector<unsig
     {
       for (k = ulMinZ; k <= ulMaxZ; k++)
       {
-        raulElements.insert(raulElements.end(), _aulGrid[i][j][k].begin(), _aulGrid[i][j][k].end());
+        CopyElements(i, j, k, raulElements);
       }
     }
   }  
@@ -190,7 +281,7 @@ unsigned long MeshGrid::Inside (const Base::BoundBox3f &rclBB, std::vector<unsig
       for (k = ulMinZ; k <= ulMaxZ; k++)
       {
         if (Base::DistanceP2(GetBoundBox(i, j, k).GetCenter(), rclOrg) < fMinDistP2)
-          raulElements.insert(raulElements.end(), _aulGrid[i][j][k].begin(), _aulGrid[i][j][k].end());
+          CopyElements(i, j, k, raulElements);
       }
     }
   }  
@@ -221,7 +312,7 @@ unsigned long MeshGrid::Inside (const Base::BoundBox3f &rclBB, std::set<unsigned
     {
       for (k = ulMinZ; k <= ulMaxZ; k++)
       {
-        raulElements.insert(_aulGrid[i][j][k].begin(), _aulGrid[i][j][k].end());
+        CopyElements(i, j, k, raulElements);
       }
     }
   }  
@@ -478,7 +569,7 @@ void MeshGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt, std::set<uns
           for (unsigned long i = 0; i < _ulCtGridsY; i++)
           {
             for (unsigned long j = 0; j < _ulCtGridsZ; j++)
-              raclInd.insert(_aulGrid[nX][i][j].begin(), _aulGrid[nX][i][j].end());
+              CopyElements(nX, i, j, raclInd);
           }
           nX++;
         }
@@ -492,7 +583,7 @@ void MeshGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt, std::set<uns
           for (unsigned long i = 0; i < _ulCtGridsY; i++)
           {
             for (unsigned long j = 0; j < _ulCtGridsZ; j++)
-              raclInd.insert(_aulGrid[nX][i][j].begin(), _aulGrid[nX][i][j].end());
+              CopyElements(nX, i, j, raclInd);
           }
           nX++;
         }
@@ -506,7 +597,7 @@ void MeshGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt, std::set<uns
           for (unsigned long i = 0; i < _ulCtGridsX; i++)
           {
             for (unsigned long j = 0; j < _ulCtGridsZ; j++)
-              raclInd.insert(_aulGrid[i][nY][j].begin(), _aulGrid[i][nY][j].end());
+              CopyElements(i, nY, j, raclInd);
           }
           nY++;
         }
@@ -520,7 +611,7 @@ void MeshGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt, std::set<uns
           for (unsigned long i = 0; i < _ulCtGridsX; i++)
           {
             for (unsigned long j = 0; j < _ulCtGridsZ; j++)
-              raclInd.insert(_aulGrid[i][nY][j].begin(), _aulGrid[i][nY][j].end());
+              CopyElements(i, nY, j, raclInd);
           }
           nY--;
         }
@@ -534,7 +625,7 @@ void MeshGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt, std::set<uns
           for (unsigned long i = 0; i < _ulCtGridsX; i++)
           {
             for (unsigned long j = 0; j < _ulCtGridsY; j++)
-              raclInd.insert(_aulGrid[i][j][nZ].begin(), _aulGrid[i][j][nZ].end());
+              CopyElements(i, j, nZ, raclInd);
           }
           nZ++;
         }
@@ -548,7 +639,7 @@ void MeshGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt, std::set<uns
           for (unsigned long i = 0; i < _ulCtGridsX; i++)
           {
             for (unsigned long j = 0; j < _ulCtGridsY; j++)
-              raclInd.insert(_aulGrid[i][j][nZ].begin(), _aulGrid[i][j][nZ].end());
+              CopyElements(i, j, nZ, raclInd);
           }
           nZ--;
         }
@@ -614,14 +705,11 @@ void MeshGrid::GetHull (unsigned long ulX, unsigned long ulY, unsigned long ulZ,
 unsigned long MeshGrid::GetElements (unsigned long ulX, unsigned long ulY, unsigned long ulZ,  
                                      std::set<unsigned long> &raclInd) const
 {
-  const std::set<unsigned long> &rclSet = _aulGrid[ulX][ulY][ulZ];
-  if (rclSet.size() > 0)
-  {
-    raclInd.insert(rclSet.begin(), rclSet.end());
-    return rclSet.size();
-  }
+  unsigned long ulCount = GetCtElements(ulX, ulY, ulZ);
+  if (ulCount > 0)
+    CopyElements(ulX, ulY, ulZ, raclInd);
 
-  return 0;
+  return ulCount;
 }
 
 unsigned long MeshGrid::GetElements(const Base::Vector3f &rclPoint, std::vector<unsigned long>& aulFacets) const
@@ -630,9 +718,9 @@ unsigned long MeshGrid::GetElements(const Base::Vector3f &rclPoint, std::vector<
   if (!CheckPosition(rclPoint, ulX, ulY, ulZ))
     return 0;
 
-  aulFacets.resize(_aulGrid[ulX][ulY][ulZ].size());
-
-  std::copy(_aulGrid[ulX][ulY][ulZ].begin(), _aulGrid[ulX][ulY][ulZ].end(), aulFacets.begin());
+  aulFacets.clear();
+  aulFacets.reserve(GetCtElements(ulX, ulY, ulZ));
+  CopyElements(ulX, ulY, ulZ, aulFacets);
   return aulFacets.size();
 }
 
@@ -746,6 +834,7 @@ void MeshFacetGrid::RebuildGrid (void)
     AddFacet(*clFIter, i++);
   }
 
+  FinishGrid();
 }
 
 unsigned long MeshFacetGrid::SearchNearestFromPoint (const Base::Vector3f &rclPt) const
@@ -946,6 +1035,22 @@ void MeshFacetGrid::SearchNearestFacetInGrid(unsigned long ulX, unsigned long ul
                                              const Base::Vector3f &rclPt, float &rfMinDist,
                                              unsigned long &rulFacetInd) const
 {
+  if (_bCompact)
+  {
+    unsigned long ulCell = CellIndex(ulX, ulY, ulZ);
+    for (unsigned long i = _aulCellOffsets[ulCell]; i < _aulCellOffsets[ulCell + 1]; i++)
+    {
+      unsigned long ulFacet = _aulCellElements[i];
+      float fDist = _pclMesh->GetFacet(ulFacet).DistanceToPoint(rclPt);
+      if (fDist < rfMinDist)
+      {
+        rfMinDist   = fDist;
+        rulFacetInd = ulFacet;
+      }
+    }
+    return;
+  }
+
   const std::set<unsigned long> &rclSet = _aulGrid[ulX][ulY][ulZ];
   for (std::set<unsigned long>::const_iterator pI = rclSet.begin(); pI != rclSet.end(); ++pI)
   {
@@ -998,7 +1103,7 @@ void MeshPointGrid::AddPoint (const MeshPoint &rclPt, unsigned long ulPtIndex, f
   unsigned long ulX, ulY, ulZ;
   Pos(Base::Vector3f(rclPt.x, rclPt.y, rclPt.z), ulX, ulY, ulZ);
   if ( (ulX < _ulCtGridsX) && (ulY < _ulCtGridsY) && (ulZ < _ulCtGridsZ) )
-    _aulGrid[ulX][ulY][ulZ].insert(ulPtIndex);
+    AddToCell(ulX, ulY, ulZ, ulPtIndex);
 }
 
 void MeshPointGrid::Validate (const MeshKernel &rclMesh)
@@ -1057,6 +1162,8 @@ void MeshPointGrid::RebuildGrid (void)
   {
     AddPoint(*cPIter, i++);
   }
+
+  FinishGrid();
 }
 
 void MeshPointGrid::Pos (const Base::Vector3f &rclPoint, unsigned long &rulX, unsigned long &rulY, unsigned long &rulZ) const
@@ -1118,7 +1225,7 @@ bool MeshGridIterator::InitOnRay (const Base::Vector3f &rclPt, const Base::Vecto
   if ((_rclGrid.GetBoundBox().IsInBox(rclPt)) == true)
   {  // Voxel bestimmen, indem der Startpunkt liegt
     _rclGrid.Position(rclPt, _ulX, _ulY, _ulZ);
-    raulElements.insert(raulElements.end(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].begin(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].end());
+    _rclGrid.CopyElements(_ulX, _ulY, _ulZ, raulElements);
     _bValidRay = true;
   }
   else
@@ -1131,7 +1238,7 @@ bool MeshGridIterator::InitOnRay (const Base::Vector3f &rclPt, const Base::Vecto
       else
         _rclGrid.Position(cP1, _ulX, _ulY, _ulZ);
 
-      raulElements.insert(raulElements.end(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].begin(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].end());
+      _rclGrid.CopyElements(_ulX, _ulY, _ulZ, raulElements);
       _bValidRay = true;
     }
   }
@@ -1182,7 +1289,7 @@ bool MeshGridIterator::NextOnRay (std::vector<unsigned long> &raulElements)
   if ((_bValidRay == true) && (_rclGrid.CheckPos(_ulX, _ulY, _ulZ) == true))
   {
     GridElement pos(_ulX, _ulY, _ulZ); _cSearchPositions.insert(pos);
-    raulElements.insert(raulElements.end(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].begin(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].end()); 
+    _rclGrid.CopyElements(_ulX, _ulY, _ulZ, raulElements);
   }
   else
     _bValidRay = false;  // Strahl ausgetreten
@@ -77,6 +77,12 @@ public:
   virtual void Rebuild (int iCtGridPerAxis = MESH_CT_GRID_PER_AXIS);
   /** Rebuilds the grid structure. */
   virtual void Rebuild (unsigned long ulX, unsigned long ulY, unsigned long ulZ);
+  /** Selects the cell layout used by grids that are (re-)built afterwards. With the compact layout
+   * (default) the element indices of all cells are stored in one contiguous array with an offset
+   * table per cell. Otherwise each cell keeps its own std::set, as done formerly. */
+  static void SetCompactLayout (bool on);
+  /** Returns true if the compact cell layout is used. */
+  static bool IsCompactLayout (void);
 
   /** @name Search */
   //@{
@@ -125,7 +131,14 @@ public:
   bool GetPositionToIndex(unsigned long id, unsigned long& ulX, unsigned long& ulY, unsigned long& ulZ) const;
   /** Returns the number of elements in a given grid. */
   unsigned long GetCtElements(unsigned long ulX, unsigned long ulY, unsigned long ulZ) const
-  { return _aulGrid[ulX][ulY][ulZ].size(); }
+  {
+    if (_bCompact)
+    {
+      unsigned long ulCell = CellIndex(ulX, ulY, ulZ);
+      return _aulCellOffsets[ulCell + 1] - _aulCellOffsets[ulCell];
+    }
+    return _aulGrid[ulX][ulY][ulZ].size();
+  }
   /** Validates the grid structure and rebuilds it if needed. Must be implemented in sub-classes. */
   virtual void Validate (const MeshKernel &rclM) = 0;
   /** Verifies the grid structure and returns false if inconsistencies are found. */
@@ -155,9 +168,26 @@ protected:
   virtual void RebuildGrid (void) = 0;
   /** Returns the number of stored elements. Must be implemented in sub-classes. */
   virtual unsigned long HasElements (void) const = 0;
+  /** Adds the element \a ulIndex to the given grid. With the compact layout the element is only
+   * recorded and the cells are built by FinishGrid(). */
+  inline void AddToCell (unsigned long ulX, unsigned long ulY, unsigned long ulZ, unsigned long ulIndex);
+  /** Builds the compact cell arrays from the elements added with AddToCell(). Must be called by
+   * sub-classes at the end of RebuildGrid(). */
+  void FinishGrid (void);
+  /** Appends the indices of the elements in the given grid. */
+  void CopyElements (unsigned long ulX, unsigned long ulY, unsigned long ulZ, std::vector<unsigned long> &raulElements) const;
+  /** Inserts the indices of the elements in the given grid. */
+  void CopyElements (unsigned long ulX, unsigned long ulY, unsigned long ulZ, std::set<unsigned long> &raulElements) const;
+  /** Returns the position of the given grid in the offset table of the compact layout. */
+  unsigned long CellIndex (unsigned long ulX, unsigned long ulY, unsigned long ulZ) const
+  { return (ulZ * _ulCtGridsY + ulY) * _ulCtGridsX + ulX; }
 
 protected:
   std::vector<std::vector<std::vector<std::set<unsigned long> > > >  _aulGrid;   /**< Grid data structure. */
+  std::vector<unsigned long> _aulCellOffsets;  /**< Compact layout: start of each grid in _aulCellElements. */
+  std::vector<unsigned long> _aulCellElements; /**< Compact layout: element indices of all grids. */
+  std::vector<unsigned long> _aulBuildCells;   /**< Grid of each element added since InitGrid(). */
+  std::vector<unsigned long> _aulBuildElements;/**< Elements added since InitGrid(). */
   const MeshKernel* _pclMesh;     /**< The mesh kernel. */
   unsigned long     _ulCtElements;/**< Number of grid elements for validation issues. */
   unsigned long     _ulCtGridsX;  /**< Number of grid elements in z. */
@@ -169,6 +199,10 @@ protected:
   float             _fMinX;       /**< Grid null position in x. */
   float             _fMinY;       /**< Grid null position in y. */ 
   float             _fMinZ;       /**< Grid null position in z. */
+  bool              _bCompact;    /**< The grid uses the compact layout. */
+
+private:
+  static bool _bCompactLayout;
 
   // friends
   friend class MeshGridIterator;
@@ -295,7 +329,7 @@ public:
   /** Returns indices of the elements in the current grid. */
   void GetElements (std::vector<unsigned long> &raulElements) const
   {
-    raulElements.insert(raulElements.end(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].begin(), _rclGrid._aulGrid[_ulX][_ulY][_ulZ].end());
+    _rclGrid.CopyElements(_ulX, _ulY, _ulZ, raulElements);
   }
   /** Returns the number of elements in the current grid. */
   unsigned long GetCtElements() const
@@ -316,6 +350,9 @@ public:
     if (++_ulX >= (_rclGrid._ulCtGridsX)) _ulX = 0; else return;
     if (++_ulY >= (_rclGrid._ulCtGridsY)) { _ulY = 0; _ulZ++; } else return;
   }
+  /** Sets the iterator to the given grid. */
+  void  Set (unsigned long ulX, unsigned long ulY, unsigned long ulZ)
+  { _ulX = ulX; _ulY = ulY; _ulZ = ulZ; }
   //@}
 
   /** @name Tests with rays */
@@ -434,6 +471,19 @@ inline void MeshFacetGrid::PosWithCheck (const Base::Vector3f &rclPoint, unsigne
   assert((rulX < _ulCtGridsX) && (rulY < _ulCtGridsY) && (rulZ < _ulCtGridsZ));
 }
 
+inline void MeshGrid::AddToCell (unsigned long ulX, unsigned long ulY, unsigned long ulZ, unsigned long ulIndex)
+{
+  if (_bCompact)
+  {
+    _aulBuildCells.push_back(CellIndex(ulX, ulY, ulZ));
+    _aulBuildElements.push_back(ulIndex);
+  }
+  else
+  {
+    _aulGrid[ulX][ulY][ulZ].insert(ulIndex);
+  }
+}
+
 inline void MeshFacetGrid::AddFacet (const MeshGeomFacet &rclFacet, unsigned long ulFacetIndex, float /*fEpsilon*/)
 {
 #if 0
@@ -503,13 +553,13 @@ inline void MeshFacetGrid::AddFacet (const MeshGeomFacet &rclFacet, unsigned lon
         for (ulZ = ulZ1; ulZ <= ulZ2; ulZ++)
         {
           if ( rclFacet.IntersectBoundingBox( GetBoundBox(ulX, ulY, ulZ) ) )
-            _aulGrid[ulX][ulY][ulZ].insert(ulFacetIndex);
+            AddToCell(ulX, ulY, ulZ, ulFacetIndex);
         }
       }
     }
   }
   else
-    _aulGrid[ulX1][ulY1][ulZ1].insert(ulFacetIndex);
+    AddToCell(ulX1, ulY1, ulZ1, ulFacetIndex);
 
 #endif
 }
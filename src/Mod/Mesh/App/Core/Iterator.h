@@ -299,7 +299,7 @@ inline MeshFastFacetIterator::MeshFastFacetIterator (const MeshKernel &rclM)
 
 inline void MeshFastFacetIterator::Next (void)
 {
-  const unsigned long *paulPt = _clIter->_aulPoints;
+  const ElementIndex *paulPt = _clIter->_aulPoints;
   Base::Vector3f *pfPt = _afPoints;
   *(pfPt++)      = _rclPAry[*(paulPt++)];
   *(pfPt++)      = _rclPAry[*(paulPt++)];
@@ -345,7 +345,7 @@ inline void MeshFacetIterator::Transform( const Base::Matrix4D& rclTrf )
 inline const MeshGeomFacet& MeshFacetIterator::Dereference (void)
 {
   MeshFacet rclF             = *_clIter;
-  const unsigned long *paulPt        = &(_clIter->_aulPoints[0]);
+  const ElementIndex *paulPt        = &(_clIter->_aulPoints[0]);
   Base::Vector3f  *pclPt = _clFacet._aclPoints;
   *(pclPt++)       = _rclPAry[*(paulPt++)];
   *(pclPt++)       = _rclPAry[*(paulPt++)];
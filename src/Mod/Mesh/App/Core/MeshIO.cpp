@@ -40,6 +40,7 @@
 #include <Base/Stream.h>
 #include <Base/Placement.h>
 #include <Base/Tools.h>
+#include <Base/TimeInfo.h>
 #include <zipios++/gzipoutputstream.h>
 
 #include <cmath>
@@ -50,6 +51,10 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <QFile>
+#include <QThread>
+#include <QtConcurrentMap>
+
 
 using namespace MeshCore;
 
@@ -157,8 +162,12 @@ bool MeshInput::LoadAny(const char* FileName)
     else {
         // read file
         bool ok = false;
+        Base::TimeInfo start;
         if (fi.hasExtension("stl") || fi.hasExtension("ast")) {
-            ok = LoadSTL(str);
+            if (_mapped && LoadMappedSTL(FileName))
+                ok = true;
+            else
+                ok = LoadSTL(str);
         }
         else if (fi.hasExtension("iv")) {
             ok = LoadInventor( str );
@@ -181,6 +190,13 @@ bool MeshInput::LoadAny(const char* FileName)
             throw Base::FileException("File extension not supported",FileName);
         }
 
+        if (ok) {
+            float seconds = Base::TimeInfo::diffTimeF(start, Base::TimeInfo());
+            float megaBytes = float(fi.size()) / (1024.0f * 1024.0f);
+            Base::Console().Log("Read %s (%.1f MB) in %.3f s: %.1f MB/s\n", FileName,
+                megaBytes, seconds, seconds > 0.0f ? megaBytes / seconds : 0.0f);
+        }
+
         return ok;
     }
 }
@@ -1248,6 +1264,235 @@ bool MeshInput::LoadBinarySTL (std::istream &rstrIn)
     return true;
 }
 
+namespace MeshCore {
+    namespace MappedSTL {
+        inline bool isSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+        }
+        // checks if the word [p, end) is equal to the upper case keyword
+        inline bool isKeyword(const char* p, const char* end, const char* key)
+        {
+            for (; *key; ++key, ++p) {
+                if (p == end || toupper(*p) != *key)
+                    return false;
+            }
+            return p == end || isSpace(*p);
+        }
+        // returns the start of the first word 'key' at or after p
+        const char* findKeyword(const char* beg, const char* p, const char* end, const char* key)
+        {
+            for (; p < end; ++p) {
+                if ((p == beg || isSpace(p[-1])) && isKeyword(p, end, key))
+                    return p;
+            }
+            return end;
+        }
+        // sets [word, return value) to the next word
+        inline const char* nextWord(const char* p, const char* end, const char*& word)
+        {
+            while (p < end && isSpace(*p))
+                ++p;
+            word = p;
+            while (p < end && !isSpace(*p))
+                ++p;
+            return p;
+        }
+        inline const char* readFloat(const char* p, const char* end, float& value, bool& ok)
+        {
+            const char* word;
+            p = nextWord(p, end, word);
+            // the mapped memory isn't null-terminated
+            char buf[64];
+            std::size_t len = std::min<std::size_t>(p - word, sizeof(buf) - 1);
+            memcpy(buf, word, len);
+            buf[len] = 0;
+            char* last;
+            value = static_cast<float>(std::strtod(buf, &last));
+            ok = ok && len > 0 && last == buf + len;
+            return p;
+        }
+        inline const char* readVector(const char* p, const char* end, Base::Vector3f& v, bool& ok)
+        {
+            p = readFloat(p, end, v.x, ok);
+            p = readFloat(p, end, v.y, ok);
+            p = readFloat(p, end, v.z, ok);
+            return p;
+        }
+
+        struct AsciiChunk
+        {
+            const char* begin;
+            const char* end;
+            // per facet the three corners and the normal
+            std::vector<Base::Vector3f> facets;
+        };
+        struct ParseAsciiChunk
+        {
+            typedef void result_type;
+            void operator()(AsciiChunk& c) const
+            {
+                Base::Vector3f facet[4];
+                int ct = 0;
+                const char* p = c.begin;
+                const char* word;
+                while (p < c.end) {
+                    p = nextWord(p, c.end, word);
+                    bool ok = true;
+                    if (isKeyword(word, p, "NORMAL")) {
+                        p = readVector(p, c.end, facet[3], ok);
+                        if (!ok)
+                            facet[3].Set(0.0f, 0.0f, 0.0f);
+                    }
+                    else if (isKeyword(word, p, "VERTEX")) {
+                        p = readVector(p, c.end, facet[ct], ok);
+                        if (ok && ++ct == 3) {
+                            ct = 0;
+                            c.facets.insert(c.facets.end(), facet, facet + 4);
+                        }
+                    }
+                }
+            }
+        };
+
+        struct BinaryChunk
+        {
+            const char* data;
+            unsigned long first, last;
+            MeshFastBuilder* builder;
+        };
+        struct ParseBinaryChunk
+        {
+            typedef void result_type;
+            void operator()(BinaryChunk& c) const
+            {
+                float v[12];
+                Base::Vector3f facet[4];
+                for (unsigned long i = c.first; i < c.last; i++) {
+                    // normal, three points and 2 bytes attribute
+                    memcpy(v, c.data + 84 + 50 * i, sizeof(v));
+                    facet[0].Set(v[3], v[4], v[5]);
+                    facet[1].Set(v[6], v[7], v[8]);
+                    facet[2].Set(v[9], v[10], v[11]);
+                    facet[3].Set(v[0], v[1], v[2]);
+                    c.builder->SetFacet(i, facet);
+                }
+            }
+        };
+
+        inline std::size_t chunkCount()
+        {
+            return 4 * std::max<int>(QThread::idealThreadCount(), 1);
+        }
+    }
+}
+
+bool MeshInput::LoadMappedSTL (const char* FileName)
+{
+    QFile file(QString::fromUtf8(FileName));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    qint64 size = file.size();
+    if (size < 84)
+        return false;
+    uchar* map = file.map(0, size);
+    if (!map)
+        return false;
+    const char* data = reinterpret_cast<const char*>(map);
+
+    // same check for keywords as in LoadSTL()
+    uint32_t ulCt;
+    memcpy(&ulCt, data + 80, sizeof(ulCt));
+    std::size_t ulBytes = std::min<std::size_t>(ulCt > 1 ? 100 : 50, size - 84);
+    std::string head(data + 84, ulBytes);
+    upper(head);
+    bool ascii = false;
+    const char* keys[] = {"SOLID", "FACET", "NORMAL", "VERTEX", "ENDFACET", "ENDLOOP"};
+    for (std::size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (head.find(keys[i]) != std::string::npos)
+            ascii = true;
+    }
+
+    bool ok = ascii ? LoadMappedAsciiSTL(data, size)
+                    : LoadMappedBinarySTL(data, size);
+    file.unmap(map);
+    return ok;
+}
+
+bool MeshInput::LoadMappedAsciiSTL (const char* data, std::size_t size)
+{
+    using namespace MappedSTL;
+
+    // each chunk starts at a FACET keyword, so that no facet is split
+    const char* end = data + size;
+    std::size_t ctChunks = chunkCount();
+    std::vector<AsciiChunk> chunks;
+    const char* begin = findKeyword(data, data, end, "FACET");
+    for (std::size_t i = 1; i <= ctChunks && begin < end; i++) {
+        const char* next = end;
+        if (i < ctChunks)
+            next = findKeyword(data, std::max(begin + 1, data + (size * i) / ctChunks), end, "FACET");
+        AsciiChunk c;
+        c.begin = begin;
+        c.end = next;
+        chunks.push_back(c);
+        begin = next;
+    }
+
+    QtConcurrent::blockingMap(chunks, ParseAsciiChunk());
+
+    unsigned long ctFacets = 0;
+    for (std::vector<AsciiChunk>::iterator it = chunks.begin(); it != chunks.end(); ++it)
+        ctFacets += it->facets.size() / 4;
+    if (ctFacets == 0)
+        return false; // no facet found
+
+    MeshFastBuilder builder(this->_rclMesh);
+    builder.Initialize(ctFacets);
+    unsigned long index = 0;
+    for (std::vector<AsciiChunk>::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+        for (std::size_t i = 0; i < it->facets.size(); i += 4)
+            builder.SetFacet(index++, &it->facets[i]);
+        std::vector<Base::Vector3f>().swap(it->facets);
+    }
+    builder.Finish();
+
+    return true;
+}
+
+bool MeshInput::LoadMappedBinarySTL (const char* data, std::size_t size)
+{
+    using namespace MappedSTL;
+
+    uint32_t ulCt;
+    memcpy(&ulCt, data + 80, sizeof(ulCt));
+
+    // compare the calculated with the read value
+    uint32_t ulFac = (size - (80 + sizeof(uint32_t))) / 50;
+    if (ulCt > ulFac)
+        return false;// not a valid STL file
+
+    MeshFastBuilder builder(this->_rclMesh);
+    builder.Initialize(ulCt);
+
+    std::size_t ctChunks = chunkCount();
+    unsigned long chunkSize = std::max<unsigned long>((ulCt + ctChunks - 1) / ctChunks, 1);
+    std::vector<BinaryChunk> chunks;
+    for (unsigned long i = 0; i < ulCt; i += chunkSize) {
+        BinaryChunk c;
+        c.data = data;
+        c.first = i;
+        c.last = std::min<unsigned long>(i + chunkSize, ulCt);
+        c.builder = &builder;
+        chunks.push_back(c);
+    }
+
+    QtConcurrent::blockingMap(chunks, ParseBinaryChunk());
+    builder.Finish();
+
+    return true;
+}
+
 /** Loads the mesh object from an XML file. */
 void MeshInput::LoadXML (Base::XMLReader &reader)
 {
@@ -85,13 +85,17 @@ class MeshExport MeshInput
 {
 public:
     MeshInput (MeshKernel &rclM)
-        : _rclMesh(rclM), _material(0){}
+        : _rclMesh(rclM), _material(0), _mapped(false){}
     MeshInput (MeshKernel &rclM, Material* m)
-        : _rclMesh(rclM), _material(m){}
+        : _rclMesh(rclM), _material(m), _mapped(false){}
     virtual ~MeshInput (void) { }
     const std::vector<std::string>& GetGroupNames() const {
         return _groupNames;
     }
+    /** If \a on is true LoadAny() reads STL files with LoadMappedSTL(). */
+    void SetMappedLoading(bool on) {
+        _mapped = on;
+    }
 
     /// Loads the file, decided by extension
     bool LoadAny(const char* FileName);
@@ -105,6 +109,11 @@ public:
     bool LoadAsciiSTL (std::istream &rstrIn);
     /** Loads a binary STL file. */
     bool LoadBinarySTL (std::istream &rstrIn);
+    /** Loads an STL file either in binary or ASCII format. The file is mapped into memory,
+     * parsed in parallel and the points are merged with MeshFastBuilder.
+     * Returns false if the file cannot be mapped or is not a valid STL file.
+     */
+    bool LoadMappedSTL (const char* FileName);
     /** Loads an OBJ Mesh file. */
     bool LoadOBJ (std::istream &rstrIn);
     /** Loads an OFF Mesh file. */
@@ -122,10 +131,17 @@ public:
     /** Loads a Cadmould FE file. */
     bool LoadCadmouldFE (std::ifstream &rstrIn);
 
+protected:
+    /** Parses a memory mapped ASCII STL file. */
+    bool LoadMappedAsciiSTL (const char* data, std::size_t size);
+    /** Parses a memory mapped binary STL file. */
+    bool LoadMappedBinarySTL (const char* data, std::size_t size);
+
 protected:
     MeshKernel &_rclMesh;   /**< reference to mesh data structure */
     Material* _material;
     std::vector<std::string> _groupNames;
+    bool _mapped;
 };
 
 /**
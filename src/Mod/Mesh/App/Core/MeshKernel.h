@@ -450,6 +450,7 @@ protected:
     friend class MeshTopoAlgorithm;
     friend class MeshFixDuplicatePoints;
     friend class MeshBuilder;
+    friend class MeshFastBuilder;
     friend class MeshTrimming;
 };
 
@@ -20,9 +20,10 @@
  *                                                                         *
  ***************************************************************************/
 
-
 #include "PreCompiled.h"
 #ifndef _PreComp_
+# include <algorithm>
+# include <cmath>
 #endif
 
 #include "Smoothing.h"
@@ -31,61 +32,112 @@
 #include "Elements.h"
 #include "Iterator.h"
 #include "Approximation.h"
+#include "Blocks.h"
 
 
 using namespace MeshCore;
 
+namespace MeshCore {
+namespace Smoothing {
 
-AbstractSmoothing::AbstractSmoothing(MeshKernel& m)
-  : kernel(m)
-  , tolerance(0)
-  , component(Normal)
-  , continuity(C0)
+/// A range of the points to smooth which is done by one thread
+struct Block
 {
-}
+    unsigned long first, last;
+};
 
-AbstractSmoothing::~AbstractSmoothing()
+static void readPoints(const MeshKernel& kernel, std::vector<Base::Vector3f>& points)
 {
+    const MeshPointArray& rPoints = kernel.GetPoints();
+    points.assign(rPoints.begin(), rPoints.end());
 }
 
-void AbstractSmoothing::initialize(Component comp, Continuity cont)
+static void writePoints(MeshKernel& kernel, const std::vector<Base::Vector3f>& points)
 {
-    this->component = comp;
-    this->continuity = cont;
+    unsigned long count = kernel.CountPoints();
+    for (unsigned long idx = 0; idx < count; idx++)
+        kernel.SetPoint(idx, points[idx].x, points[idx].y, points[idx].z);
 }
 
-PlaneFitSmoothing::PlaneFitSmoothing(MeshKernel& m)
-  : AbstractSmoothing(m)
+// Moves the points towards the centre of their neighbours. All positions are read
+// from 'src' and the moved points are written to 'dst', so the result of a point
+// doesn't depend on the order in which the points are done and the blocks can run
+// in parallel. Points that are not moved keep the same position in both buffers.
+struct UmbrellaStep
 {
-}
-
-PlaneFitSmoothing::~PlaneFitSmoothing()
-{
-}
+    typedef void result_type;
+    UmbrellaStep(const MeshFlatPointToPoints& vv_it, const MeshFlatPointToFacets& vf_it,
+                 const std::vector<unsigned long>* indices, double stepsize,
+                 const std::vector<Base::Vector3f>& src, std::vector<Base::Vector3f>& dst)
+      : vv_it(vv_it), vf_it(vf_it), indices(indices), stepsize(stepsize), src(src), dst(dst)
+    {
+    }
+    void operator()(const Block& b) const
+    {
+        for (unsigned long k = b.first; k < b.last; k++) {
+            unsigned long pos = indices ? (*indices)[k] : k;
+            MeshIndexRange cv = vv_it[pos];
+            if (cv.size() < 3)
+                continue;
+            if (cv.size() != vf_it[pos].size()) {
+                // do nothing for border points
+                continue;
+            }
 
-void PlaneFitSmoothing::Smooth(unsigned int iterations)
-{
-    MeshCore::MeshPoint center;
-    MeshCore::MeshPointArray PointArray = kernel.GetPoints();
+            // the sum of the neighbours
+            double sumx=0.0,sumy=0.0,sumz=0.0;
+            MeshIndexRange::const_iterator cv_it;
+            for (cv_it = cv.begin(); cv_it !=cv.end(); ++cv_it) {
+                const Base::Vector3f& n = src[*cv_it];
+                sumx += n.x;
+                sumy += n.y;
+                sumz += n.z;
+            }
 
-    MeshCore::MeshPointIterator v_it(kernel);
-    MeshCore::MeshRefPointToPoints vv_it(kernel);
-    MeshCore::MeshPointArray::_TConstIterator v_beg = kernel.GetPoints().begin();
+            double w = 1.0/double(cv.size());
+            const Base::Vector3f& p = src[pos];
+            float x = (float)(p.x+stepsize*(w*sumx-p.x));
+            float y = (float)(p.y+stepsize*(w*sumy-p.y));
+            float z = (float)(p.z+stepsize*(w*sumz-p.z));
+            dst[pos].Set(x,y,z);
+        }
+    }
 
-    for (unsigned int i=0; i<iterations; i++) {
+    const MeshFlatPointToPoints& vv_it;
+    const MeshFlatPointToFacets& vf_it;
+    const std::vector<unsigned long>* indices;
+    double stepsize;
+    const std::vector<Base::Vector3f>& src;
+    std::vector<Base::Vector3f>& dst;
+};
+
+// Moves the points towards the mean plane of their neighbours, but not farther
+// than the tolerance. Like UmbrellaStep it reads from 'src' and writes to 'dst'.
+struct PlaneFitStep
+{
+    typedef void result_type;
+    PlaneFitStep(const MeshFlatPointToPoints& vv_it, const std::vector<unsigned long>* indices,
+                 float tolerance, const std::vector<Base::Vector3f>& src, std::vector<Base::Vector3f>& dst)
+      : vv_it(vv_it), indices(indices), tolerance(tolerance), src(src), dst(dst)
+    {
+    }
+    void operator()(const Block& b) const
+    {
         Base::Vector3f N, L;
-        for (v_it.Begin(); v_it.More(); v_it.Next()) {
-            MeshCore::PlaneFit pf;
-            pf.AddPoint(*v_it);
-            center = *v_it;
-            const std::set<unsigned long>& cv = vv_it[v_it.Position()];
+        for (unsigned long k = b.first; k < b.last; k++) {
+            unsigned long pos = indices ? (*indices)[k] : k;
+            MeshIndexRange cv = vv_it[pos];
             if (cv.size() < 3)
                 continue;
 
-            std::set<unsigned long>::const_iterator cv_it;
+            const Base::Vector3f& p = src[pos];
+            MeshCore::PlaneFit pf;
+            pf.AddPoint(p);
+            Base::Vector3f center = p;
+            MeshIndexRange::const_iterator cv_it;
             for (cv_it = cv.begin(); cv_it !=cv.end(); ++cv_it) {
-                pf.AddPoint(v_beg[*cv_it]);
-                center += v_beg[*cv_it];
+                pf.AddPoint(src[*cv_it]);
+                center += src[*cv_it];
             }
 
             float scale = 1.0f/((float)cv.size()+1.0f);
@@ -97,77 +149,89 @@ void PlaneFitSmoothing::Smooth(unsigned int iterations)
             N.Normalize();
 
             // look in which direction we should move the vertex
-            L.Set(v_it->x - center.x, v_it->y - center.y, v_it->z - center.z);
+            L.Set(p.x - center.x, p.y - center.y, p.z - center.z);
             if (N*L < 0.0)
                 N.Scale(-1.0, -1.0, -1.0);
 
             // maximum value to move is distance to mean plane
-            float d = std::min<float>((float)fabs(this->tolerance),(float)fabs(N*L));
+            float d = std::min<float>((float)fabs(tolerance),(float)fabs(N*L));
             N.Scale(d,d,d);
 
-            PointArray[v_it.Position()].Set(v_it->x - N.x, v_it->y - N.y, v_it->z - N.z);
-        }
-
-        // assign values without affecting iterators
-        unsigned long count = kernel.CountPoints();
-        for (unsigned long idx = 0; idx < count; idx++) {
-            kernel.SetPoint(idx, PointArray[idx]);
+            dst[pos].Set(p.x - N.x, p.y - N.y, p.z - N.z);
         }
     }
+
+    const MeshFlatPointToPoints& vv_it;
+    const std::vector<unsigned long>* indices;
+    float tolerance;
+    const std::vector<Base::Vector3f>& src;
+    std::vector<Base::Vector3f>& dst;
+};
+
+} // namespace Smoothing
+} // namespace MeshCore
+
+AbstractSmoothing::AbstractSmoothing(MeshKernel& m)
+  : kernel(m)
+  , tolerance(0)
+  , component(Normal)
+  , continuity(C0)
+{
 }
 
-void PlaneFitSmoothing::SmoothPoints(unsigned int iterations, const std::vector<unsigned long>& point_indices)
+AbstractSmoothing::~AbstractSmoothing()
 {
-    MeshCore::MeshPoint center;
-    MeshCore::MeshPointArray PointArray = kernel.GetPoints();
+}
+
+void AbstractSmoothing::initialize(Component comp, Continuity cont)
+{
+    this->component = comp;
+    this->continuity = cont;
+}
 
-    MeshCore::MeshPointIterator v_it(kernel);
-    MeshCore::MeshRefPointToPoints vv_it(kernel);
-    MeshCore::MeshPointArray::_TConstIterator v_beg = kernel.GetPoints().begin();
+PlaneFitSmoothing::PlaneFitSmoothing(MeshKernel& m)
+  : AbstractSmoothing(m)
+{
+}
 
-    for (unsigned int i=0; i<iterations; i++) {
-        Base::Vector3f N, L;
-        for (std::vector<unsigned long>::const_iterator it = point_indices.begin(); it != point_indices.end(); ++it) {
-            v_it.Set(*it);
-            MeshCore::PlaneFit pf;
-            pf.AddPoint(*v_it);
-            center = *v_it;
-            const std::set<unsigned long>& cv = vv_it[v_it.Position()];
-            if (cv.size() < 3)
-                continue;
+PlaneFitSmoothing::~PlaneFitSmoothing()
+{
+}
 
-            std::set<unsigned long>::const_iterator cv_it;
-            for (cv_it = cv.begin(); cv_it !=cv.end(); ++cv_it) {
-                pf.AddPoint(v_beg[*cv_it]);
-                center += v_beg[*cv_it];
-            }
+void PlaneFitSmoothing::Smooth(unsigned int iterations)
+{
+    using namespace Smoothing;
 
-            float scale = 1.0f/((float)cv.size()+1.0f);
-            center.Scale(scale,scale,scale);
+    MeshCore::MeshFlatPointToPoints vv_it(kernel);
+    std::vector<Base::Vector3f> src, dst;
+    readPoints(kernel, src);
+    dst = src;
 
-            // get the mean plane of the current vertex with the surrounding vertices
-            pf.Fit();
-            N = pf.GetNormal();
-            N.Normalize();
+    std::vector<Block> blocks = Blocks::makeThreadBlocks<Block>(kernel.CountPoints());
+    for (unsigned int i=0; i<iterations; i++) {
+        Blocks::runBlocks(blocks, PlaneFitStep(vv_it, 0, this->tolerance, src, dst));
+        src.swap(dst);
+    }
 
-            // look in which direction we should move the vertex
-            L.Set(v_it->x - center.x, v_it->y - center.y, v_it->z - center.z);
-            if (N*L < 0.0)
-                N.Scale(-1.0, -1.0, -1.0);
+    writePoints(kernel, src);
+}
 
-            // maximum value to move is distance to mean plane
-            float d = std::min<float>((float)fabs(this->tolerance),(float)fabs(N*L));
-            N.Scale(d,d,d);
+void PlaneFitSmoothing::SmoothPoints(unsigned int iterations, const std::vector<unsigned long>& point_indices)
+{
+    using namespace Smoothing;
 
-            PointArray[v_it.Position()].Set(v_it->x - N.x, v_it->y - N.y, v_it->z - N.z);
-        }
+    MeshCore::MeshFlatPointToPoints vv_it(kernel);
+    std::vector<Base::Vector3f> src, dst;
+    readPoints(kernel, src);
+    dst = src;
 
-        // assign values without affecting iterators
-        unsigned long count = kernel.CountPoints();
-        for (unsigned long idx = 0; idx < count; idx++) {
-            kernel.SetPoint(idx, PointArray[idx]);
-        }
+    std::vector<Block> blocks = Blocks::makeThreadBlocks<Block>(point_indices.size());
+    for (unsigned int i=0; i<iterations; i++) {
+        Blocks::runBlocks(blocks, PlaneFitStep(vv_it, &point_indices, this->tolerance, src, dst));
+        src.swap(dst);
     }
+
+    writePoints(kernel, src);
 }
 
 LaplaceSmoothing::LaplaceSmoothing(MeshKernel& m)
@@ -179,95 +243,55 @@ LaplaceSmoothing::~LaplaceSmoothing()
 {
 }
 
-void LaplaceSmoothing::Umbrella(const MeshRefPointToPoints& vv_it,
-                                const MeshRefPointToFacets& vf_it, double stepsize)
+void LaplaceSmoothing::Umbrella(const MeshFlatPointToPoints& vv_it,
+                                const MeshFlatPointToFacets& vf_it, double stepsize,
+                                std::vector<Base::Vector3f>& src,
+                                std::vector<Base::Vector3f>& dst) const
 {
-    const MeshCore::MeshPointArray& points = kernel.GetPoints();
-    MeshCore::MeshPointArray::_TConstIterator v_it,
-    v_beg = points.begin(), v_end = points.end();
-
-    unsigned long pos = 0;
-    for (v_it = points.begin(); v_it != v_end; ++v_it,++pos) {
-        const std::set<unsigned long>& cv = vv_it[pos];
-        if (cv.size() < 3)
-            continue;
-        if (cv.size() != vf_it[pos].size()) {
-            // do nothing for border points
-            continue;
-        }
-
-        unsigned int n_count = cv.size();
-        double w;
-        w=1.0/double(n_count);
-
-        double delx=0.0,dely=0.0,delz=0.0;
-        std::set<unsigned long>::const_iterator cv_it;
-        for (cv_it = cv.begin(); cv_it !=cv.end(); ++cv_it) {
-            delx += w*((v_beg[*cv_it]).x-v_it->x);
-            dely += w*((v_beg[*cv_it]).y-v_it->y);
-            delz += w*((v_beg[*cv_it]).z-v_it->z);
-        }
-
-        float x = (float)(v_it->x+stepsize*delx);
-        float y = (float)(v_it->y+stepsize*dely);
-        float z = (float)(v_it->z+stepsize*delz);
-        kernel.SetPoint(pos,x,y,z);
-    }
+    std::vector<Smoothing::Block> blocks = Blocks::makeThreadBlocks<Smoothing::Block>(src.size());
+    Blocks::runBlocks(blocks, Smoothing::UmbrellaStep(vv_it, vf_it, 0, stepsize, src, dst));
+    src.swap(dst);
 }
 
-void LaplaceSmoothing::Umbrella(const MeshRefPointToPoints& vv_it,
-                                const MeshRefPointToFacets& vf_it, double stepsize,
-                                const std::vector<unsigned long>& point_indices)
+void LaplaceSmoothing::Umbrella(const MeshFlatPointToPoints& vv_it,
+                                const MeshFlatPointToFacets& vf_it, double stepsize,
+                                const std::vector<unsigned long>& point_indices,
+                                std::vector<Base::Vector3f>& src,
+                                std::vector<Base::Vector3f>& dst) const
 {
-    const MeshCore::MeshPointArray& points = kernel.GetPoints();
-    MeshCore::MeshPointArray::_TConstIterator v_beg = points.begin();
-
-    for (std::vector<unsigned long>::const_iterator pos = point_indices.begin(); pos != point_indices.end(); ++pos) {
-        const std::set<unsigned long>& cv = vv_it[*pos];
-        if (cv.size() < 3)
-            continue;
-        if (cv.size() != vf_it[*pos].size()) {
-            // do nothing for border points
-            continue;
-        }
-
-        unsigned int n_count = cv.size();
-        double w;
-        w=1.0/double(n_count);
-
-        double delx=0.0,dely=0.0,delz=0.0;
-        std::set<unsigned long>::const_iterator cv_it;
-        for (cv_it = cv.begin(); cv_it !=cv.end(); ++cv_it) {
-            delx += w*((v_beg[*cv_it]).x-(v_beg[*pos]).x);
-            dely += w*((v_beg[*cv_it]).y-(v_beg[*pos]).y);
-            delz += w*((v_beg[*cv_it]).z-(v_beg[*pos]).z);
-        }
-
-        float x = (float)((v_beg[*pos]).x+stepsize*delx);
-        float y = (float)((v_beg[*pos]).y+stepsize*dely);
-        float z = (float)((v_beg[*pos]).z+stepsize*delz);
-        kernel.SetPoint(*pos,x,y,z);
-    }
+    std::vector<Smoothing::Block> blocks = Blocks::makeThreadBlocks<Smoothing::Block>(point_indices.size());
+    Blocks::runBlocks(blocks, Smoothing::UmbrellaStep(vv_it, vf_it, &point_indices, stepsize, src, dst));
+    src.swap(dst);
 }
 
 void LaplaceSmoothing::Smooth(unsigned int iterations)
 {
-    MeshCore::MeshRefPointToPoints vv_it(kernel);
-    MeshCore::MeshRefPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToPoints vv_it(vf_it, kernel);
+    std::vector<Base::Vector3f> src, dst;
+    Smoothing::readPoints(kernel, src);
+    dst = src;
 
     for (unsigned int i=0; i<iterations; i++) {
-        Umbrella(vv_it, vf_it, lambda);
+        Umbrella(vv_it, vf_it, lambda, src, dst);
     }
+
+    Smoothing::writePoints(kernel, src);
 }
 
 void LaplaceSmoothing::SmoothPoints(unsigned int iterations, const std::vector<unsigned long>& point_indices)
 {
-    MeshCore::MeshRefPointToPoints vv_it(kernel);
-    MeshCore::MeshRefPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToPoints vv_it(vf_it, kernel);
+    std::vector<Base::Vector3f> src, dst;
+    Smoothing::readPoints(kernel, src);
+    dst = src;
 
     for (unsigned int i=0; i<iterations; i++) {
-        Umbrella(vv_it, vf_it, lambda, point_indices);
+        Umbrella(vv_it, vf_it, lambda, point_indices, src, dst);
     }
+
+    Smoothing::writePoints(kernel, src);
 }
 
 TaubinSmoothing::TaubinSmoothing(MeshKernel& m)
@@ -281,28 +305,36 @@ TaubinSmoothing::~TaubinSmoothing()
 
 void TaubinSmoothing::Smooth(unsigned int iterations)
 {
-    MeshCore::MeshPointArray::_TConstIterator v_it;
-    MeshCore::MeshRefPointToPoints vv_it(kernel);
-    MeshCore::MeshRefPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToPoints vv_it(vf_it, kernel);
+    std::vector<Base::Vector3f> src, dst;
+    Smoothing::readPoints(kernel, src);
+    dst = src;
 
     // Theoretically Taubin does not shrink the surface
     iterations = (iterations+1)/2; // two steps per iteration
     for (unsigned int i=0; i<iterations; i++) {
-        Umbrella(vv_it, vf_it, lambda);
-        Umbrella(vv_it, vf_it, -(lambda+micro));
+        Umbrella(vv_it, vf_it, lambda, src, dst);
+        Umbrella(vv_it, vf_it, -(lambda+micro), src, dst);
     }
+
+    Smoothing::writePoints(kernel, src);
 }
 
 void TaubinSmoothing::SmoothPoints(unsigned int iterations, const std::vector<unsigned long>& point_indices)
 {
-    MeshCore::MeshPointArray::_TConstIterator v_it;
-    MeshCore::MeshRefPointToPoints vv_it(kernel);
-    MeshCore::MeshRefPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToFacets vf_it(kernel);
+    MeshCore::MeshFlatPointToPoints vv_it(vf_it, kernel);
+    std::vector<Base::Vector3f> src, dst;
+    Smoothing::readPoints(kernel, src);
+    dst = src;
 
     // Theoretically Taubin does not shrink the surface
     iterations = (iterations+1)/2; // two steps per iteration
     for (unsigned int i=0; i<iterations; i++) {
-        Umbrella(vv_it, vf_it, lambda, point_indices);
-        Umbrella(vv_it, vf_it, -(lambda+micro), point_indices);
+        Umbrella(vv_it, vf_it, lambda, point_indices, src, dst);
+        Umbrella(vv_it, vf_it, -(lambda+micro), point_indices, src, dst);
     }
+
+    Smoothing::writePoints(kernel, src);
 }
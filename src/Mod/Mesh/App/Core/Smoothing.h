@@ -25,12 +25,13 @@
 #define MESH_SMOOTHING_H
 
 #include <vector>
+#include <Base/Vector3D.h>
 
 namespace MeshCore
 {
 class MeshKernel;
-class MeshRefPointToPoints;
-class MeshRefPointToFacets;
+class MeshFlatPointToPoints;
+class MeshFlatPointToFacets;
 
 /** Base class for smoothing algorithms. */
 class MeshExport AbstractSmoothing
@@ -83,11 +84,19 @@ public:
     void SetLambda(double l) { lambda = l;}
 
 protected:
-    void Umbrella(const MeshRefPointToPoints&,
-                  const MeshRefPointToFacets&, double);
-    void Umbrella(const MeshRefPointToPoints&,
-                  const MeshRefPointToFacets&, double,
-                  const std::vector<unsigned long>&);
+    /** Does one smoothing step for all points. The positions are read from the
+     * first buffer and written to the second one, then the buffers are swapped.
+     */
+    void Umbrella(const MeshFlatPointToPoints&,
+                  const MeshFlatPointToFacets&, double,
+                  std::vector<Base::Vector3f>&,
+                  std::vector<Base::Vector3f>&) const;
+    /** Does one smoothing step for the given points. */
+    void Umbrella(const MeshFlatPointToPoints&,
+                  const MeshFlatPointToFacets&, double,
+                  const std::vector<unsigned long>&,
+                  std::vector<Base::Vector3f>&,
+                  std::vector<Base::Vector3f>&) const;
 
 protected:
     double lambda;
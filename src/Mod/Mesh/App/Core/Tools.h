@@ -78,7 +78,7 @@ protected:
   const MeshKernel  &_rclMesh;
   const MeshFacetArray &_rclFAry;
   const MeshPointArray &_rclPAry;
-  MeshRefPointToFacets _clPt2Fa;
+  MeshFlatPointToFacets _clPt2Fa;
   float _fMaxDistanceP2;   // square distance 
   Base::Vector3f _clCenter;         // center points of start facet
   std::set<unsigned long> _aclResult;        // result container (point indices)
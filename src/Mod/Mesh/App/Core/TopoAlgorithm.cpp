@@ -1275,7 +1275,7 @@ void MeshTopoAlgorithm::FillupHoles(int level, AbstractPolygonTriangulator& cTri
                                     std::list<std::vector<unsigned long> >& aFailed)
 {
     // get the facets to a point
-    MeshRefPointToFacets cPt2Fac(_rclMesh);
+    MeshFlatPointToFacets cPt2Fac(_rclMesh);
     MeshAlgorithm cAlgo(_rclMesh);
 
     MeshFacetArray newFacets;
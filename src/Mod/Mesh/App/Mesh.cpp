@@ -37,6 +37,7 @@
 #include <Base/Sequencer.h>
 #include <Base/Tools.h>
 #include <Base/ViewProj.h>
+#include <App/Application.h>
 
 #include "Core/Builder.h"
 #include "Core/MeshKernel.h"
@@ -401,6 +402,9 @@ bool MeshObject::load(const char* file, MeshCore::Material* mat)
 {
     MeshCore::MeshKernel kernel;
     MeshCore::MeshInput aReader(kernel, mat);
+    ParameterGrp::handle hGrp = App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Mod/Mesh");
+    aReader.SetMappedLoading(hGrp->GetBool("MappedLoading", false));
     if (!aReader.LoadAny(file))
         return false;
 
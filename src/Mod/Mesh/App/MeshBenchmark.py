@@ -0,0 +1,134 @@
+#   (c) FreeCAD Developers 2017      LGPL
+
+"""Reports the throughput of the mesh kernel. Unlike MeshTestsApp it checks
+nothing, it only measures. Run it with FreeCADCmd:
+
+    import MeshBenchmark
+    MeshBenchmark.run()
+
+Build FreeCAD with and without FREECAD_MESH_COMPACT_INDEX to compare the index
+layouts.
+"""
+
+import FreeCAD, os, time, tempfile, math, random, Mesh
+
+
+#---------------------------------------------------------------------------
+# define the functions to measure the FreeCAD mesh module
+#---------------------------------------------------------------------------
+
+def report(text):
+    FreeCAD.Console.PrintMessage(text + "\n")
+
+def rate(count, seconds):
+    return count / max(seconds, 1e-6)
+
+def loadSTL(samples=400):
+    """Compares the stream and the memory-mapped STL loaders"""
+    param = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Mod/Mesh")
+    mapped = param.GetBool("MappedLoading", False)
+    mesh = Mesh.createSphere(10.0,samples)
+    for name in ("benchmark.stl", "benchmark.ast"):
+        name = tempfile.gettempdir() + os.sep + name
+        mesh.write(name)
+        size = os.path.getsize(name) / (1024.0 * 1024.0)
+        for loader in (False, True):
+            param.SetBool("MappedLoading", loader)
+            start = time.time()
+            Mesh.Mesh(name)
+            seconds = time.time() - start
+            report("Load %s (%s): %.1f MB/s" % (os.path.basename(name), "mapped" if loader else "stream", rate(size, seconds)))
+        os.remove(name)
+    param.SetBool("MappedLoading", mapped)
+
+def kernel(samples=400):
+    """Reports the memory of the mesh kernel and the time of common operations"""
+    mesh = Mesh.createSphere(10.0,samples)
+    size = mesh.MemSize
+    report("Mesh kernel: %d points, %d facets, %.1f MB, %.1f bytes per facet"
+           % (mesh.CountPoints, mesh.CountFacets, size / (1024.0 * 1024.0), float(size) / mesh.CountFacets))
+
+    start = time.time()
+    mesh = mesh.copy()
+    mesh.rebuildNeighbourHood()
+    topology = time.time() - start
+
+    start = time.time()
+    mesh.countComponents()
+    mesh.hasNonUniformOrientedFacets()
+    mesh.isSolid()
+    evaluation = time.time() - start
+
+    start = time.time()
+    mesh.smooth()
+    smoothing = time.time() - start
+
+    report("Mesh kernel: topology %.3f s, evaluation %.3f s, smoothing %.3f s"
+           % (topology, evaluation, smoothing))
+
+def rays(count=20000):
+    """Compares the ray queries of the bounding volume hierarchy and the facet
+    grid on a mesh with a small very dense area"""
+    mesh = Mesh.createSphere(10.0,50)
+    detail = Mesh.createSphere(1.0,400)
+    detail.translate(10.0,0.0,0.0)
+    mesh.addMesh(detail)
+
+    random.seed(0)
+    points = []
+    directions = []
+    for i in range(count):
+        angle = random.uniform(0.0, 2.0 * math.pi)
+        base = FreeCAD.Vector(30.0 * math.cos(angle), 30.0 * math.sin(angle), random.uniform(-5.0, 5.0))
+        # half of the rays aim at the dense area
+        if i % 2:
+            target = FreeCAD.Vector(10.0 + random.uniform(-1.0, 1.0), random.uniform(-1.0, 1.0), random.uniform(-1.0, 1.0))
+        else:
+            target = FreeCAD.Vector(random.uniform(-8.0, 8.0), random.uniform(-8.0, 8.0), random.uniform(-8.0, 8.0))
+        points.append(base)
+        directions.append(target - base)
+
+    start = time.time()
+    mesh.nearestFacetsOnRays(points, directions, "BVH")
+    bvh = time.time() - start
+
+    start = time.time()
+    mesh.nearestFacetsOnRays(points, directions, "Grid")
+    grid = time.time() - start
+
+    report("Ray queries on %d facets: BVH %.0f rays/s, grid %.0f rays/s"
+           % (mesh.CountFacets, rate(count, bvh), rate(count, grid)))
+
+def analysis(samples=100):
+    """Reports the time of every check of the combined analysis on two
+    overlapping spheres"""
+    mesh = Mesh.createSphere(10.0,samples)
+    other = Mesh.createSphere(10.0,samples)
+    other.translate(5.0,0.0,0.0)
+    mesh.addMesh(other)
+
+    start = time.time()
+    result = mesh.analyze()
+    total = time.time() - start
+    for name in sorted(result.keys()):
+        report("Mesh analysis: %s %d defects, %.3f s" % (name, len(result[name][0]), result[name][1]))
+    report("Mesh analysis of %d facets: %.3f s" % (mesh.CountFacets, total))
+
+def smoothing(samples=400, iterations=20):
+    """Reports the iterations per second of the smoothing algorithms"""
+    mesh = Mesh.createSphere(10.0,samples)
+    times = []
+    for method in ("Laplace", "Taubin"):
+        copy = mesh.copy()
+        start = time.time()
+        copy.smooth(iterations, 1.0, method)
+        times.append(rate(iterations, time.time() - start))
+    report("Smoothing %d points: Laplace %.1f iterations/s, Taubin %.1f iterations/s"
+           % (mesh.CountPoints, times[0], times[1]))
+
+def run():
+    loadSTL()
+    kernel()
+    rays()
+    analysis()
+    smoothing()
@@ -426,7 +426,7 @@ void PropertyCurvatureList::Paste(const App::Property &from)
 // ----------------------------------------------------------------------------
 
 PropertyMeshKernel::PropertyMeshKernel()
-  : _meshObject(new MeshObject()), meshPyObject(0)
+  : _meshObject(new MeshObject()), meshPyObject(0), _pendingIndices(0)
 {
     // Note: Normally this property is a member of a document object, i.e. the setValue()
     // method gets called in the constructor of a sublcass of DocumentObject, e.g. Mesh::Feature.
@@ -450,6 +450,7 @@ void PropertyMeshKernel::setValuePtr(MeshObject* mesh)
     // before calling hasSetValue()
     Base::Reference<MeshObject> tmp(_meshObject);
     aboutToSetValue();
+    discardDeferred();
     _meshObject = mesh;
     hasSetValue();
 }
@@ -457,6 +458,7 @@ void PropertyMeshKernel::setValuePtr(MeshObject* mesh)
 void PropertyMeshKernel::setValue(const MeshObject& mesh)
 {
     aboutToSetValue();
+    discardDeferred();
     *_meshObject = mesh;
     hasSetValue();
 }
@@ -464,12 +466,14 @@ void PropertyMeshKernel::setValue(const MeshObject& mesh)
 void PropertyMeshKernel::setValue(const MeshCore::MeshKernel& mesh)
 {
     aboutToSetValue();
+    discardDeferred();
     _meshObject->setKernel(mesh);
     hasSetValue();
 }
 
 void PropertyMeshKernel::swapMesh(MeshObject& mesh)
 {
+    restoreDeferred();
     aboutToSetValue();
     _meshObject->swap(mesh);
     hasSetValue();
@@ -477,6 +481,7 @@ void PropertyMeshKernel::swapMesh(MeshObject& mesh)
 
 void PropertyMeshKernel::swapMesh(MeshCore::MeshKernel& mesh)
 {
+    restoreDeferred();
     aboutToSetValue();
     _meshObject->swap(mesh);
     hasSetValue();
@@ -484,26 +489,31 @@ void PropertyMeshKernel::swapMesh(MeshCore::MeshKernel& mesh)
 
 const MeshObject& PropertyMeshKernel::getValue(void)const 
 {
+    restoreDeferred();
     return *_meshObject;
 }
 
 const MeshObject* PropertyMeshKernel::getValuePtr(void)const 
 {
+    restoreDeferred();
     return (MeshObject*)_meshObject;
 }
 
 const Data::ComplexGeoData* PropertyMeshKernel::getComplexData() const
 {
+    restoreDeferred();
     return (MeshObject*)_meshObject;
 }
 
 Base::BoundBox3d PropertyMeshKernel::getBoundingBox() const
 {
+    restoreDeferred();
     return _meshObject->getBoundBox();
 }
 
 unsigned int PropertyMeshKernel::getMemSize (void) const
 {
+    restoreDeferred();
     unsigned int size = 0;
     size += _meshObject->getMemSize();
     
@@ -512,6 +522,7 @@ unsigned int PropertyMeshKernel::getMemSize (void) const
 
 MeshObject* PropertyMeshKernel::startEditing()
 {
+    restoreDeferred();
     aboutToSetValue();
     return (MeshObject*)_meshObject;
 }
@@ -523,6 +534,7 @@ void PropertyMeshKernel::finishEditing()
 
 void PropertyMeshKernel::transformGeometry(const Base::Matrix4D &rclMat)
 {
+    restoreDeferred();
     aboutToSetValue();
     _meshObject->transformGeometry(rclMat);
     hasSetValue();
@@ -530,7 +542,11 @@ void PropertyMeshKernel::transformGeometry(const Base::Matrix4D &rclMat)
 
 void PropertyMeshKernel::setPointIndices(const std::vector<std::pair<unsigned long, Base::Vector3f> >& inds)
 {
+    restoreDeferred();
+    // let an open transaction record only the points that are going to change
+    _pendingIndices = &inds;
     aboutToSetValue();
+    _pendingIndices = 0;
     MeshCore::MeshKernel& kernel = _meshObject->getKernel();
     for (std::vector<std::pair<unsigned long, Base::Vector3f> >::const_iterator it = inds.begin(); it != inds.end(); ++it)
         kernel.SetPoint(it->first, it->second);
@@ -539,6 +555,7 @@ void PropertyMeshKernel::setPointIndices(const std::vector<std::pair<unsigned lo
 
 PyObject *PropertyMeshKernel::getPyObject(void)
 {
+    restoreDeferred();
     if (!meshPyObject) {
         meshPyObject = new MeshPy(&*_meshObject);
         meshPyObject->setConst(); // set immutable
@@ -574,6 +591,7 @@ void PropertyMeshKernel::setPyObject(PyObject *value)
 
 void PropertyMeshKernel::Save (Base::Writer &writer) const
 {
+    restoreDeferred();
     if (writer.isForceXML()) {
         writer.Stream() << writer.ind() << "<Mesh>" << std::endl;
         MeshCore::MeshOutput saver(_meshObject->getKernel());
@@ -613,6 +631,7 @@ void PropertyMeshKernel::Restore(Base::XMLReader &reader)
 
 void PropertyMeshKernel::SaveDocFile (Base::Writer &writer) const
 {
+    restoreDeferred();
     _meshObject->save(writer.Stream());
 }
 
@@ -625,16 +644,58 @@ void PropertyMeshKernel::RestoreDocFile(Base::Reader &reader)
 
 App::Property *PropertyMeshKernel::Copy(void) const
 {
+    restoreDeferred();
     // Note: Copy the content, do NOT reference the same mesh object
     PropertyMeshKernel *prop = new PropertyMeshKernel();
     *(prop->_meshObject) = *(this->_meshObject);
     return prop;
 }
 
+namespace Mesh {
+/** Undo record of setPointIndices() holding the old positions of the moved points. */
+class MeshPointDelta : public App::PropertyDelta
+{
+public:
+    MeshPointDelta(const MeshCore::MeshKernel& kernel,
+                   const std::vector<std::pair<unsigned long, Base::Vector3f> >& inds)
+    {
+        points.reserve(inds.size());
+        for (std::vector<std::pair<unsigned long, Base::Vector3f> >::const_iterator it = inds.begin(); it != inds.end(); ++it)
+            points.push_back(std::make_pair(it->first, Base::Vector3f(kernel.GetPoint(it->first))));
+    }
+    void apply(App::Property &prop) const
+    {
+        static_cast<PropertyMeshKernel&>(prop).setPointIndices(points);
+    }
+    unsigned int getMemSize (void) const
+    {
+        return points.size() * sizeof(std::pair<unsigned long, Base::Vector3f>);
+    }
+
+private:
+    std::vector<std::pair<unsigned long, Base::Vector3f> > points;
+};
+}
+
+App::PropertyDelta *PropertyMeshKernel::CopyDelta(void) const
+{
+    if (!_pendingIndices)
+        return 0;
+    // check the indices so that applying the delta cannot fail
+    const MeshCore::MeshKernel& kernel = _meshObject->getKernel();
+    unsigned long count = kernel.CountPoints();
+    for (std::vector<std::pair<unsigned long, Base::Vector3f> >::const_iterator it = _pendingIndices->begin(); it != _pendingIndices->end(); ++it) {
+        if (it->first >= count)
+            return 0;
+    }
+    return new MeshPointDelta(kernel, *_pendingIndices);
+}
+
 void PropertyMeshKernel::Paste(const App::Property &from)
 {
     // Note: Copy the content, do NOT reference the same mesh object
     aboutToSetValue();
+    discardDeferred();
     const PropertyMeshKernel& prop = dynamic_cast<const PropertyMeshKernel&>(from);
     *(this->_meshObject) = *(prop._meshObject);
     hasSetValue();
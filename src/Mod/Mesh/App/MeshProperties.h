@@ -247,11 +247,17 @@ public:
 
     App::Property *Copy(void) const;
     void Paste(const App::Property &from);
+    /// Records only the old positions of the points modified by setPointIndices()
+    App::PropertyDelta *CopyDelta(void) const;
+    /// the mesh is read on first access if the document is opened with lazy loading
+    bool canRestoreDeferred(void) const { return true; }
     //@}
 
 private:
     Base::Reference<MeshObject> _meshObject;
     MeshPy* meshPyObject;
+    // the points about to be changed by setPointIndices(), used by CopyDelta()
+    const std::vector<std::pair<unsigned long, Base::Vector3f> >* _pendingIndices;
 };
 
 } // namespace Mesh
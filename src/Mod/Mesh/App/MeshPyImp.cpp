@@ -41,6 +41,9 @@
 #include "Core/Degeneration.h"
 #include "Core/Elements.h"
 #include "Core/Grid.h"
+#include "Core/BVH.h"
+#include "Core/Analysis.h"
+#include "Core/Smoothing.h"
 #include "Core/MeshKernel.h"
 #include "Core/Segmentation.h"
 #include "Core/Curvature.h"
@@ -996,6 +999,138 @@ PyObject*  MeshPy::getSelfIntersections(PyObject *args)
     return Py::new_reference_to(tuple);
 }
 
+PyObject*  MeshPy::analyze(PyObject *args)
+{
+    PyObject* list = 0;
+    PyObject* parallel = Py_True;
+    if (!PyArg_ParseTuple(args, "|OO!", &list, &PyBool_Type, &parallel))
+        return NULL;
+
+    try {
+        int checks = MeshCore::MeshAnalysis::AllChecks;
+        if (list && list != Py_None) {
+            checks = 0;
+            Py::Sequence names(list);
+            for (Py::Sequence::iterator it = names.begin(); it != names.end(); ++it) {
+                std::string name = Py::String(*it).as_std_string();
+                int check = 0;
+                for (int i = 0; i < MeshCore::MeshAnalysis::NumChecks; i++) {
+                    MeshCore::MeshAnalysis::Check c = static_cast<MeshCore::MeshAnalysis::Check>(1 << i);
+                    if (name == MeshCore::MeshAnalysis::CheckName(c))
+                        check = c;
+                }
+                if (check == 0) {
+                    std::string error = std::string("Unknown check: ") + name;
+                    PyErr_SetString(PyExc_ValueError, error.c_str());
+                    return 0;
+                }
+                checks |= check;
+            }
+        }
+
+        MeshCore::MeshAnalysis analysis(getMeshObjectPtr()->getKernel());
+        analysis.SetParallel(PyObject_IsTrue(parallel) ? true : false);
+        analysis.Analyze(checks);
+
+        Py::Dict dict;
+        for (int i = 0; i < MeshCore::MeshAnalysis::NumChecks; i++) {
+            MeshCore::MeshAnalysis::Check c = static_cast<MeshCore::MeshAnalysis::Check>(1 << i);
+            if ((checks & c) == 0)
+                continue;
+            const std::vector<unsigned long>& indices = analysis.GetIndices(c);
+            Py::List ary(indices.size());
+            for (std::size_t j = 0; j < indices.size(); j++) {
+#if PY_MAJOR_VERSION >= 3
+                ary.setItem(j, Py::Long(indices[j]));
+#else
+                ary.setItem(j, Py::Int((int)indices[j]));
+#endif
+            }
+            Py::Tuple item(2);
+            item.setItem(0, ary);
+            item.setItem(1, Py::Float(analysis.GetTime(c)));
+            dict.setItem(MeshCore::MeshAnalysis::CheckName(c), item);
+        }
+        return Py::new_reference_to(dict);
+    }
+    catch (const Base::Exception& e) {
+        PyErr_SetString(Base::BaseExceptionFreeCADError, e.what());
+        return 0;
+    }
+    catch (const Py::Exception&) {
+        return 0;
+    }
+}
+
+template <class Range>
+static Py::List indexRangeToList(const Range& range)
+{
+    Py::List list;
+    for (typename Range::const_iterator it = range.begin(); it != range.end(); ++it) {
+#if PY_MAJOR_VERSION >= 3
+        list.append(Py::Long(*it));
+#else
+        list.append(Py::Int((int)*it));
+#endif
+    }
+    return list;
+}
+
+template <class Adjacency>
+static Py::List adjacencyToList(const Adjacency& adj, unsigned long count)
+{
+    Py::List list(count);
+    for (unsigned long i = 0; i < count; i++)
+        list.setItem(i, indexRangeToList(adj[i]));
+    return list;
+}
+
+PyObject*  MeshPy::getAdjacency(PyObject *args)
+{
+    char* type;
+    PyObject* flat = Py_True;
+    if (!PyArg_ParseTuple(args, "s|O!", &type, &PyBool_Type, &flat))
+        return NULL;
+
+    try {
+        const MeshCore::MeshKernel& kernel = getMeshObjectPtr()->getKernel();
+        bool useFlat = PyObject_IsTrue(flat) ? true : false;
+        std::string name = type;
+        Py::List list;
+        if (name == "PointFacets") {
+            if (useFlat)
+                list = adjacencyToList(MeshCore::MeshFlatPointToFacets(kernel), kernel.CountPoints());
+            else
+                list = adjacencyToList(MeshCore::MeshRefPointToFacets(kernel), kernel.CountPoints());
+        }
+        else if (name == "FacetFacets") {
+            if (useFlat)
+                list = adjacencyToList(MeshCore::MeshFlatFacetToFacets(kernel), kernel.CountFacets());
+            else
+                list = adjacencyToList(MeshCore::MeshRefFacetToFacets(kernel), kernel.CountFacets());
+        }
+        else if (name == "PointPoints") {
+            if (useFlat)
+                list = adjacencyToList(MeshCore::MeshFlatPointToPoints(kernel), kernel.CountPoints());
+            else
+                list = adjacencyToList(MeshCore::MeshRefPointToPoints(kernel), kernel.CountPoints());
+        }
+        else {
+            std::string error = std::string("Unknown adjacency type: ") + name;
+            PyErr_SetString(PyExc_ValueError, error.c_str());
+            return 0;
+        }
+        return Py::new_reference_to(list);
+    }
+    catch (const Base::Exception& e) {
+        PyErr_SetString(Base::BaseExceptionFreeCADError, e.what());
+        return 0;
+    }
+    catch (const Py::Exception&) {
+        return 0;
+    }
+}
+
 PyObject*  MeshPy::fixSelfIntersections(PyObject *args)
 {
     if (!PyArg_ParseTuple(args, ""))
@@ -1613,12 +1748,25 @@ PyObject*  MeshPy::smooth(PyObject *args)
 {
     int iter=1;
     float d_max=FLOAT_MAX;
-    if (!PyArg_ParseTuple(args, "|if", &iter,&d_max))
+    const char* method = "Laplace";
+    if (!PyArg_ParseTuple(args, "|ifs", &iter,&d_max,&method))
         return NULL;
 
     PY_TRY {
+        std::string mode(method);
+        if (mode != "Laplace" && mode != "Taubin") {
+            PyErr_SetString(PyExc_ValueError, "Unknown method, use 'Laplace' or 'Taubin'");
+            return 0;
+        }
+
         MeshPropertyLock lock(this->parentProperty);
-        getMeshObjectPtr()->smooth(iter, d_max);
+        if (mode == "Taubin") {
+            MeshCore::TaubinSmoothing s(getMeshObjectPtr()->getKernel());
+            s.Smooth(iter);
+        }
+        else {
+            getMeshObjectPtr()->smooth(iter, d_max);
+        }
     } PY_CATCH;
 
     Py_Return; 
@@ -1691,6 +1839,66 @@ PyObject* MeshPy::nearestFacetOnRay(PyObject *args)
     }
 }
 
+PyObject*  MeshPy::nearestFacetsOnRays(PyObject *args)
+{
+    PyObject* pnts;
+    PyObject* dirs;
+    const char* method = "BVH";
+    if (!PyArg_ParseTuple(args, "OO|s", &pnts, &dirs, &method))
+        return NULL;
+
+    try {
+        std::vector<Base::Vector3f> points, directions;
+        Py::Sequence pnt_list(pnts);
+        for (Py::Sequence::iterator it = pnt_list.begin(); it != pnt_list.end(); ++it)
+            points.push_back(Base::convertTo<Base::Vector3f>(Py::Vector(*it).toVector()));
+        Py::Sequence dir_list(dirs);
+        for (Py::Sequence::iterator it = dir_list.begin(); it != dir_list.end(); ++it)
+            directions.push_back(Base::convertTo<Base::Vector3f>(Py::Vector(*it).toVector()));
+        if (points.size() != directions.size()) {
+            PyErr_SetString(PyExc_ValueError, "Different number of points and directions");
+            return 0;
+        }
+
+        const MeshCore::MeshKernel& kernel = getMeshObjectPtr()->getKernel();
+        std::vector<Base::Vector3f> res;
+        std::vector<unsigned long> facets;
+        std::string mode(method);
+        if (mode == "BVH") {
+            MeshCore::MeshFacetBVH bvh(kernel);
+            bvh.NearestFacetsOnRays(points, directions, res, facets);
+        }
+        else if (mode == "Grid") {
+            MeshCore::MeshFacetGrid grid(kernel);
+            MeshCore::MeshAlgorithm alg(kernel);
+            res.resize(points.size());
+            facets.resize(points.size());
+            for (std::size_t i = 0; i < points.size(); i++) {
+                if (!alg.NearestFacetOnRay(points[i], directions[i], grid, res[i], facets[i]))
+                    facets[i] = ULONG_MAX;
+            }
+        }
+        else {
+            PyErr_SetString(PyExc_ValueError, "Unknown method, use 'BVH' or 'Grid'");
+            return 0;
+        }
+
+        Py::List list(facets.size());
+        for (std::size_t i = 0; i < facets.size(); i++) {
+            int index = facets[i] == ULONG_MAX ? -1 : (int)facets[i];
+#if PY_MAJOR_VERSION >= 3
+            list.setItem(i, Py::Long(index));
+#else
+            list.setItem(i, Py::Int(index));
+#endif
+        }
+        return Py::new_reference_to(list);
+    }
+    catch (const Py::Exception&) {
+        return 0;
+    }
+}
+
 PyObject*  MeshPy::getPlanarSegments(PyObject *args)
 {
     float dev;
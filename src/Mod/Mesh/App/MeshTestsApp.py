@@ -225,3 +225,192 @@ class PolynomialFitCases(unittest.TestCase):
 
     def tearDown(self):
         pass
+
+class LoadSTLCases(unittest.TestCase):
+    def setUp(self):
+        self.param = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Mod/Mesh")
+        self.mapped = self.param.GetBool("MappedLoading", False)
+        self.mesh = Mesh.createSphere(10.0,50)
+
+    def loadFile(self, name, mapped):
+        self.param.SetBool("MappedLoading", mapped)
+        return Mesh.Mesh(name)
+
+    def compare(self, name):
+        self.mesh.write(name)
+        stream = self.loadFile(name, False)
+        mapped = self.loadFile(name, True)
+        os.remove(name)
+        # the stream loader keeps the points in the order of the file, the mapped
+        # loader sorts them, so the facets are compared by their corners
+        self.failUnless(stream.CountFacets == mapped.CountFacets, "Different number of facets")
+        for f, g in zip(self.corners(stream), self.corners(mapped)):
+            for p, q in zip(f, g):
+                self.failUnless(p.distanceToPoint(q) < 1e-6, "Different facet %s" % str(f))
+
+    def corners(self, mesh):
+        points, facets = mesh.Topology
+        return sorted([tuple(points[i] for i in f) for f in facets], key=lambda f: [tuple(p) for p in f])
+
+    def testBinarySTL(self):
+        self.compare(tempfile.gettempdir() + os.sep + "mapped.stl")
+
+    def testAsciiSTL(self):
+        self.compare(tempfile.gettempdir() + os.sep + "mapped.ast")
+
+    def tearDown(self):
+        self.param.SetBool("MappedLoading", self.mapped)
+
+
+class MeshAdjacencyCases(unittest.TestCase):
+    """Compares the flat adjacency structures with the set based ones on a
+    mesh with borders and degenerated facets"""
+    def setUp(self):
+        # large enough to build the flat structures with several threads
+        n = 120
+        points = [FreeCAD.Vector(i, j, 0) for j in range(n) for i in range(n)]
+        facets = []
+        for j in range(n-1):
+            for i in range(n-1):
+                p = j * n + i
+                facets.append((p, p+1, p+n+1))
+                facets.append((p, p+n+1, p+n))
+        # a hole, facets referencing a point twice or three times and a collinear facet
+        del facets[5000:5040]
+        facets += [(0, 0, 1), (200, 201, 200), (300, 300, 300), (0, 1, 2)]
+        self.mesh = Mesh.Mesh()
+        self.mesh.addFacets((points, facets), False)
+
+    def testFlatAgainstRef(self):
+        for kind in ("PointFacets", "FacetFacets", "PointPoints"):
+            flat = self.mesh.getAdjacency(kind)
+            ref = self.mesh.getAdjacency(kind, False)
+            self.failUnless(len(flat) == len(ref), "Different number of elements for %s" % kind)
+            for i in range(len(ref)):
+                self.failUnless(flat[i] == ref[i], "Different %s neighbours of %d" % (kind, i))
+
+
+class MeshLayoutCases(unittest.TestCase):
+    """Checks the topology of the mesh kernel, run it with a build with and
+    without FREECAD_MESH_COMPACT_INDEX to check both layouts"""
+    def setUp(self):
+        self.mesh = Mesh.createSphere(10.0,50)
+
+    def testTopology(self):
+        facets = self.mesh.CountFacets
+        mesh = self.mesh.copy()
+        mesh.rebuildNeighbourHood()
+        components = mesh.countComponents()
+        self.failUnless(components == 1, "Sphere has %d components" % components)
+        self.failIf(mesh.hasNonUniformOrientedFacets(), "Sphere has wrongly oriented facets")
+        self.failUnless(mesh.isSolid(), "Sphere is not solid")
+        mesh.smooth()
+        self.failUnless(mesh.CountFacets == facets, "Different number of facets")
+
+    def testOpenEdges(self):
+        # the compact layout stores ULONG_MAX with 32 bits, an open edge must
+        # still be reported with ULONG_MAX after a copy and a binary round trip
+        import ctypes
+        invalid = ctypes.c_ulong(-1).value
+        mesh = self.mesh.copy()
+        mesh.removeFacets([0, 1, 2, 100])
+        neighbours = [f.NeighbourIndices for f in mesh.Facets]
+        count = mesh.CountFacets
+        borders = [n for t in neighbours for n in t if n >= count]
+        self.failUnless(len(borders) > 0, "Mesh has no open edges")
+        self.failUnless(all(n == invalid for n in borders), "Open edges are not marked with ULONG_MAX")
+
+        name = tempfile.gettempdir() + os.sep + "layout.bms"
+        mesh.write(name)
+        loaded = Mesh.Mesh(name)
+        os.remove(name)
+        for other in (mesh.copy(), loaded):
+            self.failUnless([f.NeighbourIndices for f in other.Facets] == neighbours, "Different neighbours")
+
+
+class MeshBVHCases(unittest.TestCase):
+    """Compares the ray queries of the bounding volume hierarchy with the
+    exhaustive search on a mesh with a small very dense area"""
+    def setUp(self):
+        self.mesh = Mesh.createSphere(10.0,50)
+        detail = Mesh.createSphere(1.0,100)
+        detail.translate(10.0,0.0,0.0)
+        self.mesh.addMesh(detail)
+
+    def testRaysAgainstExhaustive(self):
+        import random
+        random.seed(0)
+        points = []
+        directions = []
+        for i in range(500):
+            angle = random.uniform(0.0, 2.0 * math.pi)
+            base = FreeCAD.Vector(30.0 * math.cos(angle), 30.0 * math.sin(angle), random.uniform(-5.0, 5.0))
+            # half of the rays aim at the dense area
+            if i % 2:
+                target = FreeCAD.Vector(10.0 + random.uniform(-1.0, 1.0), random.uniform(-1.0, 1.0), random.uniform(-1.0, 1.0))
+            else:
+                target = FreeCAD.Vector(random.uniform(-8.0, 8.0), random.uniform(-8.0, 8.0), random.uniform(-8.0, 8.0))
+            points.append(base)
+            directions.append(target - base)
+
+        bvh = self.mesh.nearestFacetsOnRays(points, directions, "BVH")
+        self.failUnless(len(bvh) == len(points), "Wrong number of results")
+
+        # all rays start outside of the mesh, so they must hit the same facets as the
+        # exhaustive search, an index of -1 is a miss
+        for i in range(len(points)):
+            result = self.mesh.nearestFacetOnRay((points[i].x, points[i].y, points[i].z),
+                                                 (directions[i].x, directions[i].y, directions[i].z))
+            expected = list(result.keys())
+            found = [bvh[i]] if bvh[i] >= 0 else []
+            self.failUnless(found == expected, "Ray %d hits facet %d with the BVH instead of %s" % (i, bvh[i], expected))
+
+class MeshAnalysisCases(unittest.TestCase):
+    """Compares the combined analysis with the single checks on two
+    overlapping spheres"""
+    def setUp(self):
+        self.mesh = Mesh.createSphere(10.0,50)
+        other = Mesh.createSphere(10.0,50)
+        other.translate(5.0,0.0,0.0)
+        self.mesh.addMesh(other)
+
+    def testAnalyzeAll(self):
+        result = self.mesh.analyze()
+        self.failUnless(len(result) == 10, "Not all checks were run")
+
+        pairs = self.mesh.getSelfIntersections()
+        facets = set()
+        for i in pairs:
+            facets.add(i[0])
+            facets.add(i[1])
+        self.failUnless(len(pairs) > 0, "Overlapping spheres don't intersect")
+        self.failUnless(result["SelfIntersections"][0] == sorted(facets), "Different self-intersections")
+        self.failUnless(result["Orientation"][0] == list(self.mesh.getNonUniformOrientedFacets()), "Different orientation")
+        self.failUnless(len(result["NonManifoldEdges"][0]) == 0, "Unexpected non-manifolds")
+        self.failUnless(len(result["DegeneratedFacets"][0]) == 0, "Unexpected degenerated facets")
+
+    def testParallelAndSerial(self):
+        checks = ["NaNPoints", "DuplicatedPoints", "CorruptedFacets", "DegeneratedFacets", "Folds", "Orientation"]
+        parallel = self.mesh.analyze(checks, True)
+        serial = self.mesh.analyze(checks, False)
+        self.failUnless(sorted(parallel.keys()) == sorted(checks), "Wrong checks were run")
+        for name in checks:
+            self.failUnless(parallel[name][0] == serial[name][0], "Different results of %s" % name)
+
+class MeshSmoothingCases(unittest.TestCase):
+    """Compares the volume changes of the smoothing algorithms"""
+    def setUp(self):
+        self.mesh = Mesh.createSphere(10.0,50)
+
+    def testLaplaceAndTaubin(self):
+        volume = self.mesh.Volume
+        iterations = 20
+
+        laplace = self.mesh.copy()
+        laplace.smooth(iterations, 1.0, "Laplace")
+        taubin = self.mesh.copy()
+        taubin.smooth(iterations, 1.0, "Taubin")
+        self.failUnless(laplace.Volume < volume, "Laplace smoothing doesn't shrink the sphere")
+        self.failUnless(abs(taubin.Volume - volume) < abs(laplace.Volume - volume), "Taubin smoothing shrinks more than Laplace")
+        self.failUnless(laplace.CountPoints == self.mesh.CountPoints, "Different number of points")
+        self.failUnlessRaises(ValueError, taubin.smooth, 1, 1.0, "Unknown")
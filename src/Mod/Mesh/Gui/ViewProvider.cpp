@@ -1563,7 +1563,7 @@ void ViewProviderMesh::fillHole(unsigned long uFacet)
     std::list<unsigned long> aBorder;
     Mesh::Feature* fea = reinterpret_cast<Mesh::Feature*>(this->getObject());
     const MeshCore::MeshKernel& rKernel = fea->Mesh.getValue().getKernel();
-    MeshCore::MeshRefPointToFacets cPt2Fac(rKernel);
+    MeshCore::MeshFlatPointToFacets cPt2Fac(rKernel);
     MeshCore::MeshAlgorithm meshAlg(rKernel);
     meshAlg.GetMeshBorder(uFacet, aBorder);
     std::vector<unsigned long> boundary(aBorder.begin(), aBorder.end());
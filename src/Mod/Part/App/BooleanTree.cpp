@@ -0,0 +1,353 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+
+#include "PreCompiled.h"
+#ifndef _PreComp_
+# include <algorithm>
+# include <string>
+# include <BRepAlgoAPI_Fuse.hxx>
+# include <BRepBndLib.hxx>
+# include <BRepBuilderAPI_Copy.hxx>
+# include <Bnd_Box.hxx>
+# include <gp_Pnt.hxx>
+# include <Standard_Failure.hxx>
+# include <Standard_Version.hxx>
+# include <TopTools_ListOfShape.hxx>
+# include <QtConcurrentMap>
+#endif
+
+#include <Base/Console.h>
+#include <Base/Exception.h>
+#include <Base/TimeInfo.h>
+#include <App/Application.h>
+
+#include "BooleanTree.h"
+#include "PartFeature.h"
+
+using namespace Part;
+
+/// A shape and the operands it has been made of
+struct BooleanTree::Item
+{
+    TopoDS_Shape shape;
+    std::vector<int> operands;
+    // the face history of every operand in the shape, empty for an operand itself
+    std::vector<ShapeHistory> history;
+};
+
+/// A boolean operation of the tree
+struct BooleanTree::Node
+{
+    std::vector<Item> inputs;
+    Item output;
+    std::string error;
+};
+
+/// Fuses the inputs of a node, runs in a worker thread
+class BooleanTree::FuseNode
+{
+public:
+    typedef void result_type;
+
+    FuseNode(double tolerance, bool recordHistory, bool runParallel)
+      : tolerance(tolerance), recordHistory(recordHistory), runParallel(runParallel)
+    {
+    }
+
+    void operator()(Node& node) const
+    {
+        if (node.inputs.size() == 1) {
+            node.output = node.inputs.front();
+            return;
+        }
+
+        try {
+            fuse(node);
+        }
+        catch (Standard_Failure& e) {
+            // Standard_Failure::Caught() is not reliable in a worker thread
+            const char* msg = e.GetMessageString();
+            node.error = (msg && msg[0] != '\0') ? msg : "Fusion failed";
+        }
+        catch (const Base::Exception& e) {
+            node.error = e.what();
+        }
+        catch (...) {
+            node.error = "Fusion failed";
+        }
+    }
+
+private:
+    void fuse(Node& node) const
+    {
+#if OCC_VERSION_HEX >= 0x060900
+        std::vector<TopoDS_Shape> shapes;
+        shapes.reserve(node.inputs.size());
+        for (std::vector<Item>::iterator it = node.inputs.begin(); it != node.inputs.end(); ++it) {
+            // the operands may share sub-shapes and the fusion may modify its
+            // arguments, so the fusions of different nodes running at the same
+            // time must work on copies. The result of a fusion is only used by
+            // its parent node. The copy is also a workaround for
+            // http://dev.opencascade.org/index.php?q=node/1056#comment-520
+            if (it->operands.size() == 1)
+                shapes.push_back(BRepBuilderAPI_Copy(it->shape).Shape());
+            else
+                shapes.push_back(it->shape);
+        }
+
+        BRepAlgoAPI_Fuse mkFuse;
+        mkFuse.SetRunParallel(runParallel);
+        TopTools_ListOfShape shapeArguments,shapeTools;
+        shapeArguments.Append(shapes.front());
+        for (std::vector<TopoDS_Shape>::iterator it = shapes.begin()+1; it != shapes.end(); ++it)
+            shapeTools.Append(*it);
+        mkFuse.SetArguments(shapeArguments);
+        mkFuse.SetTools(shapeTools);
+        if (tolerance > 0.0)
+            mkFuse.SetFuzzyValue(tolerance);
+        mkFuse.Build();
+        if (!mkFuse.IsDone())
+            throw Base::RuntimeError("Fusion failed");
+
+        Item& output = node.output;
+        output.shape = mkFuse.Shape();
+        for (std::size_t i = 0; i < node.inputs.size(); i++) {
+            const Item& input = node.inputs[i];
+            output.operands.insert(output.operands.end(), input.operands.begin(), input.operands.end());
+            if (!recordHistory)
+                continue;
+            ShapeHistory hist = Feature::buildHistory(mkFuse, TopAbs_FACE, output.shape, shapes[i]);
+            if (input.history.empty()) {
+                output.history.push_back(hist);
+            }
+            else {
+                for (std::vector<ShapeHistory>::const_iterator jt = input.history.begin(); jt != input.history.end(); ++jt)
+                    output.history.push_back(Feature::joinHistory(*jt, hist));
+            }
+        }
+#else
+        (void)node;
+        throw Base::RuntimeError("Hierarchical fuse is available only in OCC 6.9.0 and up.");
+#endif
+    }
+
+private:
+    double tolerance;
+    bool recordHistory;
+    bool runParallel;
+};
+
+namespace Part {
+/// Orders operands by one coordinate of the centers of their bounding boxes
+struct CenterLess
+{
+    CenterLess(const std::vector<gp_Pnt>& centers, int axis)
+      : centers(centers), axis(axis)
+    {
+    }
+    bool operator()(int a, int b) const
+    {
+        return centers[a].Coord(axis) < centers[b].Coord(axis);
+    }
+
+    const std::vector<gp_Pnt>& centers;
+    int axis;
+};
+
+// Splits the operands at the median of the longest extent of their centers
+// until a part has no more than 'size' operands.
+static void splitClusters(std::vector<int>::iterator first, std::vector<int>::iterator last,
+                          const std::vector<gp_Pnt>& centers, int size,
+                          std::vector<std::vector<int> >& clusters)
+{
+    if (last - first <= size) {
+        clusters.push_back(std::vector<int>(first, last));
+        return;
+    }
+
+    Bnd_Box box;
+    for (std::vector<int>::iterator it = first; it != last; ++it)
+        box.Add(centers[*it]);
+    Standard_Real xMin, yMin, zMin, xMax, yMax, zMax;
+    box.Get(xMin, yMin, zMin, xMax, yMax, zMax);
+    int axis = 1;
+    if (yMax - yMin > xMax - xMin)
+        axis = 2;
+    if (zMax - zMin > std::max(xMax - xMin, yMax - yMin))
+        axis = 3;
+
+    std::vector<int>::iterator mid = first + (last - first) / 2;
+    std::nth_element(first, mid, last, CenterLess(centers, axis));
+    splitClusters(first, mid, centers, size, clusters);
+    splitClusters(mid, last, centers, size, clusters);
+}
+}
+
+BooleanTree::BooleanTree()
+  : tolerance(0.0), recordHistory(false)
+{
+    Base::Reference<ParameterGrp> hGrp = App::GetApplication().GetUserParameter()
+        .GetGroup("BaseApp")->GetGroup("Preferences")->GetGroup("Mod/Part/Boolean");
+    clusterSize = std::max<int>(2, hGrp->GetInt("HierarchicalClusterSize", 16));
+}
+
+BooleanTree::~BooleanTree()
+{
+}
+
+bool BooleanTree::isEnabled(std::size_t numShapes)
+{
+#if OCC_VERSION_HEX >= 0x060900
+    Base::Reference<ParameterGrp> hGrp = App::GetApplication().GetUserParameter()
+        .GetGroup("BaseApp")->GetGroup("Preferences")->GetGroup("Mod/Part/Boolean");
+    if (!hGrp->GetBool("HierarchicalBoolean", false))
+        return false;
+    // with a single cluster there is nothing to gain
+    long size = std::max<long>(2, hGrp->GetInt("HierarchicalClusterSize", 16));
+    return numShapes > static_cast<std::size_t>(size);
+#else
+    (void)numShapes;
+    return false;
+#endif
+}
+
+void BooleanTree::setClusterSize(int size)
+{
+    clusterSize = std::max<int>(2, size);
+}
+
+void BooleanTree::setTolerance(double tol)
+{
+    tolerance = tol;
+}
+
+void BooleanTree::setRecordHistory(bool on)
+{
+    recordHistory = on;
+}
+
+const std::vector<ShapeHistory>& BooleanTree::getHistory() const
+{
+    return history;
+}
+
+const std::vector<BooleanTree::Level>& BooleanTree::getLevels() const
+{
+    return levels;
+}
+
+std::vector<std::vector<int> > BooleanTree::makeClusters(const std::vector<TopoDS_Shape>& shapes) const
+{
+    std::vector<gp_Pnt> centers;
+    centers.reserve(shapes.size());
+    for (std::vector<TopoDS_Shape>::const_iterator it = shapes.begin(); it != shapes.end(); ++it) {
+        Bnd_Box bounds;
+        BRepBndLib::Add(*it, bounds);
+        if (bounds.IsVoid()) {
+            centers.push_back(gp_Pnt());
+        }
+        else {
+            Standard_Real xMin, yMin, zMin, xMax, yMax, zMax;
+            bounds.Get(xMin, yMin, zMin, xMax, yMax, zMax);
+            centers.push_back(gp_Pnt((xMin+xMax)/2, (yMin+yMax)/2, (zMin+zMax)/2));
+        }
+    }
+
+    std::vector<int> order;
+    order.reserve(shapes.size());
+    for (std::size_t i = 0; i < shapes.size(); i++)
+        order.push_back(static_cast<int>(i));
+
+    // the clusters are in the order of the leaves of a kd-tree, so neighbours are close
+    std::vector<std::vector<int> > clusters;
+    splitClusters(order.begin(), order.end(), centers, clusterSize, clusters);
+    return clusters;
+}
+
+void BooleanTree::runLevel(std::vector<Node>& nodes)
+{
+    Base::TimeInfo start;
+
+    // a single operation uses the parallel mode of OCC instead
+    QtConcurrent::blockingMap(nodes, FuseNode(tolerance, recordHistory, nodes.size() == 1));
+
+    Level level;
+    level.operations = 0;
+    for (std::vector<Node>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if (!it->error.empty())
+            throw Base::RuntimeError(it->error);
+        if (it->inputs.size() > 1)
+            level.operations++;
+    }
+    level.time = Base::TimeInfo::diffTimeF(start, Base::TimeInfo());
+    levels.push_back(level);
+
+    Base::Console().Log("Hierarchical fuse, level %d: %d operations in %.3f s\n",
+        (int)levels.size(), level.operations, level.time);
+}
+
+TopoDS_Shape BooleanTree::fuse(const std::vector<TopoDS_Shape>& shapes)
+{
+    history.clear();
+    levels.clear();
+    if (shapes.empty())
+        return TopoDS_Shape();
+    for (std::vector<TopoDS_Shape>::const_iterator it = shapes.begin(); it != shapes.end(); ++it) {
+        if (it->IsNull())
+            throw Base::ValueError("Input shape is null");
+    }
+
+    // the lowest level fuses the clusters
+    std::vector<std::vector<int> > clusters = makeClusters(shapes);
+    std::vector<Node> nodes(clusters.size());
+    for (std::size_t i = 0; i < clusters.size(); i++) {
+        for (std::vector<int>::iterator it = clusters[i].begin(); it != clusters[i].end(); ++it) {
+            Item item;
+            item.shape = shapes[*it];
+            item.operands.push_back(*it);
+            nodes[i].inputs.push_back(item);
+        }
+    }
+    runLevel(nodes);
+
+    // the next levels fuse neighbouring results pairwise
+    while (nodes.size() > 1) {
+        std::vector<Node> parents((nodes.size() + 1) / 2);
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            parents[i / 2].inputs.push_back(Item());
+            parents[i / 2].inputs.back().shape = nodes[i].output.shape;
+            parents[i / 2].inputs.back().operands.swap(nodes[i].output.operands);
+            parents[i / 2].inputs.back().history.swap(nodes[i].output.history);
+        }
+        nodes.swap(parents);
+        runLevel(nodes);
+    }
+
+    Item& result = nodes.front().output;
+    if (recordHistory) {
+        history.resize(shapes.size());
+        for (std::size_t i = 0; i < result.operands.size() && i < result.history.size(); i++)
+            history[result.operands[i]] = result.history[i];
+    }
+    return result.shape;
+}
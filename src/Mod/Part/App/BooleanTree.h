@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+
+#ifndef PART_BOOLEANTREE_H
+#define PART_BOOLEANTREE_H
+
+#include <vector>
+#include <TopoDS_Shape.hxx>
+#include "PropertyTopoShape.h"
+
+namespace Part {
+
+/** Fuses many shapes with a tree of smaller boolean operations.
+ * The operands are clustered by the centers of their bounding boxes so that
+ * nearby shapes are fused first. All fusions of one level of the tree run
+ * concurrently and their results are fused pairwise on the next level until
+ * a single shape is left. The result is topologically the same as the one of
+ * a single general fuse of all operands, but for many mostly disjoint
+ * operands it is computed much faster.
+ *
+ * The hierarchical mode is enabled with the HierarchicalBoolean preference
+ * of Mod/Part/Boolean, the size of the clusters is HierarchicalClusterSize.
+ */
+class PartExport BooleanTree
+{
+public:
+    /// The work done on one level of the tree
+    struct Level {
+        int operations;
+        double time;
+    };
+
+    BooleanTree();
+    ~BooleanTree();
+
+    /// Returns true if \a numShapes operands should be fused hierarchically
+    static bool isEnabled(std::size_t numShapes);
+
+    /// Sets the maximum number of operands fused together on the lowest level
+    void setClusterSize(int);
+    /// Sets the fuzzy value of the boolean operations
+    void setTolerance(double);
+    /// Records the face history of every operand, see getHistory()
+    void setRecordHistory(bool);
+
+    /// Fuses the shapes, throws Base::Exception on failure
+    TopoDS_Shape fuse(const std::vector<TopoDS_Shape>& shapes);
+    /// The face history of every operand in the result of the last fuse()
+    const std::vector<ShapeHistory>& getHistory() const;
+    /// The levels of the last fuse(), starting with the clusters
+    const std::vector<Level>& getLevels() const;
+
+private:
+    struct Item;
+    struct Node;
+    class FuseNode;
+
+    std::vector<std::vector<int> > makeClusters(const std::vector<TopoDS_Shape>& shapes) const;
+    void runLevel(std::vector<Node>& nodes);
+
+private:
+    int clusterSize;
+    double tolerance;
+    bool recordHistory;
+    std::vector<ShapeHistory> history;
+    std::vector<Level> levels;
+};
+
+}
+
+#endif // PART_BOOLEANTREE_H
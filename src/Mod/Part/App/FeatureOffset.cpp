@@ -26,6 +26,7 @@
 
 
 #include "FeatureOffset.h"
+#include "ShapeCache.h"
 
 
 using namespace Part;
@@ -85,8 +86,23 @@ App::DocumentObjectExecReturn *Offset::execute(void)
     short join = (short)Join.getValue();
     bool fill = Fill.getValue();
     const TopoShape& shape = static_cast<Part::Feature*>(source)->Shape.getShape();
-    if (fabs(offset) > 2*tol)
-        this->Shape.setValue(shape.makeOffsetShape(offset, tol, inter, self, mode, join, fill));
+    if (fabs(offset) > 2*tol) {
+        ShapeCache& cache = ShapeCache::instance();
+        bool useCache = cache.isEnabled();
+        ShapeCache::Key key(getTypeId().getName());
+        ShapeCache::Result result;
+        if (useCache) {
+            key << shape.getShape() << offset << tol << inter << self << mode << join << fill;
+            if (cache.find(key, result)) {
+                this->Shape.setValue(result.shape);
+                return App::DocumentObject::StdReturn;
+            }
+        }
+        result.shape = shape.makeOffsetShape(offset, tol, inter, self, mode, join, fill);
+        this->Shape.setValue(result.shape);
+        if (useCache)
+            cache.insert(key, result);
+    }
     else
         this->Shape.setValue(shape);
     return App::DocumentObject::StdReturn;
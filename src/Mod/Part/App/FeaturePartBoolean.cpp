@@ -31,6 +31,7 @@
 
 #include "FeaturePartBoolean.h"
 #include "modelRefine.h"
+#include "ShapeCache.h"
 #include <App/Application.h>
 #include <Base/Parameter.h>
 
@@ -80,6 +81,25 @@ App::DocumentObjectExecReturn *Boolean::execute(void)
         if (ToolShape.IsNull())
             throw Base::Exception("Tool shape is null");
 
+        Base::Reference<ParameterGrp> hGrp = App::GetApplication().GetUserParameter()
+            .GetGroup("BaseApp")->GetGroup("Preferences")->GetGroup("Mod/Part/Boolean");
+        bool checkModel = hGrp->GetBool("CheckModel", false);
+        bool refineModel = hGrp->GetBool("RefineModel", false);
+
+        // the same operation on the same shapes gives the same result
+        ShapeCache& cache = ShapeCache::instance();
+        bool useCache = cache.isEnabled();
+        ShapeCache::Key key(getTypeId().getName());
+        if (useCache) {
+            key << BaseShape << ToolShape << checkModel << refineModel;
+            ShapeCache::Result cached;
+            if (cache.find(key, cached)) {
+                this->Shape.setValue(cached.shape);
+                this->History.setValues(cached.history);
+                return App::DocumentObject::StdReturn;
+            }
+        }
+
         std::unique_ptr<BRepAlgoAPI_BooleanOperation> mkBool(makeOperation(BaseShape, ToolShape));
         if (!mkBool->IsDone()) {
             return new App::DocumentObjectExecReturn("Boolean operation failed");
@@ -88,10 +108,7 @@ App::DocumentObjectExecReturn *Boolean::execute(void)
         if (resShape.IsNull()) {
             return new App::DocumentObjectExecReturn("Resulting shape is null");
         }
-        Base::Reference<ParameterGrp> hGrp = App::GetApplication().GetUserParameter()
-            .GetGroup("BaseApp")->GetGroup("Preferences")->GetGroup("Mod/Part/Boolean");
-
-        if (hGrp->GetBool("CheckModel", false)) {
+        if (checkModel) {
             BRepCheck_Analyzer aChecker(resShape);
             if (! aChecker.IsValid() ) {
                 return new App::DocumentObjectExecReturn("Resulting shape is invalid");
@@ -102,7 +119,7 @@ App::DocumentObjectExecReturn *Boolean::execute(void)
         history.push_back(buildHistory(*mkBool.get(), TopAbs_FACE, resShape, BaseShape));
         history.push_back(buildHistory(*mkBool.get(), TopAbs_FACE, resShape, ToolShape));
 
-        if (hGrp->GetBool("RefineModel", false)) {
+        if (refineModel) {
             try {
                 TopoDS_Shape oldShape = resShape;
                 BRepBuilderAPI_RefineModel mkRefine(oldShape);
@@ -118,6 +135,12 @@ App::DocumentObjectExecReturn *Boolean::execute(void)
 
         this->Shape.setValue(resShape);
         this->History.setValues(history);
+        if (useCache) {
+            ShapeCache::Result result;
+            result.shape = resShape;
+            result.history = history;
+            cache.insert(key, result);
+        }
         return App::DocumentObject::StdReturn;
     }
     catch (...) {
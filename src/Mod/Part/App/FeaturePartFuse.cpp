@@ -34,6 +34,7 @@
 
 #include "FeaturePartFuse.h"
 #include "modelRefine.h"
+#include "BooleanTree.h"
 #include <App/Application.h>
 #include <Base/Parameter.h>
 #include <Base/Exception.h>
@@ -134,22 +135,32 @@ App::DocumentObjectExecReturn *MultiFuse::execute(void)
                 }
             }
 #else
-            BRepAlgoAPI_Fuse mkFuse;
-            TopTools_ListOfShape shapeArguments,shapeTools;
-            shapeArguments.Append(s.front());
-            for (std::vector<TopoDS_Shape>::iterator it = s.begin()+1; it != s.end(); ++it) {
-                if (it->IsNull())
-                    throw Base::Exception("Input shape is null");
-                shapeTools.Append(*it);
+            TopoDS_Shape resShape;
+            if (BooleanTree::isEnabled(s.size())) {
+                // fuse clusters of nearby shapes concurrently
+                BooleanTree tree;
+                tree.setRecordHistory(true);
+                resShape = tree.fuse(s);
+                history = tree.getHistory();
             }
-            mkFuse.SetArguments(shapeArguments);
-            mkFuse.SetTools(shapeTools);
-            mkFuse.Build();
-            if (!mkFuse.IsDone())
-                throw Base::Exception("MultiFusion failed");
-            TopoDS_Shape resShape = mkFuse.Shape();
-            for (std::vector<TopoDS_Shape>::iterator it = s.begin(); it != s.end(); ++it) {
-                history.push_back(buildHistory(mkFuse, TopAbs_FACE, resShape, *it));
+            else {
+                BRepAlgoAPI_Fuse mkFuse;
+                TopTools_ListOfShape shapeArguments,shapeTools;
+                shapeArguments.Append(s.front());
+                for (std::vector<TopoDS_Shape>::iterator it = s.begin()+1; it != s.end(); ++it) {
+                    if (it->IsNull())
+                        throw Base::Exception("Input shape is null");
+                    shapeTools.Append(*it);
+                }
+                mkFuse.SetArguments(shapeArguments);
+                mkFuse.SetTools(shapeTools);
+                mkFuse.Build();
+                if (!mkFuse.IsDone())
+                    throw Base::Exception("MultiFusion failed");
+                resShape = mkFuse.Shape();
+                for (std::vector<TopoDS_Shape>::iterator it = s.begin(); it != s.end(); ++it) {
+                    history.push_back(buildHistory(mkFuse, TopAbs_FACE, resShape, *it));
+                }
             }
 #endif
             if (resShape.IsNull())
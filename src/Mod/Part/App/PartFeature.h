@@ -76,9 +76,9 @@ protected:
      * newS: The new shape that was created by the operation
      * oldS: The original shape prior to the operation
      */
-    ShapeHistory buildHistory(BRepBuilderAPI_MakeShape&, TopAbs_ShapeEnum type,
+    static ShapeHistory buildHistory(BRepBuilderAPI_MakeShape&, TopAbs_ShapeEnum type,
         const TopoDS_Shape& newS, const TopoDS_Shape& oldS);
-    ShapeHistory joinHistory(const ShapeHistory&, const ShapeHistory&);
+    static ShapeHistory joinHistory(const ShapeHistory&, const ShapeHistory&);
 };
 
 class FilletBase : public Part::Feature
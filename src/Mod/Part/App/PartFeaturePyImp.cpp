@@ -1 +1,72 @@
+/***************************************************************************
+ *   Copyright (c) 2007 Juergen Riegel <FreeCAD@juergen-riegel.net>        *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
 
+
+#include "PreCompiled.h"
+
+#include "PartFeature.h"
+#include "ShapeCache.h"
+
+// inclusion of the generated files (generated out of PartFeaturePy.xml)
+#include "PartFeaturePy.h"
+#include "PartFeaturePy.cpp"
+
+using namespace Part;
+
+// returns a string which represent the object e.g. when printed in python
+std::string PartFeaturePy::representation(void) const
+{
+    return std::string("<Part::PartFeature>");
+}
+
+PyObject* PartFeaturePy::getShapeCacheStatistics(PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return 0;
+
+    ShapeCache& cache = ShapeCache::instance();
+    Py::Dict dict;
+    dict.setItem("Hits", Py::Long((long)cache.getHits()));
+    dict.setItem("Misses", Py::Long((long)cache.getMisses()));
+    dict.setItem("Size", Py::Long((long)cache.size()));
+    dict.setItem("MaxSize", Py::Long((long)cache.getMaxSize()));
+    return Py::new_reference_to(dict);
+}
+
+PyObject* PartFeaturePy::clearShapeCache(PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return 0;
+
+    ShapeCache::instance().clear();
+    Py_Return;
+}
+
+PyObject *PartFeaturePy::getCustomAttributes(const char* ) const
+{
+    return 0;
+}
+
+int PartFeaturePy::setCustomAttributes(const char* , PyObject *)
+{
+    return 0; 
+}
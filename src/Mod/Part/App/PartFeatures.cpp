@@ -46,6 +46,7 @@
 
 
 #include "PartFeatures.h"
+#include "ShapeCache.h"
 
 
 using namespace Part;
@@ -281,8 +282,25 @@ App::DocumentObjectExecReturn *Loft::execute(void)
         Standard_Boolean isRuled = Ruled.getValue() ? Standard_True : Standard_False;
         Standard_Boolean isClosed = Closed.getValue() ? Standard_True : Standard_False;
 
+        ShapeCache& cache = ShapeCache::instance();
+        bool useCache = cache.isEnabled();
+        ShapeCache::Key key(getTypeId().getName());
+        ShapeCache::Result result;
+        if (useCache) {
+            for (it = shapes.begin(); it != shapes.end(); ++it)
+                key << static_cast<Part::Feature*>(*it)->Shape.getValue();
+            key << isSolid << isRuled << isClosed;
+            if (cache.find(key, result)) {
+                this->Shape.setValue(result.shape);
+                return App::DocumentObject::StdReturn;
+            }
+        }
+
         TopoShape myShape;
-        this->Shape.setValue(myShape.makeLoft(profiles, isSolid, isRuled,isClosed));
+        result.shape = myShape.makeLoft(profiles, isSolid, isRuled,isClosed);
+        this->Shape.setValue(result.shape);
+        if (useCache)
+            cache.insert(key, result);
         return App::DocumentObject::StdReturn;
     }
     catch (Standard_Failure) {
@@ -556,8 +574,25 @@ App::DocumentObjectExecReturn *Thickness::execute(void)
     short mode = (short)Mode.getValue();
     short join = (short)Join.getValue();
 
-    if (fabs(thickness) > 2*tol)
-        this->Shape.setValue(shape.makeThickSolid(closingFaces, thickness, tol, inter, self, mode, join));
+    if (fabs(thickness) > 2*tol) {
+        ShapeCache& cache = ShapeCache::instance();
+        bool useCache = cache.isEnabled();
+        ShapeCache::Key key(getTypeId().getName());
+        ShapeCache::Result result;
+        if (useCache) {
+            key << shape.getShape() << thickness << tol << inter << self << mode << join;
+            for (std::vector<std::string>::const_iterator it = subStrings.begin(); it != subStrings.end(); ++it)
+                key << *it;
+            if (cache.find(key, result)) {
+                this->Shape.setValue(result.shape);
+                return App::DocumentObject::StdReturn;
+            }
+        }
+        result.shape = shape.makeThickSolid(closingFaces, thickness, tol, inter, self, mode, join);
+        this->Shape.setValue(result.shape);
+        if (useCache)
+            cache.insert(key, result);
+    }
     else
         this->Shape.setValue(shape);
     return App::DocumentObject::StdReturn;
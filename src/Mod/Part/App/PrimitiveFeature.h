@@ -44,6 +44,10 @@ public:
     /// recalculate the feature
     App::DocumentObjectExecReturn *execute(void);
     short mustExecute() const;
+    /// primitives only depend on their own parameters and attachment
+    bool canRecomputeConcurrently(void) const {
+        return true;
+    }
     //@}
 
 protected:
@@ -24,6 +24,7 @@
 #include "PreCompiled.h"
 
 #ifndef _PreComp_
+# include <cstring>
 # include <sstream>
 # include <BRepAdaptor_Curve.hxx>
 # include <BRepAdaptor_Surface.hxx>
@@ -33,6 +34,8 @@
 # include <BRepTools.hxx>
 # include <BRepTools_ShapeSet.hxx>
 # include <BRepBuilderAPI_Copy.hxx>
+# include <BRep_Tool.hxx>
+# include <TopTools_IndexedMapOfShape.hxx>
 # include <TopTools_HSequenceOfShape.hxx>
 # include <TopTools_MapOfShape.hxx>
 # include <TopoDS.hxx>
@@ -57,9 +60,48 @@
 
 using namespace Part;
 
+// A hash of the shape that only depends on its content and not on the session.
+// It's used to check that a triangulation read from a project file belongs to
+// the shape. The coordinates are hashed with single precision because the
+// BRep format doesn't write them with full precision.
+static unsigned long shapeHash(const TopoDS_Shape& shape)
+{
+    TopTools_IndexedMapOfShape faces, edges, vertexes;
+    TopExp::MapShapes(shape, TopAbs_FACE, faces);
+    TopExp::MapShapes(shape, TopAbs_EDGE, edges);
+    TopExp::MapShapes(shape, TopAbs_VERTEX, vertexes);
+
+    std::vector<unsigned long> words;
+    words.reserve(3 + 3 * vertexes.Extent());
+    words.push_back(faces.Extent());
+    words.push_back(edges.Extent());
+    words.push_back(vertexes.Extent());
+    for (int i=1; i<=vertexes.Extent(); i++) {
+        gp_Pnt p = BRep_Tool::Pnt(TopoDS::Vertex(vertexes(i)));
+        float xyz[3] = { (float)p.X(), (float)p.Y(), (float)p.Z() };
+        for (int j=0; j<3; j++) {
+            unsigned int bits;
+            memcpy(&bits, &xyz[j], sizeof(bits));
+            words.push_back(bits);
+        }
+    }
+
+    // 32 bit FNV-1a
+    unsigned long hash = 2166136261UL;
+    for (std::vector<unsigned long>::iterator it = words.begin(); it != words.end(); ++it) {
+        for (int j=0; j<4; j++) {
+            hash ^= (*it >> (8 * j)) & 0xff;
+            hash = (hash * 16777619UL) & 0xffffffffUL;
+        }
+    }
+    return hash;
+}
+
 TYPESYSTEM_SOURCE(Part::PropertyPartShape , App::PropertyComplexGeoData);
 
 PropertyPartShape::PropertyPartShape()
+  : _TriaDeviation(0), _TriaAngularDeflection(0), _TriaValid(false)
+  , _RestoreHash(0), _RestoreTriangulation(false)
 {
 }
 
@@ -70,34 +112,42 @@ PropertyPartShape::~PropertyPartShape()
 void PropertyPartShape::setValue(const TopoShape& sh)
 {
     aboutToSetValue();
+    discardDeferred();
     _Shape = sh;
+    _TriaValid = false;
     hasSetValue();
 }
 
 void PropertyPartShape::setValue(const TopoDS_Shape& sh)
 {
     aboutToSetValue();
+    discardDeferred();
     _Shape.setShape(sh);
+    _TriaValid = false;
     hasSetValue();
 }
 
 const TopoDS_Shape& PropertyPartShape::getValue(void)const 
 {
+    restoreDeferred();
     return _Shape.getShape();
 }
 
 const TopoShape& PropertyPartShape::getShape() const
 {
+    restoreDeferred();
     return this->_Shape;
 }
 
 const Data::ComplexGeoData* PropertyPartShape::getComplexData() const
 {
+    restoreDeferred();
     return &(this->_Shape);
 }
 
 Base::BoundBox3d PropertyPartShape::getBoundingBox() const
 {
+    restoreDeferred();
     Base::BoundBox3d box;
     if (_Shape.getShape().IsNull())
         return box;
@@ -124,13 +174,16 @@ Base::BoundBox3d PropertyPartShape::getBoundingBox() const
 
 void PropertyPartShape::transformGeometry(const Base::Matrix4D &rclTrf)
 {
+    restoreDeferred();
     aboutToSetValue();
     _Shape.transformGeometry(rclTrf);
+    _TriaValid = false;
     hasSetValue();
 }
 
 App::Property *PropertyPartShape::Copy(void) const
 {
+    restoreDeferred();
     PropertyPartShape *prop = new PropertyPartShape();
     prop->_Shape = this->_Shape;
     if (!_Shape.getShape().IsNull()) {
@@ -144,12 +197,18 @@ App::Property *PropertyPartShape::Copy(void) const
 void PropertyPartShape::Paste(const App::Property &from)
 {
     aboutToSetValue();
-    _Shape = dynamic_cast<const PropertyPartShape&>(from)._Shape;
+    discardDeferred();
+    const PropertyPartShape& prop = dynamic_cast<const PropertyPartShape&>(from);
+    _Shape = prop._Shape;
+    _TriaDeviation = prop._TriaDeviation;
+    _TriaAngularDeflection = prop._TriaAngularDeflection;
+    _TriaValid = prop._TriaValid;
     hasSetValue();
 }
 
 unsigned int PropertyPartShape::getMemSize (void) const
 {
+    restoreDeferred();
     return _Shape.getMemSize();
 }
 
@@ -167,15 +226,61 @@ void PropertyPartShape::getPaths(std::vector<App::ObjectIdentifier> &paths) cons
                     << App::ObjectIdentifier::Component::SimpleComponent(App::ObjectIdentifier::String("Volume")));
 }
 
+void PropertyPartShape::setTriangulationParameters(double deviation, double angularDeflection)
+{
+    _TriaDeviation = deviation;
+    _TriaAngularDeflection = angularDeflection;
+    _TriaValid = true;
+}
+
+bool PropertyPartShape::getTriangulationParameters(double& deviation, double& angularDeflection) const
+{
+    restoreDeferred();
+    deviation = _TriaDeviation;
+    angularDeflection = _TriaAngularDeflection;
+    return _TriaValid;
+}
+
+bool PropertyPartShape::saveTriangulation(Base::Writer &writer) const
+{
+    // Only the BRep format stores the triangulation, the binary format of
+    // older OCC versions doesn't.
+    if (!_TriaValid || writer.getMode("BinaryBrep") || _Shape.getShape().IsNull())
+        return false;
+    return App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Mod/Part/General")->GetBool("SaveTriangulation", false);
+}
+
+bool PropertyPartShape::saveBinary(Base::Writer &writer) const
+{
+    if (writer.getMode("BinaryBrep"))
+        return true;
+    // The binary format is much faster to read and write. But a saved triangulation
+    // saves more time when opening the document, so such a shape stays in BRep format.
+    if (!App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Mod/Part/General")->GetBool("SaveBinaryBrep", false))
+        return false;
+    return !saveTriangulation(writer);
+}
+
 void PropertyPartShape::Save (Base::Writer &writer) const
 {
     if(!writer.isForceXML()) {
         //See SaveDocFile(), RestoreDocFile()
-        if (writer.getMode("BinaryBrep")) {
+        if (saveBinary(writer)) {
             writer.Stream() << writer.ind() << "<Part file=\"" 
                             << writer.addFile("PartShape.bin", this)
                             << "\"/>" << std::endl;
         }
+        else if (saveTriangulation(writer)) {
+            // the triangulation is written with the shape, see SaveDocFile()
+            writer.Stream() << writer.ind() << "<Part file=\"" 
+                            << writer.addFile("PartShape.brp", this)
+                            << "\" deviation=\"" << _TriaDeviation
+                            << "\" angularDeflection=\"" << _TriaAngularDeflection
+                            << "\" hash=\"" << shapeHash(_Shape.getShape())
+                            << "\"/>" << std::endl;
+        }
         else {
             writer.Stream() << writer.ind() << "<Part file=\"" 
                             << writer.addFile("PartShape.brp", this)
@@ -189,6 +294,13 @@ void PropertyPartShape::Restore(Base::XMLReader &reader)
     reader.readElement("Part");
     std::string file (reader.getAttribute("file") );
 
+    _RestoreTriangulation = reader.hasAttribute("hash");
+    if (_RestoreTriangulation) {
+        _TriaDeviation = reader.getAttributeAsFloat("deviation");
+        _TriaAngularDeflection = reader.getAttributeAsFloat("angularDeflection");
+        _RestoreHash = reader.getAttributeAsUnsigned("hash");
+    }
+
     if (!file.empty()) {
         // initate a file read
         reader.addFile(file.c_str(),this);
@@ -197,17 +309,25 @@ void PropertyPartShape::Restore(Base::XMLReader &reader)
 
 void PropertyPartShape::SaveDocFile (Base::Writer &writer) const
 {
+    restoreDeferred();
     // If the shape is empty we simply store nothing. The file size will be 0 which
     // can be checked when reading in the data.
     if (_Shape.getShape().IsNull())
         return;
-    // NOTE: Cleaning the triangulation may cause problems on some algorithms like BOP
-    // Before writing to the project we clean all triangulation data to save memory
-    BRepBuilderAPI_Copy copy(_Shape.getShape());
-    const TopoDS_Shape& myShape = copy.Shape();
-    BRepTools::Clean(myShape); // remove triangulation
+    TopoDS_Shape myShape;
+    if (saveTriangulation(writer)) {
+        // keep the triangulation so that it doesn't need to be computed again
+        myShape = _Shape.getShape();
+    }
+    else {
+        // NOTE: Cleaning the triangulation may cause problems on some algorithms like BOP
+        // Before writing to the project we clean all triangulation data to save memory
+        BRepBuilderAPI_Copy copy(_Shape.getShape());
+        myShape = copy.Shape();
+        BRepTools::Clean(myShape); // remove triangulation
+    }
 
-    if (writer.getMode("BinaryBrep")) {
+    if (saveBinary(writer)) {
         TopoShape shape;
         shape.setShape(myShape);
         shape.exportBinary(writer.Stream());
@@ -273,8 +393,10 @@ void PropertyPartShape::RestoreDocFile(Base::Reader &reader)
 {
     Base::FileInfo brep(reader.getFileName());
     if (brep.hasExtension("bin")) {
+        // the file of an empty shape is empty
         TopoShape shape;
-        shape.importBinary(reader);
+        if (reader.peek() != EOF)
+            shape.importBinary(reader);
         setValue(shape);
     }
     else {
@@ -328,6 +450,15 @@ void PropertyPartShape::RestoreDocFile(Base::Reader &reader)
             setValue(shape);
         }
     }
+
+    // a triangulation saved with the shape is only used if it still belongs to it
+    if (_RestoreTriangulation) {
+        _RestoreTriangulation = false;
+        if (shapeHash(_Shape.getShape()) == _RestoreHash)
+            _TriaValid = true;
+        else
+            BRepTools::Clean(_Shape.getShape());
+    }
 }
 
 // -------------------------------------------------------------------------
@@ -80,13 +80,37 @@ public:
     App::Property *Copy(void) const;
     void Paste(const App::Property &from);
     unsigned int getMemSize (void) const;
+    /// the shape is read on first access if the document is opened with lazy loading
+    bool canRestoreDeferred(void) const { return true; }
     //@}
 
     /// Get valid paths for this property; used by auto completer
     virtual void getPaths(std::vector<App::ObjectIdentifier> & paths) const;
 
+    /** @name Triangulation */
+    //@{
+    /** Sets the parameters the triangulation of the shape has been created with.
+     * The view provider calls this after it has meshed the shape. With the
+     * SaveTriangulation preference the triangulation is then saved together with
+     * the shape and reused when the document is opened again. Any modification
+     * of the shape resets the parameters.
+     */
+    void setTriangulationParameters(double deviation, double angularDeflection);
+    /// Returns false if the triangulation of the shape has unknown parameters
+    bool getTriangulationParameters(double& deviation, double& angularDeflection) const;
+    //@}
+
 private:
+    bool saveTriangulation(Base::Writer &writer) const;
+    bool saveBinary(Base::Writer &writer) const;
+
     TopoShape _Shape;
+    double _TriaDeviation;
+    double _TriaAngularDeflection;
+    bool _TriaValid;
+    // the triangulation parameters read by Restore() are checked by RestoreDocFile()
+    unsigned long _RestoreHash;
+    bool _RestoreTriangulation;
 };
 
 struct PartExport ShapeHistory {
@@ -0,0 +1,205 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+
+#include "PreCompiled.h"
+#ifndef _PreComp_
+# include <iomanip>
+# include <BRepTools_ShapeSet.hxx>
+# include <QMutexLocker>
+#endif
+
+#include <stdint.h>
+
+#include <App/Application.h>
+
+#include "ShapeCache.h"
+
+using namespace Part;
+
+ShapeCache::Key::Key(const char* operation)
+{
+    str.precision(17);
+    str << operation;
+}
+
+ShapeCache::Key& ShapeCache::Key::operator << (const TopoDS_Shape& shape)
+{
+    str << ';' << ShapeCache::instance().hashShape(shape);
+    return *this;
+}
+
+std::string ShapeCache::Key::toString() const
+{
+    return str.str();
+}
+
+// ----------------------------------------------------------------------------
+
+ShapeCache& ShapeCache::instance()
+{
+    static ShapeCache cache;
+    return cache;
+}
+
+ShapeCache::ShapeCache()
+  : maxSize(0), hits(0), misses(0)
+{
+}
+
+ShapeCache::~ShapeCache()
+{
+}
+
+bool ShapeCache::isEnabled()
+{
+    long size = App::GetApplication().GetParameterGroupByPath
+        ("User parameter:BaseApp/Preferences/Mod/Part/General")->GetInt("ShapeCacheSize", 0);
+    setMaxSize(size > 0 ? static_cast<std::size_t>(size) : 0);
+    return size > 0;
+}
+
+void ShapeCache::setMaxSize(std::size_t size)
+{
+    QMutexLocker lock(&mutex);
+    maxSize = size;
+    while (entries.size() > maxSize) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    // an input shape is usually needed by one or two operations
+    while (hashes.size() > 4 * maxSize)
+        hashes.pop_back();
+}
+
+bool ShapeCache::find(const Key& key, Result& result)
+{
+    std::string str = key.toString();
+    QMutexLocker lock(&mutex);
+    std::map<std::string, std::list<Entry>::iterator>::iterator it = index.find(str);
+    if (it == index.end()) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->second;
+    return true;
+}
+
+void ShapeCache::insert(const Key& key, const Result& result)
+{
+    std::string str = key.toString();
+    QMutexLocker lock(&mutex);
+    if (maxSize == 0)
+        return;
+
+    std::map<std::string, std::list<Entry>::iterator>::iterator it = index.find(str);
+    if (it != index.end()) {
+        it->second->second = result;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    entries.push_front(Entry(str, result));
+    index[str] = entries.begin();
+    while (entries.size() > maxSize) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void ShapeCache::clear()
+{
+    QMutexLocker lock(&mutex);
+    entries.clear();
+    index.clear();
+    hashes.clear();
+    hits = 0;
+    misses = 0;
+}
+
+std::string ShapeCache::hashShape(const TopoDS_Shape& shape)
+{
+    if (shape.IsNull())
+        return std::string("0");
+
+    {
+        QMutexLocker lock(&mutex);
+        for (std::list<std::pair<TopoDS_Shape, std::string> >::iterator it = hashes.begin(); it != hashes.end(); ++it) {
+            if (it->first.IsEqual(shape)) {
+                hashes.splice(hashes.begin(), hashes, it);
+                return hashes.front().second;
+            }
+        }
+    }
+
+    // The BRep format without triangulation describes the shape completely,
+    // so a copy of it, e.g. made by the undo of a document, gets the same hash.
+    std::ostringstream str;
+    BRepTools_ShapeSet shapeSet(Standard_False);
+    shapeSet.Add(shape);
+    shapeSet.Write(str);
+    shapeSet.Write(shape, str);
+    std::string data = str.str();
+
+    // 64 bit FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::string::const_iterator it = data.begin(); it != data.end(); ++it) {
+        hash ^= static_cast<unsigned char>(*it);
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream hex;
+    hex << std::hex << std::setfill('0') << std::setw(16) << hash << '-' << data.size();
+    std::string key = hex.str();
+
+    QMutexLocker lock(&mutex);
+    hashes.push_front(std::make_pair(shape, key));
+    while (hashes.size() > 4 * maxSize)
+        hashes.pop_back();
+    return key;
+}
+
+std::size_t ShapeCache::size() const
+{
+    QMutexLocker lock(&mutex);
+    return entries.size();
+}
+
+std::size_t ShapeCache::getMaxSize() const
+{
+    QMutexLocker lock(&mutex);
+    return maxSize;
+}
+
+unsigned long ShapeCache::getHits() const
+{
+    QMutexLocker lock(&mutex);
+    return hits;
+}
+
+unsigned long ShapeCache::getMisses() const
+{
+    QMutexLocker lock(&mutex);
+    return misses;
+}
@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (c) 2017 FreeCAD Developers                                 *
+ *                                                                         *
+ *   This file is part of the FreeCAD CAx development system.              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or         *
+ *   modify it under the terms of the GNU Library General Public           *
+ *   License as published by the Free Software Foundation; either          *
+ *   version 2 of the License, or (at your option) any later version.      *
+ *                                                                         *
+ *   This library  is distributed in the hope that it will be useful,      *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU Library General Public License for more details.                  *
+ *                                                                         *
+ *   You should have received a copy of the GNU Library General Public     *
+ *   License along with this library; see the file COPYING.LIB. If not,    *
+ *   write to the Free Software Foundation, Inc., 59 Temple Place,         *
+ *   Suite 330, Boston, MA  02111-1307, USA                                *
+ *                                                                         *
+ ***************************************************************************/
+
+
+#ifndef PART_SHAPECACHE_H
+#define PART_SHAPECACHE_H
+
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <QMutex>
+#include <TopoDS_Shape.hxx>
+#include "PropertyTopoShape.h"
+
+namespace Part {
+
+/** A cache of the results of expensive shape operations.
+ * A feature builds a key from the name of its operation, the content of its
+ * input shapes and its parameters and looks it up in execute() before it runs
+ * OCC. Identical inputs, e.g. after an undo/redo cycle, then give back the
+ * previous result. The cache keeps the least recently used results up to the
+ * number set with the ShapeCacheSize preference of Mod/Part/General, the
+ * default 0 disables it.
+ *
+ * The cache is shared by all documents and may be used from several threads.
+ */
+class PartExport ShapeCache
+{
+public:
+    /// The result of a cached operation
+    struct Result {
+        TopoDS_Shape shape;
+        std::vector<ShapeHistory> history;
+    };
+
+    /// The key of an operation
+    class PartExport Key
+    {
+    public:
+        explicit Key(const char* operation);
+        /// Adds the content of a shape
+        Key& operator << (const TopoDS_Shape&);
+        /// Adds a parameter
+        template <typename T>
+        Key& operator << (const T& value) {
+            str << ';' << value;
+            return *this;
+        }
+        std::string toString() const;
+
+    private:
+        std::ostringstream str;
+    };
+
+    static ShapeCache& instance();
+
+    /// Reads the size from the preferences and returns false if the cache is disabled
+    bool isEnabled();
+    /// Returns true and the result if the key is in the cache
+    bool find(const Key&, Result&);
+    void insert(const Key&, const Result&);
+    void clear();
+
+    /// Returns a hash of the shape that doesn't depend on its triangulation
+    std::string hashShape(const TopoDS_Shape&);
+
+    /** @name Statistics */
+    //@{
+    std::size_t size() const;
+    std::size_t getMaxSize() const;
+    unsigned long getHits() const;
+    unsigned long getMisses() const;
+    //@}
+
+private:
+    ShapeCache();
+    ~ShapeCache();
+    void setMaxSize(std::size_t);
+
+    typedef std::pair<std::string, Result> Entry;
+    std::list<Entry> entries;
+    std::map<std::string, std::list<Entry>::iterator> index;
+    // the hashes of recently used input shapes
+    std::list<std::pair<TopoDS_Shape, std::string> > hashes;
+    std::size_t maxSize;
+    unsigned long hits;
+    unsigned long misses;
+    mutable QMutex mutex;
+};
+
+}
+
+#endif // PART_SHAPECACHE_H
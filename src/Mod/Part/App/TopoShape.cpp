@@ -181,6 +181,7 @@
 
 #include "TopoShape.h"
 #include "CrossSection.h"
+#include "BooleanTree.h"
 #include "ProgressIndicator.h"
 #include "modelRefine.h"
 #include "Tools.h"
@@ -1392,11 +1393,22 @@ TopoDS_Shape TopoShape::cut(const std::vector<TopoDS_Shape>& shapes, Standard_Re
     (void)tolerance;
     throw Base::RuntimeError("Multi cut is available only in OCC 6.9.0 and up.");
 #else
+    // cutting with many tools is the same as cutting with their union
+    std::vector<TopoDS_Shape> tools;
+    if (BooleanTree::isEnabled(shapes.size())) {
+        BooleanTree tree;
+        tree.setTolerance(tolerance);
+        tools.push_back(tree.fuse(shapes));
+    }
+    else {
+        tools = shapes;
+    }
+
     BRepAlgoAPI_Cut mkCut;
     mkCut.SetRunParallel(true);
     TopTools_ListOfShape shapeArguments,shapeTools;
     shapeArguments.Append(this->_Shape);
-    for (std::vector<TopoDS_Shape>::const_iterator it = shapes.begin(); it != shapes.end(); ++it) {
+    for (std::vector<TopoDS_Shape>::const_iterator it = tools.begin(); it != tools.end(); ++it) {
         if (it->IsNull())
             throw Base::ValueError("Tool shape is null");
         if (tolerance > 0.0)
@@ -1438,11 +1450,22 @@ TopoDS_Shape TopoShape::common(const std::vector<TopoDS_Shape>& shapes, Standard
     (void)tolerance;
     throw Base::RuntimeError("Multi common is available only in OCC 6.9.0 and up.");
 #else
+    // the group of tools acts as their union
+    std::vector<TopoDS_Shape> tools;
+    if (BooleanTree::isEnabled(shapes.size())) {
+        BooleanTree tree;
+        tree.setTolerance(tolerance);
+        tools.push_back(tree.fuse(shapes));
+    }
+    else {
+        tools = shapes;
+    }
+
     BRepAlgoAPI_Common mkCommon;
     mkCommon.SetRunParallel(true);
     TopTools_ListOfShape shapeArguments,shapeTools;
     shapeArguments.Append(this->_Shape);
-    for (std::vector<TopoDS_Shape>::const_iterator it = shapes.begin(); it != shapes.end(); ++it) {
+    for (std::vector<TopoDS_Shape>::const_iterator it = tools.begin(); it != tools.end(); ++it) {
         if (it->IsNull())
             throw Base::ValueError("Tool shape is null");
         if (tolerance > 0.0)
@@ -1496,6 +1519,21 @@ TopoDS_Shape TopoShape::fuse(const std::vector<TopoDS_Shape>& shapes, Standard_R
         resShape = mkFuse.Shape();
     }
 #else
+# if OCC_VERSION_HEX >= 0x060900
+    if (BooleanTree::isEnabled(shapes.size() + 1)) {
+        std::vector<TopoDS_Shape> operands;
+        operands.push_back(this->_Shape);
+        for (std::vector<TopoDS_Shape>::const_iterator it = shapes.begin(); it != shapes.end(); ++it) {
+            if (it->IsNull())
+                throw Base::Exception("Tool shape is null");
+            operands.push_back(*it);
+        }
+        BooleanTree tree;
+        tree.setTolerance(tolerance);
+        return tree.fuse(operands);
+    }
+# endif
+
     BRepAlgoAPI_Fuse mkFuse;
 # if OCC_VERSION_HEX >= 0x060900
     mkFuse.SetRunParallel(true);
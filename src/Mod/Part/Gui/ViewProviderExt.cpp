@@ -93,8 +93,13 @@
 # include <Inventor/nodes/SoSphere.h>
 # include <Inventor/nodes/SoScale.h>
 # include <Inventor/nodes/SoLightModel.h>
+# include <Inventor/sensors/SoTimerSensor.h>
 # include <QAction>
+# include <QFuture>
 # include <QMenu>
+# include <QMutex>
+# include <QtConcurrentMap>
+# include <QtConcurrentRun>
 #endif
 
 /// Here the FreeCAD includes sorted by Base,App,Gui......
@@ -305,12 +310,25 @@ ViewProviderPartExt::ViewProviderPartExt()
     Lighting.touch();
     DrawStyle.touch();
 
+    tessellationSensor = new SoTimerSensor(tessellationSensorCB, this);
+    tessellationSensor->setInterval(SbTime(0.05));
+    currentJob = 0;
+    sharedGeometry = 0;
+    pcFlatRoot = 0;
+
     sPixmap = "Tree_Part";
     loadParameter();
 }
 
 ViewProviderPartExt::~ViewProviderPartExt()
 {
+    tessellationSensor->unschedule();
+    delete tessellationSensor;
+    for (std::vector<TessellationJob*>::iterator it = tessellationJobs.begin(); it != tessellationJobs.end(); ++it) {
+        (*it)->future.waitForFinished();
+        delete *it;
+    }
+
     pcFaceBind->unref();
     pcLineBind->unref();
     pcPointBind->unref();
@@ -319,6 +337,7 @@ ViewProviderPartExt::~ViewProviderPartExt()
     pcLineStyle->unref();
     pcPointStyle->unref();
     pShapeHints->unref();
+    releaseSharedGeometry();
     coords->unref();
     faceset->unref();
     norm->unref();
@@ -457,7 +476,7 @@ void ViewProviderPartExt::attach(App::DocumentObject *pcFeat)
 
     // Workaround for #0000433, i.e. use SoSeparator instead of SoGroup
     SoGroup* pcNormalRoot = new SoSeparator();
-    SoGroup* pcFlatRoot = new SoSeparator();
+    pcFlatRoot = new SoSeparator();
     SoGroup* pcWireframeRoot = new SoSeparator();
     SoGroup* pcPointsRoot = new SoSeparator();
 
@@ -544,7 +563,8 @@ std::vector<std::string> ViewProviderPartExt::getDisplayModes(void) const
 std::string ViewProviderPartExt::getElement(const SoDetail* detail) const
 {
     std::stringstream str;
-    if (detail) {
+    // the placeholder of a running tessellation has no elements
+    if (detail && !currentJob) {
         if (detail->getTypeId() == SoFaceDetail::getClassTypeId()) {
             const SoFaceDetail* face_detail = static_cast<const SoFaceDetail*>(detail);
             int face = face_detail->getPartIndex() + 1;
@@ -783,6 +803,8 @@ bool ViewProviderPartExt::loadParameter()
     float angularDeflection = hGrp->GetFloat("MeshAngularDeflection",28.65);
     bool novertexnormals = hGrp->GetBool("NoPerVertexNormals",false);
     bool qualitynormals = hGrp->GetBool("QualityNormals",false);
+    this->backgroundTessellation = hGrp->GetBool("BackgroundTessellation",false);
+    this->instancedRendering = hGrp->GetBool("InstancedRendering",false);
 
     if (Deviation.getValue() != deviation) {
         Deviation.setValue(deviation);
@@ -870,6 +892,186 @@ void ViewProviderPartExt::unsetEdit(int ModNum)
     }
 }
 
+// ----------------------------------------------------------------------------
+
+/// The Inventor data of a shape as computed by ViewProviderPartExt::tessellate()
+struct ViewProviderPartExt::ShapeVisual
+{
+    std::vector<SbVec3f> verts;
+    std::vector<SbVec3f> norms;
+    std::vector<int32_t> faces;
+    std::vector<int32_t> parts;
+    std::vector<int32_t> lines;
+    int nodeStart;
+    bool failed;
+    // book keeping
+    int numTriangles, numNodes, numFaces, numEdges, numLines;
+
+    ShapeVisual() : nodeStart(0), failed(false), numTriangles(0), numNodes(0),
+        numFaces(0), numEdges(0), numLines(0)
+    {
+    }
+};
+
+/// Tessellation of a shape running on a worker thread
+struct ViewProviderPartExt::TessellationJob
+{
+    TopoDS_Shape shape;
+    Standard_Real deflection;
+    Standard_Real angularDeflection;
+    bool cleanMesh;
+    bool share;
+    ShapeVisual visual;
+    QFuture<void> future;
+};
+
+/// The geometry nodes of a shape shown by several view providers
+struct ViewProviderPartExt::SharedGeometry
+{
+    // without location, keeps the TShape alive so that its address stays unique
+    TopoDS_Shape shape;
+    Standard_Real deflection;
+    Standard_Real angularDeflection;
+    bool noPerVertexNormals;
+    bool qualityNormals;
+    SoCoordinate3* coords;
+    SoNormal* norm;
+    // the index arrays belong to the nodes of each view provider because of the selection
+    std::vector<int32_t> faces;
+    std::vector<int32_t> parts;
+    std::vector<int32_t> lines;
+    int nodeStart;
+    int users;
+};
+
+std::multimap<const Standard_Transient*, ViewProviderPartExt::SharedGeometry*>
+    ViewProviderPartExt::sharedGeometries;
+
+/// The triangulation of a face and where it goes into the Inventor arrays
+struct ViewProviderPartExt::FaceTriangulation
+{
+    TopoDS_Face face;
+    Handle(Poly_Triangulation) mesh;
+    TopLoc_Location loc;
+    int nodeOffset;
+    int triaOffset;
+};
+
+/// Adds the per-node normals to a triangulation. As instances of a face share
+/// the triangulation this must be done once for each before the faces are filled
+/// in concurrently.
+class ViewProviderPartExt::FaceNormals
+{
+public:
+    typedef void result_type;
+    FaceNormals(ViewProviderPartExt* vp) : vp(vp)
+    {
+    }
+    void operator()(const FaceTriangulation& f) const
+    {
+        const TColgp_Array1OfPnt& Nodes = f.mesh->Nodes();
+        TColgp_Array1OfDir Normals (Nodes.Lower(), Nodes.Upper());
+        vp->GetNormals(f.face, f.mesh, Normals);
+    }
+private:
+    ViewProviderPartExt* vp;
+};
+
+/// Fills in the nodes, normals and triangles of a face. The faces write to
+/// disjoint ranges of the arrays.
+class ViewProviderPartExt::FaceFiller
+{
+public:
+    typedef void result_type;
+    FaceFiller(ViewProviderPartExt* vp, ShapeVisual* visual) : vp(vp), visual(visual)
+    {
+    }
+    void operator()(const FaceTriangulation& f) const
+    {
+        SbVec3f* verts = visual->verts.empty() ? 0 : &visual->verts[0];
+        SbVec3f* norms = visual->norms.empty() ? 0 : &visual->norms[0];
+        int32_t* index = visual->faces.empty() ? 0 : &visual->faces[0];
+        const Handle(Poly_Triangulation)& mesh = f.mesh;
+
+        // getting the transformation of the shape/face
+        gp_Trsf myTransf;
+        Standard_Boolean identity = true;
+        if (!f.loc.IsIdentity()) {
+            identity = false;
+            myTransf = f.loc.Transformation();
+        }
+
+        int nbTriInFace = mesh->NbTriangles();
+        int faceNodeOffset = f.nodeOffset;
+        int faceTriaOffset = f.triaOffset;
+        // check orientation
+        TopAbs_Orientation orient = f.face.Orientation();
+
+        // cycling through the poly mesh
+        const Poly_Array1OfTriangle& Triangles = mesh->Triangles();
+        const TColgp_Array1OfPnt& Nodes = mesh->Nodes();
+        TColgp_Array1OfDir Normals (Nodes.Lower(), Nodes.Upper());
+        vp->GetNormals(f.face, mesh, Normals);
+
+        for (int g=1;g<=nbTriInFace;g++) {
+            // Get the triangle
+            Standard_Integer N1,N2,N3;
+            Triangles(g).Get(N1,N2,N3);
+
+            // change orientation of the triangle if the face is reversed
+            if ( orient != TopAbs_FORWARD ) {
+                Standard_Integer tmp = N1;
+                N1 = N2;
+                N2 = tmp;
+            }
+
+            // get the 3 points of this triangle
+            gp_Pnt V1(Nodes(N1)), V2(Nodes(N2)), V3(Nodes(N3));
+
+            // get the 3 normals of this triangle
+            gp_Dir NV1(Normals(N1)), NV2(Normals(N2)), NV3(Normals(N3));
+
+            // transform the vertices and normals to the place of the face
+            if(!identity) {
+                V1.Transform(myTransf);
+                V2.Transform(myTransf);
+                V3.Transform(myTransf);
+                NV1.Transform(myTransf);
+                NV2.Transform(myTransf);
+                NV3.Transform(myTransf);
+            }
+
+            // add the normals for all points of this triangle
+            norms[faceNodeOffset+N1-1] += SbVec3f(NV1.X(),NV1.Y(),NV1.Z());
+            norms[faceNodeOffset+N2-1] += SbVec3f(NV2.X(),NV2.Y(),NV2.Z());
+            norms[faceNodeOffset+N3-1] += SbVec3f(NV3.X(),NV3.Y(),NV3.Z());
+
+            // set the vertices
+            verts[faceNodeOffset+N1-1].setValue((float)(V1.X()),(float)(V1.Y()),(float)(V1.Z()));
+            verts[faceNodeOffset+N2-1].setValue((float)(V2.X()),(float)(V2.Y()),(float)(V2.Z()));
+            verts[faceNodeOffset+N3-1].setValue((float)(V3.X()),(float)(V3.Y()),(float)(V3.Z()));
+
+            // set the index vector with the 3 point indexes and the end delimiter
+            index[faceTriaOffset*4+4*(g-1)]   = faceNodeOffset+N1-1;
+            index[faceTriaOffset*4+4*(g-1)+1] = faceNodeOffset+N2-1;
+            index[faceTriaOffset*4+4*(g-1)+2] = faceNodeOffset+N3-1;
+            index[faceTriaOffset*4+4*(g-1)+3] = SO_END_FACE_INDEX;
+        }
+
+        // normalize the normals of this face
+        for (int i = faceNodeOffset; i < faceNodeOffset + mesh->NbNodes(); i++)
+            norms[i].normalize();
+    }
+private:
+    ViewProviderPartExt* vp;
+    ShapeVisual* visual;
+};
+
+// BRepMesh stores the triangulation in the shape which may be shared
+// with other shapes. So, don't mesh concurrently and don't read or add
+// normals to a triangulation while another shape is cleaned or meshed.
+static QMutex meshMutex;
+
 void ViewProviderPartExt::updateVisual(const TopoDS_Shape& inputShape)
 {
     Gui::SoUpdateVBOAction action;
@@ -887,6 +1089,15 @@ void ViewProviderPartExt::updateVisual(const TopoDS_Shape& inputShape)
     haction.apply(this->lineset);
     haction.apply(this->nodeset);
 
+    // the result of a running tessellation is outdated now
+    currentJob = 0;
+
+    // the shared nodes must not be changed for the other view providers
+    if (sharedGeometry) {
+        releaseSharedGeometry();
+        setGeometryNodes(new SoCoordinate3(), new SoNormal());
+    }
+
     TopoDS_Shape cShape(inputShape);
     if (cShape.IsNull()) {
         coords  ->point      .setNum(0);
@@ -901,301 +1112,505 @@ void ViewProviderPartExt::updateVisual(const TopoDS_Shape& inputShape)
 
     // time measurement and book keeping
     Base::TimeInfo start_time;
-    int numTriangles=0,numNodes=0,numNorms=0,numFaces=0,numEdges=0,numLines=0;
-    std::set<int> faceEdges;
+    ShapeVisual visual;
+
+    // a triangulation made with other parameters, e.g. read from the project
+    // file, must not be reused
+    Part::PropertyPartShape* shapeProp = getShapeProperty(cShape);
+    double triaDeviation, triaAngularDeflection;
+    bool cleanMesh = shapeProp &&
+        shapeProp->getTriangulationParameters(triaDeviation, triaAngularDeflection) &&
+        (triaDeviation != Deviation.getValue() || triaAngularDeflection != AngularDeflection.getValue());
 
     try {
-        // calculating the deflection value
+        // calculating the deflection value, for instances in the coordinates of
+        // the shape so that all of them get the same
+        TopoDS_Shape localShape = cShape.Located(TopLoc_Location());
         Bnd_Box bounds;
-        BRepBndLib::Add(cShape, bounds);
+        BRepBndLib::Add(instancedRendering ? localShape : cShape, bounds);
         bounds.SetGap(0.0);
         Standard_Real xMin, yMin, zMin, xMax, yMax, zMax;
         bounds.Get(xMin, yMin, zMin, xMax, yMax, zMax);
         Standard_Real deflection = ((xMax-xMin)+(yMax-yMin)+(zMax-zMin))/300.0 *
             Deviation.getValue();
-
-        // create or use the mesh on the data structure
-#if OCC_VERSION_HEX >= 0x060600
         Standard_Real AngDeflectionRads = AngularDeflection.getValue() / 180.0 * M_PI;
-        BRepMesh_IncrementalMesh(cShape,deflection,Standard_False,
-                AngDeflectionRads,Standard_True);
-#else
-        BRepMesh_IncrementalMesh(cShape,deflection);
-#endif
-        // We must reset the location here because the transformation data
-        // are set in the placement property
-        TopLoc_Location aLoc;
-        cShape.Location(aLoc);
-
-        // count triangles and nodes in the mesh
-        TopTools_IndexedMapOfShape faceMap;
-        TopExp::MapShapes(cShape, TopAbs_FACE, faceMap);
-        for (int i=1; i <= faceMap.Extent(); i++) {
-            Handle (Poly_Triangulation) mesh = BRep_Tool::Triangulation(TopoDS::Face(faceMap(i)), aLoc);
-            // Note: we must also count empty faces
-            if (!mesh.IsNull()) {
-                numTriangles += mesh->NbTriangles();
-                numNodes     += mesh->NbNodes();
-                numNorms     += mesh->NbNodes();
+
+        if (instancedRendering && !cleanMesh) {
+            SharedGeometry* geometry = findSharedGeometry(localShape, deflection, AngDeflectionRads);
+            if (geometry) {
+                useSharedGeometry(geometry);
+                VisualTouched = false;
+                return;
             }
+        }
+
+        if (backgroundTessellation) {
+            // show the bounding box until the tessellation is ready
+            SbVec3f box[8];
+            for (int i=0; i<8; i++) {
+                box[i].setValue((float)(i & 1 ? xMax : xMin),
+                                (float)(i & 2 ? yMax : yMin),
+                                (float)(i & 4 ? zMax : zMin));
+            }
+            static const int32_t boxLines[] = {
+                0,1,3,2,0,-1, 4,5,7,6,4,-1, 0,4,-1, 1,5,-1, 2,6,-1, 3,7,-1
+            };
+            coords  ->point      .setValues(0, 8, box);
+            coords  ->point      .setNum(8);
+            norm    ->vector     .setNum(0);
+            faceset ->coordIndex .setNum(0);
+            faceset ->partIndex  .setNum(0);
+            lineset ->coordIndex .setValues(0, sizeof(boxLines)/sizeof(int32_t), boxLines);
+            lineset ->coordIndex .setNum(sizeof(boxLines)/sizeof(int32_t));
+            nodeset ->startIndex .setValue(8);
+
+            TessellationJob* job = new TessellationJob();
+            job->shape = cShape;
+            job->deflection = deflection;
+            job->angularDeflection = AngDeflectionRads;
+            job->cleanMesh = cleanMesh;
+            job->share = instancedRendering;
+            job->future = QtConcurrent::run(this, &ViewProviderPartExt::runTessellation, job);
+            tessellationJobs.push_back(job);
+            currentJob = job;
+            if (!tessellationSensor->isScheduled())
+                tessellationSensor->schedule();
+            VisualTouched = false;
+            return;
+        }
+
+        tessellate(cShape, deflection, AngDeflectionRads, cleanMesh, visual);
+        applyVisual(visual);
+        if (instancedRendering)
+            shareGeometry(localShape, deflection, AngDeflectionRads, visual);
+        if (shapeProp)
+            shapeProp->setTriangulationParameters(Deviation.getValue(), AngularDeflection.getValue());
+    }
+    catch (...) {
+        printf("Cannot compute Inventor representation for the shape of %s.\n",pcObject->getNameInDocument());
+    }
+
+#   ifdef FC_DEBUG
+        // printing some informations
+        printf("ViewProvider update time: %f s\n",Base::TimeInfo::diffTimeF(start_time,Base::TimeInfo()));
+        printf("Shape tria info: Faces:%d Edges:%d Nodes:%d Triangles:%d IdxVec:%d\n",
+               visual.numFaces,visual.numEdges,visual.numNodes,visual.numTriangles,visual.numLines);
+#   endif
+    VisualTouched = false;
+}
+
+void ViewProviderPartExt::runTessellation(TessellationJob* job)
+{
+    // runs in a worker thread
+    try {
+        tessellate(job->shape, job->deflection, job->angularDeflection, job->cleanMesh, job->visual);
+    }
+    catch (...) {
+        job->visual.failed = true;
+    }
+}
 
-            TopExp_Explorer xp;
-            for (xp.Init(faceMap(i),TopAbs_EDGE);xp.More();xp.Next())
-                faceEdges.insert(xp.Current().HashCode(INT_MAX));
-            numFaces++;
+void ViewProviderPartExt::tessellationSensorCB(void* data, SoSensor*)
+{
+    ViewProviderPartExt* self = static_cast<ViewProviderPartExt*>(data);
+    std::vector<TessellationJob*> running;
+    for (std::vector<TessellationJob*>::iterator it = self->tessellationJobs.begin(); it != self->tessellationJobs.end(); ++it) {
+        TessellationJob* job = *it;
+        if (!job->future.isFinished()) {
+            running.push_back(job);
+            continue;
         }
 
-        // get an indexed map of edges
-        TopTools_IndexedMapOfShape edgeMap;
-        TopExp::MapShapes(cShape, TopAbs_EDGE, edgeMap);
-
-         // key is the edge number, value the coord indexes. This is needed to keep the same order as the edges.
-        std::map<int, std::vector<int32_t> > lineSetMap;
-        std::set<int>          edgeIdxSet;
-        std::vector<int32_t>   edgeVector;
-
-        // count and index the edges
-        for (int i=1; i <= edgeMap.Extent(); i++) {
-            edgeIdxSet.insert(i);
-            numEdges++;
-
-            const TopoDS_Edge& aEdge = TopoDS::Edge(edgeMap(i));
-            TopLoc_Location aLoc;
-
-            // handling of the free edge that are not associated to a face
-            // Note: The assumption that if for an edge BRep_Tool::Polygon3D
-            // returns a valid object is wrong. This e.g. happens for ruled
-            // surfaces which gets created by two edges or wires.
-            // So, we have to store the hashes of the edges associated to a face.
-            // If the hash of a given edge is not in this list we know it's really
-            // a free edge.
-            int hash = aEdge.HashCode(INT_MAX);
-            if (faceEdges.find(hash) == faceEdges.end()) {
-                Handle(Poly_Polygon3D) aPoly = BRep_Tool::Polygon3D(aEdge, aLoc);
-                if (!aPoly.IsNull()) {
-                    int nbNodesInEdge = aPoly->NbNodes();
-                    numNodes += nbNodesInEdge;
+        if (job == self->currentJob) {
+            self->currentJob = 0;
+            if (job->visual.failed) {
+                printf("Cannot compute Inventor representation for the shape of %s.\n",
+                       self->pcObject->getNameInDocument());
+            }
+            else {
+                self->applyVisual(job->visual);
+                if (job->share) {
+                    self->shareGeometry(job->shape.Located(TopLoc_Location()), job->deflection,
+                                        job->angularDeflection, job->visual);
                 }
+                Part::PropertyPartShape* shapeProp = self->getShapeProperty(job->shape);
+                if (shapeProp) {
+                    shapeProp->setTriangulationParameters(self->Deviation.getValue(),
+                                                          self->AngularDeflection.getValue());
+                }
+                // the same as done after a synchronous update
+                if (self->faceset->partIndex.getNum() > self->pcShapeMaterial->diffuseColor.getNum())
+                    self->pcFaceBind->value = SoMaterialBinding::OVERALL;
+                self->onChanged(&self->DiffuseColor);
             }
         }
+        delete job;
+    }
 
-        // handling of the vertices
-        TopTools_IndexedMapOfShape vertexMap;
-        TopExp::MapShapes(cShape, TopAbs_VERTEX, vertexMap);
-        numNodes += vertexMap.Extent();
-
-        // create memory for the nodes and indexes
-        coords  ->point      .setNum(numNodes);
-        norm    ->vector     .setNum(numNorms);
-        faceset ->coordIndex .setNum(numTriangles*4);
-        faceset ->partIndex  .setNum(numFaces);
-        // get the raw memory for fast fill up
-        SbVec3f* verts = coords  ->point       .startEditing();
-        SbVec3f* norms = norm    ->vector      .startEditing();
-        int32_t* index = faceset ->coordIndex  .startEditing();
-        int32_t* parts = faceset ->partIndex   .startEditing();
-
-        // preset the normal vector with null vector
-        for (int i=0;i < numNorms;i++)
-            norms[i]= SbVec3f(0.0,0.0,0.0);
-
-        int ii = 0,faceNodeOffset=0,faceTriaOffset=0;
-        for (int i=1; i <= faceMap.Extent(); i++, ii++) {
-            TopLoc_Location aLoc;
-            const TopoDS_Face &actFace = TopoDS::Face(faceMap(i));
-            // get the mesh of the shape
-            Handle (Poly_Triangulation) mesh = BRep_Tool::Triangulation(actFace,aLoc);
-            if (mesh.IsNull()) continue;
-
-            // getting the transformation of the shape/face
-            gp_Trsf myTransf;
-            Standard_Boolean identity = true;
-            if (!aLoc.IsIdentity()) {
-                identity = false;
-                myTransf = aLoc.Transformation();
-            }
+    self->tessellationJobs.swap(running);
+    if (self->tessellationJobs.empty())
+        self->tessellationSensor->unschedule();
+}
 
-            // getting size of node and triangle array of this face
-            int nbNodesInFace = mesh->NbNodes();
-            int nbTriInFace   = mesh->NbTriangles();
-            // check orientation
-            TopAbs_Orientation orient = actFace.Orientation();
-
-
-            // cycling through the poly mesh
-            const Poly_Array1OfTriangle& Triangles = mesh->Triangles();
-            const TColgp_Array1OfPnt& Nodes = mesh->Nodes();
-            TColgp_Array1OfDir Normals (Nodes.Lower(), Nodes.Upper());
-            GetNormals(actFace, mesh, Normals);
-            
-            for (int g=1;g<=nbTriInFace;g++) {
-                // Get the triangle
-                Standard_Integer N1,N2,N3;
-                Triangles(g).Get(N1,N2,N3);
-
-                // change orientation of the triangle if the face is reversed
-                if ( orient != TopAbs_FORWARD ) {
-                    Standard_Integer tmp = N1;
-                    N1 = N2;
-                    N2 = tmp;
-                }
+ViewProviderPartExt::SharedGeometry* ViewProviderPartExt::findSharedGeometry(const TopoDS_Shape& shape,
+    Standard_Real deflection, Standard_Real angularDeflection) const
+{
+    typedef std::multimap<const Standard_Transient*, SharedGeometry*>::const_iterator Iterator;
+    std::pair<Iterator, Iterator> range = sharedGeometries.equal_range(shape.TShape().operator->());
+    for (Iterator it = range.first; it != range.second; ++it) {
+        SharedGeometry* geometry = it->second;
+        if (geometry->shape.IsEqual(shape) &&
+            geometry->deflection == deflection &&
+            geometry->angularDeflection == angularDeflection &&
+            geometry->noPerVertexNormals == noPerVertexNormals &&
+            geometry->qualityNormals == qualityNormals)
+            return geometry;
+    }
+    return 0;
+}
 
-                // get the 3 points of this triangle
-                gp_Pnt V1(Nodes(N1)), V2(Nodes(N2)), V3(Nodes(N3));
+void ViewProviderPartExt::useSharedGeometry(SharedGeometry* geometry)
+{
+    setGeometryNodes(geometry->coords, geometry->norm);
+
+    faceset ->coordIndex .setValues(0, geometry->faces.size(), geometry->faces.empty() ? 0 : &geometry->faces[0]);
+    faceset ->coordIndex .setNum(geometry->faces.size());
+    faceset ->partIndex  .setValues(0, geometry->parts.size(), geometry->parts.empty() ? 0 : &geometry->parts[0]);
+    faceset ->partIndex  .setNum(geometry->parts.size());
+    lineset ->coordIndex .setValues(0, geometry->lines.size(), geometry->lines.empty() ? 0 : &geometry->lines[0]);
+    lineset ->coordIndex .setNum(geometry->lines.size());
+    nodeset ->startIndex .setValue(geometry->nodeStart);
+
+    geometry->users++;
+    sharedGeometry = geometry;
+}
 
-                // get the 3 normals of this triangle
-                gp_Dir NV1(Normals(N1)), NV2(Normals(N2)), NV3(Normals(N3));                
+void ViewProviderPartExt::shareGeometry(const TopoDS_Shape& shape, Standard_Real deflection,
+                                        Standard_Real angularDeflection, const ShapeVisual& visual)
+{
+    SharedGeometry* geometry = new SharedGeometry();
+    geometry->shape = shape;
+    geometry->deflection = deflection;
+    geometry->angularDeflection = angularDeflection;
+    geometry->noPerVertexNormals = noPerVertexNormals;
+    geometry->qualityNormals = qualityNormals;
+    geometry->coords = coords;
+    geometry->coords->ref();
+    geometry->norm = norm;
+    geometry->norm->ref();
+    geometry->faces = visual.faces;
+    geometry->parts = visual.parts;
+    geometry->lines = visual.lines;
+    geometry->nodeStart = visual.nodeStart;
+    geometry->users = 1;
+
+    sharedGeometries.insert(std::make_pair(shape.TShape().operator->(), geometry));
+    sharedGeometry = geometry;
+}
 
-                // transform the vertices and normals to the place of the face
-                if(!identity) {
-                    V1.Transform(myTransf);
-                    V2.Transform(myTransf);
-                    V3.Transform(myTransf);
-                    NV1.Transform(myTransf);
-                    NV2.Transform(myTransf);
-                    NV3.Transform(myTransf);
-                }
+void ViewProviderPartExt::releaseSharedGeometry()
+{
+    SharedGeometry* geometry = sharedGeometry;
+    if (!geometry)
+        return;
+    sharedGeometry = 0;
+    if (--geometry->users > 0)
+        return;
 
-                // add the normals for all points of this triangle
-                norms[faceNodeOffset+N1-1] += SbVec3f(NV1.X(),NV1.Y(),NV1.Z());
-                norms[faceNodeOffset+N2-1] += SbVec3f(NV2.X(),NV2.Y(),NV2.Z());
-                norms[faceNodeOffset+N3-1] += SbVec3f(NV3.X(),NV3.Y(),NV3.Z());
-
-                // set the vertices
-                verts[faceNodeOffset+N1-1].setValue((float)(V1.X()),(float)(V1.Y()),(float)(V1.Z()));
-                verts[faceNodeOffset+N2-1].setValue((float)(V2.X()),(float)(V2.Y()),(float)(V2.Z()));
-                verts[faceNodeOffset+N3-1].setValue((float)(V3.X()),(float)(V3.Y()),(float)(V3.Z()));
-
-                // set the index vector with the 3 point indexes and the end delimiter
-                index[faceTriaOffset*4+4*(g-1)]   = faceNodeOffset+N1-1;
-                index[faceTriaOffset*4+4*(g-1)+1] = faceNodeOffset+N2-1;
-                index[faceTriaOffset*4+4*(g-1)+2] = faceNodeOffset+N3-1;
-                index[faceTriaOffset*4+4*(g-1)+3] = SO_END_FACE_INDEX;
-            }
+    typedef std::multimap<const Standard_Transient*, SharedGeometry*>::iterator Iterator;
+    std::pair<Iterator, Iterator> range = sharedGeometries.equal_range(geometry->shape.TShape().operator->());
+    for (Iterator it = range.first; it != range.second; ++it) {
+        if (it->second == geometry) {
+            sharedGeometries.erase(it);
+            break;
+        }
+    }
+    geometry->coords->unref();
+    geometry->norm->unref();
+    delete geometry;
+}
 
-            parts[ii] = nbTriInFace; // new part
-
-            // handling the edges lying on this face
-            TopExp_Explorer Exp;
-            for(Exp.Init(actFace,TopAbs_EDGE);Exp.More();Exp.Next()) {
-                const TopoDS_Edge &curEdge = TopoDS::Edge(Exp.Current());
-                // get the overall index of this edge
-                int edgeIndex = edgeMap.FindIndex(curEdge);
-                edgeVector.push_back((int32_t)edgeIndex-1);
-                // already processed this index ?
-                if (edgeIdxSet.find(edgeIndex)!=edgeIdxSet.end()) {
-                    
-                    // this holds the indices of the edge's triangulation to the current polygon
-                    Handle(Poly_PolygonOnTriangulation) aPoly = BRep_Tool::PolygonOnTriangulation(curEdge, mesh, aLoc);
-                    if (aPoly.IsNull())
-                        continue; // polygon does not exist
-                    
-                    // getting the indexes of the edge polygon
-                    const TColStd_Array1OfInteger& indices = aPoly->Nodes();
-                    for (Standard_Integer i=indices.Lower();i <= indices.Upper();i++) {
-                        int nodeIndex = indices(i);
-                        int index = faceNodeOffset+nodeIndex-1;
-                        lineSetMap[edgeIndex].push_back(index);
-
-                        // usually the coordinates for this edge are already set by the
-                        // triangles of the face this edge belongs to. However, there are
-                        // rare cases where some points are only referenced by the polygon
-                        // but not by any triangle. Thus, we must apply the coordinates to
-                        // make sure that everything is properly set.
-                        gp_Pnt p(Nodes(nodeIndex));
-                        if (!identity)
-                            p.Transform(myTransf);
-                        verts[index].setValue((float)(p.X()),(float)(p.Y()),(float)(p.Z()));
-                    }
-
-                    // remove the handled edge index from the set
-                    edgeIdxSet.erase(edgeIndex);
-                }
-            }
+void ViewProviderPartExt::setGeometryNodes(SoCoordinate3* newCoords, SoNormal* newNorm)
+{
+    // the nodes may not be in the scene graph yet, see attach()
+    if (newCoords != coords) {
+        newCoords->ref();
+        int index = pcRoot->findChild(coords);
+        if (index >= 0)
+            pcRoot->replaceChild(index, newCoords);
+        coords->unref();
+        coords = newCoords;
+    }
+    if (newNorm != norm) {
+        newNorm->ref();
+        int index = pcFlatRoot ? pcFlatRoot->findChild(norm) : -1;
+        if (index >= 0)
+            pcFlatRoot->replaceChild(index, newNorm);
+        norm->unref();
+        norm = newNorm;
+    }
+}
+
+Part::PropertyPartShape* ViewProviderPartExt::getShapeProperty(const TopoDS_Shape& shape) const
+{
+    // the shape property keeps the parameters of the triangulation
+    Part::Feature* feature = dynamic_cast<Part::Feature*>(pcObject);
+    if (feature && feature->Shape.getValue().IsEqual(shape))
+        return &feature->Shape;
+    return 0;
+}
 
-            edgeVector.push_back(-1);
-            
-            // counting up the per Face offsets
-            faceNodeOffset += nbNodesInFace;
-            faceTriaOffset += nbTriInFace;
+void ViewProviderPartExt::tessellate(const TopoDS_Shape& inputShape, Standard_Real deflection,
+                                     Standard_Real angularDeflection, bool cleanMesh,
+                                     ShapeVisual& visual)
+{
+    TopoDS_Shape cShape(inputShape);
+    std::set<int> faceEdges;
+
+    // the lock is kept until all triangulations and polygons of the shape are
+    // read, the faces of this shape are still filled in concurrently
+    QMutexLocker lock(&meshMutex);
+    if (cleanMesh)
+        BRepTools::Clean(cShape);
+    // create or use the mesh on the data structure
+#if OCC_VERSION_HEX >= 0x060600
+    BRepMesh_IncrementalMesh(cShape,deflection,Standard_False,
+            angularDeflection,Standard_True);
+#else
+    (void)angularDeflection;
+    BRepMesh_IncrementalMesh(cShape,deflection);
+#endif
+    // We must reset the location here because the transformation data
+    // are set in the placement property
+    TopLoc_Location aLoc;
+    cShape.Location(aLoc);
+
+    // count triangles and nodes in the mesh
+    int numTriangles=0,numNodes=0,numNorms=0,numFaces=0,numEdges=0;
+    std::vector<FaceTriangulation> faceMeshes;
+    std::vector<FaceTriangulation> sharedMeshes;
+    std::set<Poly_Triangulation*> meshSet;
+    TopTools_IndexedMapOfShape faceMap;
+    TopExp::MapShapes(cShape, TopAbs_FACE, faceMap);
+    for (int i=1; i <= faceMap.Extent(); i++) {
+        FaceTriangulation f;
+        f.face = TopoDS::Face(faceMap(i));
+        f.mesh = BRep_Tool::Triangulation(f.face, f.loc);
+        f.nodeOffset = numNodes;
+        f.triaOffset = numTriangles;
+        faceMeshes.push_back(f);
+        // Note: we must also count empty faces
+        if (!f.mesh.IsNull()) {
+            numTriangles += f.mesh->NbTriangles();
+            numNodes     += f.mesh->NbNodes();
+            numNorms     += f.mesh->NbNodes();
+            if (!f.mesh->HasNormals() && meshSet.insert(f.mesh.operator->()).second)
+                sharedMeshes.push_back(f);
         }
 
-        // handling of the free edges
-        for (int i=1; i <= edgeMap.Extent(); i++) {
-            const TopoDS_Edge& aEdge = TopoDS::Edge(edgeMap(i));
-            Standard_Boolean identity = true;
-            gp_Trsf myTransf;
-            TopLoc_Location aLoc;
-
-            // handling of the free edge that are not associated to a face
-            int hash = aEdge.HashCode(INT_MAX);
-            if (faceEdges.find(hash) == faceEdges.end()) {
-                Handle(Poly_Polygon3D) aPoly = BRep_Tool::Polygon3D(aEdge, aLoc);
-                if (!aPoly.IsNull()) {
-                    if (!aLoc.IsIdentity()) {
-                        identity = false;
-                        myTransf = aLoc.Transformation();
-                    }
-
-                    const TColgp_Array1OfPnt& aNodes = aPoly->Nodes();
-                    int nbNodesInEdge = aPoly->NbNodes();
-
-                    gp_Pnt pnt;
-                    for (Standard_Integer j=1;j <= nbNodesInEdge;j++) {
-                        pnt = aNodes(j);
-                        if (!identity)
-                            pnt.Transform(myTransf);
-                        int index = faceNodeOffset+j-1;
-                        verts[index].setValue((float)(pnt.X()),(float)(pnt.Y()),(float)(pnt.Z()));
-                        lineSetMap[i].push_back(index);
-                    }
-
-                    faceNodeOffset += nbNodesInEdge;
-                }
+        TopExp_Explorer xp;
+        for (xp.Init(faceMap(i),TopAbs_EDGE);xp.More();xp.Next())
+            faceEdges.insert(xp.Current().HashCode(INT_MAX));
+        numFaces++;
+    }
+
+    // get an indexed map of edges
+    TopTools_IndexedMapOfShape edgeMap;
+    TopExp::MapShapes(cShape, TopAbs_EDGE, edgeMap);
+
+     // key is the edge number, value the coord indexes. This is needed to keep the same order as the edges.
+    std::map<int, std::vector<int32_t> > lineSetMap;
+    std::set<int>          edgeIdxSet;
+    std::vector<int32_t>   edgeVector;
+
+    // count and index the edges
+    for (int i=1; i <= edgeMap.Extent(); i++) {
+        edgeIdxSet.insert(i);
+        numEdges++;
+
+        const TopoDS_Edge& aEdge = TopoDS::Edge(edgeMap(i));
+        TopLoc_Location aLoc;
+
+        // handling of the free edge that are not associated to a face
+        // Note: The assumption that if for an edge BRep_Tool::Polygon3D
+        // returns a valid object is wrong. This e.g. happens for ruled
+        // surfaces which gets created by two edges or wires.
+        // So, we have to store the hashes of the edges associated to a face.
+        // If the hash of a given edge is not in this list we know it's really
+        // a free edge.
+        int hash = aEdge.HashCode(INT_MAX);
+        if (faceEdges.find(hash) == faceEdges.end()) {
+            Handle(Poly_Polygon3D) aPoly = BRep_Tool::Polygon3D(aEdge, aLoc);
+            if (!aPoly.IsNull()) {
+                int nbNodesInEdge = aPoly->NbNodes();
+                numNodes += nbNodesInEdge;
             }
         }
+    }
 
-        nodeset->startIndex.setValue(faceNodeOffset);
-        for (int i=0; i<vertexMap.Extent(); i++) {
-            const TopoDS_Vertex& aVertex = TopoDS::Vertex(vertexMap(i+1));
-            gp_Pnt pnt = BRep_Tool::Pnt(aVertex);
-            verts[faceNodeOffset+i].setValue((float)(pnt.X()),(float)(pnt.Y()),(float)(pnt.Z()));
+    // handling of the vertices
+    TopTools_IndexedMapOfShape vertexMap;
+    TopExp::MapShapes(cShape, TopAbs_VERTEX, vertexMap);
+    numNodes += vertexMap.Extent();
+
+    // create memory for the nodes and indexes, the normals are preset with null vectors
+    visual.verts.resize(numNodes);
+    visual.norms.resize(numNorms, SbVec3f(0.0,0.0,0.0));
+    visual.faces.resize(numTriangles*4);
+    visual.parts.resize(numFaces);
+    SbVec3f* verts = visual.verts.empty() ? 0 : &visual.verts[0];
+
+    // the faces are filled in concurrently
+    std::vector<FaceTriangulation> nonEmptyFaces;
+    for (std::vector<FaceTriangulation>::iterator it = faceMeshes.begin(); it != faceMeshes.end(); ++it) {
+        if (!it->mesh.IsNull())
+            nonEmptyFaces.push_back(*it);
+    }
+    QtConcurrent::blockingMap(sharedMeshes, FaceNormals(this));
+    QtConcurrent::blockingMap(nonEmptyFaces, FaceFiller(this, &visual));
+
+    int ii = 0,faceNodeOffset=0;
+    for (std::vector<FaceTriangulation>::iterator it = faceMeshes.begin(); it != faceMeshes.end(); ++it, ii++) {
+        const TopoDS_Face &actFace = it->face;
+        const Handle (Poly_Triangulation)& mesh = it->mesh;
+        if (mesh.IsNull()) continue;
+        faceNodeOffset = it->nodeOffset;
+
+        // getting the transformation of the shape/face
+        gp_Trsf myTransf;
+        Standard_Boolean identity = true;
+        if (!it->loc.IsIdentity()) {
+            identity = false;
+            myTransf = it->loc.Transformation();
         }
 
-        // normalize all normals 
-        for (int i = 0; i< numNorms ;i++)
-            norms[i].normalize();
-        
-        std::vector<int32_t> lineSetCoords;
-        for (std::map<int, std::vector<int32_t> >::iterator it = lineSetMap.begin(); it != lineSetMap.end(); ++it) {
-            lineSetCoords.insert(lineSetCoords.end(), it->second.begin(), it->second.end());
-            lineSetCoords.push_back(-1);
+        const TColgp_Array1OfPnt& Nodes = mesh->Nodes();
+        visual.parts[ii] = mesh->NbTriangles(); // new part
+
+        // handling the edges lying on this face
+        TopExp_Explorer Exp;
+        for(Exp.Init(actFace,TopAbs_EDGE);Exp.More();Exp.Next()) {
+            const TopoDS_Edge &curEdge = TopoDS::Edge(Exp.Current());
+            // get the overall index of this edge
+            int edgeIndex = edgeMap.FindIndex(curEdge);
+            edgeVector.push_back((int32_t)edgeIndex-1);
+            // already processed this index ?
+            if (edgeIdxSet.find(edgeIndex)!=edgeIdxSet.end()) {
+
+                // this holds the indices of the edge's triangulation to the current polygon
+                TopLoc_Location aLoc;
+                Handle(Poly_PolygonOnTriangulation) aPoly = BRep_Tool::PolygonOnTriangulation(curEdge, mesh, aLoc);
+                if (aPoly.IsNull())
+                    continue; // polygon does not exist
+
+                // getting the indexes of the edge polygon
+                const TColStd_Array1OfInteger& indices = aPoly->Nodes();
+                for (Standard_Integer i=indices.Lower();i <= indices.Upper();i++) {
+                    int nodeIndex = indices(i);
+                    int index = faceNodeOffset+nodeIndex-1;
+                    lineSetMap[edgeIndex].push_back(index);
+
+                    // usually the coordinates for this edge are already set by the
+                    // triangles of the face this edge belongs to. However, there are
+                    // rare cases where some points are only referenced by the polygon
+                    // but not by any triangle. Thus, we must apply the coordinates to
+                    // make sure that everything is properly set.
+                    gp_Pnt p(Nodes(nodeIndex));
+                    if (!identity)
+                        p.Transform(myTransf);
+                    verts[index].setValue((float)(p.X()),(float)(p.Y()),(float)(p.Z()));
+                }
+
+                // remove the handled edge index from the set
+                edgeIdxSet.erase(edgeIndex);
+            }
         }
 
-        // preset the index vector size
-        numLines =  lineSetCoords.size();
-        lineset ->coordIndex .setNum(numLines);
-        int32_t* lines = lineset ->coordIndex  .startEditing();
+        edgeVector.push_back(-1);
+    }
+    faceNodeOffset = numNorms;
+
+    // handling of the free edges
+    for (int i=1; i <= edgeMap.Extent(); i++) {
+        const TopoDS_Edge& aEdge = TopoDS::Edge(edgeMap(i));
+        Standard_Boolean identity = true;
+        gp_Trsf myTransf;
+        TopLoc_Location aLoc;
+
+        // handling of the free edge that are not associated to a face
+        int hash = aEdge.HashCode(INT_MAX);
+        if (faceEdges.find(hash) == faceEdges.end()) {
+            Handle(Poly_Polygon3D) aPoly = BRep_Tool::Polygon3D(aEdge, aLoc);
+            if (!aPoly.IsNull()) {
+                if (!aLoc.IsIdentity()) {
+                    identity = false;
+                    myTransf = aLoc.Transformation();
+                }
 
-        int l=0;
-        for (std::vector<int32_t>::const_iterator it=lineSetCoords.begin();it!=lineSetCoords.end();++it,l++)
-            lines[l] = *it;
+                const TColgp_Array1OfPnt& aNodes = aPoly->Nodes();
+                int nbNodesInEdge = aPoly->NbNodes();
+
+                gp_Pnt pnt;
+                for (Standard_Integer j=1;j <= nbNodesInEdge;j++) {
+                    pnt = aNodes(j);
+                    if (!identity)
+                        pnt.Transform(myTransf);
+                    int index = faceNodeOffset+j-1;
+                    verts[index].setValue((float)(pnt.X()),(float)(pnt.Y()),(float)(pnt.Z()));
+                    lineSetMap[i].push_back(index);
+                }
 
-        // end the editing of the nodes
-        coords  ->point       .finishEditing();
-        norm    ->vector      .finishEditing();
-        faceset ->coordIndex  .finishEditing();
-        faceset ->partIndex   .finishEditing();
-        lineset ->coordIndex  .finishEditing();
+                faceNodeOffset += nbNodesInEdge;
+            }
+        }
     }
-    catch (...) {
-        printf("Cannot compute Inventor representation for the shape of %s.\n",pcObject->getNameInDocument());
+
+    visual.nodeStart = faceNodeOffset;
+    for (int i=0; i<vertexMap.Extent(); i++) {
+        const TopoDS_Vertex& aVertex = TopoDS::Vertex(vertexMap(i+1));
+        gp_Pnt pnt = BRep_Tool::Pnt(aVertex);
+        verts[faceNodeOffset+i].setValue((float)(pnt.X()),(float)(pnt.Y()),(float)(pnt.Z()));
     }
+    lock.unlock();
 
-#   ifdef FC_DEBUG
-        // printing some informations
-        printf("ViewProvider update time: %f s\n",Base::TimeInfo::diffTimeF(start_time,Base::TimeInfo()));
-        printf("Shape tria info: Faces:%d Edges:%d Nodes:%d Triangles:%d IdxVec:%d\n",numFaces,numEdges,numNodes,numTriangles,numLines);
-#   endif
-    VisualTouched = false;
+    for (std::map<int, std::vector<int32_t> >::iterator it = lineSetMap.begin(); it != lineSetMap.end(); ++it) {
+        visual.lines.insert(visual.lines.end(), it->second.begin(), it->second.end());
+        visual.lines.push_back(-1);
+    }
+
+    visual.numTriangles = numTriangles;
+    visual.numNodes = numNodes;
+    visual.numFaces = numFaces;
+    visual.numEdges = numEdges;
+    visual.numLines = visual.lines.size();
+}
+
+void ViewProviderPartExt::applyVisual(const ShapeVisual& visual)
+{
+    coords  ->point      .setNum(visual.verts.size());
+    norm    ->vector     .setNum(visual.norms.size());
+    faceset ->coordIndex .setNum(visual.faces.size());
+    faceset ->partIndex  .setNum(visual.parts.size());
+    lineset ->coordIndex .setNum(visual.lines.size());
+
+    // get the raw memory for fast fill up
+    SbVec3f* verts = coords  ->point       .startEditing();
+    SbVec3f* norms = norm    ->vector      .startEditing();
+    int32_t* index = faceset ->coordIndex  .startEditing();
+    int32_t* parts = faceset ->partIndex   .startEditing();
+    int32_t* lines = lineset ->coordIndex  .startEditing();
+
+    std::copy(visual.verts.begin(), visual.verts.end(), verts);
+    std::copy(visual.norms.begin(), visual.norms.end(), norms);
+    std::copy(visual.faces.begin(), visual.faces.end(), index);
+    std::copy(visual.parts.begin(), visual.parts.end(), parts);
+    std::copy(visual.lines.begin(), visual.lines.end(), lines);
+    nodeset->startIndex.setValue(visual.nodeStart);
+
+    // end the editing of the nodes
+    coords  ->point       .finishEditing();
+    norm    ->vector      .finishEditing();
+    faceset ->coordIndex  .finishEditing();
+    faceset ->partIndex   .finishEditing();
+    lineset ->coordIndex  .finishEditing();
 }
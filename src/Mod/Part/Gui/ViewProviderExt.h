@@ -54,6 +54,12 @@ class SoNormal;
 class SoNormalBinding;
 class SoMaterialBinding;
 class SoIndexedLineSet;
+class SoTimerSensor;
+class SoSensor;
+
+namespace Part {
+class PropertyPartShape;
+}
 
 namespace PartGui {
 
@@ -166,9 +172,49 @@ protected:
     bool VisualTouched;
 
 private:
+    struct ShapeVisual;
+    struct TessellationJob;
+    struct FaceTriangulation;
+    struct SharedGeometry;
+    class FaceNormals;
+    class FaceFiller;
+
+    void tessellate(const TopoDS_Shape &, Standard_Real deflection,
+                    Standard_Real angularDeflection, bool cleanMesh, ShapeVisual &);
+    void applyVisual(const ShapeVisual &);
+    Part::PropertyPartShape* getShapeProperty(const TopoDS_Shape &) const;
+    void runTessellation(TessellationJob *);
+    static void tessellationSensorCB(void *, SoSensor *);
+
+    /** @name Instanced rendering
+     * View providers of shapes that differ only by their location show the same
+     * coordinate and normal nodes, placed by their own transformation.
+     */
+    //@{
+    SharedGeometry* findSharedGeometry(const TopoDS_Shape &, Standard_Real deflection,
+                                       Standard_Real angularDeflection) const;
+    void useSharedGeometry(SharedGeometry *);
+    void shareGeometry(const TopoDS_Shape &, Standard_Real deflection,
+                       Standard_Real angularDeflection, const ShapeVisual &);
+    void releaseSharedGeometry();
+    void setGeometryNodes(SoCoordinate3 *, SoNormal *);
+    //@}
+
+    // tessellations running in the background, only the current one gets shown
+    std::vector<TessellationJob*> tessellationJobs;
+    TessellationJob* currentJob;
+    SoTimerSensor* tessellationSensor;
+
+    // the geometry shared with other view providers, keyed by the TShape
+    SharedGeometry* sharedGeometry;
+    SoGroup* pcFlatRoot;
+    static std::multimap<const Standard_Transient*, SharedGeometry*> sharedGeometries;
+
     // settings stuff
     bool noPerVertexNormals;
     bool qualityNormals;
+    bool backgroundTessellation;
+    bool instancedRendering;
     static App::PropertyFloatConstraint::Constraints sizeRange;
     static App::PropertyFloatConstraint::Constraints tessRange;
     static App::PropertyQuantityConstraint::Constraints angDeflectionRange;
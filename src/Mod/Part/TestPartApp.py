@@ -20,6 +20,7 @@
 #**************************************************************************
 
 import FreeCAD, os, sys, unittest, Part
+import tempfile, time
 import copy 
 from FreeCAD import Units
 App = FreeCAD
@@ -37,6 +38,102 @@ class PartTestCases(unittest.TestCase):
         self.Box = App.ActiveDocument.addObject("Part::Box","Box")
         self.Doc.recompute()
         self.failUnless(len(self.Box.Shape.Faces)==6)
+
+    def testHierarchicalFuse(self):
+        # rows of overlapping boxes, the rows don't touch each other
+        boxes = []
+        for i in range(6):
+            for j in range(6):
+                box = self.Doc.addObject("Part::Box","Box")
+                box.Placement.Base = FreeCAD.Vector(i * 8, j * 20, 0)
+                boxes.append(box)
+        fusion = self.Doc.addObject("Part::MultiFuse","Fusion")
+        fusion.Shapes = boxes
+
+        grp = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Mod/Part/Boolean")
+        mode = grp.GetBool("HierarchicalBoolean", False)
+        size = grp.GetInt("HierarchicalClusterSize", 16)
+        try:
+            grp.SetInt("HierarchicalClusterSize", 4)
+            grp.SetBool("HierarchicalBoolean", False)
+            self.Doc.recompute()
+            volume = fusion.Shape.Volume
+            area = fusion.Shape.Area
+            grp.SetBool("HierarchicalBoolean", True)
+            fusion.touch()
+            self.Doc.recompute()
+        finally:
+            grp.SetBool("HierarchicalBoolean", mode)
+            grp.SetInt("HierarchicalClusterSize", size)
+
+        self.assertEqual(len(fusion.Shape.Solids), 6)
+        self.assertAlmostEqual(fusion.Shape.Volume, volume, 6)
+        self.assertAlmostEqual(fusion.Shape.Area, area, 6)
+
+    def testShapeCache(self):
+        box = self.Doc.addObject("Part::Box","Box")
+        tool = self.Doc.addObject("Part::Box","Box")
+        tool.Placement.Base = FreeCAD.Vector(5, 5, 5)
+        cut = self.Doc.addObject("Part::Cut","Cut")
+        cut.Base = box
+        cut.Tool = tool
+
+        grp = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Mod/Part/General")
+        size = grp.GetInt("ShapeCacheSize", 0)
+        try:
+            grp.SetInt("ShapeCacheSize", 8)
+            cut.clearShapeCache()
+            self.Doc.recompute()
+            volume = cut.Shape.Volume
+            box.Length = 20
+            self.Doc.recompute()
+            box.Length = 10
+            self.Doc.recompute()
+            stats = cut.getShapeCacheStatistics()
+        finally:
+            grp.SetInt("ShapeCacheSize", size)
+            cut.clearShapeCache()
+
+        self.assertGreaterEqual(stats["Hits"], 1)
+        self.assertEqual(stats["MaxSize"], 8)
+        self.assertAlmostEqual(cut.Shape.Volume, volume, 6)
+
+    def testBinaryBrep(self):
+        # save the same shapes as BRep and as binary files and compare open and save times and file sizes
+        for i in range(50):
+            box = self.Doc.addObject("Part::Box","Box")
+            box.Placement.Base = FreeCAD.Vector(i * 20, 0, 0)
+            sphere = self.Doc.addObject("Part::Sphere","Sphere")
+            sphere.Radius = 6
+            sphere.Placement.Base = FreeCAD.Vector(i * 20 + 10, 10, 10)
+            cut = self.Doc.addObject("Part::Cut","Cut")
+            cut.Base = box
+            cut.Tool = sphere
+        self.Doc.recompute()
+        volumes = [o.Shape.Volume for o in self.Doc.Objects]
+
+        grp = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Mod/Part/General")
+        binary = grp.GetBool("SaveBinaryBrep", False)
+        results = {}
+        try:
+            for mode in (False, True):
+                FileName = tempfile.gettempdir() + os.sep + "PartBinaryBrep%d.FCStd" % mode
+                grp.SetBool("SaveBinaryBrep", mode)
+                start = time.time()
+                self.Doc.saveAs(FileName)
+                saved = time.time() - start
+                start = time.time()
+                self.Doc.restore()
+                opened = time.time() - start
+                results[mode] = (saved, opened, os.path.getsize(FileName))
+                self.assertEqual(len(self.Doc.Objects), len(volumes))
+                for obj, volume in zip(self.Doc.Objects, volumes):
+                    self.assertAlmostEqual(obj.Shape.Volume, volume, 6)
+                os.remove(FileName)
+        finally:
+            grp.SetBool("SaveBinaryBrep", binary)
+        FreeCAD.Console.PrintLog("  BRep shapes: save %.3f s, open %.3f s, %d bytes\n" % results[False])
+        FreeCAD.Console.PrintLog("  Binary shapes: save %.3f s, open %.3f s, %d bytes\n" % results[True])
         
     def tearDown(self):
         #closing doc
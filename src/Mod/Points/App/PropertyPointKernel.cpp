@@ -42,7 +42,7 @@ using namespace Points;
 TYPESYSTEM_SOURCE(Points::PropertyPointKernel , App::PropertyComplexGeoData);
 
 PropertyPointKernel::PropertyPointKernel()
-    : _cPoints(new PointKernel())
+    : _cPoints(new PointKernel()), _pendingIndices(0)
 {
 
 }
@@ -150,6 +150,45 @@ void PropertyPointKernel::Paste(const App::Property &from)
     hasSetValue();
 }
 
+namespace Points {
+/** Undo record of setPointIndices() holding the old values of the changed points. */
+class PointsDelta : public App::PropertyDelta
+{
+public:
+    PointsDelta(const PointKernel& kernel,
+                const std::vector<std::pair<unsigned long, Base::Vector3f> >& inds)
+    {
+        const std::vector<PointKernel::value_type>& pts = kernel.getBasicPoints();
+        points.reserve(inds.size());
+        for (std::vector<std::pair<unsigned long, Base::Vector3f> >::const_iterator it = inds.begin(); it != inds.end(); ++it)
+            points.push_back(std::make_pair(it->first, pts[it->first]));
+    }
+    void apply(App::Property &prop) const
+    {
+        static_cast<PropertyPointKernel&>(prop).setPointIndices(points);
+    }
+    unsigned int getMemSize (void) const
+    {
+        return points.size() * sizeof(std::pair<unsigned long, Base::Vector3f>);
+    }
+
+private:
+    std::vector<std::pair<unsigned long, Base::Vector3f> > points;
+};
+}
+
+App::PropertyDelta *PropertyPointKernel::CopyDelta(void) const
+{
+    if (!_pendingIndices)
+        return 0;
+    // check the indices so that applying the delta cannot fail
+    for (std::vector<std::pair<unsigned long, Base::Vector3f> >::const_iterator it = _pendingIndices->begin(); it != _pendingIndices->end(); ++it) {
+        if (it->first >= _cPoints->size())
+            return 0;
+    }
+    return new PointsDelta(*_cPoints, *_pendingIndices);
+}
+
 unsigned int PropertyPointKernel::getMemSize (void) const
 {
     return sizeof(Base::Vector3f) * this->_cPoints->size();
@@ -194,6 +233,20 @@ void PropertyPointKernel::removeIndices( const std::vector<unsigned long>& uIndi
     setValue(kernel);
 }
 
+void PropertyPointKernel::setPointIndices(const std::vector<std::pair<unsigned long, Base::Vector3f> >& inds)
+{
+    // let an open transaction record only the points that are going to change
+    _pendingIndices = &inds;
+    aboutToSetValue();
+    _pendingIndices = 0;
+    std::vector<PointKernel::value_type>& pts = _cPoints->getBasicPoints();
+    for (std::vector<std::pair<unsigned long, Base::Vector3f> >::const_iterator it = inds.begin(); it != inds.end(); ++it) {
+        if (it->first < pts.size())
+            pts[it->first] = it->second;
+    }
+    hasSetValue();
+}
+
 void PropertyPointKernel::transformGeometry(const Base::Matrix4D &rclMat)
 {
     aboutToSetValue();
@@ -66,6 +66,8 @@ public:
     App::Property *Copy(void) const;
     /// paste the value from the property (mainly for Undo/Redo and transactions)
     void Paste(const App::Property &from);
+    /// records only the old values of the points modified by setPointIndices()
+    App::PropertyDelta *CopyDelta(void) const;
     unsigned int getMemSize (void) const;
     //@}
 
@@ -84,10 +86,14 @@ public:
     /// Transform the real 3d point kernel
     void transformGeometry(const Base::Matrix4D &rclMat);
     void removeIndices( const std::vector<unsigned long>& );
+    /// Set the untransformed coordinates of the given points
+    void setPointIndices( const std::vector<std::pair<unsigned long, Base::Vector3f> >& );
     //@}
 
 private:
     Base::Reference<PointKernel> _cPoints;
+    // the points about to be changed by setPointIndices(), used by CopyDelta()
+    const std::vector<std::pair<unsigned long, Base::Vector3f> >* _pendingIndices;
 };
 
 } // namespace Points
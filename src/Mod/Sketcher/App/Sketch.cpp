@@ -57,6 +57,7 @@
 #include "Sketch.h"
 #include "Constraint.h"
 #include <cmath>
+#include <algorithm>
 
 #include <iostream>
 
@@ -66,8 +67,21 @@ using namespace Part;
 
 TYPESYSTEM_SOURCE(Sketcher::Sketch, Base::Persistence)
 
+// splits the ratio n2/n1 of a SnellsLaw constraint into the two refractive indexes
+static void setRefractiveIndices(double n2divn1, double *n1, double *n2)
+{
+    if ( fabs(n2divn1) >= 1.0 ){
+        *n2 = n2divn1;
+        *n1 = 1.0;
+    } else {
+        *n2 = 1.0;
+        *n1 = 1/n2divn1;
+    }
+}
+
 Sketch::Sketch()
 : SolveTime(0), GCSsys(), ConstraintsCounter(0), isInitMove(false), isFine(true),
+    incrementalSetUp(false), incrementalSetUpCount(0), ExternalGeoCount(0), GeoParametersCount(0),
     defaultSolver(GCS::DogLeg),defaultSolverRedundant(GCS::DogLeg),debugMode(GCS::Minimal)
 {
 }
@@ -108,6 +122,12 @@ void Sketch::clear(void)
     //    if (*it) delete *it;
     Constrs.clear();
 
+    for (std::vector<Constraint *>::iterator it = SetUpConstraints.begin(); it != SetUpConstraints.end(); ++it)
+        delete *it;
+    SetUpConstraints.clear();
+    ExternalGeoCount = 0;
+    GeoParametersCount = 0;
+
     GCSsys.clear();
     isInitMove = false;
     ConstraintsCounter = 0;
@@ -120,24 +140,34 @@ int Sketch::setUpSketch(const std::vector<Part::Geometry *> &GeoList,
 {
     Base::TimeInfo start_time;
 
-    clear();
-
-    std::vector<Part::Geometry *> intGeoList, extGeoList;
-    for (int i=0; i < int(GeoList.size())-extGeoCount; i++)
-        intGeoList.push_back(GeoList[i]);
-    for (int i=int(GeoList.size())-extGeoCount; i < int(GeoList.size()); i++)
-        extGeoList.push_back(GeoList[i]);
-
-    addGeometry(intGeoList);
-    int extStart=Geoms.size();
-    addGeometry(extGeoList, true);
-    int extEnd=Geoms.size()-1;
-    for (int i=extStart; i <= extEnd; i++)
-        Geoms[i].external = true;
-
-    // The Geoms list might be empty after an undo/redo
-    if (!Geoms.empty()) {
-        addConstraints(ConstraintList);
+    bool incremental = incrementalSetUp && updateSketch(GeoList, ConstraintList, extGeoCount);
+    if (incremental) {
+        incrementalSetUpCount++;
+    }
+    else {
+        clear();
+
+        std::vector<Part::Geometry *> intGeoList, extGeoList;
+        for (int i=0; i < int(GeoList.size())-extGeoCount; i++)
+            intGeoList.push_back(GeoList[i]);
+        for (int i=int(GeoList.size())-extGeoCount; i < int(GeoList.size()); i++)
+            extGeoList.push_back(GeoList[i]);
+
+        addGeometry(intGeoList);
+        int extStart=Geoms.size();
+        addGeometry(extGeoList, true);
+        int extEnd=Geoms.size()-1;
+        for (int i=extStart; i <= extEnd; i++)
+            Geoms[i].external = true;
+        ExternalGeoCount = extEnd-extStart+1;
+        GeoParametersCount = int(Parameters.size());
+
+        // The Geoms list might be empty after an undo/redo
+        if (!Geoms.empty()) {
+            addConstraints(ConstraintList);
+            for (std::vector<Constraint *>::const_iterator it = ConstraintList.begin(); it != ConstraintList.end(); ++it)
+                SetUpConstraints.push_back((*it)->clone());
+        }
     }
     GCSsys.clearByTag(-1);
     GCSsys.declareUnknowns(Parameters);
@@ -148,7 +178,8 @@ int Sketch::setUpSketch(const std::vector<Part::Geometry *> &GeoList,
     if (debugMode==GCS::Minimal || debugMode==GCS::IterationLevel) {
         Base::TimeInfo end_time;
 
-        printf("Sketcher::setUpSketch()-T:%s\n",Base::TimeInfo::diffTime(start_time,end_time).c_str());
+        printf("Sketcher::setUpSketch()-%s-T:%s\n",incremental ? "incremental" : "full",
+               Base::TimeInfo::diffTime(start_time,end_time).c_str());
     }
 
     return GCSsys.dofsNumber();
@@ -165,6 +196,162 @@ int Sketch::resetSolver()
     return GCSsys.dofsNumber();
 }
 
+bool Sketch::isSameConstraint(const Constraint *c1, const Constraint *c2)
+{
+    if (c1->Type != c2->Type ||
+        c1->AlignmentType != c2->AlignmentType ||
+        c1->First != c2->First || c1->FirstPos != c2->FirstPos ||
+        c1->Second != c2->Second || c1->SecondPos != c2->SecondPos ||
+        c1->Third != c2->Third || c1->ThirdPos != c2->ThirdPos ||
+        c1->isDriving != c2->isDriving ||
+        c1->InternalAlignmentIndex != c2->InternalAlignmentIndex)
+        return false;
+    // the value of a reference constraint is an unknown of the solver
+    return !c1->isDriving || c1->Value == c2->Value;
+}
+
+bool Sketch::updateSketch(const std::vector<Part::Geometry *> &GeoList,
+                          const std::vector<Constraint *> &ConstraintList,
+                          int extGeoCount)
+{
+    if (Geoms.empty() || extGeoCount != ExternalGeoCount ||
+        Constrs.size() != SetUpConstraints.size())
+        return false;
+
+    int oldIntGeoCount = int(Geoms.size()) - ExternalGeoCount;
+    int intGeoCount = int(GeoList.size()) - extGeoCount;
+    if (intGeoCount < oldIntGeoCount)
+        return false;
+
+    // either constraints were appended or a single one was removed
+    int oldCount = int(SetUpConstraints.size());
+    int newCount = int(ConstraintList.size());
+    int common = 0;
+    while (common < oldCount && common < newCount &&
+           isSameConstraint(SetUpConstraints[common], ConstraintList[common]))
+        common++;
+
+    int removed = -1;
+    if (common < oldCount) {
+        if (newCount != oldCount-1 || intGeoCount != oldIntGeoCount)
+            return false;
+        for (int i=common; i < newCount; i++) {
+            if (!isSameConstraint(SetUpConstraints[i+1], ConstraintList[i]))
+                return false;
+        }
+        removed = common;
+    }
+
+    // read in all geometry into a scratch sketch to get its current parameter
+    // values and to check that the existing geometry still has the same layout
+    Sketch probe;
+    std::vector<Part::Geometry *> intGeoList(GeoList.begin(), GeoList.begin()+intGeoCount);
+    std::vector<Part::Geometry *> extGeoList(GeoList.begin()+intGeoCount, GeoList.end());
+    probe.addGeometry(intGeoList);
+    probe.addGeometry(extGeoList, true);
+    if (int(probe.Geoms.size()) != intGeoCount + extGeoCount)
+        return false;
+
+    for (int i=0; i < int(Geoms.size()); i++) {
+        const GeoDef &def = Geoms[i];
+        const GeoDef &cur = probe.Geoms[i < oldIntGeoCount ? i : i + intGeoCount - oldIntGeoCount];
+        if (def.type != cur.type ||
+            def.params.size() != cur.params.size() ||
+            def.fixParams.size() != cur.fixParams.size())
+            return false;
+    }
+
+    // from here on the solver model gets modified
+    try {
+        for (int i=0; i < int(Geoms.size()); i++) {
+            GeoDef &def = Geoms[i];
+            GeoDef &cur = probe.Geoms[i < oldIntGeoCount ? i : i + intGeoCount - oldIntGeoCount];
+            for (std::size_t j=0; j < def.params.size(); j++)
+                *def.params[j] = *cur.params[j];
+            for (std::size_t j=0; j < def.fixParams.size(); j++)
+                *def.fixParams[j] = *cur.fixParams[j];
+            // the copy also carries the construction flag
+            std::swap(def.geo, cur.geo);
+        }
+
+        // new geometry is inserted in front of the external geometry and
+        // its parameters in front of the parameters of the constraints, as
+        // the set up from scratch does
+        if (intGeoCount > oldIntGeoCount) {
+            std::vector<GeoDef> extGeoms(Geoms.begin()+oldIntGeoCount, Geoms.end());
+            Geoms.resize(oldIntGeoCount);
+            std::size_t paramsCount = Parameters.size();
+            std::vector<Part::Geometry *> newGeoList(GeoList.begin()+oldIntGeoCount,
+                                                     GeoList.begin()+intGeoCount);
+            addGeometry(newGeoList);
+            Geoms.insert(Geoms.end(), extGeoms.begin(), extGeoms.end());
+            std::rotate(Parameters.begin()+GeoParametersCount,
+                        Parameters.begin()+paramsCount, Parameters.end());
+            GeoParametersCount += int(Parameters.size() - paramsCount);
+        }
+
+        if (removed >= 0)
+            removeConstraint(removed);
+
+        // the constraint list is a new copy, and reference values were
+        // changed by the last solve
+        for (int i=0; i < int(Constrs.size()); i++) {
+            ConstrDef &c = Constrs[i];
+            c.constr = ConstraintList[i];
+            if (!c.driving) {
+                if (c.constr->Type == SnellsLaw)
+                    setRefractiveIndices(c.constr->Value, c.value, c.secondvalue);
+                else if (c.value)
+                    *c.value = c.constr->Value;
+            }
+        }
+
+        for (int i=int(Constrs.size()); i < newCount; i++) {
+            addConstraint(ConstraintList[i]);
+            SetUpConstraints.push_back(ConstraintList[i]->clone());
+        }
+
+        // geometry rules are tagged with 0 and go in front of all constraints
+        if (intGeoCount > oldIntGeoCount)
+            GCSsys.sortByTag();
+    }
+    catch (...) {
+        clear();
+        throw;
+    }
+
+    GCSsys.invalidateDiagnosis();
+    isInitMove = false;
+    return true;
+}
+
+void Sketch::removeConstraint(int index)
+{
+    ConstrDef &c = Constrs[index];
+    for (int tag = c.lastTag - c.tagCount + 1; tag <= c.lastTag; tag++)
+        GCSsys.clearByTag(tag);
+    GCSsys.shiftTags(c.lastTag, -c.tagCount);
+    for (std::size_t i=index+1; i < Constrs.size(); i++)
+        Constrs[i].lastTag -= c.tagCount;
+    ConstraintsCounter -= c.tagCount;
+
+    double *values[2] = {c.value, c.secondvalue};
+    for (int i=0; i < 2; i++) {
+        if (!values[i])
+            continue;
+        std::vector<double*> &params = c.driving ? FixParameters : Parameters;
+        std::vector<double*>::iterator it = std::find(params.begin(), params.end(), values[i]);
+        if (it != params.end())
+            params.erase(it);
+        delete values[i];
+    }
+
+    Constrs.erase(Constrs.begin()+index);
+    delete SetUpConstraints[index];
+    SetUpConstraints.erase(SetUpConstraints.begin()+index);
+}
+
+
 const char* nameByType(Sketch::GeoType type)
 {
     switch (type) {
@@ -246,8 +433,14 @@ int Sketch::addGeometry(const Part::Geometry *geo, bool fixed)
 int Sketch::addGeometry(const std::vector<Part::Geometry *> &geo, bool fixed)
 {
     int ret = -1;
-    for (std::vector<Part::Geometry *>::const_iterator it=geo.begin(); it != geo.end(); ++it)
+    for (std::vector<Part::Geometry *>::const_iterator it=geo.begin(); it != geo.end(); ++it) {
+        std::size_t params = Parameters.size();
+        std::size_t fixParams = FixParameters.size();
         ret = addGeometry(*it, fixed);
+        // remember the parameters of the geometry for the incremental set up
+        Geoms[ret].params.assign(Parameters.begin()+params, Parameters.end());
+        Geoms[ret].fixParams.assign(FixParameters.begin()+fixParams, FixParameters.end());
+    }
     return ret;
 }
 
@@ -1000,6 +1193,7 @@ int Sketch::addConstraint(const Constraint *constraint)
     if (Geoms.empty())
         throw Base::Exception("Sketch::addConstraint. Can't add constraint to a sketch with no geometry!");
     int rtn = -1;
+    int counter = ConstraintsCounter;
 
     ConstrDef c;
     c.constr=const_cast<Constraint *>(constraint);
@@ -1289,6 +1483,8 @@ int Sketch::addConstraint(const Constraint *constraint)
         break;
     }
 
+    c.lastTag = ConstraintsCounter;
+    c.tagCount = ConstraintsCounter - counter;
     Constrs.push_back(c);
     return rtn;
 }
@@ -2160,15 +2356,7 @@ int Sketch::addSnellsLawConstraint(int geoIdRay1, PointPos posRay1,
     double *n1 = value;
     double *n2 = secondvalue;
     
-    double n2divn1=*value;
-    
-    if ( fabs(n2divn1) >= 1.0 ){
-        *n2 = n2divn1;
-        *n1 = 1.0;
-    } else {
-        *n2 = 1.0;
-        *n1 = 1/n2divn1;
-    }
+    setRefractiveIndices(*value, n1, n2);
 
     int tag = -1;
     //tag = Sketch::addPointOnObjectConstraint(geoIdRay1, posRay1, geoIdBnd);//increases ConstraintsCounter
@@ -72,6 +72,14 @@ public:
       */
     int setUpSketch(const std::vector<Part::Geometry *> &GeoList, const std::vector<Constraint *> &ConstraintList,
                     int extGeoCount=0);
+    /** if set, setUpSketch() patches the solver model of the previous set up
+      * in place when geometry or constraints were appended or a single constraint
+      * was removed, instead of building it from scratch
+      */
+    inline void setIncrementalSetUp(bool on){incrementalSetUp=on;}
+    inline bool getIncrementalSetUp(void) const {return incrementalSetUp;}
+    /// number of set ups that patched the solver model of the previous one
+    inline int getIncrementalSetUpCount(void) const {return incrementalSetUpCount;}
     /// return the actual geometry of the sketch a TopoShape
     Part::TopoShape toShape(void) const;
     /// add unspecified geometry
@@ -361,17 +369,23 @@ protected:
         int               startPointId;    // index in Points of the start point of this geometry
         int               midPointId;      // index in Points of the start point of this geometry
         int               endPointId;      // index in Points of the end point of this geometry
+        std::vector<double*> params;       // the parameters of this geometry in Parameters
+        std::vector<double*> fixParams;    // the parameters of this geometry in FixParameters
     };
     /// container element to store and work with the constraints of this sketch
     struct ConstrDef {
         ConstrDef() : constr(0)
                     , driving(true)
                     , value(0)
-                    , secondvalue(0) {}
+                    , secondvalue(0)
+                    , lastTag(0)
+                    , tagCount(0) {}
         Constraint *    constr;             // pointer to the constraint
         bool            driving;
         double *        value;
         double *        secondvalue;        // this is needed for SnellsLaw
+        int             lastTag;            // the solver tags lastTag-tagCount+1 ... lastTag
+        int             tagCount;           // belong to this constraint
     };
 
     std::vector<GeoDef> Geoms;
@@ -398,6 +412,13 @@ protected:
     bool isInitMove;
     bool isFine;
 
+    // state of the last set up, needed by the incremental set up
+    bool incrementalSetUp;
+    int incrementalSetUpCount;
+    std::vector<Constraint *> SetUpConstraints; // copies of the constraints
+    int ExternalGeoCount;
+    int GeoParametersCount;                     // Parameters of the geometry, the rest belongs to constraints
+
 public:
     GCS::Algorithm defaultSolver;
     GCS::Algorithm defaultSolverRedundant;
@@ -411,6 +432,12 @@ public:
     inline void setConvergence(double conv){GCSsys.convergence=conv;}
     inline void setConvergenceRedundant(double conv){GCSsys.convergenceRedundant=conv;}
     inline void setQRAlgorithm(GCS::QRAlgorithm alg){GCSsys.qrAlgorithm=alg;}
+    inline void setJacobianAlgorithm(GCS::JacobianAlgorithm alg){GCSsys.jacobianAlgorithm=alg;}
+    inline GCS::JacobianAlgorithm getJacobianAlgorithm(void) const {return GCSsys.jacobianAlgorithm;}
+    inline void setParallelSolving(bool on){GCSsys.parallelSolving=on;}
+    inline bool getParallelSolving(void) const {return GCSsys.parallelSolving;}
+    inline void setIncrementalDiagnosis(bool on){GCSsys.incrementalDiagnosis=on;}
+    inline bool getIncrementalDiagnosis(void) const {return GCSsys.incrementalDiagnosis;}
     inline void setQRPivotThreshold(double val){GCSsys.qrpivotThreshold=val;}
     inline void setLM_eps(double val){GCSsys.LM_eps=val;}
     inline void setLM_eps1(double val){GCSsys.LM_eps1=val;}
@@ -434,6 +461,15 @@ private:
     bool updateGeometry(void);
     bool updateNonDrivingConstraints(void);
 
+    /// patches the solver model of the last set up, returns false if this isn't possible
+    bool updateSketch(const std::vector<Part::Geometry *> &GeoList,
+                      const std::vector<Constraint *> &ConstraintList,
+                      int extGeoCount);
+    /// removes the constraint with the given index from the solver model
+    void removeConstraint(int index);
+    /// compares everything of two constraints the solver model depends on
+    static bool isSameConstraint(const Constraint *c1, const Constraint *c2);
+
     /// checks if the index bounds and converts negative indices to positive
     int checkGeoId(int geoId);
     GCS::Curve* getGCSCurveByGeoId(int geoId);
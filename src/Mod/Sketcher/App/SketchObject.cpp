@@ -61,6 +61,7 @@
 
 #include <boost/bind.hpp>
 
+#include <App/Application.h>
 #include <App/Document.h>
 #include <App/FeaturePythonPyImp.h>
 #include <App/Part.h>
@@ -124,6 +125,10 @@ SketchObject::SketchObject()
     
     noRecomputes=false;
 
+    ParameterGrp::handle hGrp = App::GetApplication().GetParameterGroupByPath("User parameter:BaseApp/Preferences/Mod/Sketcher/SolverAdvanced");
+    solvedSketch.setIncrementalSetUp(hGrp->GetBool("IncrementalSetUp", false));
+    solvedSketch.setIncrementalDiagnosis(hGrp->GetBool("IncrementalDiagnosis", false));
+
     ExpressionEngine.setValidator(boost::bind(&Sketcher::SketchObject::validateExpression, this, _1, _2));
 
     constraintsRemovedConn = Constraints.signalConstraintsRemoved.connect(boost::bind(&Sketcher::SketchObject::constraintsRemoved, this, _1));
@@ -1174,6 +1174,11 @@ Py::Long SketchObjectPy::getAxisCount(void) const
     return Py::Long(this->getSketchObjectPtr()->getAxisCount());
 }
 
+Py::Long SketchObjectPy::getIncrementalSetUpCount(void) const
+{
+    return Py::Long(this->getSketchObjectPtr()->getSolvedSketch().getIncrementalSetUpCount());
+}
+
 PyObject *SketchObjectPy::getCustomAttributes(const char* /*attr*/) const
 {
     return 0;
@@ -203,6 +203,36 @@ Py::Object SketchPy::getShape(void) const
     return Py::Object(new TopoShapePy(new TopoShape(getSketchPtr()->toShape())));
 }
 
+Py::Boolean SketchPy::getSparseJacobian(void) const
+{
+    return Py::Boolean(getSketchPtr()->getJacobianAlgorithm() == GCS::SparseJacobian);
+}
+
+void SketchPy::setSparseJacobian(Py::Boolean arg)
+{
+    getSketchPtr()->setJacobianAlgorithm((bool)arg ? GCS::SparseJacobian : GCS::DenseJacobian);
+}
+
+Py::Boolean SketchPy::getParallelSolving(void) const
+{
+    return Py::Boolean(getSketchPtr()->getParallelSolving());
+}
+
+void SketchPy::setParallelSolving(Py::Boolean arg)
+{
+    getSketchPtr()->setParallelSolving((bool)arg);
+}
+
+Py::Boolean SketchPy::getIncrementalDiagnosis(void) const
+{
+    return Py::Boolean(getSketchPtr()->getIncrementalDiagnosis());
+}
+
+void SketchPy::setIncrementalDiagnosis(Py::Boolean arg)
+{
+    getSketchPtr()->setIncrementalDiagnosis((bool)arg);
+}
+
 
 // +++ custom attributes implementer ++++++++++++++++++++++++++++++++++++++++
 
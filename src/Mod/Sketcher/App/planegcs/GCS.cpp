@@ -72,6 +72,9 @@
 
 #include <FCConfig.h>
 #include <Base/Console.h>
+#include <Base/TimeInfo.h>
+
+#include <QtConcurrentMap>
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/connected_components.hpp>
@@ -181,6 +184,47 @@ namespace GCS
 
 typedef boost::adjacency_list <boost::vecS, boost::vecS, boost::undirectedS> Graph;
 
+// a decoupled component of the system together with its solver result
+struct ComponentSolve
+{
+    int cid;
+    SubSystem *subsys;
+    SubSystem *subsysAux;
+    int res;
+    double time;
+};
+
+// solves one component, possibly in a worker thread. Components share
+// neither parameters nor constraints, so they don't interfere.
+class ComponentSolver
+{
+public:
+    typedef void result_type;
+
+    ComponentSolver(System *sys, bool isFine, Algorithm alg, bool isRedundantsolving)
+      : sys(sys), isFine(isFine), alg(alg), isRedundantsolving(isRedundantsolving)
+    {
+    }
+    void operator()(ComponentSolve &c) const
+    {
+        Base::TimeInfo start_time;
+        if (c.subsys && c.subsysAux)
+            c.res = sys->solve(c.subsys, c.subsysAux, isFine, isRedundantsolving);
+        else if (c.subsys)
+            c.res = sys->solve(c.subsys, isFine, alg, isRedundantsolving);
+        else
+            c.res = sys->solve(c.subsysAux, isFine, alg, isRedundantsolving);
+        Base::TimeInfo end_time;
+        c.time = Base::TimeInfo::diffTimeF(start_time, end_time);
+    }
+
+private:
+    System *sys;
+    bool isFine;
+    Algorithm alg;
+    bool isRedundantsolving;
+};
+
 ///////////////////////////////////////
 // Solver
 ///////////////////////////////////////
@@ -205,6 +249,9 @@ System::System()
   , convergence(1e-10)
   , convergenceRedundant(1e-10)
   , qrAlgorithm(EigenSparseQR)
+  , jacobianAlgorithm(DenseJacobian)
+  , parallelSolving(false)
+  , incrementalDiagnosis(false)
   , dogLegGaussStep(FullPivLU)
   , qrpivotThreshold(1E-13)
   , debugMode(Minimal)
@@ -318,6 +365,7 @@ void System::clear()
 
     reference.clear();
     clearSubSystems();
+    diagnosedComponents.clear();
     free(clist);
     c2p.clear();
     p2c.clear();
@@ -337,6 +385,29 @@ void System::clearByTag(int tagId)
     }
 }
 
+void System::shiftTags(int tagId, int offset)
+{
+    for (std::vector<Constraint *>::const_iterator
+         constr=clist.begin(); constr != clist.end(); ++constr) {
+        if ((*constr)->getTag() > tagId)
+            (*constr)->setTag((*constr)->getTag() + offset);
+    }
+    hasDiagnosis = false;
+}
+
+static bool tagLess(Constraint *c1, Constraint *c2)
+{
+    return c1->getTag() < c2->getTag();
+}
+
+void System::sortByTag()
+{
+    // gives the order the constraints have when they are added tag by tag
+    std::stable_sort(clist.begin(), clist.end(), tagLess);
+    isInit = false;
+    hasDiagnosis = false;
+}
+
 int System::addConstraint(Constraint *constr)
 {
     isInit = false;
@@ -1241,21 +1312,42 @@ int System::solve(bool isFine, Algorithm alg, bool isRedundantsolving)
     if (!isInit)
         return Failed;
 
-    bool isReset = false;
+    std::vector<ComponentSolve> components;
+    for (int cid=0; cid < int(subSystems.size()); cid++) {
+        if (subSystems[cid] || subSystemsAux[cid]) {
+            ComponentSolve c = {cid, subSystems[cid], subSystemsAux[cid], Success, 0.};
+            components.push_back(c);
+        }
+    }
+
+    if (!components.empty())
+        resetToReference();
+
+    ComponentSolver solver(this, isFine, alg, isRedundantsolving);
+    if (parallelSolving && components.size() > 1)
+        QtConcurrent::blockingMap(components, solver);
+    else
+        std::for_each(components.begin(), components.end(), solver);
+
     // return success by default in order to permit coincidence constraints to be applied
     // even if no other system has to be solved
+    // the results are merged in component order, independent of the scheduling
     int res = Success;
-    for (int cid=0; cid < int(subSystems.size()); cid++) {
-        if ((subSystems[cid] || subSystemsAux[cid]) && !isReset) {
-             resetToReference();
-             isReset = true;
+    for (std::vector<ComponentSolve>::const_iterator it=components.begin(); it != components.end(); ++it) {
+        res = std::max(res, it->res);
+
+        if (debugMode==IterationLevel) {
+            std::stringstream stream;
+            stream  << "Component: "        << it->cid
+                    << ", params: "         << plists[it->cid].size()
+                    << ", constraints: "    << clists[it->cid].size()
+                    << ", result: "         << it->res
+                    << ", time: "           << it->time
+                    << (parallelSolving && components.size() > 1 ? " (parallel)" : "") << "\n";
+
+            const std::string tmp = stream.str();
+            printf(tmp.c_str());
         }
-        if (subSystems[cid] && subSystemsAux[cid])
-            res = std::max(res, solve(subSystems[cid], subSystemsAux[cid], isFine, isRedundantsolving));
-        else if (subSystems[cid])
-            res = std::max(res, solve(subSystems[cid], isFine, alg, isRedundantsolving));
-        else if (subSystemsAux[cid])
-            res = std::max(res, solve(subSystemsAux[cid], isFine, alg, isRedundantsolving));
     }
     if (res == Success) {
         for (std::set<Constraint *>::const_iterator constr=redundant.begin();
@@ -1425,6 +1517,12 @@ int System::solve_LM(SubSystem* subsys, bool isRedundantsolving)
     Eigen::MatrixXd A(xsize, xsize);
     Eigen::VectorXd x(xsize), h(xsize), x_new(xsize), g(xsize), diag_A(xsize);
 
+    // sparse counterparts of J and A, used with jacobianAlgorithm == SparseJacobian
+    bool sparse = (jacobianAlgorithm == SparseJacobian);
+    Eigen::SparseMatrix<double> Js, As, Is(xsize, xsize);
+    if (sparse)
+        Is.setIdentity();
+
     subsys->redirectParams();
 
     subsys->getParams(x);
@@ -1470,14 +1568,23 @@ int System::solve_LM(SubSystem* subsys, bool isRedundantsolving)
         }
 
         // J^T J, J^T e
-        subsys->calcJacobi(J);;
+        if (sparse) {
+            subsys->calcJacobi(Js);
 
-        A = J.transpose()*J;
-        g = J.transpose()*e;
+            As = Js.transpose()*Js;
+            g = Js.transpose()*e;
+            diag_A = As.diagonal();
+        }
+        else {
+            subsys->calcJacobi(J);;
+
+            A = J.transpose()*J;
+            g = J.transpose()*e;
+            diag_A = A.diagonal(); // save diagonal entries so that augmentation can be later canceled
+        }
 
         // Compute ||J^T e||_inf
         double g_inf = g.lpNorm<Eigen::Infinity>();
-        diag_A = A.diagonal(); // save diagonal entries so that augmentation can be later canceled
 
         // check for convergence
         if (g_inf <= eps1) {
@@ -1493,13 +1600,23 @@ int System::solve_LM(SubSystem* subsys, bool isRedundantsolving)
         // determine increment using adaptive damping
         int k=0;
         while (k < 50) {
-            // augment normal equations A = A+uI
-            for (int i=0; i < xsize; ++i)
-                A(i,i) += mu;
+            double rel_error;
+            if (sparse) {
+                // A+uI is positive definite for u > 0
+                Eigen::SparseMatrix<double> Aaug = As + mu*Is;
+                Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > ldlt(Aaug);
+                h = ldlt.solve(g);
+                rel_error = (ldlt.info() == Eigen::Success) ? (Aaug*h - g).norm() / g.norm() : 1.;
+            }
+            else {
+                // augment normal equations A = A+uI
+                for (int i=0; i < xsize; ++i)
+                    A(i,i) += mu;
 
-            //solve augmented functions A*h=-g
-            h = A.fullPivLu().solve(g);
-            double rel_error = (A*h - g).norm() / g.norm();
+                //solve augmented functions A*h=-g
+                h = A.fullPivLu().solve(g);
+                rel_error = (A*h - g).norm() / g.norm();
+            }
 
             // check if solving works
             if (rel_error < 1e-5) {
@@ -1546,8 +1663,10 @@ int System::solve_LM(SubSystem* subsys, bool isRedundantsolving)
 
             mu*=nu;
             nu*=2.0;
-            for (int i=0; i < xsize; ++i) // restore diagonal J^T J entries
-                A(i,i) = diag_A(i);
+            if (!sparse) {
+                for (int i=0; i < xsize; ++i) // restore diagonal J^T J entries
+                    A(i,i) = diag_A(i);
+            }
 
             k++;
         }
@@ -1613,9 +1732,15 @@ int System::solve_DL(SubSystem* subsys, bool isRedundantsolving)
         printf(tmp.c_str());
     }
 
+    // with jacobianAlgorithm == SparseJacobian only the sparse Jacobians are filled
+    bool sparse = (jacobianAlgorithm == SparseJacobian);
+    int jrows = sparse ? 0 : csize;
+    int jcols = sparse ? 0 : xsize;
+
     Eigen::VectorXd x(xsize), x_new(xsize);
     Eigen::VectorXd fx(csize), fx_new(csize);
-    Eigen::MatrixXd Jx(csize, xsize), Jx_new(csize, xsize);
+    Eigen::MatrixXd Jx(jrows, jcols), Jx_new(jrows, jcols);
+    Eigen::SparseMatrix<double> Jxs, Jxs_new;
     Eigen::VectorXd g(xsize), h_sd(xsize), h_gn(xsize), h_dl(xsize);
 
     subsys->redirectParams();
@@ -1623,9 +1748,14 @@ int System::solve_DL(SubSystem* subsys, bool isRedundantsolving)
     double err;
     subsys->getParams(x);
     subsys->calcResidual(fx, err);
-    subsys->calcJacobi(Jx);
-
-    g = Jx.transpose()*(-fx);
+    if (sparse) {
+        subsys->calcJacobi(Jxs);
+        g = Jxs.transpose()*(-fx);
+    }
+    else {
+        subsys->calcJacobi(Jx);
+        g = Jx.transpose()*(-fx);
+    }
 
     // get the infinity norm fx_inf and g_inf
     double g_inf = g.lpNorm<Eigen::Infinity>();
@@ -1653,25 +1783,71 @@ int System::solve_DL(SubSystem* subsys, bool isRedundantsolving)
         }
         else {
             // get the steepest descent direction
-            alpha = g.squaredNorm()/(Jx*g).squaredNorm();
+            if (sparse)
+                alpha = g.squaredNorm()/(Jxs*g).squaredNorm();
+            else
+                alpha = g.squaredNorm()/(Jx*g).squaredNorm();
             h_sd  = alpha*g;
 
             // get the gauss-newton step
             // http://forum.freecadweb.org/viewtopic.php?f=10&t=12769&start=50#p106220
             // https://forum.kde.org/viewtopic.php?f=74&t=129439#p346104
-            switch (dogLegGaussStep){
-                case FullPivLU:
-                    h_gn = Jx.fullPivLu().solve(-fx);
-                    break;
-                case LeastNormFullPivLU:
-                    h_gn = Jx.adjoint()*(Jx*Jx.adjoint()).fullPivLu().solve(-fx);
-                    break;
-                case LeastNormLdlt:
-                    h_gn = Jx.adjoint()*(Jx*Jx.adjoint()).ldlt().solve(-fx);
-                    break;
+            double rel_error;
+            if (sparse) {
+                // the least norm steps factorize the sparse J*J^T, the full pivoting LU
+                // step and a failed factorization (e.g. a singular J*J^T of redundant
+                // constraints) take the least squares solution of a sparse QR of J
+                bool solved = false;
+                if (dogLegGaussStep == LeastNormFullPivLU) {
+                    Eigen::SparseMatrix<double> JJt = Jxs*Jxs.transpose();
+                    Eigen::SparseLU<Eigen::SparseMatrix<double> > lu(JJt);
+                    if (lu.info() == Eigen::Success) {
+                        h_gn = Jxs.transpose()*lu.solve(-fx);
+                        solved = (lu.info() == Eigen::Success);
+                    }
+                }
+                else if (dogLegGaussStep == LeastNormLdlt) {
+                    Eigen::SparseMatrix<double> JJt = Jxs*Jxs.transpose();
+                    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > ldlt(JJt);
+                    if (ldlt.info() == Eigen::Success) {
+                        h_gn = Jxs.transpose()*ldlt.solve(-fx);
+                        solved = (ldlt.info() == Eigen::Success);
+                    }
+                }
+
+#ifdef EIGEN_SPARSEQR_COMPATIBLE
+                if (!solved) {
+                    Jxs.makeCompressed();
+                    Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int> > qr(Jxs);
+                    if (qr.info() == Eigen::Success) {
+                        h_gn = qr.solve(-fx);
+                        solved = (qr.info() == Eigen::Success);
+                    }
+                }
+#endif
+
+                // only if the QR failed, or there is no SparseQR in this Eigen version
+                if (!solved) {
+                    Eigen::MatrixXd Jd = Jxs;
+                    h_gn = Jd.fullPivLu().solve(-fx);
+                }
+                rel_error = (Jxs*h_gn + fx).norm() / fx.norm();
             }
+            else {
+                switch (dogLegGaussStep){
+                    case FullPivLU:
+                        h_gn = Jx.fullPivLu().solve(-fx);
+                        break;
+                    case LeastNormFullPivLU:
+                        h_gn = Jx.adjoint()*(Jx*Jx.adjoint()).fullPivLu().solve(-fx);
+                        break;
+                    case LeastNormLdlt:
+                        h_gn = Jx.adjoint()*(Jx*Jx.adjoint()).ldlt().solve(-fx);
+                        break;
+                }
 
-            double rel_error = (Jx*h_gn + fx).norm() / fx.norm();
+                rel_error = (Jx*h_gn + fx).norm() / fx.norm();
+            }
             if (rel_error > 1e15)
                 break;
 
@@ -1719,20 +1895,30 @@ int System::solve_DL(SubSystem* subsys, bool isRedundantsolving)
         x_new = x + h_dl;
         subsys->setParams(x_new);
         subsys->calcResidual(fx_new, err_new);
-        subsys->calcJacobi(Jx_new);
+        if (sparse)
+            subsys->calcJacobi(Jxs_new);
+        else
+            subsys->calcJacobi(Jx_new);
 
         // calculate the linear model and the update ratio
-        double dL = err - 0.5*(fx + Jx*h_dl).squaredNorm();
+        double dL = sparse ? err - 0.5*(fx + Jxs*h_dl).squaredNorm()
+                           : err - 0.5*(fx + Jx*h_dl).squaredNorm();
         double dF = err - err_new;
         double rho = dL/dF;
 
         if (dF > 0 && dL > 0) {
             x  = x_new;
-            Jx = Jx_new;
             fx = fx_new;
             err = err_new;
 
-            g = Jx.transpose()*(-fx);
+            if (sparse) {
+                Jxs = Jxs_new;
+                g = Jxs.transpose()*(-fx);
+            }
+            else {
+                Jx = Jx_new;
+                g = Jx.transpose()*(-fx);
+            }
 
             // get infinity norms
             g_inf = g.lpNorm<Eigen::Infinity>();
@@ -3529,6 +3715,163 @@ int System::diagnose(Algorithm alg)
     redundant.clear();
     conflictingTags.clear();
     redundantTags.clear();
+    int paramsNum = 0;
+    int constrNum = 0;
+    int rank = 0;
+    std::vector< std::vector<Constraint *> > conflictGroups;
+    if (incrementalDiagnosis)
+        diagnoseComponents(paramsNum, constrNum, rank, conflictGroups);
+    else
+        diagnoseSystem(paramsNum, constrNum, rank, conflictGroups);
+
+    if (!clist.empty()) {
+        if (constrNum > rank) { // conflicting or redundant constraints
+            // try to remove the conflicting constraints and solve the
+            // system in order to check if the removed constraints were
+            // just redundant but not really conflicting
+            std::set<Constraint *> skipped;
+            SET_I satisfiedGroups;
+            while (1) {
+                std::map< Constraint *, SET_I > conflictingMap;
+                for (std::size_t i=0; i < conflictGroups.size(); i++) {
+                    if (satisfiedGroups.count(i) == 0) {
+                        for (std::size_t j=0; j < conflictGroups[i].size(); j++) {
+                            Constraint *constr = conflictGroups[i][j];
+                            if (constr->getTag() != 0) // exclude constraints tagged with zero
+                                conflictingMap[constr].insert(i);
+                        }
+                    }
+                }
+                if (conflictingMap.empty())
+                    break;
+
+                int maxPopularity = 0;
+                Constraint *mostPopular = NULL;
+                for (std::map< Constraint *, SET_I >::const_iterator it=conflictingMap.begin();
+                     it != conflictingMap.end(); ++it) {
+                    if (static_cast<int>(it->second.size()) > maxPopularity ||
+                        (static_cast<int>(it->second.size()) == maxPopularity && mostPopular &&
+                         it->first->getTag() > mostPopular->getTag())) {
+                        mostPopular = it->first;
+                        maxPopularity = it->second.size();
+                    }
+                }
+                if (maxPopularity > 0) {
+                    skipped.insert(mostPopular);
+                    for (SET_I::const_iterator it=conflictingMap[mostPopular].begin();
+                         it != conflictingMap[mostPopular].end(); ++it)
+                        satisfiedGroups.insert(*it);
+                }
+            }
+
+            std::vector<Constraint *> clistTmp;
+            clistTmp.reserve(clist.size());
+            for (std::vector<Constraint *>::iterator constr=clist.begin();
+                constr != clist.end(); ++constr) {
+                if (skipped.count(*constr) == 0)
+                    clistTmp.push_back(*constr);
+            }
+
+            SubSystem *subSysTmp = new SubSystem(clistTmp, plist);
+            int res = solve(subSysTmp,true,alg,true);
+
+            if(debugMode==Minimal || debugMode==IterationLevel) {
+                std::string solvername;
+                switch (alg) {
+                    case 0:
+                        solvername = "BFGS";
+                        break;
+                    case 1: // solving with the LevenbergMarquardt solver
+                        solvername = "LevenbergMarquardt";
+                        break;
+                    case 2: // solving with the BFGS solver
+                        solvername = "DogLeg";
+                        break;
+                }
+
+                printf("Sketcher::RedundantSolving-%s-\n",solvername.c_str());
+            }
+
+            if (res == Success) {
+                subSysTmp->applySolution();
+                for (std::set<Constraint *>::const_iterator constr=skipped.begin();
+                     constr != skipped.end(); ++constr) {
+                    double err = (*constr)->error();
+                    if (err * err < convergenceRedundant)
+                        redundant.insert(*constr);
+                }
+                resetToReference();
+
+                if(debugMode==Minimal || debugMode==IterationLevel) {
+                    printf("Sketcher Redundant solving: %d redundants\n",redundant.size());
+                }
+
+                std::vector< std::vector<Constraint *> > conflictGroupsOrig=conflictGroups;
+                conflictGroups.clear();
+                for (int i=conflictGroupsOrig.size()-1; i >= 0; i--) {
+                    bool isRedundant = false;
+                    for (std::size_t j=0; j < conflictGroupsOrig[i].size(); j++) {
+                        if (redundant.count(conflictGroupsOrig[i][j]) > 0) {
+                            isRedundant = true;
+                            break;
+                        }
+                    }
+                    if (!isRedundant)
+                        conflictGroups.push_back(conflictGroupsOrig[i]);
+                    else
+                        constrNum--;
+                }
+            }
+            delete subSysTmp;
+
+            // simplified output of conflicting tags
+            SET_I conflictingTagsSet;
+            for (std::size_t i=0; i < conflictGroups.size(); i++) {
+                for (std::size_t j=0; j < conflictGroups[i].size(); j++) {
+                    conflictingTagsSet.insert(conflictGroups[i][j]->getTag());
+                }
+            }
+            conflictingTagsSet.erase(0); // exclude constraints tagged with zero
+            conflictingTags.resize(conflictingTagsSet.size());
+            std::copy(conflictingTagsSet.begin(), conflictingTagsSet.end(),
+                      conflictingTags.begin());
+
+            // output of redundant tags
+            SET_I redundantTagsSet;
+            for (std::set<Constraint *>::iterator constr=redundant.begin();
+                 constr != redundant.end(); ++constr)
+                redundantTagsSet.insert((*constr)->getTag());
+            // remove tags represented at least in one non-redundant constraint
+            for (std::vector<Constraint *>::iterator constr=clist.begin();
+                constr != clist.end(); ++constr) {
+                if (redundant.count(*constr) == 0)
+                    redundantTagsSet.erase((*constr)->getTag());
+            }
+            redundantTags.resize(redundantTagsSet.size());
+            std::copy(redundantTagsSet.begin(), redundantTagsSet.end(),
+                      redundantTags.begin());
+
+            if (paramsNum == rank && constrNum > rank) { // over-constrained
+                hasDiagnosis = true;
+                dofs = paramsNum - constrNum;
+                return dofs;
+            }
+        }
+
+        hasDiagnosis = true;
+        dofs = paramsNum - rank;
+        return dofs;
+    }
+
+    hasDiagnosis = true;
+    dofs = plist.size();
+    return dofs;
+}
+
+void System::diagnoseSystem(int &paramsNum, int &constrNum, int &rank,
+                            std::vector< std::vector<Constraint *> > &conflictGroups)
+{
+    // QR decomposition of the transposed Jacobian of the whole system
     Eigen::MatrixXd J(clist.size(), plist.size());
     int count=0;
     for (std::vector<Constraint *>::iterator constr=clist.begin(); constr != clist.end(); ++constr) {
@@ -3574,9 +3917,6 @@ int System::diagnose(Algorithm alg)
 #endif
 
     Eigen::MatrixXd R;
-    int paramsNum = 0;
-    int constrNum = 0;
-    int rank = 0;
     Eigen::FullPivHouseholderQR<Eigen::MatrixXd> qrJT;
 
     if(qrAlgorithm==EigenDenseQR){
@@ -3679,7 +4019,7 @@ int System::diagnose(Algorithm alg)
                     }
                 }
             }
-            std::vector< std::vector<Constraint *> > conflictGroups(constrNum-rank);
+            conflictGroups.resize(constrNum-rank);
             for (int j=rank; j < constrNum; j++) {
                 for (int row=0; row < rank; row++) {
                     if (fabs(R(row,j)) > 1e-10) {
@@ -3707,147 +4047,226 @@ int System::diagnose(Algorithm alg)
 
                 conflictGroups[j-rank].push_back(clist[origCol]);
             }
+        }
+    }
+}
 
-            // try to remove the conflicting constraints and solve the
-            // system in order to check if the removed constraints were
-            // just redundant but not really conflicting
-            std::set<Constraint *> skipped;
-            SET_I satisfiedGroups;
-            while (1) {
-                std::map< Constraint *, SET_I > conflictingMap;
-                for (std::size_t i=0; i < conflictGroups.size(); i++) {
-                    if (satisfiedGroups.count(i) == 0) {
-                        for (std::size_t j=0; j < conflictGroups[i].size(); j++) {
-                            Constraint *constr = conflictGroups[i][j];
-                            if (constr->getTag() != 0) // exclude constraints tagged with zero
-                                conflictingMap[constr].insert(i);
-                        }
-                    }
-                }
-                if (conflictingMap.empty())
-                    break;
+void System::diagnoseComponents(int &paramsNum, int &constrNum, int &rank,
+                                std::vector< std::vector<Constraint *> > &conflictGroups)
+{
+    // After reordering, the Jacobian of decoupled components is block diagonal.
+    // Its rank and the dependencies between its rows are those of the blocks.
+    // The QR decomposition of a block is kept and only recomputed if the
+    // block changed since the last diagnosis.
+#ifndef EIGEN_SPARSEQR_COMPATIBLE
+    if(qrAlgorithm==EigenSparseQR){
+        printf("SparseQR not supported by you current version of Eigen. It requires Eigen 3.2.2 or higher. Falling back to Dense QR\n");
+        qrAlgorithm=EigenDenseQR;
+    }
+#endif
 
-                int maxPopularity = 0;
-                Constraint *mostPopular = NULL;
-                for (std::map< Constraint *, SET_I >::const_iterator it=conflictingMap.begin();
-                     it != conflictingMap.end(); ++it) {
-                    if (static_cast<int>(it->second.size()) > maxPopularity ||
-                        (static_cast<int>(it->second.size()) == maxPopularity && mostPopular &&
-                         it->first->getTag() > mostPopular->getTag())) {
-                        mostPopular = it->first;
-                        maxPopularity = it->second.size();
-                    }
-                }
-                if (maxPopularity > 0) {
-                    skipped.insert(mostPopular);
-                    for (SET_I::const_iterator it=conflictingMap[mostPopular].begin();
-                         it != conflictingMap[mostPopular].end(); ++it)
-                        satisfiedGroups.insert(*it);
-                }
-            }
+    std::vector<Constraint *> clistJ; // the constraints that make up the rows of the Jacobian
+    for (std::vector<Constraint *>::iterator constr=clist.begin(); constr != clist.end(); ++constr) {
+        (*constr)->revertParams();
+        if ((*constr)->getTag() >= 0)
+            clistJ.push_back(*constr);
+    }
 
-            std::vector<Constraint *> clistTmp;
-            clistTmp.reserve(clist.size());
-            for (std::vector<Constraint *>::iterator constr=clist.begin();
-                constr != clist.end(); ++constr) {
-                if (skipped.count(*constr) == 0)
-                    clistTmp.push_back(*constr);
-            }
+    // partitioning into decoupled components
+    Graph g;
+    for (int i=0; i < int(plist.size() + clistJ.size()); i++)
+        boost::add_vertex(g);
 
-            SubSystem *subSysTmp = new SubSystem(clistTmp, plist);
-            int res = solve(subSysTmp,true,alg,true);
+    int cvtid = int(plist.size());
+    for (std::vector<Constraint *>::const_iterator constr=clistJ.begin();
+         constr != clistJ.end(); ++constr, cvtid++) {
+        VEC_pD &cparams = c2p[*constr];
+        for (VEC_pD::const_iterator param=cparams.begin();
+             param != cparams.end(); ++param) {
+            MAP_pD_I::const_iterator it = pIndex.find(*param);
+            if (it != pIndex.end())
+                boost::add_edge(cvtid, it->second, g);
+        }
+    }
 
-            if(debugMode==Minimal || debugMode==IterationLevel) {
-                std::string solvername;
-                switch (alg) {
-                    case 0:
-                        solvername = "BFGS";
-                        break;
-                    case 1: // solving with the LevenbergMarquardt solver
-                        solvername = "LevenbergMarquardt";
-                        break;
-                    case 2: // solving with the BFGS solver
-                        solvername = "DogLeg";
-                        break;
-                }
+    VEC_I components(boost::num_vertices(g));
+    int componentsSize = 0;
+    if (!components.empty())
+        componentsSize = boost::connected_components(g, &components[0]);
 
-                printf("Sketcher::RedundantSolving-%s-\n",solvername.c_str());
-            }
+    std::vector<DiagnosedComponent> blocks(componentsSize);
+    for (int i=0; i < int(plist.size()); i++)
+        blocks[components[i]].plist.push_back(plist[i]);
+    for (int i=0; i < int(clistJ.size()); i++) {
+        DiagnosedComponent &block = blocks[components[plist.size()+i]];
+        block.clist.push_back(clistJ[i]);
+        block.rows.push_back(i);
+    }
 
-            if (res == Success) {
-                subSysTmp->applySolution();
-                for (std::set<Constraint *>::const_iterator constr=skipped.begin();
-                     constr != skipped.end(); ++constr) {
-                    double err = (*constr)->error();
-                    if (err * err < convergenceRedundant)
-                        redundant.insert(*constr);
-                }
-                resetToReference();
+    // components without constraints don't contribute to the rank
+    std::vector<DiagnosedComponent> constrained;
+    constrained.reserve(blocks.size());
+    for (std::vector<DiagnosedComponent>::iterator block=blocks.begin(); block != blocks.end(); ++block) {
+        if (!block->clist.empty()) {
+            constrained.push_back(DiagnosedComponent());
+            std::swap(constrained.back().clist, block->clist);
+            std::swap(constrained.back().plist, block->plist);
+            std::swap(constrained.back().rows, block->rows);
+        }
+    }
+    blocks.swap(constrained);
+
+    double max2Norm = 0.;
+    for (std::vector<DiagnosedComponent>::iterator block=blocks.begin(); block != blocks.end(); ++block) {
+        block->J.resize(block->clist.size(), block->plist.size());
+        for (int i=0; i < int(block->clist.size()); i++) {
+            for (int j=0; j < int(block->plist.size()); j++)
+                block->J(i,j) = block->clist[i]->grad(block->plist[j]);
+            max2Norm = std::max(max2Norm, block->J.row(i).norm());
+        }
+    }
 
-                if(debugMode==Minimal || debugMode==IterationLevel) {
-                    printf("Sketcher Redundant solving: %d redundants\n",redundant.size());
-                }
+    // the sparse QR uses the pivot threshold it would take for the whole
+    // Jacobian, so that each block gets the same rank as within the whole
+    double pivotThreshold = 0.;
+    if (qrAlgorithm==EigenSparseQR) {
+        if (max2Norm == 0.)
+            max2Norm = 1.;
+        pivotThreshold = 20 * (plist.size() + clistJ.size()) * max2Norm *
+                         std::numeric_limits<double>::epsilon();
+    }
 
-                std::vector< std::vector<Constraint *> > conflictGroupsOrig=conflictGroups;
-                conflictGroups.clear();
-                for (int i=conflictGroupsOrig.size()-1; i >= 0; i--) {
-                    bool isRedundant = false;
-                    for (std::size_t j=0; j < conflictGroupsOrig[i].size(); j++) {
-                        if (redundant.count(conflictGroupsOrig[i][j]) > 0) {
-                            isRedundant = true;
-                            break;
-                        }
-                    }
-                    if (!isRedundant)
-                        conflictGroups.push_back(conflictGroupsOrig[i]);
-                    else
-                        constrNum--;
-                }
+    std::map<Constraint *, std::size_t> previous;
+    for (std::size_t i=0; i < diagnosedComponents.size(); i++)
+        previous[diagnosedComponents[i].clist.front()] = i;
+
+    int reused = 0;
+    for (std::vector<DiagnosedComponent>::iterator block=blocks.begin(); block != blocks.end(); ++block) {
+        block->qrAlgorithm = qrAlgorithm;
+        block->pivotThreshold = pivotThreshold;
+
+        std::map<Constraint *, std::size_t>::const_iterator it = previous.find(block->clist.front());
+        if (it != previous.end()) {
+            DiagnosedComponent &old = diagnosedComponents[it->second];
+            if (old.clist == block->clist && old.plist == block->plist &&
+                old.qrAlgorithm == block->qrAlgorithm &&
+                old.pivotThreshold == block->pivotThreshold &&
+                old.J.rows() == block->J.rows() && old.J.cols() == block->J.cols() &&
+                old.J == block->J) {
+                std::swap(block->R, old.R);
+                std::swap(block->colsPermutation, old.colsPermutation);
+                block->nonzeroPivots = old.nonzeroPivots;
+                block->maxPivot = old.maxPivot;
+                reused++;
+                continue;
             }
-            delete subSysTmp;
+        }
 
-            // simplified output of conflicting tags
-            SET_I conflictingTagsSet;
-            for (std::size_t i=0; i < conflictGroups.size(); i++) {
-                for (std::size_t j=0; j < conflictGroups[i].size(); j++) {
-                    conflictingTagsSet.insert(conflictGroups[i][j]->getTag());
-                }
-            }
-            conflictingTagsSet.erase(0); // exclude constraints tagged with zero
-            conflictingTags.resize(conflictingTagsSet.size());
-            std::copy(conflictingTagsSet.begin(), conflictingTagsSet.end(),
-                      conflictingTags.begin());
+        int blockParams = block->J.cols();
+        int blockConstr = block->J.rows();
+        if (blockParams == 0) {
+            // constraints on fixed parameters only
+            block->R.resize(0, blockConstr);
+            block->colsPermutation.resize(blockConstr);
+            for (int j=0; j < blockConstr; j++)
+                block->colsPermutation[j] = j;
+            block->nonzeroPivots = 0;
+            block->maxPivot = 0.;
+        }
+        else if (qrAlgorithm==EigenDenseQR) {
+            Eigen::FullPivHouseholderQR<Eigen::MatrixXd> qrJT(block->J.transpose());
+            if (blockConstr >= blockParams)
+                block->R = qrJT.matrixQR().triangularView<Eigen::Upper>();
+            else
+                block->R = qrJT.matrixQR().topRows(blockConstr)
+                                .triangularView<Eigen::Upper>();
+            block->colsPermutation.assign(qrJT.colsPermutation().indices().data(),
+                                          qrJT.colsPermutation().indices().data() + blockConstr);
+            block->nonzeroPivots = qrJT.nonzeroPivots();
+            block->maxPivot = qrJT.maxPivot();
+        }
+#ifdef EIGEN_SPARSEQR_COMPATIBLE
+        else if (qrAlgorithm==EigenSparseQR) {
+            Eigen::SparseMatrix<double> SJT = block->J.transpose().sparseView();
+            SJT.makeCompressed();
+            Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int> > SqrJT;
+            SqrJT.setPivotThreshold(pivotThreshold);
+            SqrJT.compute(SJT);
+            if (blockConstr >= blockParams)
+                block->R = SqrJT.matrixR().triangularView<Eigen::Upper>();
+            else
+                block->R = SqrJT.matrixR().topRows(blockConstr)
+                                .triangularView<Eigen::Upper>();
+            block->colsPermutation.assign(SqrJT.colsPermutation().indices().data(),
+                                          SqrJT.colsPermutation().indices().data() + blockConstr);
+            block->nonzeroPivots = SqrJT.rank();
+            block->maxPivot = 0.;
+        }
+#endif
+    }
 
-            // output of redundant tags
-            SET_I redundantTagsSet;
-            for (std::set<Constraint *>::iterator constr=redundant.begin();
-                 constr != redundant.end(); ++constr)
-                redundantTagsSet.insert((*constr)->getTag());
-            // remove tags represented at least in one non-redundant constraint
-            for (std::vector<Constraint *>::iterator constr=clist.begin();
-                constr != clist.end(); ++constr) {
-                if (redundant.count(*constr) == 0)
-                    redundantTagsSet.erase((*constr)->getTag());
+    // the dense QR compares the pivots with the largest pivot of the whole Jacobian
+    double maxPivot = 0.;
+    for (std::vector<DiagnosedComponent>::const_iterator block=blocks.begin(); block != blocks.end(); ++block)
+        maxPivot = std::max(maxPivot, fabs(block->maxPivot));
+
+    paramsNum = plist.size();
+    constrNum = clistJ.size();
+    rank = 0;
+    for (std::vector<DiagnosedComponent>::const_iterator block=blocks.begin(); block != blocks.end(); ++block) {
+        int blockConstr = block->J.rows();
+        int blockRank = 0;
+        if (block->qrAlgorithm==EigenDenseQR) {
+            for (int i=0; i < block->nonzeroPivots; i++) {
+                if (fabs(block->R(i,i)) > maxPivot * qrpivotThreshold)
+                    blockRank++;
             }
-            redundantTags.resize(redundantTagsSet.size());
-            std::copy(redundantTagsSet.begin(), redundantTagsSet.end(),
-                      redundantTags.begin());
+        }
+        else
+            blockRank = block->nonzeroPivots;
+        rank += blockRank;
 
-            if (paramsNum == rank && constrNum > rank) { // over-constrained
-                hasDiagnosis = true;
-                dofs = paramsNum - constrNum;
-                return dofs;
+        if (blockConstr > blockRank) { // conflicting or redundant constraints
+            Eigen::MatrixXd R = block->R;
+            for (int i=1; i < blockRank; i++) {
+                // eliminate non zeros above pivot
+                assert(R(i,i) != 0);
+                for (int row=0; row < i; row++) {
+                    if (R(row,i) != 0) {
+                        double coef=R(row,i)/R(i,i);
+                        R.block(row,i+1,1,blockConstr-i-1) -= coef * R.block(i,i+1,1,blockConstr-i-1);
+                        R(row,i) = 0;
+                    }
+                }
+            }
+            // same mapping from Jacobian rows to constraints as in diagnoseSystem()
+            for (int j=blockRank; j < blockConstr; j++) {
+                std::vector<Constraint *> group;
+                for (int row=0; row < blockRank; row++) {
+                    if (fabs(R(row,j)) > 1e-10)
+                        group.push_back(clist[block->rows[block->colsPermutation[row]]]);
+                }
+                group.push_back(clist[block->rows[block->colsPermutation[j]]]);
+                conflictGroups.push_back(group);
             }
         }
+    }
 
-        hasDiagnosis = true;
-        dofs = paramsNum - rank;
-        return dofs;
+    if(debugMode==IterationLevel) {
+        std::stringstream stream;
+        stream  << (qrAlgorithm==EigenSparseQR?"EigenSparseQR":(qrAlgorithm==EigenDenseQR?"DenseQR":""))
+                << ", Pivot Threshold: " << qrpivotThreshold
+                << ", Params: " << paramsNum
+                << ", Constr: " << constrNum
+                << ", Rank: "   << rank
+                << ", Components: " << blocks.size()
+                << ", Reused: " << reused << "\n";
+
+        const std::string tmp = stream.str();
+        printf(tmp.c_str());
     }
 
-    hasDiagnosis = true;
-    dofs = plist.size();
-    return dofs;
+    diagnosedComponents.swap(blocks);
 }
 
 void System::clearSubSystems()
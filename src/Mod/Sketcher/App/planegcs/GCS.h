@@ -62,6 +62,11 @@ namespace GCS
         EigenDenseQR = 0,
         EigenSparseQR = 1
     };
+
+    enum JacobianAlgorithm {
+        DenseJacobian = 0,  // dense Jacobian, LU based solves
+        SparseJacobian = 1  // sparse Jacobian, LDLT solves of the normal equations
+    };
     
     enum DebugMode {
         NoDebug = 0,
@@ -69,6 +74,22 @@ namespace GCS
         IterationLevel = 2
     };
 
+    // Jacobian block of a decoupled component and the QR decomposition of
+    // its transpose, as kept between two calls of System::diagnose()
+    struct DiagnosedComponent
+    {
+        std::vector<Constraint *> clist; // rows of the Jacobian block
+        VEC_pD plist;                    // columns of the Jacobian block
+        VEC_I rows;                      // row indices within the Jacobian of the whole system
+        Eigen::MatrixXd J;
+        QRAlgorithm qrAlgorithm;
+        double pivotThreshold;           // of the sparse QR
+        Eigen::MatrixXd R;               // upper triangular factor
+        VEC_I colsPermutation;
+        int nonzeroPivots;               // rank in case of the sparse QR
+        double maxPivot;                 // of the dense QR
+    };
+
     class System
     {
     // This is the main class. It holds all constraints and information
@@ -100,6 +121,12 @@ namespace GCS
         bool hasDiagnosis; // if dofs, conflictingTags, redundantTags are up to date
         bool isInit;       // if plists, clists, reductionmaps are up to date
 
+        std::vector<DiagnosedComponent> diagnosedComponents; // of the last incremental diagnosis
+        void diagnoseSystem(int &paramsNum, int &constrNum, int &rank,
+                            std::vector< std::vector<Constraint *> > &conflictGroups);
+        void diagnoseComponents(int &paramsNum, int &constrNum, int &rank,
+                                std::vector< std::vector<Constraint *> > &conflictGroups);
+
         int solve_BFGS(SubSystem *subsys, bool isFine=true, bool isRedundantsolving=false);
         int solve_LM(SubSystem *subsys, bool isRedundantsolving=false);
         int solve_DL(SubSystem *subsys, bool isRedundantsolving=false);
@@ -115,6 +142,9 @@ namespace GCS
         double convergence;
         double convergenceRedundant;
         QRAlgorithm qrAlgorithm;
+        JacobianAlgorithm jacobianAlgorithm; // used by LevenbergMarquardt and DogLeg
+        bool parallelSolving; // if true decoupled components are solved concurrently
+        bool incrementalDiagnosis; // if true the QR decompositions of unchanged components are reused
         DogLegGaussStep dogLegGaussStep;
         double qrpivotThreshold;
         DebugMode debugMode;
@@ -138,6 +168,8 @@ namespace GCS
 
         void clear();
         void clearByTag(int tagId);
+        void shiftTags(int tagId, int offset); // adds offset to all tags greater than tagId
+        void sortByTag();                      // stable sort of the constraints by their tags
 
         int addConstraint(Constraint *constr);
         void removeConstraint(Constraint *constr);
@@ -265,6 +297,7 @@ namespace GCS
         double getFinePrecision(){ return convergence;}
 
         int diagnose(Algorithm alg=DogLeg);
+        void invalidateDiagnosis() { hasDiagnosis = false; }
         int dofsNumber() const { return hasDiagnosis ? dofs : -1; }
         void getConflicting(VEC_I &conflictingOut) const
           { conflictingOut = hasDiagnosis ? conflictingTags : VEC_I(0); }
@@ -275,6 +275,22 @@ void SubSystem::calcJacobi(Eigen::MatrixXd &jacobi)
     calcJacobi(plist, jacobi);
 }
 
+void SubSystem::calcJacobi(Eigen::SparseMatrix<double> &jacobi)
+{
+    // only the parameters a constraint depends on give a non-zero entry,
+    // the column of a parameter in pvals is its position in plist
+    std::vector<Eigen::Triplet<double> > entries;
+    for (int i=0; i < csize; i++) {
+        VEC_pD &cparams = c2p[clist[i]];
+        for (VEC_pD::const_iterator param=cparams.begin();
+             param != cparams.end(); ++param)
+            entries.push_back(Eigen::Triplet<double>(i, int(*param - &pvals[0]),
+                                                     clist[i]->grad(*param)));
+    }
+    jacobi.resize(csize, psize);
+    jacobi.setFromTriplets(entries.begin(), entries.end());
+}
+
 void SubSystem::calcGrad(VEC_pD &params, Eigen::VectorXd &grad)
 {
     assert(grad.size() == int(params.size()));
@@ -27,6 +27,7 @@
 #undef max
 
 #include <Eigen/Core>
+#include <Eigen/Sparse>
 #include "Constraints.h"
 
 namespace GCS
@@ -71,6 +72,7 @@ namespace GCS
         void calcResidual(Eigen::VectorXd &r, double &err);
         void calcJacobi(VEC_pD &params, Eigen::MatrixXd &jacobi);
         void calcJacobi(Eigen::MatrixXd &jacobi);
+        void calcJacobi(Eigen::SparseMatrix<double> &jacobi);
         void calcGrad(VEC_pD &params, Eigen::VectorXd &grad);
         void calcGrad(Eigen::VectorXd &grad);
 
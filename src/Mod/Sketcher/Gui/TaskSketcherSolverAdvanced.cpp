@@ -55,6 +55,10 @@
 #define DEFAULT_SOLVER 2            // DL=2, LM=1, BFGS=0
 #define DEFAULT_RSOLVER 2           // DL=2, LM=1, BFGS=0
 #define DEFAULT_QRSOLVER 1          // DENSE=0, SPARSEQR=1
+#define DEFAULT_JACOBIAN 0          // DENSE=0, SPARSE=1
+#define PARALLEL_SOLVING false
+#define INCREMENTAL_SETUP false
+#define INCREMENTAL_DIAGNOSIS false
 #define QR_PIVOT_THRESHOLD 1E-13    // under this value a Jacobian value is regarded as zero
 #define DEFAULT_SOLVER_DEBUG 1      // None=0, Minimal=1, IterationLevel=2
 #define MAX_ITER_MULTIPLIER false
@@ -81,6 +85,10 @@ TaskSketcherSolverAdvanced::TaskSketcherSolverAdvanced(ViewProviderSketch *sketc
     ui->checkBoxSketchSizeMultiplier->onRestore();
     ui->lineEditConvergence->onRestore();
     ui->comboBoxQRMethod->onRestore();
+    ui->comboBoxJacobian->onRestore();
+    ui->checkBoxParallelSolving->onRestore();
+    ui->checkBoxIncrementalSetUp->onRestore();
+    ui->checkBoxIncrementalDiagnosis->onRestore();
     ui->lineEditQRPivotThreshold->onRestore();
     ui->comboBoxRedundantDefaultSolver->onRestore();
     ui->spinBoxRedundantSolverMaxIterations->onRestore();
@@ -476,6 +484,48 @@ void TaskSketcherSolverAdvanced::on_comboBoxQRMethod_currentIndexChanged(int ind
     ui->comboBoxQRMethod->onSave();
 }
 
+void TaskSketcherSolverAdvanced::on_comboBoxJacobian_currentIndexChanged(int index)
+{
+    sketchView->getSketchObject()->getSolvedSketch().setJacobianAlgorithm((GCS::JacobianAlgorithm) index);
+    ui->comboBoxJacobian->onSave();
+}
+
+void TaskSketcherSolverAdvanced::on_checkBoxParallelSolving_stateChanged(int state)
+{
+    if(state==Qt::Checked) {
+        ui->checkBoxParallelSolving->onSave();
+        sketchView->getSketchObject()->getSolvedSketch().setParallelSolving(true);
+    }
+    else if (state==Qt::Unchecked) {
+        ui->checkBoxParallelSolving->onSave();
+        sketchView->getSketchObject()->getSolvedSketch().setParallelSolving(false);
+    }
+}
+
+void TaskSketcherSolverAdvanced::on_checkBoxIncrementalSetUp_stateChanged(int state)
+{
+    if(state==Qt::Checked) {
+        ui->checkBoxIncrementalSetUp->onSave();
+        sketchView->getSketchObject()->getSolvedSketch().setIncrementalSetUp(true);
+    }
+    else if (state==Qt::Unchecked) {
+        ui->checkBoxIncrementalSetUp->onSave();
+        sketchView->getSketchObject()->getSolvedSketch().setIncrementalSetUp(false);
+    }
+}
+
+void TaskSketcherSolverAdvanced::on_checkBoxIncrementalDiagnosis_stateChanged(int state)
+{
+    if(state==Qt::Checked) {
+        ui->checkBoxIncrementalDiagnosis->onSave();
+        sketchView->getSketchObject()->getSolvedSketch().setIncrementalDiagnosis(true);
+    }
+    else if (state==Qt::Unchecked) {
+        ui->checkBoxIncrementalDiagnosis->onSave();
+        sketchView->getSketchObject()->getSolvedSketch().setIncrementalDiagnosis(false);
+    }
+}
+
 void TaskSketcherSolverAdvanced::on_comboBoxRedundantDefaultSolver_currentIndexChanged(int index)
 {
     ui->comboBoxRedundantDefaultSolver->onSave();
@@ -542,6 +592,10 @@ void TaskSketcherSolverAdvanced::on_pushButtonDefaults_clicked(bool checked/* =
     hGrp->SetASCII("Convergence",QString::number(CONVERGENCE).toUtf8());
     hGrp->SetASCII("RedundantConvergence",QString::number(CONVERGENCE).toUtf8());
     hGrp->SetInt("QRMethod",DEFAULT_QRSOLVER);
+    hGrp->SetInt("JacobianAlgorithm",DEFAULT_JACOBIAN);
+    hGrp->SetBool("ParallelSolving",PARALLEL_SOLVING);
+    hGrp->SetBool("IncrementalSetUp",INCREMENTAL_SETUP);
+    hGrp->SetBool("IncrementalDiagnosis",INCREMENTAL_DIAGNOSIS);
     hGrp->SetASCII("QRPivotThreshold",QString::number(QR_PIVOT_THRESHOLD).toUtf8());
     hGrp->SetInt("DebugMode",DEFAULT_SOLVER_DEBUG);
 
@@ -551,6 +605,10 @@ void TaskSketcherSolverAdvanced::on_pushButtonDefaults_clicked(bool checked/* =
     ui->checkBoxSketchSizeMultiplier->onRestore();
     ui->lineEditConvergence->onRestore();
     ui->comboBoxQRMethod->onRestore();
+    ui->comboBoxJacobian->onRestore();
+    ui->checkBoxParallelSolving->onRestore();
+    ui->checkBoxIncrementalSetUp->onRestore();
+    ui->checkBoxIncrementalDiagnosis->onRestore();
     ui->lineEditQRPivotThreshold->onRestore();
     ui->comboBoxRedundantDefaultSolver->onRestore();
     ui->spinBoxRedundantSolverMaxIterations->onRestore();
@@ -568,6 +626,10 @@ void TaskSketcherSolverAdvanced::updateSketchObject(void)
     sketchView->getSketchObject()->getSolvedSketch().setMaxIterRedundant(ui->spinBoxRedundantSolverMaxIterations->value());
     sketchView->getSketchObject()->getSolvedSketch().defaultSolverRedundant=(GCS::Algorithm) ui->comboBoxRedundantDefaultSolver->currentIndex();
     sketchView->getSketchObject()->getSolvedSketch().setQRAlgorithm((GCS::QRAlgorithm) ui->comboBoxQRMethod->currentIndex());
+    sketchView->getSketchObject()->getSolvedSketch().setJacobianAlgorithm((GCS::JacobianAlgorithm) ui->comboBoxJacobian->currentIndex());
+    sketchView->getSketchObject()->getSolvedSketch().setParallelSolving(ui->checkBoxParallelSolving->isChecked());
+    sketchView->getSketchObject()->getSolvedSketch().setIncrementalSetUp(ui->checkBoxIncrementalSetUp->isChecked());
+    sketchView->getSketchObject()->getSolvedSketch().setIncrementalDiagnosis(ui->checkBoxIncrementalDiagnosis->isChecked());
     sketchView->getSketchObject()->getSolvedSketch().setQRPivotThreshold(ui->lineEditQRPivotThreshold->text().toDouble());
     sketchView->getSketchObject()->getSolvedSketch().setConvergenceRedundant(ui->lineEditRedundantConvergence->text().toDouble());
     sketchView->getSketchObject()->getSolvedSketch().setConvergence(ui->lineEditConvergence->text().toDouble());
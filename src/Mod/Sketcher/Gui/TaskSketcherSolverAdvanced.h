@@ -53,6 +53,10 @@ private Q_SLOTS:
     void on_checkBoxSketchSizeMultiplier_stateChanged(int state);    
     void on_lineEditConvergence_editingFinished();
     void on_comboBoxQRMethod_currentIndexChanged(int index);
+    void on_comboBoxJacobian_currentIndexChanged(int index);
+    void on_checkBoxParallelSolving_stateChanged(int state);
+    void on_checkBoxIncrementalSetUp_stateChanged(int state);
+    void on_checkBoxIncrementalDiagnosis_stateChanged(int state);
     void on_lineEditQRPivotThreshold_editingFinished();
     void on_comboBoxRedundantDefaultSolver_currentIndexChanged(int index);
     void on_lineEditRedundantConvergence_editingFinished();
@@ -123,6 +123,33 @@ def CreateSlotPlateInnerSet(SketchFeature):
 	SketchFeature.addConstraint(Sketcher.Constraint('Coincident',8,2,5,1))
 	
 
+def CreateLadderSketch(sketch, count, chained=True):
+	# a row of squares drawn slightly off so that the solver has to move everything.
+	# If chained the bottom left corner of each square is attached to the top
+	# right corner of its predecessor, so that the squares form a staircase,
+	# otherwise each square is fixed on its own.
+	for k in range(count):
+		x = 10.0 * k + 0.3 * (k % 3)
+		h = 10.0 + 0.2 * (k % 5)
+		i = sketch.addGeometry(Part.LineSegment(FreeCAD.Vector(x,h,0),FreeCAD.Vector(x+h,h,0)))
+		sketch.addGeometry(Part.LineSegment(FreeCAD.Vector(x+h,h,0),FreeCAD.Vector(x+h,0,0)))
+		sketch.addGeometry(Part.LineSegment(FreeCAD.Vector(x+h,0,0),FreeCAD.Vector(x,0,0)))
+		sketch.addGeometry(Part.LineSegment(FreeCAD.Vector(x,0,0),FreeCAD.Vector(x,h,0)))
+		sketch.addConstraint(Sketcher.Constraint('Coincident',i+0,2,i+1,1))
+		sketch.addConstraint(Sketcher.Constraint('Coincident',i+1,2,i+2,1))
+		sketch.addConstraint(Sketcher.Constraint('Coincident',i+2,2,i+3,1))
+		sketch.addConstraint(Sketcher.Constraint('Coincident',i+3,2,i+0,1))
+		sketch.addConstraint(Sketcher.Constraint('Horizontal',i+0))
+		sketch.addConstraint(Sketcher.Constraint('Horizontal',i+2))
+		sketch.addConstraint(Sketcher.Constraint('Vertical',i+1))
+		sketch.addConstraint(Sketcher.Constraint('Vertical',i+3))
+		sketch.addConstraint(Sketcher.Constraint('Distance',i+0,10.0))
+		sketch.addConstraint(Sketcher.Constraint('Distance',i+1,10.0))
+		if k == 0 or not chained:
+			sketch.addConstraint(Sketcher.Constraint('DistanceX',i+2,2,10.0*k))
+			sketch.addConstraint(Sketcher.Constraint('DistanceY',i+2,2,0.0))
+		else:
+			sketch.addConstraint(Sketcher.Constraint('Coincident',i+2,2,i-3,1))
 
 #---------------------------------------------------------------------------
 # define the test cases to test the FreeCAD Sketcher module
@@ -155,6 +182,110 @@ class SketcherSolverTestCases(unittest.TestCase):
 		self.failUnless(len(self.Slot.Shape.Edges) == 9)
 	
 	
+	def testSparseJacobian(self):
+		# solves the same sketch with a dense and a sparse Jacobian
+		import time
+		count = 50
+		results = []
+		for sparse in (False, True):
+			sketch = Sketcher.Sketch()
+			CreateLadderSketch(sketch, count)
+			sketch.SparseJacobian = sparse
+			self.failUnless(sketch.SparseJacobian == sparse)
+			start = time.time()
+			self.failUnless(sketch.solve() == 0)
+			FreeCAD.Console.PrintMessage("Ladder of %d squares, sparse Jacobian %s: %f s\n" % (count, sparse, time.time() - start))
+			results.append([g.StartPoint for g in sketch.Geometries])
+		for dense, sparse in zip(results[0], results[1]):
+			self.failUnless(dense.distanceToPoint(sparse) < 1e-6)
+		# the top left corner of the last square of the staircase
+		self.failUnless(results[1][4*count-4].distanceToPoint(FreeCAD.Vector(10.0*(count-1),10.0*count,0)) < 1e-6)
+
+	def testParallelSolving(self):
+		# solves a sketch of decoupled squares serially and concurrently
+		import time
+		count = 200
+		results = []
+		for parallel in (False, True):
+			sketch = Sketcher.Sketch()
+			CreateLadderSketch(sketch, count, False)
+			sketch.ParallelSolving = parallel
+			self.failUnless(sketch.ParallelSolving == parallel)
+			start = time.time()
+			self.failUnless(sketch.solve() == 0)
+			FreeCAD.Console.PrintMessage("%d decoupled squares, parallel solving %s: %f s\n" % (count, parallel, time.time() - start))
+			results.append([g.StartPoint for g in sketch.Geometries])
+		# the results must not depend on the scheduling
+		for serial, parallel in zip(results[0], results[1]):
+			self.failUnless(serial == parallel)
+		self.failUnless(results[1][4*count-4].distanceToPoint(FreeCAD.Vector(10.0*(count-1),10.0,0)) < 1e-6)
+
+	def testIncrementalDiagnosis(self):
+		# edits a sketch of decoupled squares and compares the diagnosis of the
+		# whole sketch with the one that only looks at the changed squares
+		import time
+		count = 100
+		results = []
+		for incremental in (False, True):
+			sketch = Sketcher.Sketch()
+			CreateLadderSketch(sketch, count, False)
+			sketch.IncrementalDiagnosis = incremental
+			self.failUnless(sketch.IncrementalDiagnosis == incremental)
+			reports = [(sketch.solve(), sketch.Conflicts, sketch.Redundancies)]
+			start = time.time()
+			for k in range(0, count, 10):
+				# a redundant and a conflicting constraint
+				sketch.addConstraint(Sketcher.Constraint('Horizontal',4*k))
+				reports.append((sketch.solve(), sketch.Conflicts, sketch.Redundancies))
+				sketch.addConstraint(Sketcher.Constraint('Distance',4*k+2,12.0))
+				reports.append((sketch.solve(), sketch.Conflicts, sketch.Redundancies))
+			FreeCAD.Console.PrintMessage("%d decoupled squares, incremental diagnosis %s: %f s\n" % (count, incremental, time.time() - start))
+			results.append(reports)
+		self.failUnless(results[0] == results[1])
+		self.failUnless(len(results[1][-1][1]) > 0 and len(results[1][-1][2]) > 0)
+
+	def testIncrementalSetUp(self):
+		# builds up a sketch with a full and with an incremental set up of the solver
+		import time
+		grp = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Mod/Sketcher/SolverAdvanced")
+		old = grp.GetBool("IncrementalSetUp", False)
+		count = 20
+		results = []
+		try:
+			for incremental in (False, True):
+				grp.SetBool("IncrementalSetUp", incremental)
+				sketch = self.Doc.addObject('Sketcher::SketchObject','SketchSetUp')
+				status = []
+				setups = []
+				def solve():
+					setUpCount = sketch.IncrementalSetUpCount
+					status.append(sketch.solve())
+					setups.append(sketch.IncrementalSetUpCount - setUpCount)
+				start = time.time()
+				for k in range(count):
+					CreateRectangleSketch(sketch, [10.0*k, 0.0], [10.0, 5.0 + k])
+					solve()
+				# a redundant constraint and its removal
+				sketch.addConstraint(Sketcher.Constraint('Horizontal',0))
+				solve()
+				sketch.delConstraint(sketch.ConstraintCount-1)
+				solve()
+				# removing a constraint in the middle
+				sketch.delConstraint(4)
+				solve()
+				# only the very first set up has to be done from scratch
+				if incremental:
+					self.failUnless(min(setups[1:]) >= 1)
+				else:
+					self.failUnless(max(setups) == 0)
+				FreeCAD.Console.PrintMessage("%d rectangles, incremental set up %s: %f s\n" % (count, incremental, time.time() - start))
+				results.append((status, [g.StartPoint for g in sketch.Geometry]))
+		finally:
+			grp.SetBool("IncrementalSetUp", old)
+		self.failUnless(results[0][0] == results[1][0])
+		for full, incremental in zip(results[0][1], results[1][1]):
+			self.failUnless(full.distanceToPoint(incremental) < 1e-6)
+
 	def tearDown(self):
 		#closing doc
 		FreeCAD.closeDocument("SketchSolverTest")
@@ -22,7 +22,7 @@
 #*   Juergen Riegel 2003                                                   *
 #***************************************************************************/
 
-import FreeCAD, os, unittest, tempfile
+import FreeCAD, os, unittest, tempfile, time, zipfile
 
 
 #---------------------------------------------------------------------------
@@ -463,6 +463,42 @@ class DocumentSaveRestoreCases(unittest.TestCase):
     self.failUnless(len(Doc.Objects) == 1)
     FreeCAD.closeDocument("RestoreTests")
 
+  def testBinaryDocument(self):
+    # save the same document as XML and as binary Document.xml and compare open and save times
+    Doc = FreeCAD.newDocument("BinaryTests")
+    for i in range(2000):
+      obj = Doc.addObject("App::FeatureTest","Feature")
+      obj.Integer = i
+      obj.String = "<Test & \"%d\">" % i
+    Doc.Feature.Link = Doc.Feature001
+    param = FreeCAD.ParamGet("User parameter:BaseApp/Preferences/Document")
+    binary = param.GetBool("SaveBinaryDocument", False)
+    times = {}
+    try:
+      for mode in (False, True):
+        FileName = self.TempPath + os.sep + "BinaryTests%d.FCStd" % mode
+        param.SetBool("SaveBinaryDocument", mode)
+        start = time.time()
+        Doc.saveAs(FileName)
+        saved = time.time() - start
+        zip = zipfile.ZipFile(FileName)
+        head = zip.read("Document.xml")[:4]
+        zip.close()
+        self.failUnless((head == b"\0FCB") == mode)
+        start = time.time()
+        Doc.restore()
+        opened = time.time() - start
+        times[mode] = (saved, opened)
+        self.failUnless(len(Doc.Objects) == 2000)
+        self.failUnless(Doc.Feature1999.Integer == 1999)
+        self.failUnless(Doc.Feature1999.String == "<Test & \"1999\">")
+        self.failUnless(Doc.Feature.Link == Doc.Feature001)
+    finally:
+      param.SetBool("SaveBinaryDocument", binary)
+      FreeCAD.closeDocument("BinaryTests")
+    FreeCAD.Console.PrintLog("  XML document: save %.3f s, open %.3f s\n" % times[False])
+    FreeCAD.Console.PrintLog("  Binary document: save %.3f s, open %.3f s\n" % times[True])
+
   def testActiveDocument(self):
     # open 2nd doc
     Second = FreeCAD.newDocument("Active")
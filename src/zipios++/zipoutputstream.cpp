@@ -56,6 +56,12 @@ void ZipOutputStream::putNextEntry(const std::string& entryName) {
 }
 
 
+void ZipOutputStream::putRawEntry( const ZipCDirEntry &entry, const char *data, uint32 size,
+                                   uint32 crc, uint32 uncompressed_size, StorageMethod method ) {
+  ozf->putRawEntry( entry, data, size, crc, uncompressed_size, method ) ;
+}
+
+
 void ZipOutputStream::setComment( const std::string &comment ) {
   ozf->setComment( comment ) ;
 }
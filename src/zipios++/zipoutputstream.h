@@ -54,6 +54,11 @@ public:
   */
   void putNextEntry(const std::string& entryName);
 
+  /** Writes a complete, already compressed entry.
+      @see ZipOutputStreambuf::putRawEntry() */
+  void putRawEntry( const ZipCDirEntry &entry, const char *data, uint32 size,
+                    uint32 crc, uint32 uncompressed_size, StorageMethod method ) ;
+
   /** Sets the global comment for the Zip archive. */
   void setComment( const std::string& comment ) ;
 
@@ -81,6 +81,36 @@ void ZipOutputStreambuf::putNextEntry( const ZipCDirEntry &entry ) {
 }
 
 
+void ZipOutputStreambuf::putRawEntry( const ZipCDirEntry &entry, const char *data, uint32 size,
+                                      uint32 crc, uint32 uncompressed_size, StorageMethod method ) {
+  if ( _open_entry )
+    closeEntry() ;
+
+  _entries.push_back( entry ) ;
+  ZipCDirEntry &ent = _entries.back() ;
+
+  ostream os( _outbuf ) ;
+
+  time_t ltime;
+  time( &ltime );
+  struct tm *now;
+  now = localtime( &ltime );
+  int dosTime = (now->tm_year - 80) << 25 | (now->tm_mon + 1) << 21 | now->tm_mday << 16 |
+              now->tm_hour << 11 | now->tm_min << 5 | now->tm_sec >> 1;
+
+  // all sizes are known in advance, so the header never needs to be rewritten
+  ent.setLocalHeaderOffset( os.tellp() ) ;
+  ent.setMethod( method ) ;
+  ent.setSize( uncompressed_size ) ;
+  ent.setCompressedSize( size ) ;
+  ent.setCrc( crc ) ;
+  ent.setTime( dosTime ) ;
+
+  os << static_cast< ZipLocalEntry >( ent ) ;
+  os.write( data, size ) ;
+}
+
+
 void ZipOutputStreambuf::setComment( const string &comment ) {
   _zip_comment = comment ;
 }
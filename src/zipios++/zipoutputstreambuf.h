@@ -49,6 +49,18 @@ public:
       entry. */
   void putNextEntry( const ZipCDirEntry &entry ) ;
 
+  /** Writes a complete entry whose data has already been compressed (or
+      not, if method is STORED) by the caller, e.g. in another thread.
+      The entry is appended to the central directory in call order.
+      @param entry the entry to write.
+      @param data the (compressed) entry data.
+      @param size the number of bytes in data.
+      @param crc the CRC-32 of the uncompressed data.
+      @param uncompressed_size the size of the uncompressed data.
+      @param method the method that was used to produce data. */
+  void putRawEntry( const ZipCDirEntry &entry, const char *data, uint32 size,
+                    uint32 crc, uint32 uncompressed_size, StorageMethod method ) ;
+
   /** Sets the global comment for the Zip archive. */
   void setComment( const string &comment ) ;
 